@@ -19,6 +19,7 @@
 
 library ieee;
 use ieee.std_logic_1164.all;
+use work.CommonPckg.all;
 
 package fifoPckg is
 
@@ -53,6 +54,56 @@ package fifoPckg is
       );
   end component;
 
+  -- FIFO of any width and depth with common read and write clock.
+  component FifoSync is
+    generic (
+      DATA_WIDTH_G   : natural := 16;     -- width of the FIFO words
+      DEPTH_G        : natural := 256;    -- # of words in the FIFO (power of 2)
+      FWFT_G         : boolean := false;  -- if true, the next word is on data_o before it's read
+      ALMOST_FULL_G  : natural := 224;    -- almostFull_o is high when there are at least this many words
+      ALMOST_EMPTY_G : natural := 32      -- almostEmpty_o is high when there are no more than this many words
+      );
+    port (
+      clk_i         : in  std_logic;    -- master clock
+      rst_i         : in  std_logic := '0';  -- reset
+      rd_i          : in  std_logic := '0';  -- read fifo control
+      wr_i          : in  std_logic := '0';  -- write fifo control
+      data_i        : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- input data bus
+      data_o        : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- output data bus
+      full_o        : out std_logic;    -- fifo-full status
+      empty_o       : out std_logic;    -- fifo-empty status
+      almostFull_o  : out std_logic;    -- fifo level >= ALMOST_FULL_G
+      almostEmpty_o : out std_logic;    -- fifo level <= ALMOST_EMPTY_G
+      level_o       : out std_logic_vector(Log2(DEPTH_G) downto 0)  -- fifo level
+      );
+  end component;
+
+  -- FIFO of any width and depth with independent read and write clocks.
+  component FifoAsync is
+    generic (
+      DATA_WIDTH_G   : natural := 16;     -- width of the FIFO words
+      DEPTH_G        : natural := 256;    -- # of words in the FIFO (power of 2)
+      FWFT_G         : boolean := false;  -- if true, the next word is on data_o before it's read
+      ALMOST_FULL_G  : natural := 224;    -- almostFull_o is high when there are at least this many words
+      ALMOST_EMPTY_G : natural := 32      -- almostEmpty_o is high when there are no more than this many words
+      );
+    port (
+      rdClk_i       : in  std_logic;    -- clock for reading from the FIFO
+      wrClk_i       : in  std_logic;    -- clock for writing to the FIFO
+      rst_i         : in  std_logic := '0';  -- reset
+      rd_i          : in  std_logic := '0';  -- read fifo control
+      wr_i          : in  std_logic := '0';  -- write fifo control
+      data_i        : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- input data bus
+      data_o        : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- output data bus
+      full_o        : out std_logic;    -- fifo-full status (write clock)
+      empty_o       : out std_logic;    -- fifo-empty status (read clock)
+      almostFull_o  : out std_logic;    -- fifo level >= ALMOST_FULL_G (write clock)
+      almostEmpty_o : out std_logic;    -- fifo level <= ALMOST_EMPTY_G (read clock)
+      wrLevel_o     : out std_logic_vector(Log2(DEPTH_G) downto 0);  -- fifo level seen from the write side
+      rdLevel_o     : out std_logic_vector(Log2(DEPTH_G) downto 0)   -- fifo level seen from the read side
+      );
+  end component;
+
 end package;
 
 
@@ -225,3 +276,311 @@ begin
   level_o <= level_s;
 
 end architecture;
+
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CommonPckg.all;
+
+--**********************************************************************
+-- FIFO of any width and depth with common read and write clock.
+--
+-- In standard mode, the word appears on data_o on the clock after rd_i
+-- is raised. In first-word-fall-through mode (FWFT_G = true), the word
+-- at the head of the FIFO is already on data_o whenever empty_o is low
+-- and raising rd_i moves to the next one. The level includes the word
+-- waiting on data_o.
+--
+-- almostFull_o and almostEmpty_o come from registers that change along
+-- with level_o, so a producer or consumer can check for room for a whole
+-- burst (or a whole burst waiting) with a single flag.
+--**********************************************************************
+entity FifoSync is
+  generic (
+    DATA_WIDTH_G   : natural := 16;       -- width of the FIFO words
+    DEPTH_G        : natural := 256;      -- # of words in the FIFO (power of 2)
+    FWFT_G         : boolean := false;    -- if true, the next word is on data_o before it's read
+    ALMOST_FULL_G  : natural := 224;      -- almostFull_o is high when there are at least this many words
+    ALMOST_EMPTY_G : natural := 32        -- almostEmpty_o is high when there are no more than this many words
+    );
+  port (
+    clk_i         : in  std_logic;      -- master clock
+    rst_i         : in  std_logic := NO;  -- reset
+    rd_i          : in  std_logic := NO;  -- read fifo control
+    wr_i          : in  std_logic := NO;  -- write fifo control
+    data_i        : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- input data bus
+    data_o        : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- output data bus
+    full_o        : out std_logic;      -- fifo-full status
+    empty_o       : out std_logic;      -- fifo-empty status
+    almostFull_o  : out std_logic;      -- fifo level >= ALMOST_FULL_G
+    almostEmpty_o : out std_logic;      -- fifo level <= ALMOST_EMPTY_G
+    level_o       : out std_logic_vector(Log2(DEPTH_G) downto 0)  -- fifo level
+    );
+end entity;
+
+architecture arch of FifoSync is
+  constant ADDR_WIDTH_C : natural := Log2(DEPTH_G);
+  subtype Ptr_t is unsigned(ADDR_WIDTH_C downto 0);  -- RAM address plus a wrap-around bit.
+  signal rdPtr_r       : Ptr_t     := (others => ZERO);
+  signal wrPtr_r       : Ptr_t     := (others => ZERO);
+  signal ramLevel_s    : Ptr_t;     -- # of words in the RAM.
+  signal ramEmpty_s    : std_logic;
+  signal full_s        : std_logic;
+  signal outValid_r    : std_logic := NO;  -- a word is waiting on data_o (FWFT only).
+  signal rdAllow_s     : std_logic;  -- take a word out of the RAM.
+  signal wrAllow_s     : std_logic;  -- put a word into the RAM.
+  signal rdDone_s      : std_logic;  -- the host has read a word.
+  signal level_r       : Ptr_t     := (others => ZERO);
+  signal almostFull_r  : std_logic := NO;
+  signal almostEmpty_r : std_logic := YES;
+  subtype RamWord_t is std_logic_vector(data_i'range);  -- RAM word type.
+  type Ram_t is array (0 to DEPTH_G-1) of RamWord_t;  -- array of RAM words type.
+  signal ram_r         : Ram_t;     -- RAM declaration.
+begin
+
+  -- the read and write addresses wrap around at 2**ADDR_WIDTH_C.
+  assert 2**ADDR_WIDTH_C = DEPTH_G
+    report "FifoSync: DEPTH_G has to be a power of 2." severity failure;
+
+  -- Inferred dual-port RAM.
+  process (clk_i)
+  begin
+    if rising_edge(clk_i) then
+      if wrAllow_s = YES then
+        ram_r(to_integer(wrPtr_r(ADDR_WIDTH_C-1 downto 0))) <= data_i;
+      end if;
+      if rdAllow_s = YES then
+        data_o <= ram_r(to_integer(rdPtr_r(ADDR_WIDTH_C-1 downto 0)));
+      end if;
+    end if;
+  end process;
+
+  ramLevel_s <= wrPtr_r - rdPtr_r;
+  ramEmpty_s <= YES when ramLevel_s = 0       else NO;
+  full_s     <= YES when ramLevel_s = DEPTH_G else NO;
+
+  -- In FWFT mode, the RAM is read whenever data_o is empty or being read.
+  wrAllow_s <= wr_i and not full_s;
+  rdAllow_s <= not ramEmpty_s and (rd_i or not outValid_r) when FWFT_G else rd_i and not ramEmpty_s;
+  rdDone_s  <= rd_i and outValid_r                         when FWFT_G else rdAllow_s;
+
+  process (clk_i, rst_i)
+    variable level_v : Ptr_t;
+  begin
+    if rst_i = YES then
+      rdPtr_r       <= (others => ZERO);
+      wrPtr_r       <= (others => ZERO);
+      outValid_r    <= NO;
+      level_r       <= (others => ZERO);
+      almostFull_r  <= NO;
+      almostEmpty_r <= YES;
+    elsif rising_edge(clk_i) then
+      if rdAllow_s = YES then
+        rdPtr_r <= rdPtr_r + 1;
+      end if;
+      if wrAllow_s = YES then
+        wrPtr_r <= wrPtr_r + 1;
+      end if;
+      if FWFT_G then
+        if rdAllow_s = YES then
+          outValid_r <= YES;
+        elsif rd_i = YES then
+          outValid_r <= NO;
+        end if;
+      end if;
+      level_v := level_r;
+      if (wrAllow_s and not rdDone_s) = YES then
+        level_v := level_v + 1;
+      elsif (rdDone_s and not wrAllow_s) = YES then
+        level_v := level_v - 1;
+      end if;
+      level_r       <= level_v;
+      almostFull_r  <= BooleanToStdLogic(level_v >= ALMOST_FULL_G);
+      almostEmpty_r <= BooleanToStdLogic(level_v <= ALMOST_EMPTY_G);
+    end if;
+  end process;
+
+  full_o        <= full_s;
+  empty_o       <= not outValid_r when FWFT_G else ramEmpty_s;
+  almostFull_o  <= almostFull_r;
+  almostEmpty_o <= almostEmpty_r;
+  level_o       <= std_logic_vector(level_r);
+
+end architecture;
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CommonPckg.all;
+
+--**********************************************************************
+-- FIFO of any width and depth with independent read and write clocks.
+--
+-- The read and write addresses are passed between the clock domains as
+-- Gray codes through a pair of registers, so full_o, almostFull_o and
+-- wrLevel_o (write clock) and empty_o, almostEmpty_o and rdLevel_o
+-- (read clock) can lag the other side by a few clocks. They are always
+-- on the safe side: the FIFO can look fuller to the writer and emptier
+-- to the reader than it really is. FWFT_G works as in FifoSync.
+--**********************************************************************
+entity FifoAsync is
+  generic (
+    DATA_WIDTH_G   : natural := 16;       -- width of the FIFO words
+    DEPTH_G        : natural := 256;      -- # of words in the FIFO (power of 2)
+    FWFT_G         : boolean := false;    -- if true, the next word is on data_o before it's read
+    ALMOST_FULL_G  : natural := 224;      -- almostFull_o is high when there are at least this many words
+    ALMOST_EMPTY_G : natural := 32        -- almostEmpty_o is high when there are no more than this many words
+    );
+  port (
+    rdClk_i       : in  std_logic;      -- clock for reading from the FIFO
+    wrClk_i       : in  std_logic;      -- clock for writing to the FIFO
+    rst_i         : in  std_logic := NO;  -- reset
+    rd_i          : in  std_logic := NO;  -- read fifo control
+    wr_i          : in  std_logic := NO;  -- write fifo control
+    data_i        : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- input data bus
+    data_o        : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- output data bus
+    full_o        : out std_logic;      -- fifo-full status (write clock)
+    empty_o       : out std_logic;      -- fifo-empty status (read clock)
+    almostFull_o  : out std_logic;      -- fifo level >= ALMOST_FULL_G (write clock)
+    almostEmpty_o : out std_logic;      -- fifo level <= ALMOST_EMPTY_G (read clock)
+    wrLevel_o     : out std_logic_vector(Log2(DEPTH_G) downto 0);  -- fifo level seen from the write side
+    rdLevel_o     : out std_logic_vector(Log2(DEPTH_G) downto 0)   -- fifo level seen from the read side
+    );
+end entity;
+
+architecture arch of FifoAsync is
+  constant ADDR_WIDTH_C : natural := Log2(DEPTH_G);
+  subtype Ptr_t is unsigned(ADDR_WIDTH_C downto 0);  -- RAM address plus a wrap-around bit.
+  subtype GrayPtr_t is std_logic_vector(ADDR_WIDTH_C downto 0);
+  -- Write side.
+  signal wrPtr_r         : Ptr_t     := (others => ZERO);
+  signal grayWrPtr_r     : GrayPtr_t := (others => ZERO);
+  signal grayRdPtrWr1_r  : GrayPtr_t := (others => ZERO);  -- read address crossing into the write clock domain.
+  signal grayRdPtrWr2_r  : GrayPtr_t := (others => ZERO);
+  signal wrLevel_s       : Ptr_t;
+  signal full_s          : std_logic;
+  signal wrAllow_s       : std_logic;
+  signal almostFull_r    : std_logic := NO;
+  -- Read side.
+  signal rdPtr_r         : Ptr_t     := (others => ZERO);
+  signal grayRdPtr_r     : GrayPtr_t := (others => ZERO);
+  signal grayWrPtrRd1_r  : GrayPtr_t := (others => ZERO);  -- write address crossing into the read clock domain.
+  signal grayWrPtrRd2_r  : GrayPtr_t := (others => ZERO);
+  signal ramLevel_s      : Ptr_t;   -- # of words in the RAM seen from the read side.
+  signal ramEmpty_s      : std_logic;
+  signal outValid_r      : std_logic := NO;  -- a word is waiting on data_o (FWFT only).
+  signal rdAllow_s       : std_logic;
+  signal almostEmpty_r   : std_logic := YES;
+  subtype RamWord_t is std_logic_vector(data_i'range);  -- RAM word type.
+  type Ram_t is array (0 to DEPTH_G-1) of RamWord_t;  -- array of RAM words type.
+  signal ram_r           : Ram_t;   -- RAM declaration.
+begin
+
+  -- the read and write addresses wrap around at 2**ADDR_WIDTH_C.
+  assert 2**ADDR_WIDTH_C = DEPTH_G
+    report "FifoAsync: DEPTH_G has to be a power of 2." severity failure;
+
+  -- Inferred dual-port RAM with a write port and a read port on different clocks.
+  process (wrClk_i)
+  begin
+    if rising_edge(wrClk_i) then
+      if wrAllow_s = YES then
+        ram_r(to_integer(wrPtr_r(ADDR_WIDTH_C-1 downto 0))) <= data_i;
+      end if;
+    end if;
+  end process;
+
+  process (rdClk_i)
+  begin
+    if rising_edge(rdClk_i) then
+      if rdAllow_s = YES then
+        data_o <= ram_r(to_integer(rdPtr_r(ADDR_WIDTH_C-1 downto 0)));
+      end if;
+    end if;
+  end process;
+
+  --**********************************************************************
+  -- Write side.
+  --**********************************************************************
+  wrLevel_s <= wrPtr_r - unsigned(GrayToBinary(grayRdPtrWr2_r));
+  full_s    <= YES when wrLevel_s = DEPTH_G else NO;
+  wrAllow_s <= wr_i and not full_s;
+
+  process (wrClk_i, rst_i)
+    variable wrPtr_v : Ptr_t;
+  begin
+    if rst_i = YES then
+      wrPtr_r        <= (others => ZERO);
+      grayWrPtr_r    <= (others => ZERO);
+      grayRdPtrWr1_r <= (others => ZERO);
+      grayRdPtrWr2_r <= (others => ZERO);
+      almostFull_r   <= NO;
+    elsif rising_edge(wrClk_i) then
+      grayRdPtrWr1_r <= grayRdPtr_r;
+      grayRdPtrWr2_r <= grayRdPtrWr1_r;
+      wrPtr_v        := wrPtr_r;
+      if wrAllow_s = YES then
+        wrPtr_v := wrPtr_v + 1;
+      end if;
+      wrPtr_r      <= wrPtr_v;
+      grayWrPtr_r  <= BinaryToGray(std_logic_vector(wrPtr_v));
+      almostFull_r <= BooleanToStdLogic(wrPtr_v - unsigned(GrayToBinary(grayRdPtrWr2_r)) >= ALMOST_FULL_G);
+    end if;
+  end process;
+
+  full_o       <= full_s;
+  almostFull_o <= almostFull_r;
+  wrLevel_o    <= std_logic_vector(wrLevel_s);
+
+  --**********************************************************************
+  -- Read side.
+  --**********************************************************************
+  ramLevel_s <= unsigned(GrayToBinary(grayWrPtrRd2_r)) - rdPtr_r;
+  ramEmpty_s <= YES when ramLevel_s = 0 else NO;
+  rdAllow_s  <= not ramEmpty_s and (rd_i or not outValid_r) when FWFT_G else rd_i and not ramEmpty_s;
+
+  process (rdClk_i, rst_i)
+    variable rdPtr_v    : Ptr_t;
+    variable outValid_v : std_logic;
+  begin
+    if rst_i = YES then
+      rdPtr_r        <= (others => ZERO);
+      grayRdPtr_r    <= (others => ZERO);
+      grayWrPtrRd1_r <= (others => ZERO);
+      grayWrPtrRd2_r <= (others => ZERO);
+      outValid_r     <= NO;
+      almostEmpty_r  <= YES;
+    elsif rising_edge(rdClk_i) then
+      grayWrPtrRd1_r <= grayWrPtr_r;
+      grayWrPtrRd2_r <= grayWrPtrRd1_r;
+      rdPtr_v        := rdPtr_r;
+      if rdAllow_s = YES then
+        rdPtr_v := rdPtr_v + 1;
+      end if;
+      outValid_v := NO;
+      if FWFT_G then
+        outValid_v := outValid_r;
+        if rdAllow_s = YES then
+          outValid_v := YES;
+        elsif rd_i = YES then
+          outValid_v := NO;
+        end if;
+      end if;
+      rdPtr_r       <= rdPtr_v;
+      grayRdPtr_r   <= BinaryToGray(std_logic_vector(rdPtr_v));
+      outValid_r    <= outValid_v;
+      almostEmpty_r <= BooleanToStdLogic(unsigned(GrayToBinary(grayWrPtrRd2_r)) - rdPtr_v
+                                         + IntSelect(outValid_v = YES, 1, 0) <= ALMOST_EMPTY_G);
+    end if;
+  end process;
+
+  empty_o       <= not outValid_r when FWFT_G else ramEmpty_s;
+  almostEmpty_o <= almostEmpty_r;
+  rdLevel_o     <= std_logic_vector(ramLevel_s + 1) when outValid_r = YES else std_logic_vector(ramLevel_s);
+
+end architecture;
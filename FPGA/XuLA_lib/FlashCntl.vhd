@@ -19,6 +19,24 @@
 
 ----------------------------------------------------------------------------------
 -- Flash controller.
+--
+-- Raising h_stream starts a streaming read at h_addr: the fast read command
+-- and address are sent once and then bytes are read from the flash one after
+-- another for as long as h_stream stays high. Each byte is placed on h_do
+-- and h_valid goes high until the host takes it by raising h_ready. If the
+-- host doesn't take a byte before the next one is ready, SCLK stops until
+-- it does. The bits are shifted at half the master clock frequency with no
+-- gaps between bytes. Lowering h_stream ends the read after the current
+-- byte and h_done goes high for a cycle.
+--
+-- The block RAM holds two pages. The host loads one page with h_wr while the
+-- other is programmed into the flash, so once h_begun goes high for a block
+-- program the host can start loading the next page. (The next h_blk_pgm waits
+-- until the previous page is programmed.)
+--
+-- Raising h_sector_erase erases just the 4 KB sector (or 64 KB block if
+-- BLOCK_ERASE_G is true) that holds h_addr instead of the whole chip. The
+-- sector is read first and the erase is skipped if it's already blank.
 --------------------------------------------------------------------
 
 library IEEE;
@@ -28,28 +46,33 @@ package FlashCntlPckg is
 
   component FlashCntl
     generic(
-      DATA_WIDTH_G : natural := 8;        -- data width of Flash chip
-      ADDR_WIDTH_G : natural := 24;       -- address width of Flash chip
-      BLOCK_SIZE_G : natural := 256  -- size of RAM block that buffers data programmed into Flash
+      DATA_WIDTH_G  : natural := 8;        -- data width of Flash chip
+      ADDR_WIDTH_G  : natural := 24;       -- address width of Flash chip
+      BLOCK_SIZE_G  : natural := 256;  -- size of RAM block that buffers data programmed into Flash
+      BLOCK_ERASE_G : boolean := false  -- if true, sector erase works on 64 KB blocks instead of 4 KB sectors
       );
     port(
-      reset         : in  std_logic;    -- reset input
-      clk           : in  std_logic;    -- main clock input
-      h_rd          : in  std_logic;    -- read enable
-      h_rd_continue : in  std_logic;    -- enable contiguous reads
-      h_wr          : in  std_logic;    -- port A write enable
-      h_erase       : in  std_logic;    -- flash chip erase enable
-      h_blk_pgm     : in  std_logic;    -- block program enable
-      h_addr        : in  std_logic_vector(ADDR_WIDTH_G-1 downto 0);  -- address for read/write
-      h_di          : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from JTAG instr. unit
-      h_do          : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data output from flash
-      h_begun       : out std_logic;    -- true when flash operation begun
-      h_busy        : out std_logic;    -- true when operation in progress
-      h_done        : out std_logic;    -- true when flash operation done
-      f_cs_n        : out std_logic;    -- flash chip-enable
-      sclk          : out std_logic;    -- serial data clock
-      si            : in  std_logic;    -- serial data input
-      so            : out std_logic     -- serial data output
+      reset          : in  std_logic;    -- reset input
+      clk            : in  std_logic;    -- main clock input
+      h_rd           : in  std_logic;    -- read enable
+      h_rd_continue  : in  std_logic;    -- enable contiguous reads
+      h_stream       : in  std_logic := '0';  -- enable streaming read
+      h_wr           : in  std_logic;    -- port A write enable
+      h_erase        : in  std_logic;    -- flash chip erase enable
+      h_sector_erase : in  std_logic := '0';  -- flash sector erase enable
+      h_blk_pgm      : in  std_logic;    -- block program enable
+      h_addr         : in  std_logic_vector(ADDR_WIDTH_G-1 downto 0);  -- address for read/write
+      h_di           : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from JTAG instr. unit
+      h_do           : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data output from flash
+      h_valid        : out std_logic;    -- true when a streamed byte is on h_do
+      h_ready        : in  std_logic := '1';  -- host takes the streamed byte on h_do
+      h_begun        : out std_logic;    -- true when flash operation begun
+      h_busy         : out std_logic;    -- true when operation in progress
+      h_done         : out std_logic;    -- true when flash operation done
+      f_cs_n         : out std_logic;    -- flash chip-enable
+      sclk           : out std_logic;    -- serial data clock
+      si             : in  std_logic;    -- serial data input
+      so             : out std_logic     -- serial data output
       );
   end component;
 end package;
@@ -69,28 +92,33 @@ use UNISIM.VComponents.all;
 
 entity FlashCntl is
   generic(
-    DATA_WIDTH_G : natural := 8;          -- data width of Flash chip
-    ADDR_WIDTH_G : natural := 24;         -- address width of Flash chip
-    BLOCK_SIZE_G : natural := 256  -- size of RAM block that buffers data programmed into Flash
+    DATA_WIDTH_G  : natural := 8;          -- data width of Flash chip
+    ADDR_WIDTH_G  : natural := 24;         -- address width of Flash chip
+    BLOCK_SIZE_G  : natural := 256;  -- size of RAM block that buffers data programmed into Flash
+    BLOCK_ERASE_G : boolean := false  -- if true, sector erase works on 64 KB blocks instead of 4 KB sectors
     );
   port(
-    reset         : in  std_logic;      -- reset input
-    clk           : in  std_logic;      -- main clock input
-    h_rd          : in  std_logic;      -- read enable
-    h_rd_continue : in  std_logic;      -- enable contiguous reads
-    h_wr          : in  std_logic;      -- port A write enable
-    h_erase       : in  std_logic;      -- flash chip erase enable
-    h_blk_pgm     : in  std_logic;      -- block program enable
-    h_addr        : in  std_logic_vector(ADDR_WIDTH_G-1 downto 0);  -- address for read/write
-    h_di          : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from JTAG instr. unit
-    h_do          : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data output from flash
-    h_begun       : out std_logic;      -- true when flash operation begun
-    h_busy        : out std_logic;      -- true when operation in progress
-    h_done        : out std_logic;      -- true when flash operation done
-    f_cs_n        : out std_logic;      -- flash chip-enable
-    sclk          : out std_logic;      -- serial data clock
-    si            : in  std_logic;      -- serial data input
-    so            : out std_logic       -- serial data output
+    reset          : in  std_logic;      -- reset input
+    clk            : in  std_logic;      -- main clock input
+    h_rd           : in  std_logic;      -- read enable
+    h_rd_continue  : in  std_logic;      -- enable contiguous reads
+    h_stream       : in  std_logic := '0';  -- enable streaming read
+    h_wr           : in  std_logic;      -- port A write enable
+    h_erase        : in  std_logic;      -- flash chip erase enable
+    h_sector_erase : in  std_logic := '0';  -- flash sector erase enable
+    h_blk_pgm      : in  std_logic;      -- block program enable
+    h_addr         : in  std_logic_vector(ADDR_WIDTH_G-1 downto 0);  -- address for read/write
+    h_di           : in  std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from JTAG instr. unit
+    h_do           : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data output from flash
+    h_valid        : out std_logic;      -- true when a streamed byte is on h_do
+    h_ready        : in  std_logic := '1';  -- host takes the streamed byte on h_do
+    h_begun        : out std_logic;      -- true when flash operation begun
+    h_busy         : out std_logic;      -- true when operation in progress
+    h_done         : out std_logic;      -- true when flash operation done
+    f_cs_n         : out std_logic;      -- flash chip-enable
+    sclk           : out std_logic;      -- serial data clock
+    si             : in  std_logic;      -- serial data input
+    so             : out std_logic       -- serial data output
     );
 end entity;
 
@@ -102,6 +130,8 @@ architecture arch of FlashCntl is
   subtype cmd is std_logic_vector(DATA_WIDTH_G-1 downto 0);
   constant WRITE_ENABLE_CMD   : cmd := "00000110";
   constant CHIP_ERASE_CMD     : cmd := "11000111";
+  constant SECTOR_ERASE_CMD   : cmd := "00100000";
+  constant BLOCK_ERASE_CMD    : cmd := "11011000";
   constant PAGE_PROGRAM_CMD   : cmd := "00000010";
   constant READ_DATA_CMD      : cmd := "00000011";
   constant FAST_READ_CMD      : cmd := "00001011";
@@ -110,19 +140,26 @@ architecture arch of FlashCntl is
 
   constant BUSY_BIT : natural := 0;  -- position of BUSY bit in flash status register
 
+  constant ERASE_SIZE : natural := IntSelect(BLOCK_ERASE_G, 65536, 4096);  -- # of bytes cleared by a sector erase
+
   -- States of the flash controller FSM.
   type cntlState is (
     RAM_BLK_INIT,
+    RAM_BLK_INIT_2,
     FLASH_NOP,
     FLASH_ERASE, FLASH_ERASE_2, FLASH_ERASE_3, FLASH_ERASE_4, FLASH_ERASE_5,
+    FLASH_BLANK_CHK, FLASH_BLANK_CHK_2,
+    FLASH_SECTOR_ERASE, FLASH_SECTOR_ERASE_2, FLASH_SECTOR_ERASE_3, FLASH_SECTOR_ERASE_4, FLASH_SECTOR_ERASE_5,
     FLASH_BLK_PGM, FLASH_BLK_PGM_2, FLASH_BLK_PGM_3, FLASH_BLK_PGM_4, FLASH_BLK_PGM_5,
     FLASH_BLK_PGM_6, FLASH_BLK_PGM_7, FLASH_BLK_PGM_8, FLASH_BLK_PGM_9, FLASH_BLK_PGM_10,
     FLASH_READ, FLASH_READ_2, FLASH_READ_3, FLASH_READ_4, FLASH_READ_5, FLASH_READ_6, FLASH_READ_7, FLASH_READ_DUMMY,
+    FLASH_STREAM, FLASH_STREAM_2, FLASH_STREAM_3, FLASH_STREAM_FULL,
     FLASH_IO_WAIT, FLASH_IO_WAIT_2,
     FLASH_IO, FLASH_IO_2, FLASH_IO_3, FLASH_IO_4, FLASH_IO_5
     );
   signal flash_state     : cntlState;   -- FSM state register
   signal rtn_flash_state : cntlState;   -- return-to state for FSM subroutines
+  signal rtn_read_state  : cntlState;   -- state to go to once a read command and address are sent
 
   -- Signals to/from dualport block RAM to FSM.
   constant BLOCK_ADDR_WIDTH_G : natural := Log2(BLOCK_SIZE_G);
@@ -132,6 +169,8 @@ architecture arch of FlashCntl is
   signal blk_do_b           : std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- port B data output
   signal blk_en_b           : std_logic;  -- port B enable
   signal blk_we_b           : std_logic;  -- port B write enable
+  signal host_buf           : std_logic;  -- page of the block RAM the host is loading
+  signal pgm_buf            : std_logic;  -- page of the block RAM being programmed into the flash
 
   signal f_addr : std_logic_vector(h_addr'range);  -- address of location in serial flash
 
@@ -145,6 +184,10 @@ architecture arch of FlashCntl is
 
   signal read_cntr : natural range BLOCK_SIZE_G-1 downto 0 := 0;
 
+  signal valid     : std_logic := NO;   -- true when a streamed byte is waiting for the host
+
+  signal erase_cntr : natural range ERASE_SIZE-1 downto 0;  -- # of sector bytes left to check for blankness
+
 begin
 
   -- The dual-port block RAM buffers data that is to be written to the flash.
@@ -169,12 +212,15 @@ begin
       WEB   => blk_we_b                 -- write-enable port B
       );
 
-  process(h_addr, blk_addr_b)
+  -- The bit above the page address selects which of the two pages in the block RAM is used.
+  process(h_addr, blk_addr_b, host_buf, pgm_buf)
   begin
-    addra                   <= (others => '0');
-    addra(blk_addr_b'range) <= h_addr(blk_addr_b'range);
-    addrb                   <= (others => '0');
-    addrb(blk_addr_b'range) <= blk_addr_b;
+    addra                     <= (others => '0');
+    addra(blk_addr_b'range)   <= h_addr(blk_addr_b'range);
+    addra(blk_addr_b'length)  <= host_buf;
+    addrb                     <= (others => '0');
+    addrb(blk_addr_b'range)   <= blk_addr_b;
+    addrb(blk_addr_b'length)  <= pgm_buf;
   end process;
 
   -- This FSM performs the sequences of write/reads to the Flash chip that will
@@ -193,10 +239,17 @@ begin
       h_begun         <= NO;
       h_busy          <= NO;
       h_done          <= NO;
+      valid           <= NO;
+      host_buf        <= '0';
+      pgm_buf         <= '0';           -- initialize the first page and then the second
       flash_state     <= RAM_BLK_INIT;  -- starting state after reset
-      rtn_flash_state <= FLASH_NOP;  -- go to this state after RAM initialization
+      rtn_flash_state <= RAM_BLK_INIT_2;  -- go to this state after RAM initialization
       
     elsif rising_edge(clk) then
+      if h_ready = YES then
+        valid <= NO;                    -- the host has taken the streamed byte
+      end if;
+
       case flash_state is
 
         -- Initialize the block RAM with the value stored in an erased Flash location.
@@ -213,6 +266,10 @@ begin
           if blk_addr_b = BLOCK_SIZE_G-1 then
             flash_state <= rtn_flash_state;
           end if;
+        when RAM_BLK_INIT_2 =>
+          pgm_buf         <= '1';       -- now initialize the second page
+          flash_state     <= RAM_BLK_INIT;
+          rtn_flash_state <= FLASH_NOP;
 
         -- Wait for a Flash erase, program or read operation to arrive.  
         when FLASH_NOP =>
@@ -225,12 +282,25 @@ begin
           h_busy     <= YES;        -- assume we are busy doing some operation
           if h_erase = YES then
             flash_state <= FLASH_ERASE;  -- go to states where Flash erasure occurs
+          elsif h_sector_erase = YES then
+            f_addr                            <= h_addr;
+            f_addr(Log2(ERASE_SIZE)-1 downto 0) <= (others => '0');  -- start of the sector holding the address
+            erase_cntr                        <= ERASE_SIZE-1;
+            rtn_read_state                    <= FLASH_BLANK_CHK;
+            flash_state                       <= FLASH_READ;  -- read the sector to see if it's already erased
           elsif h_blk_pgm = YES then
             f_addr      <= h_addr;  -- send the address to write to in the flash
+            pgm_buf     <= host_buf;    -- program the page the host just loaded...
+            host_buf    <= not host_buf;  -- and let the host load the other page meanwhile
             flash_state <= FLASH_BLK_PGM;  -- go to states where flash programming occurs
           elsif h_rd = YES then
-            f_addr      <= h_addr;  -- send the address to read from to the external Flash interface
-            flash_state <= FLASH_READ;  -- go to the states where Flash reading occurs
+            f_addr         <= h_addr;  -- send the address to read from to the external Flash interface
+            rtn_read_state <= FLASH_READ_5;
+            flash_state    <= FLASH_READ;  -- go to the states where Flash reading occurs
+          elsif h_stream = YES then
+            f_addr         <= h_addr;  -- send the address to start streaming from to the external Flash interface
+            rtn_read_state <= FLASH_STREAM;
+            flash_state    <= FLASH_READ;  -- the streaming read starts the same way as a normal read
           else  -- cancel the begun and busy indicators since no operation was initiated
             h_begun <= NO;              -- no operation has been initiated
             h_busy  <= NO;              -- no operation is in-progress
@@ -268,7 +338,53 @@ begin
             flash_state <= FLASH_NOP;   -- return to wait for another operation
           end if;
 
-        -- Program the contents of the block RAM into the flash.
+        -- Erase the sector whose address was registered during the NOP state:
+        --  1) Read the sector and skip the erase if every byte is already erased.
+        --  2) Enable writing of the flash.
+        --  3) Issue the sector (or block) erase command and address.
+        --  4) Read status register until the erase operation is done.
+        when FLASH_BLANK_CHK =>
+          flash_state     <= FLASH_IO;  -- after this, the next byte of the sector is in the f_do register
+          rtn_flash_state <= FLASH_BLANK_CHK_2;
+        when FLASH_BLANK_CHK_2 =>
+          if f_do /= ERASED then
+            f_cs_n      <= '1';         -- terminate the read and erase the sector
+            flash_state <= FLASH_SECTOR_ERASE;
+          elsif erase_cntr = 0 then
+            f_cs_n      <= '1';         -- the sector is blank, so there's nothing to do
+            h_done      <= YES;
+            flash_state <= FLASH_NOP;
+          else
+            erase_cntr  <= erase_cntr - 1;
+            flash_state <= FLASH_BLANK_CHK;
+          end if;
+        when FLASH_SECTOR_ERASE =>
+          f_di            <= WRITE_ENABLE_CMD;  -- enable writing to the flash
+          flash_state     <= FLASH_IO_WAIT;
+          rtn_flash_state <= FLASH_SECTOR_ERASE_2;
+        when FLASH_SECTOR_ERASE_2 =>
+          f_cs_n <= '1';  -- raise flash CS after write enable command so it will take effect
+          if BLOCK_ERASE_G then
+            f_di <= BLOCK_ERASE_CMD;
+          else
+            f_di <= SECTOR_ERASE_CMD;
+          end if;
+          flash_state     <= FLASH_IO_WAIT;
+          rtn_flash_state <= FLASH_SECTOR_ERASE_3;
+        when FLASH_SECTOR_ERASE_3 =>
+          f_di            <= f_addr(23 downto 16);  -- send the MSByte of the sector address
+          flash_state     <= FLASH_IO;
+          rtn_flash_state <= FLASH_SECTOR_ERASE_4;
+        when FLASH_SECTOR_ERASE_4 =>
+          f_di            <= f_addr(15 downto 8);  -- send the middle byte of the sector address
+          flash_state     <= FLASH_IO;
+          rtn_flash_state <= FLASH_SECTOR_ERASE_5;
+        when FLASH_SECTOR_ERASE_5 =>
+          f_di            <= f_addr(7 downto 0);  -- send the LSByte of the sector address
+          flash_state     <= FLASH_IO;
+          rtn_flash_state <= FLASH_ERASE_3;  -- then wait for the erase to finish like a chip erase
+
+        -- Program the page of the block RAM loaded by the host into the flash.
         --  1) Enable writing of the flash.
         --  2) Issue the programming command.
         --  3) Send the starting address.
@@ -322,7 +438,7 @@ begin
           else
             -- flash has completed the page programming operation
             f_cs_n          <= '1';     -- stop reading flash status
-            flash_state     <= RAM_BLK_INIT;   -- re-initialize the block RAM
+            flash_state     <= RAM_BLK_INIT;   -- re-initialize the programmed page of the block RAM
             rtn_flash_state <= FLASH_BLK_PGM_10;
           end if;
         when FLASH_BLK_PGM_10 =>
@@ -352,7 +468,7 @@ begin
           rtn_flash_state <= FLASH_READ_DUMMY;
         when FLASH_READ_DUMMY =>
           flash_state     <= FLASH_IO;  -- send dummy byte required for fast read command
-          rtn_flash_state <= FLASH_READ_5;
+          rtn_flash_state <= rtn_read_state;  -- then read a byte, stream bytes, or check for an erased sector
         when FLASH_READ_5 =>
           h_begun         <= NO;  -- remove begun signal raised when coming from FLASH_READ_7 state
           flash_state     <= FLASH_IO;  -- after this completes, the data read from flash appears is in the f_do register
@@ -376,6 +492,46 @@ begin
             null;
           end if;
 
+        -- Stream bytes from the flash to the host after the read command, address and dummy byte are sent:
+        --  1) Clock in the bits of a byte without stopping between bytes.
+        --  2) Give each byte to the host, stopping SCLK if the host hasn't taken the previous one.
+        --  3) Terminate the read when the host lowers h_stream.
+        when FLASH_STREAM =>
+          cntr        <= DATA_WIDTH_G-1;
+          flash_state <= FLASH_STREAM_2;
+        when FLASH_STREAM_2 =>
+          sclk        <= '1';
+          flash_state <= FLASH_STREAM_3;
+        when FLASH_STREAM_3 =>
+          sclk        <= '0';
+          f_do        <= f_do(DATA_WIDTH_G-2 downto 0) & si;
+          cntr        <= cntr - 1;
+          flash_state <= FLASH_STREAM_2;
+          if cntr = 0 then              -- a complete byte has been read
+            cntr <= DATA_WIDTH_G-1;
+            if valid = YES and h_ready = NO then
+              flash_state <= FLASH_STREAM_FULL;  -- wait for the host to take the previous byte
+            else
+              h_do  <= f_do(DATA_WIDTH_G-2 downto 0) & si;
+              valid <= YES;
+              if h_stream = NO then
+                f_cs_n      <= '1';     -- terminate the read data command
+                h_done      <= YES;
+                flash_state <= FLASH_NOP;
+              end if;
+            end if;
+          end if;
+        when FLASH_STREAM_FULL =>
+          if h_stream = NO then
+            f_cs_n      <= '1';  -- terminate the read data command (the byte the host didn't take is dropped)
+            h_done      <= YES;
+            flash_state <= FLASH_NOP;
+          elsif h_ready = YES then
+            h_do        <= f_do;
+            valid       <= YES;
+            flash_state <= FLASH_STREAM_2;
+          end if;
+
         -- This is an FSM subroutine that writes a value to and reads a value from the serial flash.
         when FLASH_IO_WAIT =>
           wait_cntr   <= CS_HIGH_WAIT - 1;
@@ -414,6 +570,7 @@ begin
     end if;
   end process;
 
-  so <= f_di(DATA_WIDTH_G-1);
+  so      <= f_di(DATA_WIDTH_G-1);
+  h_valid <= valid;
 
 end architecture;
@@ -39,6 +39,11 @@ package HostIoPckg is
   constant WRITE_OPCODE_C : std_logic_vector(1 downto 0) := "10";
   constant READ_OPCODE_C  : std_logic_vector(1 downto 0) := "11";
 
+  -- Use one of these in the two bits after a NOP opcode to select an extended operation of HostIoToRam.
+  constant STATUS_XOPCODE_C : std_logic_vector(1 downto 0) := "00";  -- Return status bits.
+  constant LIST_XOPCODE_C   : std_logic_vector(1 downto 0) := "01";  -- Perform a list of reads and writes.
+  constant LIST_LEN_SIZE_C  : natural                      := 16;  -- Width of the word count in a list descriptor.
+
   component BscanToHostIo is
     generic (
       FPGA_DEVICE_G    : FpgaDevice_t   := SPARTAN3A;  -- FPGA device type.
@@ -126,7 +131,59 @@ package HostIoPckg is
       dataFromHost_o : out std_logic_vector;      -- Data written to memory.
       rd_o           : out std_logic;   -- Read data from memory when high.
       dataToHost_i   : in  std_logic_vector;      -- Data read from memory.
-      rwDone_i       : in  std_logic := HI  -- True when memory read/write operation is done.
+      rwDone_i       : in  std_logic := HI;  -- True when memory read/write operation is done.
+      wrDrained_i    : in  std_logic := HI;  -- True when all posted writes have reached the memory.
+      active_o       : out std_logic    -- True when this module has been selected by the host.
+      );
+  end component;
+
+  component RamWrPost is
+    generic (
+      DEPTH_G : natural := 16           -- Number of writes that can be posted (rounded up to a power of 2).
+      );
+    port (
+      reset_i   : in  std_logic := LO;  -- Active-high reset signal.
+      -- Interface to HostIoToRamCore in the JTAG clock domain.
+      drck_i    : in  std_logic;        -- Clock from JTAG domain.
+      addr_i    : in  std_logic_vector;  -- Address from HostIoToRamCore.
+      data_i    : in  std_logic_vector;  -- Data from HostIoToRamCore.
+      wr_i      : in  std_logic;        -- Write request.
+      wrDone_o  : out std_logic;        -- Write has been posted.
+      drained_o : out std_logic;        -- True when all posted writes have reached the memory.
+      -- Interface to the memory in the memory clock domain.
+      clk_i     : in  std_logic;        -- Clock from RAM domain.
+      addr_o    : out std_logic_vector;  -- Address to memory.
+      data_o    : out std_logic_vector;  -- Data to memory.
+      wr_o      : out std_logic;        -- Write data to memory when high.
+      busy_o    : out std_logic;        -- True from the start of a memory write until it's done.
+      opBegun_i : in  std_logic := HI;  -- High when memory write operation has begun.
+      done_i    : in  std_logic := HI   -- High when memory write operation is done.
+      );
+  end component;
+
+  component RamRdPrefetch is
+    generic (
+      DEPTH_G  : natural := 4;          -- Number of words to read ahead.
+      ADDR_INC : integer := 1           -- Add to address after each memory read.
+      );
+    port (
+      clk_i          : in  std_logic;   -- Clock from RAM domain.
+      flush_i        : in  std_logic := LO;  -- Empty the prefetch buffer and stop reading ahead.
+      -- Interface to the RamCtrlSync modules.
+      addr_i         : in  std_logic_vector;  -- Address from HostIoToRamCore.
+      wr_i           : in  std_logic;   -- Write request.
+      wrBegun_o      : out std_logic;   -- Write has begun.
+      wrDone_o       : out std_logic;   -- Write is done.
+      rd_i           : in  std_logic;   -- Read request.
+      rdDone_o       : out std_logic;   -- Read data is ready on data_o.
+      data_o         : out std_logic_vector;  -- Data read from the prefetch buffer.
+      -- Interface to the memory.
+      addr_o         : out std_logic_vector;  -- Address to memory.
+      wr_o           : out std_logic;   -- Write data to memory when high.
+      rd_o           : out std_logic;   -- Read data from memory when high.
+      data_i         : in  std_logic_vector;  -- Data read from memory.
+      opBegun_i      : in  std_logic := HI;  -- High when memory read/write operation has begun.
+      done_i         : in  std_logic := HI  -- High when memory read/write operation is done.
       );
   end component;
 
@@ -138,7 +195,9 @@ package HostIoPckg is
       FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
       TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
       SIMPLE_G           : boolean          := false;  -- If true, include BscanToHostIo module in this module.
-      SYNC_G             : boolean          := true  -- If true, sync this module with the memory clock domain.
+      SYNC_G             : boolean          := true;  -- If true, sync this module with the memory clock domain.
+      RD_PREFETCH_G      : natural          := 0;  -- If >0, read this many words ahead of the host (needs SYNC_G).
+      WR_POST_G          : natural          := 0  -- If >0, post up to this many writes to the memory (needs SYNC_G).
       );
     port (
       reset_i        : in  std_logic := LO;  -- Active-high reset signal.
@@ -436,6 +495,37 @@ end architecture;
 -- TDO:  |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|   Address width   |   Data width   |
 -- Addr: |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|
 -- Data: |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|
+--
+-- Status query operation:
+-- A NOP opcode doesn't touch the memory. It's followed by a two-bit extended opcode, and
+-- STATUS_XOPCODE_C (or no more payload bits at all) makes this module place its status into the
+-- LSB of the shift register so it goes back to the host. The status bit is high once all the
+-- writes posted by HostIoToRam (see WR_POST_G) have reached the memory. (It's always
+-- high if writes aren't posted.)
+--
+--       |     Header reception     |     Payload bits    |   Status goes back to host   |
+-- TDI:  |  ID  | # of payload bits | Opcode | Ext. opcode |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|
+-- TDO:  |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx| Drained | Drained | ... | Drained | Drained |
+--
+-- List operation:
+-- A NOP followed by LIST_XOPCODE_C performs a list of reads and writes that are described by
+-- descriptors in the rest of the payload. Each descriptor has an opcode (WRITE_OPCODE_C or
+-- READ_OPCODE_C), a starting address and a LIST_LEN_SIZE_C-bit word count. The descriptor
+-- is followed by the data words for a write, or by room for the words going back to the host
+-- for a read. Just like a read operation, the first word of each read is garbage. The words
+-- read are followed by a status word whose LSB is high if every word was read from the memory
+-- before it had to go back to the host. (A memory that's too slow for DRCK makes the LSB low
+-- and the data words are stale.) So a read of N words takes N+2 words of payload bits.
+-- A descriptor with a word count of zero (or any other opcode) does nothing and is followed
+-- immediately by the next descriptor.
+-- The memory only has a single done signal for reads and writes, so the first read of a read
+-- descriptor isn't started until the last write of the previous descriptor is done and its
+-- done signal has gone away. That write finishes while the garbage word is going back, so it
+-- doesn't cost the host anything unless the memory is too slow to keep up with DRCK anyway.
+--
+--       | Payload bits |   Write descriptor   |  Write data   |   Read descriptor    |  Room for read data and status  |
+-- TDI:  | NOP | LIST   | Opcode | Addr | N    | Data1...DataN | Opcode | Addr | M    |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|
+-- TDO:  |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx| Data1 | ... | DataM | Status |
 --**************************************************************************************************
 
 library IEEE;
@@ -464,7 +554,9 @@ entity HostIoToRamCore is
     dataFromHost_o : out std_logic_vector;      -- Data written to memory.
     rd_o           : out std_logic;     -- Read data from memory when high.
     dataToHost_i   : in  std_logic_vector;      -- Data read from memory.
-    rwDone_i       : in  std_logic := HI  -- True when memory read/write operation is done.
+    rwDone_i       : in  std_logic := HI;  -- True when memory read/write operation is done.
+    wrDrained_i    : in  std_logic := HI;  -- True when all posted writes have reached the memory.
+    active_o       : out std_logic      -- True when this module has been selected by the host.
     );
 end entity;
 
@@ -483,6 +575,19 @@ architecture arch of HostIoToRamCore is
   signal wrToMemory_r       : std_logic                                     := NO;
   signal rdFromMemory_r     : std_logic                                     := NO;
   signal dataFromMemory_r   : std_logic_vector(dataToHost_i'high downto 0);
+  -- Extended operations and descriptor lists.
+  signal xopcode_r          : std_logic_vector(STATUS_XOPCODE_C'range)      := STATUS_XOPCODE_C;
+  signal xopcodeRcvd_r      : std_logic                                     := NO;
+  signal descOpcode_r       : std_logic_vector(NOP_OPCODE_C'range)          := NOP_OPCODE_C;
+  signal descOpcodeRcvd_r   : std_logic                                     := NO;
+  signal descAddr_r         : std_logic_vector(addr_o'high downto 0)        := (others => ZERO);
+  signal descAddrRcvd_r     : std_logic                                     := NO;
+  signal descLen_r          : std_logic_vector(LIST_LEN_SIZE_C-1 downto 0)  := (others => ZERO);
+  signal descLenRcvd_r      : std_logic                                     := NO;
+  signal wordCntr_r         : std_logic_vector(LIST_LEN_SIZE_C-1 downto 0)  := (others => ZERO);
+  signal rdPending_r        : std_logic                                     := NO;  -- 1st read of a descriptor is waiting for a write to finish.
+  signal rdLate_r           : std_logic                                     := NO;  -- A word went to the host before the memory returned it.
+  signal rdStatusSent_r     : std_logic                                     := NO;  -- The status word of a read descriptor has gone to the host.
 begin
 
   -- Scan the bits from the host looking for an instruction header.
@@ -576,9 +681,130 @@ begin
                 end if;
               end if;
 
-            -- Default case is NOP.
+            -- NOP doesn't touch the memory. Its extended opcode selects what happens next.
             when others =>
-              null;
+              if xopcodeRcvd_r = NO then  -- Get the extended opcode while sending the status back to the host.
+                xopcode_r     <= tdi_i & xopcode_r(xopcode_r'high downto 1);
+                xopcodeRcvd_r <= xopcode_r(0);  -- Extended opcode complete once LSB is set.
+                shiftReg_r(0) <= wrDrained_i;
+
+              elsif xopcode_r = LIST_XOPCODE_C then  -- Perform a list of reads and writes.
+
+                -- Finish any write to memory that's still in progress from the previous descriptor.
+                if wrToMemory_r = YES and rwDone_i = YES then
+                  wrToMemory_r   <= NO;
+                  addrFromHost_r <= addrFromHost_r + ADDR_INC;
+                end if;
+
+                if descOpcodeRcvd_r = NO then  -- Get the opcode for the next descriptor.
+                  descOpcode_r     <= tdi_i & descOpcode_r(descOpcode_r'high downto 1);
+                  descOpcodeRcvd_r <= descOpcode_r(0);
+                elsif descAddrRcvd_r = NO then  -- Get the starting address.
+                  descAddr_r     <= tdi_i & descAddr_r(descAddr_r'high downto 1);
+                  descAddrRcvd_r <= descAddr_r(0);
+                elsif descLenRcvd_r = NO then  -- Get the number of words to read or write.
+                  descLen_r     <= tdi_i & descLen_r(descLen_r'high downto 1);
+                  descLenRcvd_r <= descLen_r(0);
+                  if descLen_r(0) = ONE then  -- Descriptor is complete, so set up the transfer.
+                    wordCntr_r                      <= tdi_i & descLen_r(descLen_r'high downto 1);
+                    addrFromHost_r                  <= descAddr_r;
+                    bitCntr_r                       <= dataFromMemory_r'length - 1;  -- Output a garbage word before the 1st read completes.
+                    shiftReg_r                      <= (others => ZERO);
+                    shiftReg_r(dataFromHost_o'high) <= ONE;
+                    if (tdi_i = ZERO and descLen_r(descLen_r'high downto 1) = 0) or
+                      (descOpcode_r /= WRITE_OPCODE_C and descOpcode_r /= READ_OPCODE_C) then
+                      -- Nothing to transfer, so go on to the next descriptor.
+                      descOpcode_r                    <= (others => ZERO);
+                      descOpcode_r(descOpcode_r'high) <= ONE;
+                      descOpcodeRcvd_r                <= NO;
+                      descAddr_r                      <= (others => ZERO);
+                      descAddr_r(descAddr_r'high)     <= ONE;
+                      descAddrRcvd_r                  <= NO;
+                      descLen_r                       <= (others => ZERO);
+                      descLen_r(descLen_r'high)       <= ONE;
+                      descLenRcvd_r                   <= NO;
+                    elsif descOpcode_r = READ_OPCODE_C then
+                      rdPending_r    <= YES;  -- Start the first read once any write is out of the way.
+                      rdLate_r       <= NO;
+                      rdStatusSent_r <= NO;
+                    end if;
+                  end if;
+
+                elsif descOpcode_r = WRITE_OPCODE_C then  -- Write words from the host to memory.
+                  if shiftReg_r(0) = LO then
+                    shiftReg_r(dataFromHost_o'range) <= tdi_i & shiftReg_r(dataFromHost_o'high downto 1);
+                  else
+                    dataFromHost_o                  <= tdi_i & shiftReg_r(dataFromHost_o'high downto 1);
+                    shiftReg_r                      <= (others => ZERO);
+                    shiftReg_r(dataFromHost_o'high) <= HI;
+                    wrToMemory_r                    <= YES;
+                    wordCntr_r                      <= wordCntr_r - 1;
+                    if wordCntr_r = 1 then  -- Last word of this descriptor, so get ready for the next one.
+                      descOpcode_r                    <= (others => ZERO);
+                      descOpcode_r(descOpcode_r'high) <= ONE;
+                      descOpcodeRcvd_r                <= NO;
+                      descAddr_r                      <= (others => ZERO);
+                      descAddr_r(descAddr_r'high)     <= ONE;
+                      descAddrRcvd_r                  <= NO;
+                      descLen_r                       <= (others => ZERO);
+                      descLen_r(descLen_r'high)       <= ONE;
+                      descLenRcvd_r                   <= NO;
+                    end if;
+                  end if;
+
+                else  -- Read words from memory and send them to the host.
+                  if rdPending_r = YES then
+                    -- Don't start the first read while a write is still in progress or its done
+                    -- signal is still high, otherwise the write's done would end the read, too.
+                    if wrToMemory_r = NO and rwDone_i = NO then
+                      rdPending_r    <= NO;
+                      rdFromMemory_r <= YES;
+                    end if;
+                  elsif rdFromMemory_r = YES and rwDone_i = YES then
+                    rdFromMemory_r   <= NO;
+                    dataFromMemory_r <= dataToHost_i;
+                  end if;
+                  if bitCntr_r = 0 then
+                    if wordCntr_r /= 0 then  -- Send the next word to the host.
+                      shiftReg_r(dataFromMemory_r'range) <= dataFromMemory_r;
+                      bitCntr_r                          <= dataFromMemory_r'length-1;
+                      wordCntr_r                         <= wordCntr_r - 1;
+                      rdPending_r                        <= NO;  -- Stop waiting to start the 1st read.
+                      if rdPending_r = YES or rdFromMemory_r = YES then
+                        rdLate_r <= YES;  -- The memory hasn't returned this word yet, so it's stale.
+                      end if;
+                      if wordCntr_r > 1 then
+                        addrFromHost_r <= addrFromHost_r + ADDR_INC;
+                        rdFromMemory_r <= YES;
+                      end if;
+                    elsif rdStatusSent_r = NO then  -- Tell the host if all the words it got were good.
+                      shiftReg_r     <= (others => ZERO);
+                      shiftReg_r(0)  <= not rdLate_r;
+                      bitCntr_r      <= dataFromMemory_r'length-1;
+                      rdStatusSent_r <= YES;
+                      rdFromMemory_r <= NO;  -- Don't let a late read acknowledge the next write.
+                    else  -- The status has gone to the host, so get ready for the next descriptor.
+                      rdPending_r                     <= NO;
+                      rdFromMemory_r                  <= NO;  -- Don't let a late read acknowledge the next write.
+                      descOpcode_r                    <= (others => ZERO);
+                      descOpcode_r(descOpcode_r'high) <= ONE;
+                      descOpcodeRcvd_r                <= NO;
+                      descAddr_r                      <= (others => ZERO);
+                      descAddr_r(descAddr_r'high)     <= ONE;
+                      descAddrRcvd_r                  <= NO;
+                      descLen_r                       <= (others => ZERO);
+                      descLen_r(descLen_r'high)       <= ONE;
+                      descLenRcvd_r                   <= NO;
+                    end if;
+                  else
+                    shiftReg_r <= ZERO & shiftReg_r(shiftReg_r'high downto 1);
+                    bitCntr_r  <= bitCntr_r - 1;
+                  end if;
+                end if;
+
+              else  -- Keep sending the status back to the host.
+                shiftReg_r(0) <= wrDrained_i;
+              end if;
               
           end case;
         end if;
@@ -595,6 +821,21 @@ begin
         bitCntr_r                           <= 0;
         wrToMemory_r                        <= NO;
         rdFromMemory_r                      <= NO;
+        rdPending_r                         <= NO;
+        rdLate_r                            <= NO;
+        rdStatusSent_r                      <= NO;
+        xopcode_r                           <= (others => ZERO);
+        xopcode_r(xopcode_r'high)           <= ONE;
+        xopcodeRcvd_r                       <= NO;
+        descOpcode_r                        <= (others => ZERO);
+        descOpcode_r(descOpcode_r'high)     <= ONE;
+        descOpcodeRcvd_r                    <= NO;
+        descAddr_r                          <= (others => ZERO);
+        descAddr_r(descAddr_r'high)         <= ONE;
+        descAddrRcvd_r                      <= NO;
+        descLen_r                           <= (others => ZERO);
+        descLen_r(descLen_r'high)           <= ONE;
+        descLenRcvd_r                       <= NO;
       end if;
     end if;
 
@@ -609,6 +850,8 @@ begin
   addr_o <= addrFromHost_r;
   wr_o   <= wrToMemory_r;
   rd_o   <= rdFromMemory_r;
+
+  active_o <= active_s;
   
 end architecture;
 
@@ -681,10 +924,312 @@ begin
 end architecture;
 
 
+--**************************************************************************************************
+-- This module sits between the RamCtrlSync modules and the memory and reads ahead of the
+-- HostIoToRamCore so slow memories (like SDRAM) don't limit the rate that data goes back to the host.
+--
+-- When the HostIoToRamCore requests a read, the address is compared with the address of the
+-- word at the head of the prefetch buffer. If they match, the word is returned from the buffer
+-- right away. Otherwise, the buffer is emptied and prefetching restarts at the requested address.
+-- Whenever the buffer has room and no write is pending, the next sequential word is read
+-- from the memory and placed in the buffer. Writes pass straight through to the memory and empty
+-- the buffer so it never holds stale data. The buffer is also emptied when flush_i is high
+-- (e.g., when the HostIoToRamCore is no longer selected by the host).
+--
+-- Memory reads are issued using the same handshake as RamCtrlSync: rd_o stays high until
+-- opBegun_i or done_i goes high, and the data is taken from the memory when done_i goes high.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.STD_LOGIC_UNSIGNED.all;
+use work.CommonPckg.all;
+
+entity RamRdPrefetch is
+  generic (
+    DEPTH_G  : natural := 4;            -- Number of words to read ahead.
+    ADDR_INC : integer := 1             -- Add to address after each memory read.
+    );
+  port (
+    clk_i          : in  std_logic;     -- Clock from RAM domain.
+    flush_i        : in  std_logic := LO;  -- Empty the prefetch buffer and stop reading ahead.
+    -- Interface to the RamCtrlSync modules.
+    addr_i         : in  std_logic_vector;  -- Address from HostIoToRamCore.
+    wr_i           : in  std_logic;     -- Write request.
+    wrBegun_o      : out std_logic;     -- Write has begun.
+    wrDone_o       : out std_logic;     -- Write is done.
+    rd_i           : in  std_logic;     -- Read request.
+    rdDone_o       : out std_logic;     -- Read data is ready on data_o.
+    data_o         : out std_logic_vector;  -- Data read from the prefetch buffer.
+    -- Interface to the memory.
+    addr_o         : out std_logic_vector;  -- Address to memory.
+    wr_o           : out std_logic;     -- Write data to memory when high.
+    rd_o           : out std_logic;     -- Read data from memory when high.
+    data_i         : in  std_logic_vector;  -- Data read from memory.
+    opBegun_i      : in  std_logic := HI;  -- High when memory read/write operation has begun.
+    done_i         : in  std_logic := HI  -- High when memory read/write operation is done.
+    );
+end entity;
+
+
+architecture arch of RamRdPrefetch is
+  subtype Addr_t is std_logic_vector(addr_i'length-1 downto 0);
+  subtype Data_t is std_logic_vector(data_i'length-1 downto 0);
+  type Buffer_t is array (0 to DEPTH_G-1) of Data_t;
+  signal buffer_r      : Buffer_t;
+  signal headPtr_r     : natural range 0 to DEPTH_G-1 := 0;  -- Buffer location of the next word to the host.
+  signal tailPtr_r     : natural range 0 to DEPTH_G-1 := 0;  -- Buffer location for the next word from memory.
+  signal level_r       : natural range 0 to DEPTH_G   := 0;  -- Number of words in the buffer.
+  signal headAddr_r    : Addr_t;        -- Memory address of the word at the head of the buffer.
+  signal fetchAddr_r   : Addr_t;        -- Memory address of the next word to prefetch.
+  signal prefetching_r : std_logic     := NO;  -- True when reading ahead of the host.
+  signal discard_r     : std_logic     := NO;  -- True if the memory read in progress is no longer wanted.
+  signal rdServed_r    : std_logic     := NO;  -- True once the current read request has been answered.
+  signal rdDone_r      : std_logic     := NO;
+  signal memAddr_r     : Addr_t;
+  signal memWr_r       : std_logic     := NO;
+  signal memRd_r       : std_logic     := NO;
+  type MemState_t is (MEM_IDLE, MEM_WRITE, MEM_READ);
+  signal memState_r    : MemState_t    := MEM_IDLE;
+begin
+
+  process(clk_i)
+    variable level_v : natural range 0 to DEPTH_G;
+    variable flush_v : boolean;         -- True if the buffer contents are being thrown away.
+  begin
+    if rising_edge(clk_i) then
+      level_v  := level_r;
+      flush_v  := flush_i = YES;
+      rdDone_r <= NO;
+
+      -- Answer read requests from the HostIoToRamCore.
+      if rd_i = LO then
+        rdServed_r <= NO;
+      elsif rdServed_r = NO and flush_i = NO then
+        if prefetching_r = YES and addr_i = headAddr_r then
+          if level_v /= 0 then          -- The requested word is in the buffer, so send it.
+            data_o     <= buffer_r(headPtr_r);
+            headPtr_r  <= (headPtr_r + 1) mod DEPTH_G;
+            headAddr_r <= headAddr_r + ADDR_INC;
+            level_v    := level_v - 1;
+            rdDone_r   <= YES;
+            rdServed_r <= YES;
+          end if;
+        else  -- The host wants something else, so start prefetching from the new address.
+          prefetching_r <= YES;
+          headAddr_r    <= addr_i;
+          fetchAddr_r   <= addr_i;
+          flush_v       := true;
+        end if;
+      end if;
+
+      -- Perform writes and prefetch reads on the memory one at a time.
+      case memState_r is
+        when MEM_IDLE =>
+          if wr_i = HI then             -- Writes take priority and empty the buffer.
+            memAddr_r     <= addr_i;
+            memWr_r       <= HI;
+            memState_r    <= MEM_WRITE;
+            prefetching_r <= NO;
+            flush_v       := true;
+          elsif prefetching_r = YES and level_v < DEPTH_G and not flush_v then
+            memAddr_r  <= fetchAddr_r;
+            memRd_r    <= HI;
+            memState_r <= MEM_READ;
+          end if;
+
+        when MEM_WRITE =>
+          if opBegun_i = HI or done_i = HI then
+            memWr_r <= LO;
+          end if;
+          if done_i = HI then
+            memState_r <= MEM_IDLE;
+          end if;
+
+        when MEM_READ =>
+          if opBegun_i = HI or done_i = HI then
+            memRd_r <= LO;
+          end if;
+          if done_i = HI then
+            if discard_r = NO and not flush_v then  -- Store the word unless it's no longer wanted.
+              buffer_r(tailPtr_r) <= data_i;
+              tailPtr_r           <= (tailPtr_r + 1) mod DEPTH_G;
+              fetchAddr_r         <= fetchAddr_r + ADDR_INC;
+              level_v             := level_v + 1;
+            end if;
+            discard_r  <= NO;
+            memState_r <= MEM_IDLE;
+          end if;
+      end case;
+
+      -- Empty the buffer. A memory read that's still in progress will be thrown away when it finishes.
+      if flush_v then
+        level_v   := 0;
+        headPtr_r <= tailPtr_r;
+        if memState_r = MEM_READ and done_i = LO then
+          discard_r <= YES;
+        end if;
+      end if;
+      if flush_i = YES then
+        prefetching_r <= NO;
+      end if;
+
+      level_r <= level_v;
+    end if;
+  end process;
+
+  wrBegun_o <= opBegun_i when memState_r = MEM_WRITE else LO;
+  wrDone_o  <= done_i    when memState_r = MEM_WRITE else LO;
+  rdDone_o  <= rdDone_r;
+  addr_o    <= memAddr_r;
+  wr_o      <= memWr_r;
+  rd_o      <= memRd_r;
+
+end architecture;
+
+
+--**************************************************************************************************
+-- This module lets the HostIoToRamCore post writes into a FIFO at the JTAG clock rate while
+-- the writes are drained into the memory at whatever rate it can handle. That way, a slow
+-- memory or an SDRAM refresh doesn't back up into the JTAG bit stream during uploads.
+--
+-- The FIFO holds the address and data of each write. Its read and write pointers cross between
+-- the clock domains as Gray codes so only one bit changes at a time. A FIFO entry isn't released
+-- until the memory says the write is done, so drained_o only goes high (in the JTAG clock domain)
+-- once every posted write has actually reached the memory.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.STD_LOGIC_UNSIGNED.all;
+use work.CommonPckg.all;
+
+entity RamWrPost is
+  generic (
+    DEPTH_G : natural := 16             -- Number of writes that can be posted (rounded up to a power of 2).
+    );
+  port (
+    reset_i   : in  std_logic := LO;    -- Active-high reset signal.
+    -- Interface to HostIoToRamCore in the JTAG clock domain.
+    drck_i    : in  std_logic;          -- Clock from JTAG domain.
+    addr_i    : in  std_logic_vector;   -- Address from HostIoToRamCore.
+    data_i    : in  std_logic_vector;   -- Data from HostIoToRamCore.
+    wr_i      : in  std_logic;          -- Write request.
+    wrDone_o  : out std_logic;          -- Write has been posted.
+    drained_o : out std_logic;          -- True when all posted writes have reached the memory.
+    -- Interface to the memory in the memory clock domain.
+    clk_i     : in  std_logic;          -- Clock from RAM domain.
+    addr_o    : out std_logic_vector;   -- Address to memory.
+    data_o    : out std_logic_vector;   -- Data to memory.
+    wr_o      : out std_logic;          -- Write data to memory when high.
+    busy_o    : out std_logic;          -- True from the start of a memory write until it's done.
+    opBegun_i : in  std_logic := HI;    -- High when memory write operation has begun.
+    done_i    : in  std_logic := HI     -- High when memory write operation is done.
+    );
+end entity;
+
+
+architecture arch of RamWrPost is
+  constant PTR_WIDTH_C    : natural := IntMax(Log2(DEPTH_G), 1);
+  subtype Ptr_t is std_logic_vector(PTR_WIDTH_C downto 0);  -- Extra MSB tells a full FIFO from an empty one.
+  subtype Entry_t is std_logic_vector(addr_i'length + data_i'length - 1 downto 0);
+  type Fifo_t is array (0 to 2**PTR_WIDTH_C - 1) of Entry_t;
+  signal fifo_r           : Fifo_t;
+  -- JTAG clock domain.
+  signal wrPtr_r          : Ptr_t     := (others => ZERO);
+  signal wrPtrGray_r      : Ptr_t     := (others => ZERO);
+  signal rdPtrGrayMeta_r  : Ptr_t     := (others => ZERO);
+  signal rdPtrGrayDrck_r  : Ptr_t     := (others => ZERO);  -- Read pointer sync'ed to the JTAG clock domain.
+  signal rdPtrDrck_s      : Ptr_t;
+  signal full_s           : std_logic;
+  -- Memory clock domain.
+  signal rdPtr_r          : Ptr_t     := (others => ZERO);
+  signal rdPtrGray_r      : Ptr_t     := (others => ZERO);
+  signal wrPtrGrayMeta_r  : Ptr_t     := (others => ZERO);
+  signal wrPtrGrayClk_r   : Ptr_t     := (others => ZERO);  -- Write pointer sync'ed to the memory clock domain.
+  signal entry_r          : Entry_t;    -- Address and data of the memory write in progress.
+  signal busy_r           : std_logic := NO;
+  signal memWr_r          : std_logic := NO;
+begin
+
+  -- Post writes from the HostIoToRamCore into the FIFO.
+  process(drck_i)
+  begin
+    if rising_edge(drck_i) then
+      rdPtrGrayMeta_r <= rdPtrGray_r;
+      rdPtrGrayDrck_r <= rdPtrGrayMeta_r;
+      if reset_i = HI then
+        wrPtr_r     <= (others => ZERO);
+        wrPtrGray_r <= (others => ZERO);
+      elsif wr_i = HI and full_s = NO then
+        fifo_r(CONV_INTEGER(wrPtr_r(PTR_WIDTH_C-1 downto 0))) <= addr_i & data_i;
+        wrPtr_r     <= wrPtr_r + 1;
+        wrPtrGray_r <= BinaryToGray(wrPtr_r + 1);
+      end if;
+    end if;
+  end process;
+
+  rdPtrDrck_s <= GrayToBinary(rdPtrGrayDrck_r);
+  full_s      <= YES when wrPtr_r(PTR_WIDTH_C) /= rdPtrDrck_s(PTR_WIDTH_C)
+                 and wrPtr_r(PTR_WIDTH_C-1 downto 0) = rdPtrDrck_s(PTR_WIDTH_C-1 downto 0) else NO;
+  wrDone_o    <= wr_i and not full_s;  -- The HostIoToRamCore can go on as soon as the write is in the FIFO.
+  drained_o   <= YES when wrPtrGray_r = rdPtrGrayDrck_r else NO;
+
+  -- Drain the FIFO into the memory one write at a time.
+  process(clk_i)
+  begin
+    if rising_edge(clk_i) then
+      wrPtrGrayMeta_r <= wrPtrGray_r;
+      wrPtrGrayClk_r  <= wrPtrGrayMeta_r;
+      if reset_i = HI then
+        rdPtr_r     <= (others => ZERO);
+        rdPtrGray_r <= (others => ZERO);
+        busy_r      <= NO;
+        memWr_r     <= NO;
+      elsif busy_r = NO then
+        if rdPtrGray_r /= wrPtrGrayClk_r then  -- FIFO isn't empty, so start the next write.
+          entry_r <= fifo_r(CONV_INTEGER(rdPtr_r(PTR_WIDTH_C-1 downto 0)));
+          memWr_r <= HI;
+          busy_r  <= YES;
+        end if;
+      else
+        if opBegun_i = HI or done_i = HI then
+          memWr_r <= LO;
+        end if;
+        if done_i = HI then  -- Write is done, so release the FIFO entry.
+          busy_r      <= NO;
+          rdPtr_r     <= rdPtr_r + 1;
+          rdPtrGray_r <= BinaryToGray(rdPtr_r + 1);
+        end if;
+      end if;
+    end if;
+  end process;
+
+  addr_o <= entry_r(entry_r'high downto data_i'length);
+  data_o <= entry_r(data_i'length-1 downto 0);
+  wr_o   <= memWr_r;
+  busy_o <= busy_r;
+
+end architecture;
+
+
+
+
 
 --**************************************************************************************************
 -- This module combines the HostIoToRamCore with two RamCtrlSync modules for the R/W control
 -- signals to form a complete interface between the JTAG port and a memory device.
+--
+-- If RD_PREFETCH_G is greater than zero, a RamRdPrefetch module is placed between the
+-- RamCtrlSync modules and the memory. It reads up to RD_PREFETCH_G words ahead of the host
+-- so reads stream back at the full DRCK rate even when the memory is slow to finish a read.
+-- (This reads a few locations past the end of each host read, so don't use it with memories
+-- or registers where a read has side effects.)
+--
+-- If WR_POST_G is greater than zero, writes from the host are posted into a RamWrPost FIFO
+-- and drained into the memory at its own pace. The host can send a NOP to see if the
+-- posted writes have all reached the memory (see the status query in HostIoToRamCore).
+-- Reads are held off until the posted writes have drained.
 --**************************************************************************************************
 
 library IEEE;
@@ -701,7 +1246,9 @@ entity HostIoToRam is
     FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;   -- FPGA device type.
     TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
     SIMPLE_G           : boolean          := false;  -- If true, include BscanToHostIo module in this module.
-    SYNC_G             : boolean          := true  -- If true, sync this module with the memory clock domain.
+    SYNC_G             : boolean          := true;  -- If true, sync this module with the memory clock domain.
+    RD_PREFETCH_G      : natural          := 0;  -- If >0, read this many words ahead of the host (needs SYNC_G).
+    WR_POST_G          : natural          := 0  -- If >0, post up to this many writes to the memory (needs SYNC_G).
     );
   port (
     reset_i        : in  std_logic := LO;  -- Active-high reset signal.
@@ -725,16 +1272,31 @@ end entity;
 
 architecture arch of HostIoToRam is
   -- Internal memory signals.
-  signal wr_s        : std_logic;
-  signal rd_s        : std_logic;
-  signal wrDone_s    : std_logic;
-  signal rdDone_s    : std_logic;
-  signal rwDone_s    : std_logic;
+  signal wr_s           : std_logic;
+  signal rd_s           : std_logic;
+  signal rdGated_s      : std_logic;
+  signal wrDone_s       : std_logic;
+  signal rdDone_s       : std_logic;
+  signal rwDone_s       : std_logic;
+  signal wrDrained_s    : std_logic;
+  signal addr_s         : std_logic_vector(addr_o'range);
+  signal dataFromHost_s : std_logic_vector(dataFromHost_o'range);
+  signal dataToHost_s   : std_logic_vector(dataToHost_i'range);
+  signal active_s       : std_logic;
+  -- Internal memory signals in the memory clock domain.
+  signal wrReqM_s       : std_logic;
+  signal wrBegunM_s     : std_logic;
+  signal wrDoneM_s      : std_logic;
+  signal wrBusyM_s      : std_logic;
+  signal wrAddrM_s      : std_logic_vector(addr_o'range);
+  signal rdReqM_s       : std_logic;
+  signal rdBegunM_s     : std_logic;
+  signal rdDoneM_s      : std_logic;
   -- Internal JTAG signals.
-  signal inShiftDr_s : std_logic;
-  signal drck_s      : std_logic;
-  signal tdi_s       : std_logic;
-  signal tdo_s       : std_logic;
+  signal inShiftDr_s    : std_logic;
+  signal drck_s         : std_logic;
+  signal tdi_s          : std_logic;
+  signal tdo_s          : std_logic;
 begin
 
   -- If you're only interfacing the JTAG port to a single module, then the
@@ -779,36 +1341,75 @@ begin
       drck_i         => drck_s,
       tdi_i          => tdi_s,
       tdo_o          => tdo_s,
-      addr_o         => addr_o,
+      addr_o         => addr_s,
       wr_o           => wr_s,
-      dataFromHost_o => dataFromHost_o,
+      dataFromHost_o => dataFromHost_s,
       rd_o           => rd_s,
-      dataToHost_i   => dataToHost_i,
-      rwDone_i       => rwDone_s
+      dataToHost_i   => dataToHost_s,
+      rwDone_i       => rwDone_s,
+      wrDrained_i    => wrDrained_s,
+      active_o       => active_s
       );
 
   -- Synchronize the JTAG interface to the memory clock domain.
   USync : if SYNC_G = true generate
   begin
-    UWrRamCtrlSync : RamCtrlSync
-      port map (
-        drck_i    => drck_s,
-        clk_i     => clk_i,
-        ctrlIn_i  => wr_s,
-        ctrlOut_o => wr_o,
-        opBegun_i => opBegun_i,
-        doneIn_i  => done_i,
-        doneOut_o => wrDone_s
-        );
+
+    -- Post writes into a FIFO so the host doesn't have to wait for the memory.
+    UWrPost : if WR_POST_G > 0 generate
+    begin
+      URamWrPost : RamWrPost
+        generic map (
+          DEPTH_G => WR_POST_G
+          )
+        port map (
+          reset_i   => reset_i,
+          drck_i    => drck_s,
+          addr_i    => addr_s,
+          data_i    => dataFromHost_s,
+          wr_i      => wr_s,
+          wrDone_o  => wrDone_s,
+          drained_o => wrDrained_s,
+          clk_i     => clk_i,
+          addr_o    => wrAddrM_s,
+          data_o    => dataFromHost_o,
+          wr_o      => wrReqM_s,
+          busy_o    => wrBusyM_s,
+          opBegun_i => wrBegunM_s,
+          done_i    => wrDoneM_s
+          );
+    end generate;
+
+    -- Or do each write to the memory while the host waits.
+    UWrNoPost : if WR_POST_G = 0 generate
+    begin
+      UWrRamCtrlSync : RamCtrlSync
+        port map (
+          drck_i    => drck_s,
+          clk_i     => clk_i,
+          ctrlIn_i  => wr_s,
+          ctrlOut_o => wrReqM_s,
+          opBegun_i => wrBegunM_s,
+          doneIn_i  => wrDoneM_s,
+          doneOut_o => wrDone_s
+          );
+      wrAddrM_s      <= addr_s;
+      wrBusyM_s      <= wrReqM_s;
+      dataFromHost_o <= dataFromHost_s;
+      wrDrained_s    <= HI;
+    end generate;
+
+    -- Hold off reads until any posted writes have reached the memory so the host never reads stale data.
+    rdGated_s <= rd_s and wrDrained_s;
 
     URdRamCtrlSync : RamCtrlSync
       port map (
         drck_i    => drck_s,
         clk_i     => clk_i,
-        ctrlIn_i  => rd_s,
-        ctrlOut_o => rd_o,
-        opBegun_i => opBegun_i,
-        doneIn_i  => done_i,
+        ctrlIn_i  => rdGated_s,
+        ctrlOut_o => rdReqM_s,
+        opBegun_i => rdBegunM_s,
+        doneIn_i  => rdDoneM_s,
         doneOut_o => rdDone_s
         );
 
@@ -816,14 +1417,69 @@ begin
     -- so OR their done signals together to create a unified
     -- "memory operation done" signal.
     rwDone_s <= rdDone_s or wrDone_s;
+
+    -- Read ahead of the host so the memory latency doesn't slow down reads.
+    UPrefetch : if RD_PREFETCH_G > 0 generate
+      signal activeSync_s : std_logic;  -- HostIoToRamCore active signal sync'ed to the memory clock domain.
+      signal flush_s      : std_logic;
+      signal pfAddr_s     : std_logic_vector(addr_o'range);
+    begin
+      -- Throw away the prefetched data once the host is done with this module.
+      UActiveSync : SyncToClock port map (clk_i => clk_i, unsynced_i => active_s, synced_o => activeSync_s);
+      flush_s <= reset_i or not activeSync_s;
+
+      pfAddr_s <= wrAddrM_s when wrReqM_s = HI else addr_s;
+
+      URamRdPrefetch : RamRdPrefetch
+        generic map (
+          DEPTH_G  => RD_PREFETCH_G,
+          ADDR_INC => ADDR_INC
+          )
+        port map (
+          clk_i     => clk_i,
+          flush_i   => flush_s,
+          addr_i    => pfAddr_s,
+          wr_i      => wrReqM_s,
+          wrBegun_o => wrBegunM_s,
+          wrDone_o  => wrDoneM_s,
+          rd_i      => rdReqM_s,
+          rdDone_o  => rdDoneM_s,
+          data_o    => dataToHost_s,
+          addr_o    => addr_o,
+          wr_o      => wr_o,
+          rd_o      => rd_o,
+          data_i    => dataToHost_i,
+          opBegun_i => opBegun_i,
+          done_i    => done_i
+          );
+      rdBegunM_s <= LO;
+    end generate;
+
+    -- Or connect the read and write controls straight to the memory.
+    UNoPrefetch : if RD_PREFETCH_G = 0 generate
+    begin
+      addr_o       <= wrAddrM_s when wrBusyM_s = YES else addr_s;
+      wr_o         <= wrReqM_s;
+      rd_o         <= rdReqM_s;
+      wrBegunM_s   <= opBegun_i;
+      wrDoneM_s    <= done_i;
+      rdBegunM_s   <= opBegun_i;
+      rdDoneM_s    <= done_i;
+      dataToHost_s <= dataToHost_i;
+    end generate;
+
   end generate;
 
   -- Don't synchronize the JTAG interface to the memory clock domain.
   UUnsync : if SYNC_G = false generate
   begin
-    rwDone_s <= done_i;
-    rd_o     <= rd_s;
-    wr_o     <= wr_s;
+    addr_o         <= addr_s;
+    dataFromHost_o <= dataFromHost_s;
+    dataToHost_s   <= dataToHost_i;
+    wrDrained_s    <= HI;
+    rwDone_s       <= done_i;
+    rd_o           <= rd_s;
+    wr_o           <= wr_s;
   end generate;
 
 end architecture;
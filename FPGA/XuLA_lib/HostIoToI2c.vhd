@@ -61,6 +61,8 @@ package HostIoToI2cPckg is
 
   component HostIoToI2c is
     generic (
+      FREQ_G             : real             := 100.0;  -- Main clock frequency (MHz).
+      I2C_FREQ_G         : real             := 0.1;  -- I2C clock frequency (MHz). Use 1.0 for fast mode plus.
       ID_G               : std_logic_vector := "11111111";  -- The ID this module responds to.
       PYLD_CNTR_LENGTH_G : natural          := 32;  -- Length of payload bit counter.
       FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
@@ -97,6 +99,8 @@ use work.I2cPckg.all;
 
 entity HostIoToI2c is
   generic (
+    FREQ_G             : real             := 100.0;  -- Main clock frequency (MHz).
+    I2C_FREQ_G         : real             := 0.1;  -- I2C clock frequency (MHz). Use 1.0 for fast mode plus.
     ID_G               : std_logic_vector := "11111111";  -- The ID this module responds to.
     PYLD_CNTR_LENGTH_G : natural          := 32;  -- Length of payload bit counter.
     FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;   -- FPGA device type.
@@ -120,7 +124,7 @@ end entity;
 
 
 architecture arch of HostIoToI2c is
-  signal addr_s         : std_logic_vector(2 downto 0);  -- Register address in I2C interface.
+  signal addr_s         : std_logic_vector(3 downto 0);  -- Register address in I2C interface.
   signal wr_s           : std_logic;  -- Active-high write to I2C interface register.
   signal rd_s           : std_logic;  -- Active-high read of I2C interface register.
   signal dataFromHost_s : std_logic_vector(7 downto 0);  -- Data from PC to I2C slave.
@@ -162,8 +166,8 @@ begin
   -- Instantiate an I2C interface module.
   u2 : I2c
     generic map(
-      FREQ_G     => 100.0,              -- Main clock frequency (MHz).
-      I2C_FREQ_G => 0.1                 -- I2C clock frequency (MHz).
+      FREQ_G     => FREQ_G,             -- Main clock frequency (MHz).
+      I2C_FREQ_G => I2C_FREQ_G          -- I2C clock frequency (MHz).
       )
     port map(
       rst_i   => reset_i,               -- Active-high reset input.
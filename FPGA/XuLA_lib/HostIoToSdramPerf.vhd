@@ -0,0 +1,169 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+--**********************************************************************
+-- This module lets a host PC read and clear the performance counters
+-- of an SdramCntl module (built with PERF_CNTRS_G => true). It has its
+-- own HostIo ID so it can sit alongside the HostIoToRam module that
+-- gives the host access to the SDRAM itself.
+--
+--                   +------------------------XuLA Board-----------------------+
+-- +---------+       | +---uC---+          +---------------FPGA--------------+ |
+-- | Host PC |<--USB-->| PIC18F |<--JTAG-->| HostIoToSdramPerf <-- SdramCntl | |
+-- +---------+       | +--------+          +---------------------------------+ |
+--                   +---------------------------------------------------------+
+--
+-- The counters appear as NUM_PERF_CNTRS_C 32-bit registers at the
+-- addresses given by the counter indices in SdramCntlPckg (ROW_HITS_C,
+-- ROW_MISSES_C, ...). Reading the register at address 0 takes a snapshot
+-- of all the counters at once and every register, including address 0,
+-- is read from that snapshot so a multi-word read starting at address 0
+-- gets a consistent set of counts. Writing any value to any address
+-- clears all the counters.
+--**********************************************************************
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use work.CommonPckg.all;
+use work.HostIoPckg.all;
+use work.SdramCntlPckg.all;
+
+package HostIoToSdramPerfPckg is
+
+  component HostIoToSdramPerf is
+    generic (
+      ID_G               : std_logic_vector := "11111111";  -- The ID this module responds to.
+      PYLD_CNTR_LENGTH_G : natural          := 32;  -- Length of payload bit counter.
+      FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
+      TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
+      SIMPLE_G           : boolean          := false  -- If true, include BscanToHostIo module in this module.
+      );
+    port (
+      reset_i     : in  std_logic := LO;  -- Active-high reset signal.
+      clk_i       : in  std_logic;      -- Master clock (same as the SdramCntl clock).
+      -- Interface to BscanHostIo. (Used only if SIMPLE_G is false.)
+      inShiftDr_i : in  std_logic := LO;  -- True when USER JTAG instruction is active and the TAP FSM is in the Shift-DR state.
+      drck_i      : in  std_logic := LO;  -- Bit clock. TDI clocked in on rising edge, TDO sampled on falling edge.
+      tdi_i       : in  std_logic := LO;  -- Bit from the host to the counters.
+      tdo_o       : out std_logic;      -- Bit from the counters to the host.
+      -- Interface to SdramCntl.
+      perfCntrs_i : in  std_logic_vector(NUM_PERF_CNTRS_C*PERF_CNTR_LENGTH_C-1 downto 0);  -- Performance counters.
+      perfClear_o : out std_logic       -- Clear the performance counters.
+      );
+  end component;
+
+end package;
+
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CommonPckg.all;
+use work.HostIoPckg.all;
+use work.SdramCntlPckg.all;
+
+entity HostIoToSdramPerf is
+  generic (
+    ID_G               : std_logic_vector := "11111111";  -- The ID this module responds to.
+    PYLD_CNTR_LENGTH_G : natural          := 32;  -- Length of payload bit counter.
+    FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
+    TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
+    SIMPLE_G           : boolean          := false  -- If true, include BscanToHostIo module in this module.
+    );
+  port (
+    reset_i     : in  std_logic := LO;  -- Active-high reset signal.
+    clk_i       : in  std_logic;        -- Master clock (same as the SdramCntl clock).
+    -- Interface to BscanHostIo. (Used only if SIMPLE_G is false.)
+    inShiftDr_i : in  std_logic := LO;  -- True when USER JTAG instruction is active and the TAP FSM is in the Shift-DR state.
+    drck_i      : in  std_logic := LO;  -- Bit clock. TDI clocked in on rising edge, TDO sampled on falling edge.
+    tdi_i       : in  std_logic := LO;  -- Bit from the host to the counters.
+    tdo_o       : out std_logic;        -- Bit from the counters to the host.
+    -- Interface to SdramCntl.
+    perfCntrs_i : in  std_logic_vector(NUM_PERF_CNTRS_C*PERF_CNTR_LENGTH_C-1 downto 0);  -- Performance counters.
+    perfClear_o : out std_logic         -- Clear the performance counters.
+    );
+end entity;
+
+
+architecture arch of HostIoToSdramPerf is
+  signal addr_s         : std_logic_vector(Log2(NUM_PERF_CNTRS_C)-1 downto 0);  -- Counter address.
+  signal wr_s           : std_logic;  -- Active-high write (clears the counters).
+  signal rd_s           : std_logic;  -- Active-high read of a counter.
+  signal dataFromHost_s : std_logic_vector(PERF_CNTR_LENGTH_C-1 downto 0);  -- Data from PC (ignored).
+  signal dataToHost_s   : std_logic_vector(PERF_CNTR_LENGTH_C-1 downto 0);  -- Counter value to PC.
+  signal snapshot_r     : std_logic_vector(perfCntrs_i'range) := (others => ZERO);  -- Counters captured by the last read of address 0.
+  signal rdPrev_r       : std_logic                           := NO;  -- Read control from the previous clock cycle.
+begin
+
+  -- Instantiate an interface between the JTAG port and the counters.
+  u1 : HostIoToRam
+    generic map(
+      ID_G               => ID_G,
+      PYLD_CNTR_LENGTH_G => PYLD_CNTR_LENGTH_G,
+      FPGA_DEVICE_G      => FPGA_DEVICE_G,
+      TAP_USER_INSTR_G   => TAP_USER_INSTR_G,
+      SIMPLE_G           => SIMPLE_G,
+      SYNC_G             => true,
+      ADDR_INC           => 1  -- So the host can read all the counters in one go.
+      )
+    port map(
+      reset_i        => reset_i,        -- Active-high reset input.
+      clk_i          => clk_i,          -- Master clock input.
+      -- JTAG interface.
+      inShiftDr_i    => inShiftDr_i,
+      drck_i         => drck_i,
+      tdi_i          => tdi_i,
+      tdo_o          => tdo_o,
+      -- Interface to the counters.
+      addr_o         => addr_s,         -- Counter address from PC.
+      wr_o           => wr_s,           -- Write control from PC.
+      rd_o           => rd_s,           -- Read control from PC.
+      dataFromHost_o => dataFromHost_s,  -- Data from PC.
+      dataToHost_i   => dataToHost_s    -- Counter value to PC.
+      );
+
+  -- Take a snapshot of all the counters when a read of the first one begins.
+  -- Only the leading edge of the read is used so the snapshot holds still
+  -- while the JTAG side picks up the value.
+  process(clk_i)
+  begin
+    if rising_edge(clk_i) then
+      rdPrev_r <= rd_s;
+      if (rd_s = HI) and (rdPrev_r = LO) and (unsigned(addr_s) = 0) then
+        snapshot_r <= perfCntrs_i;
+      end if;
+    end if;
+  end process;
+
+  -- Send the snapshot of every counter to the PC.
+  process(addr_s, snapshot_r)
+    variable cntr_v : natural range 0 to 2**addr_s'length-1;
+  begin
+    cntr_v := to_integer(unsigned(addr_s));
+    if cntr_v < NUM_PERF_CNTRS_C then
+      dataToHost_s <= snapshot_r((cntr_v+1)*PERF_CNTR_LENGTH_C-1 downto cntr_v*PERF_CNTR_LENGTH_C);
+    else
+      dataToHost_s <= (others => ZERO);
+    end if;
+  end process;
+
+  -- Any write from the PC clears the counters.
+  perfClear_o <= wr_s;
+
+end architecture;
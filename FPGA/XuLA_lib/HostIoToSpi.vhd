@@ -72,7 +72,8 @@ package HostIoToSpiPckg is
       FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
       TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
       SIMPLE_G           : boolean          := false;  -- If true, include BscanToHostIo module in this module.
-      SYNC_G             : boolean          := true  -- If true, sync this module with the SPI clock domain.
+      SYNC_G             : boolean          := true;  -- If true, sync this module with the SPI clock domain.
+      FIFO_DEPTH_G       : natural          := 512  -- # of bytes in each of the SPI burst FIFOs.
       );
     port (
       reset_i     : in  std_logic := LO;  -- Active-high reset signal.
@@ -125,7 +126,8 @@ entity HostIoToSpi is
     FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;   -- FPGA device type.
     TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
     SIMPLE_G           : boolean          := false;  -- If true, include BscanToHostIo module in this module.
-    SYNC_G             : boolean          := true  -- If true, sync this module with the SPI clock domain.
+    SYNC_G             : boolean          := true;  -- If true, sync this module with the SPI clock domain.
+    FIFO_DEPTH_G       : natural          := 512  -- # of bytes in each of the SPI burst FIFOs.
     );
   port (
     reset_i     : in  std_logic := LO;  -- Active-high reset signal.
@@ -145,7 +147,7 @@ end entity;
 
 
 architecture arch of HostIoToSpi is
-  signal addr_s         : std_logic_vector(1 downto 0);  -- Register address in SPI interface.
+  signal addr_s         : std_logic_vector(2 downto 0);  -- Register address in SPI interface.
   signal wr_s           : std_logic;  -- Active-high write to SPI interface register.
   signal rd_s           : std_logic;  -- Active-high read of SPI interface register.
   signal dataFromHost_s : std_logic_vector(DATA_LENGTH_G-1 downto 0);  -- Data from PC to SPI slave.
@@ -188,10 +190,11 @@ begin
   -- Instantiate an SPI master interface module.
   u2 : SpiMaster
     generic map(
-      FREQ_G     => FREQ_G,             -- Main clock frequency (MHz).
-      SPI_FREQ_G => SPI_FREQ_G,         -- SPI clock frequency (MHz).
-      CPOL_G     => CPOL_G,             -- SCK polarity.
-      CPHA_G     => CPHA_G              -- Sampling edge.
+      FREQ_G       => FREQ_G,           -- Main clock frequency (MHz).
+      SPI_FREQ_G   => SPI_FREQ_G,       -- SPI clock frequency (MHz).
+      CPOL_G       => CPOL_G,           -- SCK polarity.
+      CPHA_G       => CPHA_G,           -- Sampling edge.
+      FIFO_DEPTH_G => FIFO_DEPTH_G      -- Size of burst FIFOs.
       )
     port map(
       rst_i   => reset_i,               -- Active-high reset input.
@@ -16,6 +16,10 @@ use work.CommonPckg.all;
 package I2cPckg is
 
   component i2c_master_bit_ctrl is
+    generic (
+      FREQ_G     : real := 100.0;       -- Master clock frequency (MHz).
+      I2C_FREQ_G : real := 0.1          -- I2C clock frequency (MHz). Above 0.4, FM+ timing is used.
+      );
     port (
       clk    : in std_logic;
       rst    : in std_logic;
@@ -43,6 +47,10 @@ package I2cPckg is
   end component;
 
   component i2c_master_byte_ctrl is
+    generic (
+      FREQ_G     : real := 100.0;       -- Master clock frequency (MHz).
+      I2C_FREQ_G : real := 0.1          -- I2C clock frequency (MHz). Above 0.4, FM+ timing is used.
+      );
     port (
       clk    : in std_logic;
       rst    : in std_logic;  -- synchronous active high reset (WISHBONE compatible)
@@ -108,13 +116,14 @@ package I2cPckg is
 
   component I2c is
     generic(
-      FREQ_G     : real := 100.0;       -- Main clock frequency (MHz).
-      I2C_FREQ_G : real := 0.1          -- I2C clock frequency (MHz).
+      FREQ_G       : real    := 100.0;  -- Main clock frequency (MHz).
+      I2C_FREQ_G   : real    := 0.1;    -- I2C clock frequency (MHz).
+      FIFO_DEPTH_G : natural := 512     -- # of bytes in each of the transaction list FIFOs.
       );
     port (
       clk_i  : in    std_logic;         -- Master clock input.
       rst_i  : in    std_logic := LO;   -- Synchronous active high reset.
-      addr_i : in    std_logic_vector(2 downto 0);  -- Lower address bits.
+      addr_i : in    std_logic_vector(3 downto 0);  -- Lower address bits.
       data_i : in    std_logic_vector(7 downto 0);  -- Databus input.
       data_o : out   std_logic_vector(7 downto 0);  -- Databus output.
       wr_i   : in    std_logic;         -- Write enable input.
@@ -194,21 +203,36 @@ end package;
 --                x | A | B | C | D | i
 --
 
--- Timing:      Normal mode     Fast mode
+-- Timing:      Normal mode     Fast mode       Fast mode plus
 -----------------------------------------------------------------
--- Fscl         100KHz          400KHz
--- Th_scl       4.0us           0.6us   High period of SCL
--- Tl_scl       4.7us           1.3us   Low period of SCL
--- Tsu:sta      4.7us           0.6us   setup time for a repeated start condition
--- Tsu:sto      4.0us           0.6us   setup time for a stop conditon
--- Tbuf         4.7us           1.3us   Bus free time between a stop and start condition
+-- Fscl         100KHz          400KHz          1MHz
+-- Th_scl       4.0us           0.6us           0.26us  High period of SCL
+-- Tl_scl       4.7us           1.3us           0.5us   Low period of SCL
+-- Tsu:sta      4.7us           0.6us           0.26us  setup time for a repeated start condition
+-- Tsu:sto      4.0us           0.6us           0.26us  setup time for a stop conditon
+-- Tbuf         4.7us           1.3us           0.5us   Bus free time between a stop and start condition
+--
+-- XESS: In normal and fast mode, every state lasts clk_cnt+1 clocks so
+-- SCL is high for 2 states and low for 3. In fast mode plus (I2C_FREQ_G
+-- above 0.4 MHz), the state lengths come from FREQ_G and I2C_FREQ_G
+-- instead of clk_cnt: the SCL high and low states are sized to meet
+-- Th_scl and Tl_scl with the SCL rise time taken out of the period, and
+-- the start and stop states are sized for Tsu:sta, Thd:sta and Tsu:sto.
+-- SCL and SDA are also filtered over about 50ns (the FM+ spike limit)
+-- instead of over a quarter state, so the end of a clock stretch by a
+-- slave is seen right away rather than a large part of a state later.
 --
 
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
+use ieee.math_real.all;
 
 entity i2c_master_bit_ctrl is
+  generic (
+    FREQ_G     : real := 100.0;         -- Master clock frequency (MHz).
+    I2C_FREQ_G : real := 0.1            -- I2C clock frequency (MHz). Above 0.4, FM+ timing is used.
+    );
   port (
     clk    : in std_logic;
     rst    : in std_logic;
@@ -256,7 +280,36 @@ architecture structural of i2c_master_bit_ctrl is
   signal ial                  : std_logic;  -- internal arbitration lost signal
   signal cnt                  : unsigned(15 downto 0);  -- clock divider counter (synthesis)
 
+  -- XESS: fast mode plus timing (all times in us).
+  constant FMP_C          : boolean := I2C_FREQ_G > 0.4;
+  constant T_LOW_MIN_C    : real    := 0.5;
+  constant T_HIGH_MIN_C   : real    := 0.26;
+  constant T_STA_STO_C    : real    := 0.26;  -- Tsu:sta, Thd:sta and Tsu:sto.
+  constant T_RISE_C       : real    := 0.12;  -- Max. SCL rise time.
+  constant T_FILTER_C     : real    := 0.05;  -- Spike filter time.
+  constant T_SLACK_C      : real    := realmax(0.0, 1.0 / realmax(I2C_FREQ_G, 0.001) - T_RISE_C - T_FILTER_C - T_LOW_MIN_C - T_HIGH_MIN_C);
+  constant T_LOW_C        : real    := T_LOW_MIN_C + T_SLACK_C * T_LOW_MIN_C / (T_LOW_MIN_C + T_HIGH_MIN_C);
+  constant T_HIGH_C       : real    := T_HIGH_MIN_C + T_SLACK_C * T_HIGH_MIN_C / (T_LOW_MIN_C + T_HIGH_MIN_C);
+  -- SCL is low for 3 states and high for 2, and the counter runs for cnt+1 clocks.
+  constant LOW_CNT_C      : unsigned(15 downto 0) := to_unsigned(integer(realmax(1.0, ceil(T_LOW_C * FREQ_G / 3.0))) - 1, 16);
+  constant HIGH_CNT_C     : unsigned(15 downto 0) := to_unsigned(integer(realmax(1.0, ceil(T_HIGH_C * FREQ_G / 2.0))) - 1, 16);
+  constant STA_STO_CNT_C  : unsigned(15 downto 0) := to_unsigned(integer(realmax(1.0, ceil(T_STA_STO_C * FREQ_G))) - 1, 16);
+  -- Three filter samples span the spike filter time.
+  constant FILTER_CNT_C   : unsigned(13 downto 0) := to_unsigned(integer(realmax(1.0, ceil(T_FILTER_C * FREQ_G / 3.0))) - 1, 14);
+  signal   state_cnt      : unsigned(15 downto 0);  -- length of the current state
+  signal   filter_cnt_rld : unsigned(13 downto 0);  -- filter sampling interval
+
 begin
+  -- XESS: the length of each state and the filter sampling interval come from the
+  -- prescale value, or from the FM+ timing constants.
+  state_cnt <= clk_cnt when not FMP_C else
+               HIGH_CNT_C when c_state = rd_b or c_state = rd_c or c_state = wr_b or c_state = wr_c else
+               STA_STO_CNT_C when c_state = start_a or c_state = start_b or c_state = start_c or c_state = start_d or
+                                  c_state = start_e or c_state = stop_a or c_state = stop_b or c_state = stop_c or
+                                  c_state = stop_d else
+               LOW_CNT_C;
+  filter_cnt_rld <= clk_cnt(15 downto 2) when not FMP_C else FILTER_CNT_C;
+
   -- whenever the slave is not ready it can delay the cycle by pulling SCL low
   -- delay scl_oen
   process (clk, nReset)
@@ -291,7 +344,7 @@ begin
       clk_en <= '1';
     elsif (clk'event and clk = '1') then
       if ((rst = '1') or (cnt = 0) or (ena = '0') or (scl_sync = '1')) then
-        cnt    <= clk_cnt;
+        cnt    <= state_cnt;
         clk_en <= '1';
       elsif (slave_wait = '1') then
         cnt    <= cnt;
@@ -340,7 +393,7 @@ begin
         if ((rst = '1') or (ena = '0')) then
           filter_cnt <= (others => '0');
         elsif (filter_cnt = 0) then
-          filter_cnt <= clk_cnt(15 downto 2);
+          filter_cnt <= filter_cnt_rld;
         else
           filter_cnt <= filter_cnt -1;
         end if;
@@ -686,6 +739,10 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
 entity i2c_master_byte_ctrl is
+  generic (
+    FREQ_G     : real := 100.0;         -- Master clock frequency (MHz).
+    I2C_FREQ_G : real := 0.1            -- I2C clock frequency (MHz). Above 0.4, FM+ timing is used.
+    );
   port (
     clk    : in std_logic;
     rst    : in std_logic;  -- synchronous active high reset (WISHBONE compatible)
@@ -721,6 +778,10 @@ end entity i2c_master_byte_ctrl;
 
 architecture structural of i2c_master_byte_ctrl is
   component i2c_master_bit_ctrl is
+    generic (
+      FREQ_G     : real := 100.0;       -- Master clock frequency (MHz).
+      I2C_FREQ_G : real := 0.1          -- I2C clock frequency (MHz). Above 0.4, FM+ timing is used.
+      );
     port (
       clk    : in std_logic;
       rst    : in std_logic;
@@ -770,25 +831,30 @@ architecture structural of i2c_master_byte_ctrl is
 
 begin
   -- hookup bit_controller
-  bit_ctrl : i2c_master_bit_ctrl port map(
-    clk     => clk,
-    rst     => rst,
-    nReset  => nReset,
-    ena     => ena,
-    clk_cnt => clk_cnt,
-    cmd     => core_cmd,
-    cmd_ack => core_ack,
-    busy    => i2c_busy,
-    al      => al,
-    din     => core_txd,
-    dout    => core_rxd,
-    scl_i   => scl_i,
-    scl_o   => scl_o,
-    scl_oen => scl_oen,
-    sda_i   => sda_i,
-    sda_o   => sda_o,
-    sda_oen => sda_oen
-    );
+  bit_ctrl : i2c_master_bit_ctrl
+    generic map(
+      FREQ_G     => FREQ_G,
+      I2C_FREQ_G => I2C_FREQ_G
+      )
+    port map(
+      clk     => clk,
+      rst     => rst,
+      nReset  => nReset,
+      ena     => ena,
+      clk_cnt => clk_cnt,
+      cmd     => core_cmd,
+      cmd_ack => core_ack,
+      busy    => i2c_busy,
+      al      => al,
+      din     => core_txd,
+      dout    => core_rxd,
+      scl_i   => scl_i,
+      scl_o   => scl_o,
+      scl_oen => scl_oen,
+      sda_i   => sda_i,
+      sda_o   => sda_o,
+      sda_oen => sda_oen
+      );
   i2c_al <= al;
 
   -- generate host-command-acknowledge
@@ -1050,6 +1116,10 @@ end entity i2c_master_top;
 
 architecture structural of i2c_master_top is
   component i2c_master_byte_ctrl is
+    generic (
+      FREQ_G     : real := 100.0;       -- Master clock frequency (MHz).
+      I2C_FREQ_G : real := 0.1          -- I2C clock frequency (MHz). Above 0.4, FM+ timing is used.
+      );
     port (
       clk    : in std_logic;
       rst    : in std_logic;  -- synchronous active high reset (WISHBONE compatible)
@@ -1227,6 +1297,10 @@ begin
 
   -- hookup byte controller block
   byte_ctrl : i2c_master_byte_ctrl
+    generic map(
+      FREQ_G     => FREQ_G,
+      I2C_FREQ_G => I2C_FREQ_G
+      )
     port map (
       clk      => wb_clk_i,
       rst      => wb_rst_i,
@@ -1325,22 +1399,86 @@ end architecture structural;
 -- along with this program.  If not, see <http://www.gnu.org/licenses/>.
 --**********************************************************************
 
+--**********************************************************************
+-- Addresses 0-7 reach the registers of the i2c_master_top module.
+-- Addresses 8 and up are for an I2C transaction list sequencer:
+--
+--   1000: A write pushes a byte of a transaction list into the list
+--         FIFO and the list is executed as it arrives. A read pops a
+--         byte from the result FIFO. Writes stall while the list FIFO
+--         is full and reads stall while the result FIFO is empty.
+--   1001: A read returns the status:
+--           bit 0: list in progress.
+--           bit 1: list FIFO empty.
+--           bit 2: result FIFO empty.
+--           bit 3: arbitration was lost during the last list.
+--         A write clears the arbitration-lost flag. If bit 0 of the
+--         written byte is set, the list is also aborted: a stop is sent
+--         if the list left the bus in the middle of a transfer, and both
+--         FIFOs are emptied.
+--   1010: A read returns the number of results in the result FIFO
+--         (255 if there are more) and the next read of 1010 takes the
+--         first result out of the result FIFO and returns it, or
+--         returns 00 if the count was 0. (An access to any other
+--         register in between makes the next read of 1010 return the
+--         count again.)
+--
+-- The list is a sequence of these commands:
+--   00:          End of list.
+--   01:          Send a start (or a repeated start) with the next read or write.
+--   02:          Send a stop.
+--   03 n d...:   Write n+1 bytes d.... One result byte is stored with
+--                bit 0 set if any byte wasn't ACKed by the slave and
+--                bit 1 set if arbitration was lost.
+--   04 n:        Read n+1 bytes and store them as results. Every byte
+--                is ACKed except the last one.
+--   05 n:        Same as 04, but the last byte is ACKed as well so the
+--                read can be continued by another command.
+--   06 l h:      Wait for h*256+l microseconds.
+-- Unknown commands are ignored.
+--
+-- If arbitration is lost, the rest of the list up to its 00 is read
+-- but not done: no more bytes are read or written (each write command
+-- still stores its result byte with bit 1 set) and the stops and waits
+-- are skipped.
+--
+-- Host accesses to the i2c_master_top registers wait while a list is
+-- running. The sequencer enables the I2C core when a list starts.
+--
+-- A JTAG scan can't wait for a stalled read of address 8, so the
+-- results of a list are read back through address 10 instead. A single
+-- scan writes the list to address 8, reads address 10 in pairs (the
+-- number of results and then a result) and finally reads address 9.
+-- A pair whose count is 0 was read before the list stored its next
+-- result, so its second byte is 00 and is just padding. The host reads
+-- enough pairs to cover the time the list takes to run, keeps the
+-- results from the pairs with nonzero counts, and gets the ACK status
+-- of the writes from their result bytes and the arbitration status
+-- from address 9. If bit 0 of address 9 shows the list was still
+-- running, the scan was too short and the rest of the results can be
+-- read with another one. A list that's missing its 00 or was cut short
+-- keeps bit 0 set, so the host has to give up on it after a while and
+-- abort it by writing 01 to address 9.
+--**********************************************************************
+
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 use ieee.math_real.all;
 use work.CommonPckg.all;
 use work.I2CPckg.all;
+use work.fifoPckg.all;
 
 entity I2c is
   generic(
-    FREQ_G     : real := 100.0;         -- Main clock frequency (MHz).
-    I2C_FREQ_G : real := 0.1            -- I2C clock frequency (MHz).
+    FREQ_G       : real    := 100.0;    -- Main clock frequency (MHz).
+    I2C_FREQ_G   : real    := 0.1;      -- I2C clock frequency (MHz).
+    FIFO_DEPTH_G : natural := 512       -- # of bytes in each of the transaction list FIFOs.
     );
   port (
     clk_i  : in    std_logic;           -- Master clock input.
     rst_i  : in    std_logic := LO;     -- Synchronous active high reset.
-    addr_i : in    std_logic_vector(2 downto 0);  -- Lower address bits.
+    addr_i : in    std_logic_vector(3 downto 0);  -- Lower address bits.
     data_i : in    std_logic_vector(7 downto 0);  -- Databus input.
     data_o : out   std_logic_vector(7 downto 0);  -- Databus output.
     wr_i   : in    std_logic;           -- Write enable input.
@@ -1352,11 +1490,421 @@ entity I2c is
 end entity;
 
 architecture arch of I2c is
+  subtype wbAddr_t is std_logic_vector(2 downto 0);
+  constant CTR_ADDR_C    : wbAddr_t := "010";  -- Control register.
+  constant TXR_ADDR_C    : wbAddr_t := "011";  -- Transmit register (write), receive register (read).
+  constant CR_ADDR_C     : wbAddr_t := "100";  -- Command register (write), status register (read).
+  constant CR_RD_ADDR_C  : wbAddr_t := "110";  -- Command register (read).
+  constant LIST_ADDR_C   : std_logic_vector(addr_i'range) := "1000";
+  constant STATUS_ADDR_C : std_logic_vector(addr_i'range) := "1001";
+  constant COUNT_ADDR_C  : std_logic_vector(addr_i'range) := "1010";
+  constant CLKS_PER_US_C : natural                        := integer(round(FREQ_G));
+  subtype listCmd_t is std_logic_vector(data_i'range);
+  constant LIST_END_C    : listCmd_t                      := x"00";
+  constant LIST_START_C  : listCmd_t                      := x"01";
+  constant LIST_STOP_C   : listCmd_t                      := x"02";
+  constant LIST_WR_C     : listCmd_t                      := x"03";
+  constant LIST_RD_C     : listCmd_t                      := x"04";
+  constant LIST_RD_ACK_C : listCmd_t                      := x"05";
+  constant LIST_WAIT_C   : listCmd_t                      := x"06";
+
   signal rd_or_wr_s              : std_logic;  -- True when either read or write occurs.
   signal scl_pad_s, scl_padoen_s : std_logic;
   signal sda_pad_s, sda_padoen_s : std_logic;
+
+  -- Wishbone bus of the I2C core, driven by the host or the sequencer.
+  signal wbAdr_s  : wbAddr_t;
+  signal wbDatI_s : std_logic_vector(data_i'range);
+  signal wbDatO_s : std_logic_vector(data_o'range);
+  signal wbWe_s   : std_logic;
+  signal wbStb_s  : std_logic;
+  signal wbAck_s  : std_logic;
+
+  -- Transaction list sequencer.
+  type seqState_t is (SEQ_IDLE, SEQ_FETCH, SEQ_ARG, SEQ_ARG_HI, SEQ_DELAY, SEQ_WR_DATA,
+                      SEQ_WR_CMD, SEQ_WR_ACK, SEQ_RD_CMD, SEQ_RD_DATA, SEQ_RD_PUSH,
+                      SEQ_POLL, SEQ_POLL_CHK, SEQ_STATUS, SEQ_PUSH, SEQ_WB);
+  signal seqBusy_r   : std_logic := NO;  -- The sequencer owns the Wishbone bus.
+  signal seqAdr_r    : wbAddr_t;
+  signal seqDat_r    : std_logic_vector(data_i'range);
+  signal seqWe_r     : std_logic := NO;
+  signal seqStb_r    : std_logic := NO;
+  signal seqDone_r   : std_logic := NO;  -- R/W of a sequencer register is done.
+  signal fifoRst_r   : std_logic := NO;  -- Empty the list and result FIFOs.
+  signal fifoRst_s   : std_logic;
+  signal seqData_r   : std_logic_vector(data_o'range);  -- Sequencer register data to the host.
+  signal al_r        : std_logic := NO;  -- Arbitration was lost during a list.
+  signal cmdWr_r     : std_logic := NO;
+  signal cmdRd_r     : std_logic := NO;
+  signal cmdIn_r     : std_logic_vector(data_i'range);
+  signal cmdOut_s    : std_logic_vector(data_i'range);
+  signal cmdEmpty_s  : std_logic;
+  signal cmdFull_s   : std_logic;
+  signal rsltWr_r    : std_logic := NO;
+  signal rsltRd_r    : std_logic := NO;
+  signal rsltIn_r    : std_logic_vector(data_o'range);
+  signal rsltOut_s   : std_logic_vector(data_o'range);
+  signal rsltEmpty_s : std_logic;
+  signal rsltFull_s  : std_logic;
+  signal rsltLevel_s : std_logic_vector(Log2(FIFO_DEPTH_G) downto 0);  -- # of results in the result FIFO.
 begin
-  rd_or_wr_s <= rd_i or wr_i;  -- Initiate a Wishbone bus cycle whenever read or write occurs.
+  -- Initiate a Wishbone bus cycle whenever the host reads or writes an I2C core register,
+  -- but not while the sequencer is using the bus.
+  rd_or_wr_s <= (rd_i or wr_i) and not addr_i(3) and not seqBusy_r;
+
+  wbAdr_s  <= seqAdr_r when seqBusy_r = YES else addr_i(2 downto 0);
+  wbDatI_s <= seqDat_r when seqBusy_r = YES else data_i;
+  wbWe_s   <= seqWe_r  when seqBusy_r = YES else wr_i;
+  wbStb_s  <= seqStb_r when seqBusy_r = YES else rd_or_wr_s;
+
+  data_o <= seqData_r when addr_i(3) = YES else wbDatO_s;
+  done_o <= seqDone_r or (wbAck_s and not seqBusy_r);
+
+  fifoRst_s <= rst_i or fifoRst_r;
+
+  -- Transaction list bytes from the host.
+  uCmdFifo : FifoSync
+    generic map(
+      DATA_WIDTH_G => data_i'length,
+      DEPTH_G      => FIFO_DEPTH_G,
+      FWFT_G       => true
+      )
+    port map(
+      clk_i   => clk_i,
+      rst_i   => fifoRst_s,
+      rd_i    => cmdRd_r,
+      wr_i    => cmdWr_r,
+      data_i  => cmdIn_r,
+      data_o  => cmdOut_s,
+      full_o  => cmdFull_s,
+      empty_o => cmdEmpty_s
+      );
+
+  -- Read data and write status from the list, waiting for the host.
+  uRsltFifo : FifoSync
+    generic map(
+      DATA_WIDTH_G => data_o'length,
+      DEPTH_G      => FIFO_DEPTH_G,
+      FWFT_G       => true
+      )
+    port map(
+      clk_i   => clk_i,
+      rst_i   => fifoRst_s,
+      rd_i    => rsltRd_r,
+      wr_i    => rsltWr_r,
+      data_i  => rsltIn_r,
+      data_o  => rsltOut_s,
+      full_o  => rsltFull_s,
+      empty_o => rsltEmpty_s,
+      level_o => rsltLevel_s
+      );
+
+  process (clk_i)
+    variable ackd_v     : boolean := false;  -- R/W of a sequencer register was acknowledged.
+    variable state_v    : seqState_t := SEQ_IDLE;
+    variable wbRtn_v    : seqState_t;   -- State to go to after a Wishbone access.
+    variable pollRtn_v  : seqState_t;   -- State to go to after an I2C command completes.
+    variable pushRtn_v  : seqState_t;   -- State to go to after storing a result.
+    variable wbData_v   : std_logic_vector(data_o'range);  -- Data read over the Wishbone bus.
+    variable pushData_v : std_logic_vector(data_o'range);  -- Result to store.
+    variable cmd_v      : listCmd_t;
+    variable sta_v      : std_logic := NO;  -- Send a start with the next read or write.
+    variable nack_v     : std_logic;    -- A written byte wasn't ACKed.
+    variable skip_v     : boolean := false;  -- Arbitration was lost, so skip the rest of the list.
+    variable open_v     : boolean := false;  -- A start was sent without a stop after it.
+    variable abort_v    : boolean := false;  -- The host wants the list aborted.
+    variable rsltPair_v : boolean := false;  -- The next read of the count register is the 2nd of a pair.
+    variable rsltPop_v  : boolean := false;  -- The 1st read of the pair found a result in the result FIFO.
+    variable byteCnt_v  : natural range 0 to 256;
+    variable delayLo_v  : natural range 0 to 255;
+    variable delay_v    : natural range 0 to (2**16 - 1) * CLKS_PER_US_C;
+
+    -- Start an access of an I2C core register.
+    procedure WbAccess(adr : in wbAddr_t; we : in std_logic; dat : in std_logic_vector; rtn : in seqState_t) is
+    begin
+      seqAdr_r <= adr;
+      seqWe_r  <= we;
+      seqDat_r <= dat;
+      seqStb_r <= YES;
+      wbRtn_v  := rtn;
+      state_v  := SEQ_WB;
+    end procedure;
+  begin
+    if rising_edge(clk_i) then
+
+      -- These controls are pulsed for a single cycle.
+      seqDone_r <= NO;
+      fifoRst_r <= NO;
+      cmdWr_r   <= NO;
+      cmdRd_r   <= NO;
+      rsltWr_r  <= NO;
+      rsltRd_r  <= NO;
+
+      -- The R/W controls from the host stay active for a few cycles after
+      -- an operation is acknowledged, so don't repeat a sequencer register
+      -- operation until they go inactive.
+      if wr_i = NO and rd_i = NO then
+        ackd_v := false;
+      end if;
+
+      -- Any access to another register, or a write, ends a pair of
+      -- result reads.
+      if (wr_i = YES or rd_i = YES) and (addr_i /= COUNT_ADDR_C or wr_i = YES) then
+        rsltPair_v := false;
+      end if;
+
+      -- Handle host R/W operations on the sequencer registers.
+      if rst_i = NO and not ackd_v and (wr_i = YES or rd_i = YES) and addr_i(3) = YES then
+        if addr_i = LIST_ADDR_C then
+          if wr_i = YES and cmdFull_s = NO and cmdWr_r = NO then
+            cmdIn_r <= data_i;
+            cmdWr_r <= YES;
+            ackd_v  := true;
+          elsif rd_i = YES and rsltEmpty_s = NO and rsltRd_r = NO then
+            seqData_r <= rsltOut_s;
+            rsltRd_r  <= YES;
+            ackd_v    := true;
+          end if;
+        elsif addr_i = STATUS_ADDR_C then
+          if wr_i = YES then
+            al_r <= NO;
+            if data_i(0) = YES then
+              abort_v := true;
+            end if;
+          end if;
+          seqData_r <= "0000" & al_r & rsltEmpty_s & cmdEmpty_s & seqBusy_r;
+          ackd_v    := true;
+        elsif addr_i = COUNT_ADDR_C then
+          if rsltPair_v and rsltPop_v then
+            -- The count read before this one saw this result, so send it.
+            seqData_r <= rsltOut_s;
+            rsltRd_r  <= YES;
+          elsif rsltPair_v then
+            -- The result FIFO was empty, so pad the results instead of stalling.
+            seqData_r <= (others => ZERO);
+          else
+            -- Send the count.
+            if unsigned(rsltLevel_s) > 255 then
+              seqData_r <= (others => ONE);
+            else
+              seqData_r <= std_logic_vector(resize(unsigned(rsltLevel_s), seqData_r'length));
+            end if;
+            rsltPop_v := rsltEmpty_s = NO;
+          end if;
+          rsltPair_v := not rsltPair_v;
+          ackd_v     := true;
+        else
+          seqData_r <= (others => ZERO);
+          ackd_v    := true;
+        end if;
+        if ackd_v then
+          seqDone_r <= YES;
+        end if;
+      end if;
+
+      if rst_i = YES then
+        state_v    := SEQ_IDLE;
+        sta_v      := NO;
+        skip_v     := false;
+        open_v     := false;
+        abort_v    := false;
+        rsltPair_v := false;
+        seqBusy_r  <= NO;
+        seqStb_r   <= NO;
+        al_r       <= NO;
+
+      -- Abort the list for the host once the sequencer is waiting on a FIFO
+      -- or a delay (any I2C command that's going is allowed to finish).
+      elsif abort_v and (state_v = SEQ_IDLE or state_v = SEQ_FETCH or state_v = SEQ_ARG or state_v = SEQ_ARG_HI
+                         or state_v = SEQ_DELAY or state_v = SEQ_WR_DATA or state_v = SEQ_PUSH) then
+        abort_v   := false;
+        skip_v    := false;
+        fifoRst_r <= YES;
+        if open_v then                  -- Let go of the bus.
+          open_v    := false;
+          pollRtn_v := SEQ_IDLE;
+          WbAccess(CR_ADDR_C, YES, x"40", SEQ_POLL);
+        else
+          state_v := SEQ_IDLE;
+        end if;
+
+      else
+        case state_v is
+
+          -- Take over the Wishbone bus once a list arrives and the host isn't
+          -- using it, and enable the I2C core.
+          when SEQ_IDLE =>
+            seqBusy_r <= NO;
+            if cmdEmpty_s = NO and cmdRd_r = NO and fifoRst_r = NO and rd_or_wr_s = NO then
+              seqBusy_r <= YES;
+              sta_v     := NO;
+              skip_v    := false;
+              al_r      <= NO;
+              WbAccess(CTR_ADDR_C, YES, x"80", SEQ_FETCH);
+            end if;
+
+          -- Get the next list command.
+          when SEQ_FETCH =>
+            if cmdEmpty_s = NO and cmdRd_r = NO then
+              cmdRd_r <= YES;
+              cmd_v   := cmdOut_s;
+              case cmdOut_s is
+                when LIST_END_C =>
+                  state_v := SEQ_IDLE;
+                when LIST_START_C =>
+                  sta_v := BooleanToStdLogic(not skip_v);
+                when LIST_STOP_C =>
+                  if not skip_v then
+                    open_v    := false;
+                    pollRtn_v := SEQ_FETCH;
+                    WbAccess(CR_ADDR_C, YES, x"40", SEQ_POLL);
+                  end if;
+                when LIST_WR_C | LIST_RD_C | LIST_RD_ACK_C | LIST_WAIT_C =>
+                  state_v := SEQ_ARG;
+                when others =>
+                  null;
+              end case;
+            end if;
+
+          -- Get the byte count or the low byte of the wait time.
+          when SEQ_ARG =>
+            if cmdEmpty_s = NO and cmdRd_r = NO then
+              cmdRd_r <= YES;
+              if cmd_v = LIST_WAIT_C then
+                delayLo_v := to_integer(unsigned(cmdOut_s));
+                state_v   := SEQ_ARG_HI;
+              else
+                byteCnt_v := to_integer(unsigned(cmdOut_s)) + 1;
+                nack_v    := NO;
+                if cmd_v = LIST_WR_C then
+                  state_v := SEQ_WR_DATA;
+                elsif skip_v then
+                  state_v := SEQ_FETCH;
+                else
+                  state_v := SEQ_RD_CMD;
+                end if;
+              end if;
+            end if;
+
+          when SEQ_ARG_HI =>
+            if cmdEmpty_s = NO and cmdRd_r = NO then
+              cmdRd_r <= YES;
+              delay_v := (to_integer(unsigned(cmdOut_s)) * 256 + delayLo_v) * CLKS_PER_US_C;
+              state_v := SEQ_DELAY;
+              if skip_v then
+                state_v := SEQ_FETCH;
+              end if;
+            end if;
+
+          when SEQ_DELAY =>
+            if delay_v = 0 then
+              state_v := SEQ_FETCH;
+            else
+              delay_v := delay_v - 1;
+            end if;
+
+          -- Write the next byte to the slave.
+          when SEQ_WR_DATA =>
+            if cmdEmpty_s = NO and cmdRd_r = NO then
+              cmdRd_r <= YES;
+              if skip_v then
+                state_v := SEQ_WR_ACK;  -- Throw away a byte that can't be sent.
+              else
+                WbAccess(TXR_ADDR_C, YES, cmdOut_s, SEQ_WR_CMD);
+              end if;
+            end if;
+
+          when SEQ_WR_CMD =>
+            if sta_v = YES then
+              open_v := true;
+            end if;
+            pollRtn_v := SEQ_WR_ACK;
+            WbAccess(CR_ADDR_C, YES, sta_v & "001" & "0000", SEQ_POLL);
+            sta_v     := NO;
+
+          when SEQ_WR_ACK =>
+            byteCnt_v := byteCnt_v - 1;
+            if byteCnt_v = 0 then
+              pushData_v := "000000" & al_r & nack_v;
+              pushRtn_v  := SEQ_FETCH;
+              state_v    := SEQ_PUSH;
+            else
+              state_v := SEQ_WR_DATA;
+            end if;
+
+          -- Read the next byte from the slave. The last byte of a read is
+          -- NACKed unless the read is to be continued.
+          when SEQ_RD_CMD =>
+            if sta_v = YES then
+              open_v := true;
+            end if;
+            pollRtn_v := SEQ_RD_DATA;
+            if byteCnt_v = 1 and cmd_v = LIST_RD_C then
+              WbAccess(CR_ADDR_C, YES, sta_v & "010" & "1000", SEQ_POLL);
+            else
+              WbAccess(CR_ADDR_C, YES, sta_v & "010" & "0000", SEQ_POLL);
+            end if;
+            sta_v := NO;
+
+          when SEQ_RD_DATA =>
+            if skip_v then
+              state_v := SEQ_FETCH;     -- Arbitration was lost, so drop the rest of the read.
+            else
+              WbAccess(TXR_ADDR_C, NO, x"00", SEQ_RD_PUSH);
+            end if;
+
+          when SEQ_RD_PUSH =>
+            pushData_v := wbData_v;
+            byteCnt_v  := byteCnt_v - 1;
+            if byteCnt_v = 0 then
+              pushRtn_v := SEQ_FETCH;
+            else
+              pushRtn_v := SEQ_RD_CMD;
+            end if;
+            state_v := SEQ_PUSH;
+
+          -- Wait for the I2C core to finish a command by watching for the
+          -- command bits to clear, then check the ACK and arbitration status.
+          when SEQ_POLL =>
+            WbAccess(CR_RD_ADDR_C, NO, x"00", SEQ_POLL_CHK);
+
+          when SEQ_POLL_CHK =>
+            if wbData_v(7 downto 4) /= "0000" then
+              state_v := SEQ_POLL;
+            else
+              WbAccess(CR_ADDR_C, NO, x"00", SEQ_STATUS);
+            end if;
+
+          when SEQ_STATUS =>
+            nack_v := nack_v or wbData_v(7);
+            if wbData_v(5) = YES then
+              al_r   <= YES;
+              skip_v := true;           -- The core has let go of the bus.
+              open_v := false;
+            end if;
+            state_v := pollRtn_v;
+
+          -- Store a result once there's room for it.
+          when SEQ_PUSH =>
+            if rsltFull_s = NO and rsltWr_r = NO then
+              rsltIn_r <= pushData_v;
+              rsltWr_r <= YES;
+              state_v  := pushRtn_v;
+            end if;
+
+          -- Finish an access of an I2C core register.
+          when SEQ_WB =>
+            if wbAck_s = YES then
+              seqStb_r <= NO;
+              wbData_v := wbDatO_s;
+              state_v  := wbRtn_v;
+            end if;
+
+        end case;
+      end if;
+
+    end if;
+  end process;
 
   u0 : i2c_master_top
     generic map(
@@ -1366,13 +1914,13 @@ begin
     port map (
       wb_clk_i     => clk_i,
       wb_rst_i     => rst_i,
-      wb_adr_i     => addr_i,
-      wb_dat_i     => data_i,
-      wb_dat_o     => data_o,
-      wb_we_i      => wr_i,
-      wb_stb_i     => rd_or_wr_s,  -- R/W operation activates the Wishbone interface.
-      wb_cyc_i     => rd_or_wr_s,  -- R/W operation activates the Wishbone interface.
-      wb_ack_o     => done_o,  -- Wishbone acknowledgement asserted when R/W is done.
+      wb_adr_i     => wbAdr_s,
+      wb_dat_i     => wbDatI_s,
+      wb_dat_o     => wbDatO_s,
+      wb_we_i      => wbWe_s,
+      wb_stb_i     => wbStb_s,  -- R/W operation activates the Wishbone interface.
+      wb_cyc_i     => wbStb_s,  -- R/W operation activates the Wishbone interface.
+      wb_ack_o     => wbAck_s,  -- Wishbone acknowledgement asserted when R/W is done.
       scl_pad_i    => scl_io,
       scl_pad_o    => scl_pad_s,
       scl_padoen_o => scl_padoen_s,
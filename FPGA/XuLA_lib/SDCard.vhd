@@ -36,6 +36,22 @@
 --         operation (25 MHz), the size of data sectors in the Flash memory (512 bytes),
 --         and the type of card (either SD or SDHC). I typically use a 100 MHz 
 --         clock if I'm running an SD card with a 25 Mbps serial data stream. 
+--
+--         The SCLK frequencies are made by dividing down the master clock, so the
+--         actual SCLK is the fastest one that doesn't exceed the requested frequency.
+--
+--     High-speed mode:
+--         If HIGH_SPEED_G is true, the controller sends CMD6 after initialization to
+--         switch the SD card into high-speed mode and checks the function-switch
+--         status the card sends back. If the card made the switch, SCLK runs at
+--         HS_SPI_FREQ_G (up to 50 MHz) from then on. Otherwise (older cards don't
+--         support CMD6, and some cards don't support high-speed), the controller
+--         just carries on at SPI_FREQ_G. At high SCLK rates, the time for SCLK to
+--         get to the card and the data to get back can be more than an SCLK phase,
+--         so HS_RX_DELAY_G can be used to sample MISO a few master clocks after
+--         SCLK falls while receiving in high-speed mode. SCLK keeps the same period;
+--         only the sampling point moves, so HS_RX_DELAY_G has to be less than the
+--         number of master clocks in one phase of the high-speed SCLK.
 --       
 --     Initialize it:
 --         Pulsing the reset_i input high and then bringing it low again will make 
@@ -92,6 +108,30 @@
 --         data block are passed from the controller to the host. Once all the data 
 --         is read, the busy_o output will be lowered.
 --     
+--     Multi-block read/write:
+--         Place the number of blocks on the numBlocks_i input along with the address
+--         and the read or write strobe. If numBlocks_i is more than one, the
+--         controller uses a single multi-block command (CMD18 to read, CMD25 to
+--         write) for the whole transfer instead of a separate command for each
+--         block. The data bytes of all the blocks are passed through the same
+--         handshake as a single block, one after the other, and busy_o stays high
+--         until the last block is done. At the end, the controller stops the
+--         transfer (CMD12 for reads, the stop-transfer token for writes) and waits
+--         for the SD card to finish. If continue_i is raised with the next read or
+--         write, it starts at the block after the last one transferred.
+--     
+--     CRC checking:
+--         Commands always go out with their real CRC7 and written data blocks with
+--         their real CRC16. If CRC_G is true, the controller also sends CMD59 during
+--         initialization so the SD card checks them, and it checks the CRC16 of
+--         every block it reads. When a read block fails its check, crcErr_o pulses
+--         high (after the last byte of the block has been passed to the host, so
+--         the host knows to throw those bytes away) and the controller reads the
+--         block again, up to CRC_RETRIES_G times before it reports an error. A
+--         written block that the card rejects because of its CRC also pulses
+--         crcErr_o, but it can't be retried since the data came from the host, so
+--         it is reported as an error.
+--     
 --     Handle errors:
 --         If an error is detected during either a read or write operation, then the
 --         controller will stall, lower busy_o, and output an error code on the 
@@ -101,7 +141,6 @@
 --
 -- TODO:
 --
---     * Implement multi-block read and write commands.
 --     * Allow host to send/receive SPI commands/data directly to
 --       the SD card through the controller.
 -- *********************************************************************
@@ -121,28 +160,35 @@ package SdCardPckg is
       FREQ_G          : real       := 100.0;  -- Master clock frequency (MHz).
       INIT_SPI_FREQ_G : real       := 0.4;  -- Slow SPI clock freq. during initialization (MHz).
       SPI_FREQ_G      : real       := 25.0;  -- Operational SPI freq. to the SD card (MHz).
+      HIGH_SPEED_G    : boolean    := false;  -- If true, try to switch the SD card into high-speed mode.
+      HS_SPI_FREQ_G   : real       := 50.0;  -- SPI freq. to the SD card in high-speed mode (MHz).
+      HS_RX_DELAY_G   : natural    := 0;  -- Master clocks after SCLK falls that MISO is sampled in high-speed mode.
+      CRC_G           : boolean    := false;  -- If true, have the card check CRCs and check the CRCs of read blocks.
+      CRC_RETRIES_G   : natural    := 3;  -- # of times to re-read a block that fails its CRC check.
       BLOCK_SIZE_G    : natural    := 512;  -- Number of bytes in an SD card block or sector.
       CARD_TYPE_G     : CardType_t := SD_CARD_E  -- Type of SD card connected to this controller.
       );
     port (
       -- Host-side interface signals.
-      clk_i      : in  std_logic;       -- Master clock.
-      reset_i    : in  std_logic                     := NO;  -- active-high, synchronous  reset.
-      rd_i       : in  std_logic                     := NO;  -- active-high read block request.
-      wr_i       : in  std_logic                     := NO;  -- active-high write block request.
-      continue_i : in  std_logic                     := NO;  -- If true, inc address and continue R/W.
-      addr_i     : in  std_logic_vector(31 downto 0) := x"00000000";  -- Block address.
-      data_i     : in  std_logic_vector(7 downto 0)  := x"00";  -- Data to write to block.
-      data_o     : out std_logic_vector(7 downto 0)  := x"00";  -- Data read from block.
-      busy_o     : out std_logic;  -- High when controller is busy performing some operation.
-      hndShk_i   : in  std_logic;  -- High when host has data to give or has taken data.
-      hndShk_o   : out std_logic;  -- High when controller has taken data or has data to give.
-      error_o    : out std_logic_vector(15 downto 0) := (others => NO);
+      clk_i       : in  std_logic;       -- Master clock.
+      reset_i     : in  std_logic                     := NO;  -- active-high, synchronous  reset.
+      rd_i        : in  std_logic                     := NO;  -- active-high read block request.
+      wr_i        : in  std_logic                     := NO;  -- active-high write block request.
+      continue_i  : in  std_logic                     := NO;  -- If true, inc address and continue R/W.
+      numBlocks_i : in  std_logic_vector(15 downto 0) := x"0001";  -- # of blocks to R/W with one command.
+      addr_i      : in  std_logic_vector(31 downto 0) := x"00000000";  -- Block address.
+      data_i      : in  std_logic_vector(7 downto 0)  := x"00";  -- Data to write to block.
+      data_o      : out std_logic_vector(7 downto 0)  := x"00";  -- Data read from block.
+      busy_o      : out std_logic;  -- High when controller is busy performing some operation.
+      hndShk_i    : in  std_logic;  -- High when host has data to give or has taken data.
+      hndShk_o    : out std_logic;  -- High when controller has taken data or has data to give.
+      error_o     : out std_logic_vector(15 downto 0) := (others => NO);
+      crcErr_o    : out std_logic;  -- Pulses high when a block fails its CRC check.
       -- I/O signals to the external SD card.
-      cs_bo      : out std_logic                     := HI;  -- Active-low chip-select.
-      sclk_o     : out std_logic                     := LO;  -- Serial clock to SD card.
-      mosi_o     : out std_logic                     := HI;  -- Serial data output to SD card.
-      miso_i     : in  std_logic                     := ZERO  -- Serial data input from SD card.
+      cs_bo       : out std_logic                     := HI;  -- Active-low chip-select.
+      sclk_o      : out std_logic                     := LO;  -- Serial clock to SD card.
+      mosi_o      : out std_logic                     := HI;  -- Serial data output to SD card.
+      miso_i      : in  std_logic                     := ZERO  -- Serial data input from SD card.
       );
   end component;
 
@@ -163,28 +209,35 @@ entity SdCardCtrl is
     FREQ_G          : real       := 100.0;     -- Master clock frequency (MHz).
     INIT_SPI_FREQ_G : real       := 0.4;  -- Slow SPI clock freq. during initialization (MHz).
     SPI_FREQ_G      : real       := 25.0;  -- Operational SPI freq. to the SD card (MHz).
+    HIGH_SPEED_G    : boolean    := false;  -- If true, try to switch the SD card into high-speed mode.
+    HS_SPI_FREQ_G   : real       := 50.0;  -- SPI freq. to the SD card in high-speed mode (MHz).
+    HS_RX_DELAY_G   : natural    := 0;  -- Master clocks after SCLK falls that MISO is sampled in high-speed mode.
+    CRC_G           : boolean    := false;  -- If true, have the card check CRCs and check the CRCs of read blocks.
+    CRC_RETRIES_G   : natural    := 3;  -- # of times to re-read a block that fails its CRC check.
     BLOCK_SIZE_G    : natural    := 512;  -- Number of bytes in an SD card block or sector.
     CARD_TYPE_G     : CardType_t := SD_CARD_E  -- Type of SD card connected to this controller.
     );
   port (
     -- Host-side interface signals.
-    clk_i      : in  std_logic;         -- Master clock.
-    reset_i    : in  std_logic                     := NO;  -- active-high, synchronous  reset.
-    rd_i       : in  std_logic                     := NO;  -- active-high read block request.
-    wr_i       : in  std_logic                     := NO;  -- active-high write block request.
-    continue_i : in  std_logic                     := NO;  -- If true, inc address and continue R/W.
-    addr_i     : in  std_logic_vector(31 downto 0) := x"00000000";  -- Block address.
-    data_i     : in  std_logic_vector(7 downto 0)  := x"00";  -- Data to write to block.
-    data_o     : out std_logic_vector(7 downto 0)  := x"00";  -- Data read from block.
-    busy_o     : out std_logic;  -- High when controller is busy performing some operation.
-    hndShk_i   : in  std_logic;  -- High when host has data to give or has taken data.
-    hndShk_o   : out std_logic;  -- High when controller has taken data or has data to give.
-    error_o    : out std_logic_vector(15 downto 0) := (others => NO);
+    clk_i       : in  std_logic;         -- Master clock.
+    reset_i     : in  std_logic                     := NO;  -- active-high, synchronous  reset.
+    rd_i        : in  std_logic                     := NO;  -- active-high read block request.
+    wr_i        : in  std_logic                     := NO;  -- active-high write block request.
+    continue_i  : in  std_logic                     := NO;  -- If true, inc address and continue R/W.
+    numBlocks_i : in  std_logic_vector(15 downto 0) := x"0001";  -- # of blocks to R/W with one command.
+    addr_i      : in  std_logic_vector(31 downto 0) := x"00000000";  -- Block address.
+    data_i      : in  std_logic_vector(7 downto 0)  := x"00";  -- Data to write to block.
+    data_o      : out std_logic_vector(7 downto 0)  := x"00";  -- Data read from block.
+    busy_o      : out std_logic;  -- High when controller is busy performing some operation.
+    hndShk_i    : in  std_logic;  -- High when host has data to give or has taken data.
+    hndShk_o    : out std_logic;  -- High when controller has taken data or has data to give.
+    error_o     : out std_logic_vector(15 downto 0) := (others => NO);
+    crcErr_o    : out std_logic;  -- Pulses high when a block fails its CRC check.
     -- I/O signals to the external SD card.
-    cs_bo      : out std_logic                     := HI;  -- Active-low chip-select.
-    sclk_o     : out std_logic                     := LO;  -- Serial clock to SD card.
-    mosi_o     : out std_logic                     := HI;  -- Serial data output to SD card.
-    miso_i     : in  std_logic                     := ZERO  -- Serial data input from SD card.
+    cs_bo       : out std_logic                     := HI;  -- Active-low chip-select.
+    sclk_o      : out std_logic                     := LO;  -- Serial clock to SD card.
+    mosi_o      : out std_logic                     := HI;  -- Serial data output to SD card.
+    miso_i      : in  std_logic                     := ZERO  -- Serial data input from SD card.
     );
 end entity;
 
@@ -194,8 +247,40 @@ architecture arch of SdCardCtrl is
 
   signal sclk_r   : std_logic := ZERO;  -- Register output drives SD card clock.
   signal hndShk_r : std_logic := NO;  -- Register output drives handshake output to host.
+  signal crcErr_r : std_logic := NO;  -- Register output drives the CRC error flag to the host.
+
+  -- CRC7 (x^7 + x^3 + 1) of the bits of an SD card command, MSB first.
+  function Crc7(d : std_logic_vector) return std_logic_vector is
+    variable crc_v : std_logic_vector(6 downto 0) := (others => ZERO);
+    variable fb_v  : std_logic;
+  begin
+    for i in d'range loop
+      fb_v     := d(i) xor crc_v(6);
+      crc_v    := crc_v(5 downto 0) & fb_v;
+      crc_v(3) := crc_v(3) xor fb_v;
+    end loop;
+    return crc_v;
+  end function;
+
+  -- CRC16 (x^16 + x^12 + x^5 + 1) of a data block, updated with the next byte, MSB first.
+  function Crc16(crc : std_logic_vector(15 downto 0); d : std_logic_vector) return std_logic_vector is
+    variable crc_v : std_logic_vector(15 downto 0) := crc;
+    variable fb_v  : std_logic;
+  begin
+    for i in d'range loop
+      fb_v      := d(i) xor crc_v(15);
+      crc_v     := crc_v(14 downto 0) & fb_v;
+      crc_v(5)  := crc_v(5) xor fb_v;
+      crc_v(12) := crc_v(12) xor fb_v;
+    end loop;
+    return crc_v;
+  end function;
 
 begin
+
+  -- The delayed MISO sample has to be taken before the low phase of the high-speed SCLK ends.
+  assert HS_RX_DELAY_G < IntMax(1, integer(ceil(FREQ_G / HS_SPI_FREQ_G / 2.0)))
+    report "SdCardCtrl: HS_RX_DELAY_G must be less than the # of master clocks in a high-speed SCLK phase." severity failure;
   
   process(clk_i)  -- FSM process for the SD card controller.
 
@@ -208,10 +293,22 @@ begin
       SEND_CMD55,                       -- Send CMD55 to the SD card. 
       SEND_CMD41,                       -- Send CMD41 to the SD card.
       CHK_ACMD41_RESPONSE,  -- Check if the SD card has left the IDLE state.     
+      SEND_CMD59,  -- Turn on CRC checking in the SD card.
+      CHK_CMD59_RESPONSE,  -- Check the R1 response to CMD59.
+      SEND_CMD6,   -- Ask the SD card to switch to high-speed mode.
+      CHK_CMD6_RESPONSE,  -- Check the R1 response to CMD6.
+      GET_SWITCH_STATUS,  -- Get the function-switch status block and see if high-speed mode was selected.
       WAIT_FOR_HOST_RW,  -- Wait for the host to issue a read or write command.
       RD_BLK,    -- Read a block of data from the SD card.
       WR_BLK,    -- Write a block of data to the SD card.
       WR_WAIT,   -- Wait for SD card to finish writing the data block.
+      RD_RETRY,  -- Read a block again after it failed its CRC check.
+      RD_STOP,   -- Send CMD12 to end a multi-block read.
+      RD_STOP_SKIP,  -- Skip the stuff byte the SD card sends after CMD12.
+      RD_STOP_RESPONSE,  -- Get the R1 response to CMD12.
+      CHK_RD_STOP_RESPONSE,  -- Check the R1 response and wait for the SD card to finish.
+      WR_STOP,   -- Send the stop-transfer token to end a multi-block write.
+      WR_STOP_SKIP,  -- Skip a byte before waiting for the SD card to finish.
       START_TX,                         -- Start sending command/data.
       TX_BITS,   -- Shift out remaining command/data bits.
       GET_CMD_RESPONSE,  -- Get the R1 response of the SD card to a command.
@@ -225,16 +322,23 @@ begin
 
     -- Timing constants based on the master clock frequency and the SPI SCLK frequencies.
     constant CLKS_PER_INIT_SCLK_C      : real    := FREQ_G / INIT_SPI_FREQ_G;
+    -- (Each SCLK phase is rounded up to a whole # of master clocks so SCLK never exceeds the requested freq.)
     constant CLKS_PER_SCLK_C           : real    := FREQ_G / SPI_FREQ_G;
+    constant CLKS_PER_HS_SCLK_C        : real    := FREQ_G / HS_SPI_FREQ_G;
     constant MAX_CLKS_PER_SCLK_C       : real    := realmax(CLKS_PER_INIT_SCLK_C, CLKS_PER_SCLK_C);
-    constant MAX_CLKS_PER_SCLK_PHASE_C : natural := integer(round(MAX_CLKS_PER_SCLK_C / 2.0));
-    constant INIT_SCLK_PHASE_PERIOD_C  : natural := integer(round(CLKS_PER_INIT_SCLK_C / 2.0));
-    constant SCLK_PHASE_PERIOD_C       : natural := integer(round(CLKS_PER_SCLK_C / 2.0));
+    constant MAX_CLKS_PER_SCLK_PHASE_C : natural := integer(ceil(MAX_CLKS_PER_SCLK_C / 2.0));
+    constant INIT_SCLK_PHASE_PERIOD_C  : natural := IntMax(1, integer(ceil(CLKS_PER_INIT_SCLK_C / 2.0)));
+    constant SCLK_PHASE_PERIOD_C       : natural := IntMax(1, integer(ceil(CLKS_PER_SCLK_C / 2.0)));
+    constant HS_SCLK_PHASE_PERIOD_C    : natural := IntMax(1, integer(ceil(CLKS_PER_HS_SCLK_C / 2.0)));
     constant DELAY_BETWEEN_BLOCK_RW_C  : natural := SCLK_PHASE_PERIOD_C;
 
     -- Registers for generating slow SPI SCLK from the faster master clock.
     variable clkDivider_v     : natural range 0 to MAX_CLKS_PER_SCLK_PHASE_C;  -- Holds the SCLK period.
     variable sclkPhaseTimer_v : natural range 0 to MAX_CLKS_PER_SCLK_PHASE_C;  -- Counts down to zero, then SCLK toggles.
+    variable rxDelay_v        : natural range 0 to HS_RX_DELAY_G;  -- Time after SCLK falls that MISO is sampled.
+    variable rxLate_v         : boolean;  -- When true, SCLK has fallen and MISO is sampled when the timer runs out.
+    variable rxSample_v       : boolean;  -- When true, a receiving state takes in the MISO bit.
+    variable highSpeed_v      : boolean;  -- True once the SD card has switched to high-speed mode.
 
     constant NUM_INIT_CLKS_C : natural := 160;  -- Number of initialization clocks to SD card.
     variable bitCnt_v        : natural range 0 to NUM_INIT_CLKS_C;  -- Tx/Rx bit counter.
@@ -244,22 +348,42 @@ begin
     constant RD_BLK_SZ_C : natural := 1 + BLOCK_SIZE_G + CRC_SZ_C;
     -- When writing blocks of data, send 0xFF + 0xFE + [DATA BLOCK] + [CRC] then receive response byte.
     constant WR_BLK_SZ_C : natural := 1 + 1 + BLOCK_SIZE_G + CRC_SZ_C + 1;
-    variable byteCnt_v   : natural range 0 to IntMax(WR_BLK_SZ_C, RD_BLK_SZ_C);  -- Tx/Rx byte counter.
+    -- After CMD6, get 0xFE + [64-BYTE SWITCH STATUS] + [CRC].
+    constant SWITCH_STATUS_SZ_C : natural := 64;
+    constant SWITCH_BLK_SZ_C    : natural := 1 + SWITCH_STATUS_SZ_C + CRC_SZ_C;
+    constant SWITCH_GRP1_BYTE_C : natural := 16;  -- Status byte whose lower nibble is the function selected for group 1.
+    variable byteCnt_v   : natural range 0 to IntMax(IntMax(WR_BLK_SZ_C, RD_BLK_SZ_C), SWITCH_BLK_SZ_C);  -- Tx/Rx byte counter.
 
     -- Command bytes for various SD card operations.
     subtype Cmd_t is std_logic_vector(7 downto 0);
-    constant CMD0_C          : Cmd_t := std_logic_vector(to_unsigned(16#40# + 0, Cmd_t'length));
-    constant CMD8_C          : Cmd_t := std_logic_vector(to_unsigned(16#40# + 8, Cmd_t'length));
-    constant CMD55_C         : Cmd_t := std_logic_vector(to_unsigned(16#40# + 55, Cmd_t'length));
-    constant CMD41_C         : Cmd_t := std_logic_vector(to_unsigned(16#40# + 41, Cmd_t'length));
-    constant READ_BLK_CMD_C  : Cmd_t := std_logic_vector(to_unsigned(16#40# + 17, Cmd_t'length));
-    constant WRITE_BLK_CMD_C : Cmd_t := std_logic_vector(to_unsigned(16#40# + 24, Cmd_t'length));
-
-    -- Except for CMD0 and CMD8, SD card ops don't need a CRC, so use a fake one for that slot in the command.
+    constant CMD0_C            : Cmd_t := std_logic_vector(to_unsigned(16#40# + 0, Cmd_t'length));
+    constant CMD6_C            : Cmd_t := std_logic_vector(to_unsigned(16#40# + 6, Cmd_t'length));
+    constant CMD8_C            : Cmd_t := std_logic_vector(to_unsigned(16#40# + 8, Cmd_t'length));
+    constant CMD59_C           : Cmd_t := std_logic_vector(to_unsigned(16#40# + 59, Cmd_t'length));
+    constant CMD55_C           : Cmd_t := std_logic_vector(to_unsigned(16#40# + 55, Cmd_t'length));
+    constant CMD41_C           : Cmd_t := std_logic_vector(to_unsigned(16#40# + 41, Cmd_t'length));
+    constant CMD12_C           : Cmd_t := std_logic_vector(to_unsigned(16#40# + 12, Cmd_t'length));
+    constant READ_BLK_CMD_C    : Cmd_t := std_logic_vector(to_unsigned(16#40# + 17, Cmd_t'length));
+    constant READ_MULTI_CMD_C  : Cmd_t := std_logic_vector(to_unsigned(16#40# + 18, Cmd_t'length));
+    constant WRITE_BLK_CMD_C   : Cmd_t := std_logic_vector(to_unsigned(16#40# + 24, Cmd_t'length));
+    constant WRITE_MULTI_CMD_C : Cmd_t := std_logic_vector(to_unsigned(16#40# + 25, Cmd_t'length));
+
+    -- Placeholder for the CRC slot in a command. (The real CRC7 is put there as the command goes out.)
     constant FAKE_CRC_C : std_logic_vector(7 downto 0) := x"FF";
 
+    -- CRC checking of data blocks.
+    constant CRC_ERR_CODE_C : std_logic_vector(7 downto 0) := "00001011";  -- Error code for a read block with a bad CRC.
+    variable crc16_v        : std_logic_vector(15 downto 0);  -- CRC16 of the data block being read or written.
+    variable crcRx_v        : std_logic_vector(15 downto 0);  -- CRC16 that came with a read data block.
+    variable retries_v      : natural range 0 to CRC_RETRIES_G;  -- # of re-reads left for the current block.
+    variable retry_v        : boolean;  -- When true, re-read the current block once the card is deselected.
+
     variable addr_v : unsigned(addr_i'range);  -- Address of current block for R/W operations.
 
+    -- Multi-block R/W operations.
+    variable multi_v  : boolean;  -- When true, a CMD18/CMD25 multi-block R/W is in progress.
+    variable blkCnt_v : natural range 0 to 2**numBlocks_i'length-1;  -- # of blocks left after the current one.
+
     -- Maximum Tx to SD card consists of command + address + CRC. Data Tx is just a single byte.
     variable tx_v : std_logic_vector(CMD0_C'length + addr_v'length + FAKE_CRC_C'length - 1 downto 0);  -- Data/command to SD card.
     alias txCmd_v is tx_v;              -- Command transmission shift register.
@@ -268,15 +392,17 @@ begin
     variable rx_v               : std_logic_vector(data_i'range);  -- Data/response byte received from SD card.
     -- Various response codes.
     subtype Response_t is std_logic_vector(rx_v'range);
-    constant ACTIVE_NO_ERRORS_C : Response_t := "00000000";  -- Normal R1 code after initialization.
-    constant IDLE_NO_ERRORS_C   : Response_t := "00000001";  -- Normal R1 code after CMD0.
-    constant DATA_ACCEPTED_C    : Response_t := "---00101";  -- SD card accepts data block from host.
-    constant DATA_REJ_CRC_C     : Response_t := "---01011";  -- SD card rejects data block from host due to CRC error.
-    constant DATA_REJ_WERR_C    : Response_t := "---01101";  -- SD card rejects data block from host due to write error.
+    constant ACTIVE_NO_ERRORS_C  : Response_t := "00000000";  -- Normal R1 code after initialization.
+    constant IDLE_NO_ERRORS_C    : Response_t := "00000001";  -- Normal R1 code after CMD0.
+    constant DATA_ACCEPTED_C     : Response_t := "---00101";  -- SD card accepts data block from host.
+    constant DATA_REJ_CRC_C      : Response_t := "---01011";  -- SD card rejects data block from host due to CRC error.
+    constant DATA_REJ_WERR_C     : Response_t := "---01101";  -- SD card rejects data block from host due to write error.
     -- Various tokens.
     subtype Token_t is std_logic_vector(rx_v'range);
-    constant NO_TOKEN_C         : Token_t    := x"FF";  -- Received before the SD card responds to a block read command.
-    constant START_TOKEN_C      : Token_t    := x"FE";  -- Starting byte preceding a data block.
+    constant NO_TOKEN_C          : Token_t    := x"FF";  -- Received before the SD card responds to a block read command.
+    constant START_TOKEN_C       : Token_t    := x"FE";  -- Starting byte preceding a data block.
+    constant START_MULTI_TOKEN_C : Token_t    := x"FC";  -- Starting byte preceding each block of a multi-block write.
+    constant STOP_TRAN_TOKEN_C   : Token_t    := x"FD";  -- Ends a multi-block write.
 
     -- Flags that are set/cleared to affect the operation of the FSM.
     variable getCmdResponse_v : boolean;  -- When true, get R1 response to command sent to SD card.
@@ -286,6 +412,8 @@ begin
   begin
     if rising_edge(clk_i) then
 
+      crcErr_r <= NO;                   -- The CRC error flag only pulses high for one clock.
+
       if reset_i = YES then             -- Perform a reset.
         state_v          := START_INIT;  -- Send the FSM to the initialization entry-point.
         sclkPhaseTimer_v := 0;  -- Don't delay the initialization right after reset.
@@ -311,6 +439,9 @@ begin
         null;            -- Waiting for the host to acknowledge handshake.
       elsif state_v /= START_INIT and hndShk_r = HI and hndShk_i = HI then
         txData_v := data_i;             -- Get any data passed from the host.
+        if rtnState_v = WR_BLK then
+          crc16_v := Crc16(crc16_v, data_i);  -- Add the data byte to the CRC of the block being written.
+        end if;
         hndShk_r <= LO;  -- The host acknowledged, so lower the controller handshake.
       elsif state_v /= START_INIT and hndShk_r = LO and hndShk_i = HI then
         null;            -- Waiting for the host to lower its handshake.
@@ -319,6 +450,10 @@ begin
         
         busy_o <= YES;  -- Busy by default. Only false when waiting for R/W from host or stalled by error.
 
+        -- Receiving states take in MISO at the end of the high SCLK phase or, if there's an
+        -- RX delay, once the delay after the falling edge of SCLK has passed.
+        rxSample_v := rxLate_v or (sclk_r = HI and rxDelay_v = 0);
+
         case state_v is
           
           when START_INIT =>  -- Deselect the SD card and send it a bunch of clock pulses with MOSI high.
@@ -328,6 +463,12 @@ begin
             sclk_r           <= LO;     -- Start with low clock to the SD card.
             hndShk_r         <= LO;     -- Initialize handshake signal.
             addr_v           := (others => ZERO);  -- Initialize address.
+            multi_v          := false;  -- No multi-block R/W in progress.
+            blkCnt_v         := 0;
+            highSpeed_v      := false;  -- Cards always start out in default-speed mode.
+            retry_v          := false;
+            rxDelay_v        := 0;
+            rxLate_v         := false;
             rtnData_v        := false;  -- No data is returned to host during initialization.
             bitCnt_v         := NUM_INIT_CLKS_C;  -- Generate this many clock pulses.
             state_v          := DESELECT;  -- De-select the SD card and pulse SCLK.
@@ -389,16 +530,94 @@ begin
             -- and become ready for SPI read/write operations. If still IDLE, then repeat the CMD55, CMD41 sequence.
             -- If one of the R1 error flags is set, then report the error and stall.
             if rx_v = ACTIVE_NO_ERRORS_C then   -- Not IDLE, no errors.
-              state_v := WAIT_FOR_HOST_RW;  -- Start processing R/W commands from the host.
+              if CRC_G then
+                state_v := SEND_CMD59;  -- Turn on CRC checking.
+              elsif HIGH_SPEED_G then
+                state_v := SEND_CMD6;   -- Try to switch to high-speed mode.
+              else
+                state_v := WAIT_FOR_HOST_RW;  -- Start processing R/W commands from the host.
+              end if;
             elsif rx_v = IDLE_NO_ERRORS_C then  -- Still IDLE but no errors. 
               state_v := SEND_CMD55;    -- Repeat the CMD55, CMD41 sequence.
             else                        -- Some error occurred.
               state_v := REPORT_ERROR;  -- Report the error and stall.
             end if;
             
+          when SEND_CMD59 =>  -- Tell the SD card to check the CRCs of commands and data blocks.
+            cs_bo            <= LO;     -- Enable the SD card.
+            txCmd_v          := CMD59_C & x"00000001" & FAKE_CRC_C;
+            bitCnt_v         := txCmd_v'length;  -- Set bit counter to the size of the command.
+            getCmdResponse_v := true;  -- Sending a command that generates a response.
+            doDeselect_v     := true;  -- De-select SD card after this command finishes.
+            state_v          := START_TX;  -- Go to FSM subroutine to send the command.
+            rtnState_v       := CHK_CMD59_RESPONSE;  -- Then check the response to the command.
+
+          when CHK_CMD59_RESPONSE =>
+            if rx_v /= ACTIVE_NO_ERRORS_C then
+              state_v := REPORT_ERROR;
+            elsif HIGH_SPEED_G then
+              state_v := SEND_CMD6;     -- Try to switch to high-speed mode.
+            else
+              state_v := WAIT_FOR_HOST_RW;  -- Start processing R/W commands from the host.
+            end if;
+
+          when SEND_CMD6 =>  -- Ask the SD card to switch function group 1 to high-speed and leave the other groups alone.
+            cs_bo            <= LO;     -- Enable the SD card.
+            clkDivider_v     := SCLK_PHASE_PERIOD_C - 1;  -- No need to do this at the slow init. clock.
+            txCmd_v          := CMD6_C & x"80FFFFF1" & FAKE_CRC_C;
+            bitCnt_v         := txCmd_v'length;  -- Set bit counter to the size of the command.
+            getCmdResponse_v := true;  -- Sending a command that generates a response.
+            doDeselect_v     := false;  -- Don't de-select, the switch status block follows the response.
+            byteCnt_v        := SWITCH_BLK_SZ_C;
+            state_v          := START_TX;  -- Go to FSM subroutine to send the command.
+            rtnState_v       := CHK_CMD6_RESPONSE;  -- Then check the response to the command.
+
+          when CHK_CMD6_RESPONSE =>
+            if rx_v = ACTIVE_NO_ERRORS_C then
+              state_v := GET_SWITCH_STATUS;  -- Card accepted CMD6, so see if it made the switch.
+            else  -- Card doesn't know CMD6, so deselect it and carry on at the normal speed.
+              bitCnt_v   := 2;
+              state_v    := DESELECT;
+              rtnState_v := WAIT_FOR_HOST_RW;
+            end if;
+
+          when GET_SWITCH_STATUS =>  -- Get the function-switch status block (same as reading a data block).
+            rtnData_v  := false;  -- None of this goes to the host.
+            bitCnt_v   := rx_v'length - 1;   -- Receiving byte-sized data.
+            state_v    := RX_BITS;      -- Call the bit receiver routine.
+            rtnState_v := GET_SWITCH_STATUS;  -- Return here when done receiving a byte.
+            if byteCnt_v = SWITCH_BLK_SZ_C then  -- Initial read to prime the pump.
+              byteCnt_v := byteCnt_v - 1;
+            elsif byteCnt_v = SWITCH_BLK_SZ_C - 1 then  -- Then look for the data block start token.
+              if rx_v = NO_TOKEN_C then
+                null;
+              elsif rx_v = START_TOKEN_C then
+                byteCnt_v := byteCnt_v - 1;
+              else
+                state_v := REPORT_ERROR;
+              end if;
+            elsif byteCnt_v /= 0 then  -- Status bytes followed by the CRC.
+              if byteCnt_v = SWITCH_BLK_SZ_C - 2 - SWITCH_GRP1_BYTE_C and rx_v(3 downto 0) = "0001" then
+                highSpeed_v := true;    -- Function 1 (high-speed) was selected for group 1.
+              end if;
+              byteCnt_v := byteCnt_v - 1;
+            else  -- Deselect and give the card the eight clocks it needs before running at the new speed.
+              sclk_r     <= LO;
+              bitCnt_v   := 8;
+              state_v    := DESELECT;
+              rtnState_v := WAIT_FOR_HOST_RW;
+            end if;
+
           when WAIT_FOR_HOST_RW =>  -- Wait for the host to read or write a block of data from the SD card.
-            clkDivider_v     := SCLK_PHASE_PERIOD_C - 1;  -- Set SPI clock frequency for normal operation.
+            if highSpeed_v then
+              clkDivider_v := HS_SCLK_PHASE_PERIOD_C - 1;  -- Set SPI clock frequency for high-speed operation.
+              rxDelay_v    := HS_RX_DELAY_G;
+            else
+              clkDivider_v := SCLK_PHASE_PERIOD_C - 1;  -- Set SPI clock frequency for normal operation.
+              rxDelay_v    := 0;
+            end if;
             getCmdResponse_v := true;  -- Get R1 response to any commands issued to the SD card.
+            retries_v        := CRC_RETRIES_G;
             if rd_i = YES then  -- send READ command and address to the SD card.
               cs_bo <= LO;              -- Enable the SD card.
               if continue_i = YES then  -- Multi-block read. Use stored address.
@@ -407,11 +626,18 @@ begin
                 else                    -- SDHC cards use block-addressing,
                   addr_v := addr_v + 1;  -- so just increment current block address.
                 end if;
-                txCmd_v := READ_BLK_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
               else                      -- Single-block read.
-                txCmd_v := READ_BLK_CMD_C & addr_i & FAKE_CRC_C;  -- Use address supplied by host.
                 addr_v  := unsigned(addr_i);  -- Store address for multi-block operations.
               end if;
+              if unsigned(numBlocks_i) > 1 then  -- Read all the blocks with one command.
+                txCmd_v  := READ_MULTI_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
+                multi_v  := true;
+                blkCnt_v := to_integer(unsigned(numBlocks_i)) - 1;
+              else
+                txCmd_v  := READ_BLK_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
+                multi_v  := false;
+                blkCnt_v := 0;  -- No blocks after this one, so a retry uses CMD17 again.
+              end if;
               bitCnt_v   := txCmd_v'length;  -- Set bit counter to the size of the command.
               byteCnt_v  := RD_BLK_SZ_C;
               state_v    := START_TX;  -- Go to FSM subroutine to send the command.
@@ -424,11 +650,18 @@ begin
                 else                    -- SDHC cards use block-addressing,
                   addr_v := addr_v + 1;  -- so just increment current block address.
                 end if;
-                txCmd_v := WRITE_BLK_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
               else                      -- Single-block write.
-                txCmd_v := WRITE_BLK_CMD_C & addr_i & FAKE_CRC_C;  -- Use address supplied by host.
                 addr_v  := unsigned(addr_i);  -- Store address for multi-block operations.
               end if;
+              if unsigned(numBlocks_i) > 1 then  -- Write all the blocks with one command.
+                txCmd_v  := WRITE_MULTI_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
+                multi_v  := true;
+                blkCnt_v := to_integer(unsigned(numBlocks_i)) - 1;
+              else
+                txCmd_v  := WRITE_BLK_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
+                multi_v  := false;
+                blkCnt_v := 0;
+              end if;
               bitCnt_v   := txCmd_v'length;  -- Set bit counter to the size of the command.
               byteCnt_v  := WR_BLK_SZ_C;    -- Set number of bytes to write.
               state_v    := START_TX;  -- Go to this FSM subroutine to send the command ...
@@ -453,16 +686,50 @@ begin
               elsif rx_v = START_TOKEN_C then
                 rtnData_v := true;  -- Found the start token, so now start returning data byes to the host.
                 byteCnt_v := byteCnt_v - 1;
+                crc16_v   := (others => ZERO);
               else  -- Getting anything else means something strange has happened.
                 state_v := REPORT_ERROR;
               end if;
             elsif byteCnt_v >= 3 then  -- Now bytes of data from the SD card are received.
               rtnData_v := true;        -- Return this data to the host.
               byteCnt_v := byteCnt_v - 1;
+              crc16_v   := Crc16(crc16_v, rx_v);
             elsif byteCnt_v = 2 then  -- Receive the 1st CRC byte at the end of the data block.
               byteCnt_v := byteCnt_v - 1;
+              crc16_v   := Crc16(crc16_v, rx_v);  -- (Last data byte.)
             elsif byteCnt_v = 1 then    -- Receive the 2nd
               byteCnt_v := byteCnt_v - 1;
+              crcRx_v(15 downto 8) := rx_v;
+            elsif CRC_G and crcRx_v(15 downto 8) & rx_v /= crc16_v then  -- The block failed its CRC check.
+              crcErr_r <= YES;  -- Tell the host to throw away the block.
+              if retries_v = 0 then
+                error_o(15 downto 8) <= CRC_ERR_CODE_C;
+                state_v              := REPORT_ERROR;
+              else
+                retries_v := retries_v - 1;
+                retry_v   := true;
+                if multi_v then  -- Stop the multi-block read and start again from this block.
+                  multi_v := false;
+                  state_v := RD_STOP;
+                else
+                  sclk_r     <= LO;
+                  bitCnt_v   := 2;
+                  state_v    := DESELECT;
+                  rtnState_v := RD_RETRY;
+                end if;
+              end if;
+            elsif multi_v and blkCnt_v /= 0 then  -- Go on to the next block of a multi-block read.
+              blkCnt_v  := blkCnt_v - 1;
+              if CARD_TYPE_G = SD_CARD_E then
+                addr_v := addr_v + BLOCK_SIZE_G;
+              else
+                addr_v := addr_v + 1;
+              end if;
+              byteCnt_v := RD_BLK_SZ_C - 1;  -- Look for the start token of the next block.
+              retries_v := CRC_RETRIES_G;
+            elsif multi_v then  -- The last block of a multi-block read is done, so stop the transfer.
+              multi_v := false;
+              state_v := RD_STOP;
             else    -- Reading is done, so deselect the SD card.
               sclk_r     <= LO;
               bitCnt_v   := 2;
@@ -479,41 +746,133 @@ begin
             if byteCnt_v = WR_BLK_SZ_C then
               txData_v := NO_TOKEN_C;  -- Hold MOSI high for one byte before data block goes out.
             elsif byteCnt_v = WR_BLK_SZ_C - 1 then     -- Send start token.
-              txData_v := START_TOKEN_C;   -- Starting token for data block.
+              if multi_v then
+                txData_v := START_MULTI_TOKEN_C;  -- Starting token for each block of a multi-block write.
+              else
+                txData_v := START_TOKEN_C;   -- Starting token for data block.
+              end if;
+              crc16_v := (others => ZERO);
             elsif byteCnt_v >= 4 then   -- Now send bytes in the data block.
               hndShk_r <= HI;           -- Signal host to provide data.
             -- The transmit shift register is loaded with data from host in the handshaking section above.
-            elsif byteCnt_v = 3 or byteCnt_v = 2 then  -- Send two phony CRC bytes at end of packet.
-              txData_v := FAKE_CRC_C;
+            elsif byteCnt_v = 3 then    -- Send the two CRC bytes at end of packet.
+              txData_v := crc16_v(15 downto 8);
+            elsif byteCnt_v = 2 then
+              txData_v := crc16_v(7 downto 0);
             elsif byteCnt_v = 1 then
               bitCnt_v   := rx_v'length - 1;
               state_v    := RX_BITS;  -- Get response of SD card to the write operation.
-              rtnState_v := WR_WAIT;
+              rtnState_v := WR_BLK;   -- Then come back here to check it.
             else                        -- Check received response byte.
               if std_match(rx_v, DATA_ACCEPTED_C) then  -- Data block was accepted.
                 state_v := WR_WAIT;  -- Wait for the SD card to finish writing the data into Flash.
               else                      -- Data block was rejected.
+                if std_match(rx_v, DATA_REJ_CRC_C) then
+                  crcErr_r <= YES;
+                end if;
                 error_o(15 downto 8) <= rx_v;
                 state_v              := REPORT_ERROR;  -- Report the error.
               end if;
             end if;
-            byteCnt_v := byteCnt_v - 1;
+            if byteCnt_v /= 0 then
+              byteCnt_v := byteCnt_v - 1;
+            end if;
             
           when WR_WAIT =>  -- Wait for SD card to finish writing the data block.
             -- The SD card will pull MISO low while it is busy, and raise it when it is done.
-            sclk_r           <= not sclk_r;    -- Toggle the SPI clock...
-            sclkPhaseTimer_v := clkDivider_v;  -- and set the duration of the next clock phase.
-            if sclk_r = HI and miso_i = HI then  -- Data block has been written, so deselect the SD card.
-              bitCnt_v   := 2;
-              state_v    := DESELECT;
-              rtnState_v := WAIT_FOR_HOST_RW;
+            if rxLate_v then  -- MISO was sampled partway into the low SCLK phase, so finish out the phase.
+              rxLate_v         := false;
+              sclkPhaseTimer_v := clkDivider_v - rxDelay_v;
+            elsif sclk_r = HI and rxDelay_v /= 0 then  -- Lower SCLK on time but sample MISO a bit later.
+              sclk_r           <= LO;
+              sclkPhaseTimer_v := rxDelay_v - 1;
+              rxLate_v         := true;
+            else
+              sclk_r           <= not sclk_r;    -- Toggle the SPI clock...
+              sclkPhaseTimer_v := clkDivider_v;  -- and set the duration of the next clock phase.
+            end if;
+            if rxSample_v and miso_i = HI then  -- Data block has been written.
+              if multi_v and blkCnt_v /= 0 then  -- Send the next block of a multi-block write.
+                blkCnt_v := blkCnt_v - 1;
+                if CARD_TYPE_G = SD_CARD_E then
+                  addr_v := addr_v + BLOCK_SIZE_G;
+                else
+                  addr_v := addr_v + 1;
+                end if;
+                byteCnt_v := WR_BLK_SZ_C;
+                state_v   := WR_BLK;
+              elsif multi_v then  -- The last block of a multi-block write is done, so stop the transfer.
+                multi_v := false;
+                state_v := WR_STOP;
+              else  -- Deselect the SD card.
+                bitCnt_v   := 2;
+                state_v    := DESELECT;
+                rtnState_v := WAIT_FOR_HOST_RW;
+                if retry_v then  -- A multi-block read was stopped to re-read a bad block.
+                  rtnState_v := RD_RETRY;
+                end if;
+              end if;
+            end if;
+
+          when RD_RETRY =>  -- Read the block that failed its CRC check (and any after it) again.
+            retry_v          := false;
+            cs_bo            <= LO;     -- Enable the SD card.
+            getCmdResponse_v := true;
+            if blkCnt_v /= 0 then  -- There are more blocks after this one, so use a multi-block read.
+              txCmd_v := READ_MULTI_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
+              multi_v := true;
+            else
+              txCmd_v := READ_BLK_CMD_C & std_logic_vector(addr_v) & FAKE_CRC_C;
+            end if;
+            bitCnt_v   := txCmd_v'length;  -- Set bit counter to the size of the command.
+            byteCnt_v  := RD_BLK_SZ_C;
+            state_v    := START_TX;  -- Go to FSM subroutine to send the command.
+            rtnState_v := RD_BLK;  -- Then go to this state to read the data block.
+
+          when RD_STOP =>  -- Send CMD12 to end a multi-block read.
+            txCmd_v          := CMD12_C & x"00000000" & FAKE_CRC_C;
+            bitCnt_v         := txCmd_v'length;  -- Set bit counter to the size of the command.
+            getCmdResponse_v := false;  -- The card is still sending data, so skip a byte before the response.
+            state_v          := START_TX;  -- Go to FSM subroutine to send the command.
+            rtnState_v       := RD_STOP_SKIP;
+
+          when RD_STOP_SKIP =>  -- Skip the stuff byte the SD card sends after CMD12.
+            bitCnt_v   := rx_v'length - 1;
+            state_v    := RX_BITS;
+            rtnState_v := RD_STOP_RESPONSE;
+
+          when RD_STOP_RESPONSE =>  -- Get the R1 response to CMD12.
+            bitCnt_v   := Response_t'length - 1;  -- Length of the expected response.
+            state_v    := GET_CMD_RESPONSE;
+            rtnState_v := CHK_RD_STOP_RESPONSE;
+
+          when CHK_RD_STOP_RESPONSE =>
+            if rx_v = ACTIVE_NO_ERRORS_C then
+              state_v := WR_WAIT;  -- Wait while the SD card is busy, then deselect it.
+            else
+              state_v := REPORT_ERROR;
             end if;
+
+          when WR_STOP =>  -- Send the stop-transfer token to end a multi-block write.
+            txData_v         := STOP_TRAN_TOKEN_C;
+            bitCnt_v         := txData_v'length;
+            getCmdResponse_v := false;
+            state_v          := START_TX;
+            rtnState_v       := WR_STOP_SKIP;
+
+          when WR_STOP_SKIP =>  -- Skip a byte, then wait while the SD card is busy and deselect it.
+            bitCnt_v   := rx_v'length - 1;
+            state_v    := RX_BITS;
+            rtnState_v := WR_WAIT;
             
           when START_TX =>
             -- Start sending command/data by lowering SCLK and outputing MSB of command/data
             -- so it has plenty of setup before the rising edge of SCLK.
             sclk_r           <= LO;  -- Lower the SCLK (although it should already be low).
             sclkPhaseTimer_v := clkDivider_v;  -- Set the duration of the low SCLK.
+            if bitCnt_v = txCmd_v'length then  -- Sending a command, so fill in its CRC7 and end bit.
+              tx_v(FAKE_CRC_C'range) := Crc7(tx_v(tx_v'high downto FAKE_CRC_C'length)) & ONE;
+            end if;
             mosi_o           <= tx_v(tx_v'high);  -- Output MSB of command/data.
             tx_v             := tx_v(tx_v'high-1 downto 0) & ONE;  -- Shift command/data register by one bit.
             bitCnt_v         := bitCnt_v - 1;  -- The first bit has been sent, so decrement bit counter.
@@ -541,17 +900,26 @@ begin
             end if;
 
           when GET_CMD_RESPONSE =>  -- Get the response of the SD card to a command.
-            if sclk_r = HI and miso_i = LO then  -- MISO will be held high by SD card until 1st bit of R1 response, which is 0.
+            if rxSample_v and miso_i = LO then  -- MISO will be held high by SD card until 1st bit of R1 response, which is 0.
               -- Shift in the MSB bit of the response.
               rx_v     := rx_v(rx_v'high-1 downto 0) & miso_i;
               bitCnt_v := bitCnt_v - 1;
               state_v  := RX_BITS;  -- Now receive the reset of the response.
             end if;
-            sclk_r           <= not sclk_r;    -- Toggle the SPI clock...
-            sclkPhaseTimer_v := clkDivider_v;  -- and set the duration of the next clock phase.
+            if rxLate_v then  -- MISO was sampled partway into the low SCLK phase, so finish out the phase.
+              rxLate_v         := false;
+              sclkPhaseTimer_v := clkDivider_v - rxDelay_v;
+            elsif sclk_r = HI and rxDelay_v /= 0 then  -- Lower SCLK on time but sample MISO a bit later.
+              sclk_r           <= LO;
+              sclkPhaseTimer_v := rxDelay_v - 1;
+              rxLate_v         := true;
+            else
+              sclk_r           <= not sclk_r;    -- Toggle the SPI clock...
+              sclkPhaseTimer_v := clkDivider_v;  -- and set the duration of the next clock phase.
+            end if;
 
           when RX_BITS =>               -- Receive bits from the SD card.
-            if sclk_r = HI then    -- Bits enter after the rising edge of SCLK.
+            if rxSample_v then     -- Bits enter after the rising edge of SCLK.
               rx_v := rx_v(rx_v'high-1 downto 0) & miso_i;
               if bitCnt_v /= 0 then     -- More bits left to receive.
                 bitCnt_v := bitCnt_v - 1;
@@ -568,8 +936,17 @@ begin
                 end if;
               end if;
             end if;
-            sclk_r           <= not sclk_r;    -- Toggle the SPI clock...
-            sclkPhaseTimer_v := clkDivider_v;  -- and set the duration of the next clock phase.
+            if rxLate_v then  -- MISO was sampled partway into the low SCLK phase, so finish out the phase.
+              rxLate_v         := false;
+              sclkPhaseTimer_v := clkDivider_v - rxDelay_v;
+            elsif sclk_r = HI and rxDelay_v /= 0 then  -- Lower SCLK on time but sample MISO a bit later.
+              sclk_r           <= LO;
+              sclkPhaseTimer_v := rxDelay_v - 1;
+              rxLate_v         := true;
+            else
+              sclk_r           <= not sclk_r;    -- Toggle the SPI clock...
+              sclkPhaseTimer_v := clkDivider_v;  -- and set the duration of the next clock phase.
+            end if;
             
           when DESELECT =>  -- De-select the SD card and send some clock pulses (Must enter with sclk at zero.)
             doDeselect_v     := false;  -- Once the de-select is done, clear the flag that caused it.
@@ -603,6 +980,7 @@ begin
 
   sclk_o   <= sclk_r;    -- Output the generated SPI clock for the SD card.
   hndShk_o <= hndShk_r;  -- Output the generated handshake to the host.
+  crcErr_o <= crcErr_r;  -- Output the CRC error flag to the host.
   
 end architecture;
 
@@ -0,0 +1,497 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+--**********************************************************************
+-- SD card <=> SDRAM block DMA.
+--
+-- SdDma moves whole blocks between an SdCardCtrl and an SdramCntl
+-- without any help from user logic. Apply a descriptor (SD card block
+-- address, SDRAM address, # of blocks and direction) and pulse start_i.
+-- The blocks are read or written with one multi-block SD card command
+-- and each group of DATA_WIDTH_G/8 bytes is packed into an SDRAM word
+-- with the first byte in the least-significant bits. busy_o stays high
+-- until the transfer is over. Then done_o goes high if it went OK, or
+-- error_o goes high and sdError_o holds the SdCardCtrl error code if it
+-- didn't. (The SdCardCtrl has to be reset after an error.) If the
+-- SdCardCtrl pulses its CRC error flag while reading, the block that
+-- failed is written over when the SdCardCtrl reads it again.
+--
+-- HostIoToSdDma lets a host PC load the descriptor and start the DMA
+-- through its own HostIo ID. It has five 32-bit registers:
+--     0: SD card block address.
+--     1: SDRAM word address.
+--     2: # of blocks in bits 15..0; bit 31 is set for SDRAM to SD card.
+--     3: Writing any value starts the transfer. Reading gets the status:
+--        bit 0 = busy, bit 1 = done, bit 2 = error, bits 31..16 = # of
+--        blocks transferred so far.
+--     4: SdCardCtrl error code (read-only).
+--**********************************************************************
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use work.CommonPckg.all;
+use work.HostIoPckg.all;
+
+package SdDmaPckg is
+
+  component SdDma is
+    generic (
+      DATA_WIDTH_G  : natural := 16;    -- SDRAM data width (a multiple of 8).
+      HADDR_WIDTH_G : natural := 23;    -- SDRAM host-side address width.
+      BLOCK_SIZE_G  : natural := 512    -- Number of bytes in an SD card block.
+      );
+    port (
+      clk_i          : in  std_logic;    -- Master clock (same as the SdCardCtrl and SdramCntl clock).
+      reset_i        : in  std_logic                                  := LO;  -- Active-high reset.
+      -- Descriptor and status.
+      start_i        : in  std_logic                                  := LO;  -- Start the transfer in the descriptor.
+      toSd_i         : in  std_logic                                  := LO;  -- Direction: high for SDRAM to SD card, low for SD card to SDRAM.
+      blkAddr_i      : in  std_logic_vector(31 downto 0)              := (others => ZERO);  -- SD card block address.
+      sdramAddr_i    : in  std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- SDRAM word address.
+      numBlocks_i    : in  std_logic_vector(15 downto 0)              := (others => ZERO);  -- # of blocks to transfer.
+      busy_o         : out std_logic;    -- High while a transfer is going on.
+      done_o         : out std_logic;    -- High once a transfer has finished without errors.
+      error_o        : out std_logic;    -- High once a transfer has stopped because of an SD card error.
+      blocksDone_o   : out std_logic_vector(15 downto 0);  -- # of blocks transferred so far.
+      sdError_o      : out std_logic_vector(15 downto 0);  -- Error code from the SdCardCtrl.
+      -- Interface to SdCardCtrl.
+      sdRd_o         : out std_logic;    -- Read block request.
+      sdWr_o         : out std_logic;    -- Write block request.
+      sdNumBlocks_o  : out std_logic_vector(15 downto 0);  -- # of blocks to read/write.
+      sdAddr_o       : out std_logic_vector(31 downto 0);  -- Block address.
+      sdData_o       : out std_logic_vector(7 downto 0);   -- Data to write to the SD card.
+      sdData_i       : in  std_logic_vector(7 downto 0);   -- Data read from the SD card.
+      sdBusy_i       : in  std_logic;    -- SdCardCtrl is busy.
+      sdHndShk_i     : in  std_logic;    -- SdCardCtrl has data to give or has taken data.
+      sdHndShk_o     : out std_logic;    -- DMA has data to give or has taken data.
+      sdError_i      : in  std_logic_vector(15 downto 0);  -- SdCardCtrl error code.
+      sdCrcErr_i     : in  std_logic                                  := LO;  -- SdCardCtrl CRC error flag.
+      -- Interface to SdramCntl.
+      rd_o           : out std_logic;    -- Initiate SDRAM read operation.
+      wr_o           : out std_logic;    -- Initiate SDRAM write operation.
+      earlyOpBegun_i : in  std_logic;   -- SDRAM read/write op has begun (async).
+      rdDone_i       : in  std_logic;    -- SDRAM read data is available.
+      addr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- SDRAM address.
+      data_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);   -- Data to SDRAM.
+      data_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)    -- Data from SDRAM.
+      );
+  end component;
+
+  component HostIoToSdDma is
+    generic (
+      ID_G               : std_logic_vector := "11111111";  -- The ID this module responds to.
+      PYLD_CNTR_LENGTH_G : natural          := 32;  -- Length of payload bit counter.
+      FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
+      TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
+      SIMPLE_G           : boolean          := false;  -- If true, include BscanToHostIo module in this module.
+      HADDR_WIDTH_G      : natural          := 23  -- SDRAM host-side address width.
+      );
+    port (
+      reset_i      : in  std_logic := LO;  -- Active-high reset signal.
+      clk_i        : in  std_logic;      -- Master clock (same as the SdDma clock).
+      -- Interface to BscanHostIo. (Used only if SIMPLE_G is false.)
+      inShiftDr_i  : in  std_logic := LO;  -- True when USER JTAG instruction is active and the TAP FSM is in the Shift-DR state.
+      drck_i       : in  std_logic := LO;  -- Bit clock. TDI clocked in on rising edge, TDO sampled on falling edge.
+      tdi_i        : in  std_logic := LO;  -- Bit from the host to the DMA registers.
+      tdo_o        : out std_logic;      -- Bit from the DMA registers to the host.
+      -- Interface to SdDma.
+      start_o      : out std_logic;      -- Start the transfer.
+      toSd_o       : out std_logic;      -- Direction of the transfer.
+      blkAddr_o    : out std_logic_vector(31 downto 0);  -- SD card block address.
+      sdramAddr_o  : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- SDRAM word address.
+      numBlocks_o  : out std_logic_vector(15 downto 0);  -- # of blocks to transfer.
+      busy_i       : in  std_logic;      -- DMA is busy.
+      done_i       : in  std_logic;      -- DMA is done.
+      error_i      : in  std_logic;      -- DMA stopped on an error.
+      blocksDone_i : in  std_logic_vector(15 downto 0);  -- # of blocks transferred.
+      sdError_i    : in  std_logic_vector(15 downto 0)   -- SdCardCtrl error code.
+      );
+  end component;
+
+end package;
+
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CommonPckg.all;
+
+entity SdDma is
+  generic (
+    DATA_WIDTH_G  : natural := 16;    -- SDRAM data width (a multiple of 8).
+    HADDR_WIDTH_G : natural := 23;    -- SDRAM host-side address width.
+    BLOCK_SIZE_G  : natural := 512    -- Number of bytes in an SD card block.
+    );
+  port (
+    clk_i          : in  std_logic;    -- Master clock (same as the SdCardCtrl and SdramCntl clock).
+    reset_i        : in  std_logic                                  := LO;  -- Active-high reset.
+    -- Descriptor and status.
+    start_i        : in  std_logic                                  := LO;  -- Start the transfer in the descriptor.
+    toSd_i         : in  std_logic                                  := LO;  -- Direction: high for SDRAM to SD card, low for SD card to SDRAM.
+    blkAddr_i      : in  std_logic_vector(31 downto 0)              := (others => ZERO);  -- SD card block address.
+    sdramAddr_i    : in  std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- SDRAM word address.
+    numBlocks_i    : in  std_logic_vector(15 downto 0)              := (others => ZERO);  -- # of blocks to transfer.
+    busy_o         : out std_logic;    -- High while a transfer is going on.
+    done_o         : out std_logic;    -- High once a transfer has finished without errors.
+    error_o        : out std_logic;    -- High once a transfer has stopped because of an SD card error.
+    blocksDone_o   : out std_logic_vector(15 downto 0);  -- # of blocks transferred so far.
+    sdError_o      : out std_logic_vector(15 downto 0);  -- Error code from the SdCardCtrl.
+    -- Interface to SdCardCtrl.
+    sdRd_o         : out std_logic;    -- Read block request.
+    sdWr_o         : out std_logic;    -- Write block request.
+    sdNumBlocks_o  : out std_logic_vector(15 downto 0);  -- # of blocks to read/write.
+    sdAddr_o       : out std_logic_vector(31 downto 0);  -- Block address.
+    sdData_o       : out std_logic_vector(7 downto 0);   -- Data to write to the SD card.
+    sdData_i       : in  std_logic_vector(7 downto 0);   -- Data read from the SD card.
+    sdBusy_i       : in  std_logic;    -- SdCardCtrl is busy.
+    sdHndShk_i     : in  std_logic;    -- SdCardCtrl has data to give or has taken data.
+    sdHndShk_o     : out std_logic;    -- DMA has data to give or has taken data.
+    sdError_i      : in  std_logic_vector(15 downto 0);  -- SdCardCtrl error code.
+    sdCrcErr_i     : in  std_logic                                  := LO;  -- SdCardCtrl CRC error flag.
+    -- Interface to SdramCntl.
+    rd_o           : out std_logic;    -- Initiate SDRAM read operation.
+    wr_o           : out std_logic;    -- Initiate SDRAM write operation.
+    earlyOpBegun_i : in  std_logic;   -- SDRAM read/write op has begun (async).
+    rdDone_i       : in  std_logic;    -- SDRAM read data is available.
+    addr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- SDRAM address.
+    data_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);   -- Data to SDRAM.
+    data_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)    -- Data from SDRAM.
+    );
+end entity;
+
+
+architecture arch of SdDma is
+  constant BYTES_PER_WORD_C : natural := DATA_WIDTH_G / 8;
+  type StateType is (
+    IDLE,                               -- Wait for a descriptor.
+    WAIT_FOR_SD,                        -- Wait for the SdCardCtrl to be ready.
+    START_SD,                           -- Send the read/write request to the SdCardCtrl.
+    XFER,                               -- Move the bytes of the blocks.
+    FINISH                              -- Wait for the SdCardCtrl to finish the transfer.
+    );
+  signal state_r      : StateType := IDLE;
+  signal toSd_r       : std_logic := LO;  -- Direction of the current transfer.
+  signal blkAddr_r    : std_logic_vector(blkAddr_i'range);
+  signal numBlocks_r  : std_logic_vector(numBlocks_i'range);
+  signal addr_r       : unsigned(addr_o'range);  -- Address of the next SDRAM word.
+  signal bytesLeft_r  : natural range 0 to (2**numBlocks_i'length-1) * BLOCK_SIZE_G;  -- Bytes left to pass to/from the SD card.
+  signal blkByte_r    : natural range 0 to BLOCK_SIZE_G-1;  -- Byte position within the current block.
+  signal blocksDone_r : unsigned(blocksDone_o'range);
+  signal done_r       : std_logic := LO;
+  signal error_r      : std_logic := LO;
+  signal hndShk_r     : std_logic := LO;  -- Handshake to the SdCardCtrl.
+  signal sdData_r     : std_logic_vector(sdData_o'range);  -- Byte to the SdCardCtrl.
+  -- Packing/unpacking bytes into/out of SDRAM words.
+  signal word_r       : std_logic_vector(data_i'range);  -- Word being packed or unpacked.
+  signal wordByte_r   : natural range 0 to BYTES_PER_WORD_C;  -- # of bytes packed into, or left to unpack from, word_r.
+  signal wrWord_r     : std_logic_vector(data_o'range);  -- Full word waiting to be written to the SDRAM.
+  signal wrPend_r     : std_logic := LO;  -- A word is waiting to be written.
+  signal rdPend_r     : std_logic := LO;  -- A word is being read from the SDRAM.
+  signal rdBusy_r     : std_logic := LO;  -- The SDRAM read has begun but its data hasn't arrived.
+  signal wordsLeft_r  : natural range 0 to (2**numBlocks_i'length-1) * BLOCK_SIZE_G;  -- Words left to read from the SDRAM.
+  signal rewind_r     : std_logic := LO;  -- The last block read had a bad CRC, so go back and get it again.
+begin
+
+  process(clk_i)
+    variable word_v : std_logic_vector(word_r'range);
+  begin
+    if rising_edge(clk_i) then
+      if reset_i = HI then
+        state_r  <= IDLE;
+        done_r   <= LO;
+        error_r  <= LO;
+        hndShk_r <= LO;
+        wrPend_r <= LO;
+        rdPend_r <= LO;
+        rdBusy_r <= LO;
+        rewind_r <= LO;
+      else
+
+        -- Write packed words to the SDRAM.
+        if wrPend_r = HI and earlyOpBegun_i = HI then
+          wrPend_r <= LO;
+          addr_r   <= addr_r + 1;
+        end if;
+
+        -- Read words from the SDRAM to unpack.
+        if rdPend_r = HI and earlyOpBegun_i = HI then
+          rdPend_r    <= LO;
+          rdBusy_r    <= HI;
+          addr_r      <= addr_r + 1;
+          wordsLeft_r <= wordsLeft_r - 1;
+        end if;
+        if rdDone_i = HI and rdBusy_r = HI then
+          rdBusy_r   <= LO;
+          word_r     <= data_i;
+          wordByte_r <= BYTES_PER_WORD_C;
+        end if;
+
+        case state_r is
+
+          when IDLE =>
+            if start_i = HI then
+              toSd_r       <= toSd_i;
+              blkAddr_r    <= blkAddr_i;
+              numBlocks_r  <= numBlocks_i;
+              addr_r       <= unsigned(sdramAddr_i);
+              bytesLeft_r  <= to_integer(unsigned(numBlocks_i)) * BLOCK_SIZE_G;
+              wordsLeft_r  <= to_integer(unsigned(numBlocks_i)) * BLOCK_SIZE_G / BYTES_PER_WORD_C;
+              blkByte_r    <= 0;
+              blocksDone_r <= (others => ZERO);
+              wordByte_r   <= 0;
+              rewind_r     <= LO;
+              done_r       <= LO;
+              error_r      <= LO;
+              if unsigned(numBlocks_i) = 0 then
+                done_r <= HI;           -- Nothing to do.
+              else
+                state_r <= WAIT_FOR_SD;
+              end if;
+            end if;
+
+          when WAIT_FOR_SD =>  -- Wait until the SdCardCtrl is done initializing the card.
+            if sdBusy_i = LO then
+              if unsigned(sdError_i) /= 0 then
+                error_r <= HI;          -- The SdCardCtrl is stalled on an earlier error.
+                state_r <= IDLE;
+              else
+                state_r <= START_SD;
+              end if;
+            end if;
+
+          when START_SD =>  -- Hold the request until the SdCardCtrl takes it.
+            if sdBusy_i = HI then
+              state_r <= XFER;
+            end if;
+
+          when XFER =>
+            if toSd_r = LO then
+              -- Take bytes from the SdCardCtrl and pack them into SDRAM words.
+              if sdHndShk_i = HI and hndShk_r = LO and rewind_r = LO and (wordByte_r /= BYTES_PER_WORD_C - 1 or wrPend_r = LO) then
+                word_v := word_r;
+                word_v((wordByte_r+1)*8-1 downto wordByte_r*8) := sdData_i;
+                word_r <= word_v;
+                if wordByte_r = BYTES_PER_WORD_C - 1 then
+                  wrWord_r   <= word_v;   -- Word is full so write it to the SDRAM.
+                  wrPend_r   <= HI;
+                  wordByte_r <= 0;
+                else
+                  wordByte_r <= wordByte_r + 1;
+                end if;
+                hndShk_r    <= HI;      -- Tell the SdCardCtrl the byte was taken.
+                bytesLeft_r <= bytesLeft_r - 1;
+                if blkByte_r = BLOCK_SIZE_G - 1 then
+                  blkByte_r    <= 0;
+                  blocksDone_r <= blocksDone_r + 1;
+                else
+                  blkByte_r <= blkByte_r + 1;
+                end if;
+              end if;
+            else
+              -- Unpack bytes from SDRAM words and give them to the SdCardCtrl.
+              if wordByte_r = 0 and rdPend_r = LO and rdBusy_r = LO and wordsLeft_r /= 0 then
+                rdPend_r <= HI;         -- Get the next word.
+              end if;
+              if sdHndShk_i = HI and hndShk_r = LO and wordByte_r /= 0 then
+                sdData_r    <= word_r(7 downto 0);
+                word_r      <= std_logic_vector(shift_right(unsigned(word_r), 8));
+                wordByte_r  <= wordByte_r - 1;
+                hndShk_r    <= HI;      -- Tell the SdCardCtrl the byte is ready.
+                bytesLeft_r <= bytesLeft_r - 1;
+                if blkByte_r = BLOCK_SIZE_G - 1 then
+                  blkByte_r    <= 0;
+                  blocksDone_r <= blocksDone_r + 1;
+                else
+                  blkByte_r <= blkByte_r + 1;
+                end if;
+              end if;
+            end if;
+            if sdHndShk_i = LO and hndShk_r = HI then
+              hndShk_r <= LO;           -- Finish the handshake.
+            end if;
+            if bytesLeft_r = 0 and hndShk_r = LO and wrPend_r = LO and rewind_r = LO then
+              state_r <= FINISH;
+            end if;
+            if sdBusy_i = LO and bytesLeft_r /= 0 then  -- The SdCardCtrl stopped early because of an error.
+              error_r <= HI;
+              state_r <= IDLE;
+            end if;
+
+          when FINISH =>  -- Wait for the SdCardCtrl to finish writing or stopping the transfer.
+            if sdBusy_i = LO then
+              if unsigned(sdError_i) /= 0 then
+                error_r <= HI;
+              else
+                done_r <= HI;
+              end if;
+              state_r <= IDLE;
+            end if;
+
+        end case;
+
+        -- Back up over a block that failed its CRC check once its last word is in the SDRAM.
+        if toSd_r = LO and sdCrcErr_i = HI and (state_r = XFER or state_r = FINISH) then
+          rewind_r <= HI;
+        end if;
+        if rewind_r = HI and wrPend_r = LO then
+          rewind_r     <= LO;
+          addr_r       <= addr_r - BLOCK_SIZE_G / BYTES_PER_WORD_C;
+          bytesLeft_r  <= bytesLeft_r + BLOCK_SIZE_G;
+          blocksDone_r <= blocksDone_r - 1;
+          state_r      <= XFER;
+        end if;
+      end if;
+    end if;
+  end process;
+
+  busy_o        <= LO when state_r = IDLE else HI;
+  done_o        <= done_r;
+  error_o       <= error_r;
+  blocksDone_o  <= std_logic_vector(blocksDone_r);
+  sdError_o     <= sdError_i;
+  sdRd_o        <= HI when state_r = START_SD and toSd_r = LO else LO;
+  sdWr_o        <= HI when state_r = START_SD and toSd_r = HI else LO;
+  sdNumBlocks_o <= numBlocks_r;
+  sdAddr_o      <= blkAddr_r;
+  sdData_o      <= sdData_r;
+  sdHndShk_o    <= hndShk_r;
+  rd_o          <= rdPend_r;
+  wr_o          <= wrPend_r;
+  addr_o        <= std_logic_vector(addr_r);
+  data_o        <= wrWord_r;
+
+end architecture;
+
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CommonPckg.all;
+use work.HostIoPckg.all;
+
+entity HostIoToSdDma is
+  generic (
+    ID_G               : std_logic_vector := "11111111";  -- The ID this module responds to.
+    PYLD_CNTR_LENGTH_G : natural          := 32;  -- Length of payload bit counter.
+    FPGA_DEVICE_G      : FpgaDevice_t     := SPARTAN3A;  -- FPGA device type.
+    TAP_USER_INSTR_G   : TapUserInstr_t   := USER1;  -- USER instruction this module responds to.
+    SIMPLE_G           : boolean          := false;  -- If true, include BscanToHostIo module in this module.
+    HADDR_WIDTH_G      : natural          := 23  -- SDRAM host-side address width.
+    );
+  port (
+    reset_i      : in  std_logic := LO;  -- Active-high reset signal.
+    clk_i        : in  std_logic;      -- Master clock (same as the SdDma clock).
+    -- Interface to BscanHostIo. (Used only if SIMPLE_G is false.)
+    inShiftDr_i  : in  std_logic := LO;  -- True when USER JTAG instruction is active and the TAP FSM is in the Shift-DR state.
+    drck_i       : in  std_logic := LO;  -- Bit clock. TDI clocked in on rising edge, TDO sampled on falling edge.
+    tdi_i        : in  std_logic := LO;  -- Bit from the host to the DMA registers.
+    tdo_o        : out std_logic;      -- Bit from the DMA registers to the host.
+    -- Interface to SdDma.
+    start_o      : out std_logic;      -- Start the transfer.
+    toSd_o       : out std_logic;      -- Direction of the transfer.
+    blkAddr_o    : out std_logic_vector(31 downto 0);  -- SD card block address.
+    sdramAddr_o  : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- SDRAM word address.
+    numBlocks_o  : out std_logic_vector(15 downto 0);  -- # of blocks to transfer.
+    busy_i       : in  std_logic;      -- DMA is busy.
+    done_i       : in  std_logic;      -- DMA is done.
+    error_i      : in  std_logic;      -- DMA stopped on an error.
+    blocksDone_i : in  std_logic_vector(15 downto 0);  -- # of blocks transferred.
+    sdError_i    : in  std_logic_vector(15 downto 0)   -- SdCardCtrl error code.
+    );
+end entity;
+
+
+architecture arch of HostIoToSdDma is
+  constant NUM_REGS_C   : natural := 5;
+  signal addr_s         : std_logic_vector(Log2(NUM_REGS_C)-1 downto 0);  -- Register address.
+  signal wr_s           : std_logic;    -- Active-high register write.
+  signal rd_s           : std_logic;    -- Active-high register read.
+  signal dataFromHost_s : std_logic_vector(31 downto 0);  -- Data from PC.
+  signal dataToHost_s   : std_logic_vector(31 downto 0);  -- Register value to PC.
+  signal blkAddr_r      : std_logic_vector(31 downto 0) := (others => ZERO);
+  signal sdramAddr_r    : std_logic_vector(31 downto 0) := (others => ZERO);
+  signal blocks_r       : std_logic_vector(31 downto 0) := (others => ZERO);
+begin
+
+  -- Instantiate an interface between the JTAG port and the DMA registers.
+  u1 : HostIoToRam
+    generic map(
+      ID_G               => ID_G,
+      PYLD_CNTR_LENGTH_G => PYLD_CNTR_LENGTH_G,
+      FPGA_DEVICE_G      => FPGA_DEVICE_G,
+      TAP_USER_INSTR_G   => TAP_USER_INSTR_G,
+      SIMPLE_G           => SIMPLE_G,
+      SYNC_G             => true,
+      ADDR_INC           => 1  -- So the host can load the whole descriptor in one go.
+      )
+    port map(
+      reset_i        => reset_i,        -- Active-high reset input.
+      clk_i          => clk_i,          -- Master clock input.
+      -- JTAG interface.
+      inShiftDr_i    => inShiftDr_i,
+      drck_i         => drck_i,
+      tdi_i          => tdi_i,
+      tdo_o          => tdo_o,
+      -- Interface to the registers.
+      addr_o         => addr_s,         -- Register address from PC.
+      wr_o           => wr_s,           -- Write control from PC.
+      rd_o           => rd_s,           -- Read control from PC.
+      dataFromHost_o => dataFromHost_s,  -- Data from PC.
+      dataToHost_i   => dataToHost_s    -- Register value to PC.
+      );
+
+  -- Load the descriptor registers from the PC.
+  process(clk_i)
+  begin
+    if rising_edge(clk_i) then
+      if wr_s = HI then
+        case to_integer(unsigned(addr_s)) is
+          when 0      => blkAddr_r   <= dataFromHost_s;
+          when 1      => sdramAddr_r <= dataFromHost_s;
+          when 2      => blocks_r    <= dataFromHost_s;
+          when others => null;
+        end case;
+      end if;
+    end if;
+  end process;
+
+  -- Writing to the status register starts the DMA.
+  start_o     <= HI when wr_s = HI and to_integer(unsigned(addr_s)) = 3 else LO;
+  blkAddr_o   <= blkAddr_r;
+  sdramAddr_o <= sdramAddr_r(sdramAddr_o'range);
+  numBlocks_o <= blocks_r(15 downto 0);
+  toSd_o      <= blocks_r(31);
+
+  -- Send the selected register to the PC.
+  process(addr_s, blkAddr_r, sdramAddr_r, blocks_r, busy_i, done_i, error_i, blocksDone_i, sdError_i)
+  begin
+    dataToHost_s <= (others => ZERO);
+    case to_integer(unsigned(addr_s)) is
+      when 0 => dataToHost_s <= blkAddr_r;
+      when 1 => dataToHost_s <= sdramAddr_r;
+      when 2 => dataToHost_s <= blocks_r;
+      when 3 => dataToHost_s <= blocksDone_i & x"000" & '0' & error_i & done_i & busy_i;
+      when 4 => dataToHost_s(sdError_i'range) <= sdError_i;
+      when others => null;
+    end case;
+  end process;
+
+end architecture;
@@ -0,0 +1,419 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+--**********************************************************************
+-- Block read-ahead for the SD card controller.
+--
+-- SdReadAhead sits between a host and an SdCardCtrl and has the same
+-- host interface as the SdCardCtrl. When the host reads block N, it
+-- reads blocks N through N+DEPTH_G from the SD card with one multi-block
+-- command into a block RAM, and gives block N to the host as soon as it
+-- arrives. If the host then reads block N+1, it's already in the block
+-- RAM (or on its way), so the host doesn't have to wait for the SD card
+-- to find it, and its bytes are handshaked out at the clock rate. Each
+-- time the host finishes a block, another multi-block read is started
+-- to keep DEPTH_G blocks ahead of the host.
+--
+-- A read of any other block (or any write) throws away the blocks read
+-- ahead. (A multi-block read that is already going has to finish
+-- first.) Writes are passed straight through to the SdCardCtrl, along
+-- with numBlocks_i. The write address and length are kept apart from
+-- the read-ahead's so a read-ahead that starts (or is still waiting for
+-- the SdCardCtrl to take it) when the write comes in can't change them.
+-- Reads are always one block, since reading the next block is what the
+-- read-ahead is for.
+--
+-- If CRC_G is true (and it should match the SdCardCtrl), a block isn't
+-- given to the host until the SdCardCtrl has had the chance to flag a
+-- CRC error in it. A block with a bad CRC is just written over when the
+-- SdCardCtrl reads it again.
+--
+-- hits_o counts the host reads of a block that was read ahead and
+-- misses_o counts the ones that had to start a new read-ahead.
+--
+-- The SD card controller stalls on an error, so don't let the read-ahead
+-- run off the end of the card: stop reading sequentially DEPTH_G blocks
+-- before the last one.
+--**********************************************************************
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use work.CommonPckg.all;
+use work.SdCardPckg.all;
+
+package SdReadAheadPckg is
+
+  component SdReadAhead is
+    generic (
+      DEPTH_G      : natural    := 3;    -- # of blocks to read ahead of the one the host is reading.
+      CRC_G        : boolean    := false;  -- Same as the SdCardCtrl CRC_G.
+      BLOCK_SIZE_G : natural    := 512;  -- Number of bytes in an SD card block.
+      CARD_TYPE_G  : CardType_t := SD_CARD_E  -- Type of SD card connected to the SdCardCtrl.
+      );
+    port (
+      clk_i         : in  std_logic;     -- Master clock (same as the SdCardCtrl clock).
+      reset_i       : in  std_logic                     := LO;  -- Active-high reset.
+      -- Host-side interface (same as the SdCardCtrl).
+      rd_i          : in  std_logic                     := LO;  -- Read block request.
+      wr_i          : in  std_logic                     := LO;  -- Write block request.
+      numBlocks_i   : in  std_logic_vector(15 downto 0) := x"0001";  -- # of blocks to write.
+      addr_i        : in  std_logic_vector(31 downto 0) := x"00000000";  -- Block address.
+      data_i        : in  std_logic_vector(7 downto 0)  := x"00";  -- Data to write to block.
+      data_o        : out std_logic_vector(7 downto 0);  -- Data read from block.
+      busy_o        : out std_logic;     -- High when busy performing some operation.
+      hndShk_i      : in  std_logic;     -- High when host has data to give or has taken data.
+      hndShk_o      : out std_logic;     -- High when read-ahead has taken data or has data to give.
+      error_o       : out std_logic_vector(15 downto 0);  -- SdCardCtrl error code.
+      hits_o        : out std_logic_vector(31 downto 0);  -- # of reads of blocks that were read ahead.
+      misses_o      : out std_logic_vector(31 downto 0);  -- # of reads that started a new read-ahead.
+      -- Interface to SdCardCtrl.
+      sdRd_o        : out std_logic;     -- Read block request.
+      sdWr_o        : out std_logic;     -- Write block request.
+      sdNumBlocks_o : out std_logic_vector(15 downto 0);  -- # of blocks to read/write.
+      sdAddr_o      : out std_logic_vector(31 downto 0);  -- Block address.
+      sdData_o      : out std_logic_vector(7 downto 0);   -- Data to write to the SD card.
+      sdData_i      : in  std_logic_vector(7 downto 0);   -- Data read from the SD card.
+      sdBusy_i      : in  std_logic;     -- SdCardCtrl is busy.
+      sdHndShk_i    : in  std_logic;     -- SdCardCtrl has data to give or has taken data.
+      sdHndShk_o    : out std_logic;     -- Read-ahead has data to give or has taken data.
+      sdError_i     : in  std_logic_vector(15 downto 0);  -- SdCardCtrl error code.
+      sdCrcErr_i    : in  std_logic                     := LO  -- SdCardCtrl CRC error flag.
+      );
+  end component;
+
+end package;
+
+
+
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use work.CommonPckg.all;
+use work.SdCardPckg.all;
+
+entity SdReadAhead is
+  generic (
+    DEPTH_G      : natural    := 3;      -- # of blocks to read ahead of the one the host is reading.
+    CRC_G        : boolean    := false;  -- Same as the SdCardCtrl CRC_G.
+    BLOCK_SIZE_G : natural    := 512;    -- Number of bytes in an SD card block.
+    CARD_TYPE_G  : CardType_t := SD_CARD_E  -- Type of SD card connected to the SdCardCtrl.
+    );
+  port (
+    clk_i         : in  std_logic;       -- Master clock (same as the SdCardCtrl clock).
+    reset_i       : in  std_logic                     := LO;  -- Active-high reset.
+    -- Host-side interface (same as the SdCardCtrl).
+    rd_i          : in  std_logic                     := LO;  -- Read block request.
+    wr_i          : in  std_logic                     := LO;  -- Write block request.
+    numBlocks_i   : in  std_logic_vector(15 downto 0) := x"0001";  -- # of blocks to write.
+    addr_i        : in  std_logic_vector(31 downto 0) := x"00000000";  -- Block address.
+    data_i        : in  std_logic_vector(7 downto 0)  := x"00";  -- Data to write to block.
+    data_o        : out std_logic_vector(7 downto 0);  -- Data read from block.
+    busy_o        : out std_logic;       -- High when busy performing some operation.
+    hndShk_i      : in  std_logic;       -- High when host has data to give or has taken data.
+    hndShk_o      : out std_logic;       -- High when read-ahead has taken data or has data to give.
+    error_o       : out std_logic_vector(15 downto 0);  -- SdCardCtrl error code.
+    hits_o        : out std_logic_vector(31 downto 0);  -- # of reads of blocks that were read ahead.
+    misses_o      : out std_logic_vector(31 downto 0);  -- # of reads that started a new read-ahead.
+    -- Interface to SdCardCtrl.
+    sdRd_o        : out std_logic;       -- Read block request.
+    sdWr_o        : out std_logic;       -- Write block request.
+    sdNumBlocks_o : out std_logic_vector(15 downto 0);  -- # of blocks to read/write.
+    sdAddr_o      : out std_logic_vector(31 downto 0);  -- Block address.
+    sdData_o      : out std_logic_vector(7 downto 0);   -- Data to write to the SD card.
+    sdData_i      : in  std_logic_vector(7 downto 0);   -- Data read from the SD card.
+    sdBusy_i      : in  std_logic;       -- SdCardCtrl is busy.
+    sdHndShk_i    : in  std_logic;       -- SdCardCtrl has data to give or has taken data.
+    sdHndShk_o    : out std_logic;       -- Read-ahead has data to give or has taken data.
+    sdError_i     : in  std_logic_vector(15 downto 0);  -- SdCardCtrl error code.
+    sdCrcErr_i    : in  std_logic                     := LO  -- SdCardCtrl CRC error flag.
+    );
+end entity;
+
+
+architecture arch of SdReadAhead is
+  constant SLOTS_C    : natural := DEPTH_G + 1;  -- # of blocks in the block RAM.
+  constant ADDR_INC_C : natural := IntSelect(CARD_TYPE_G = SD_CARD_E, BLOCK_SIZE_G, 1);  -- Address step between blocks.
+
+  -- Block RAM that holds the blocks read from the SD card.
+  type RamType is array(0 to SLOTS_C*BLOCK_SIZE_G-1) of std_logic_vector(7 downto 0);
+  signal ram_r         : RamType;
+  signal ramWr_r       : std_logic := NO;  -- Write ramData_r into the block RAM.
+  signal ramWrAddr_r   : natural range 0 to SLOTS_C*BLOCK_SIZE_G-1;
+  signal ramData_r     : std_logic_vector(7 downto 0);
+  signal ramRdAddr_s   : natural range 0 to SLOTS_C*BLOCK_SIZE_G-1;
+  signal ramQ_r        : std_logic_vector(7 downto 0);  -- Byte read from the block RAM.
+
+  type HostStateType is (
+    H_IDLE,                             -- Wait for a read or write from the host.
+    H_RESTART,                          -- Throw away the blocks read ahead and start from the host's block.
+    H_SERVE,                            -- Give the host the bytes of its block.
+    H_WR_WAIT,                          -- Wait for the read-ahead to stop before a write.
+    H_WR_START,                         -- Send the write request to the SdCardCtrl.
+    H_WR                                -- Pass the write through to the SdCardCtrl.
+    );
+  type FetchStateType is (
+    F_IDLE,                             -- Wait for room in the block RAM.
+    F_START,                            -- Send the read request to the SdCardCtrl.
+    F_XFER                              -- Put the bytes from the SdCardCtrl into the block RAM.
+    );
+  signal hState_r      : HostStateType  := H_IDLE;
+  signal fState_r      : FetchStateType := F_IDLE;
+  signal init_r        : std_logic      := NO;  -- The SdCardCtrl has finished initializing the SD card.
+  signal stream_r      : std_logic      := NO;  -- Blocks are being read ahead.
+  signal reqAddr_r     : unsigned(addr_i'range);  -- Block requested by the host.
+  signal headAddr_r    : unsigned(addr_i'range);  -- Block the host should read next.
+  signal headSlot_r    : natural range 0 to SLOTS_C-1 := 0;  -- Where that block is in the block RAM.
+  signal numReady_r    : natural range 0 to SLOTS_C   := 0;  -- # of blocks in the block RAM, starting with the head.
+  signal serveByte_r   : natural range 0 to BLOCK_SIZE_G-1;  -- Next byte of the head block for the host.
+  signal rdWait_r      : std_logic      := NO;  -- Wait a clock for the block RAM to output the next byte.
+  signal hndShk_r      : std_logic      := NO;  -- Handshake to the host.
+  signal fetchAddr_r   : unsigned(addr_i'range);  -- Next block to read ahead.
+  signal fetching_r    : natural range 0 to SLOTS_C := 0;  -- # of blocks left in the read-ahead command.
+  signal fillSlot_r    : natural range 0 to SLOTS_C-1 := 0;  -- Where the block being read goes in the block RAM.
+  signal fillByte_r    : natural range 0 to BLOCK_SIZE_G-1;  -- Where the next byte goes in that block.
+  signal pending_r     : std_logic      := NO;  -- A block is waiting to see if it had a CRC error.
+  signal sdHndShk_r    : std_logic      := NO;  -- Handshake to the SdCardCtrl.
+  signal sdRd_r        : std_logic      := NO;
+  signal sdWr_r        : std_logic      := NO;
+  signal sdAddr_r      : std_logic_vector(sdAddr_o'range);
+  signal sdNumBlocks_r : std_logic_vector(sdNumBlocks_o'range);
+  signal wrAddr_r      : std_logic_vector(sdAddr_o'range);  -- Block address for a host write.
+  signal wrNumBlocks_r : std_logic_vector(sdNumBlocks_o'range);  -- # of blocks for a host write.
+  signal hits_r        : unsigned(hits_o'range)   := (others => ZERO);
+  signal misses_r      : unsigned(misses_o'range) := (others => ZERO);
+begin
+
+  process(clk_i)
+    variable numReady_v : natural range 0 to SLOTS_C;
+    variable commit_v   : boolean;      -- The block just read from the SD card can go to the host.
+    variable wrStart_v  : boolean;      -- The host just asked for a write.
+    variable rdMiss_v   : boolean;      -- The host just asked for a block that isn't being read ahead.
+  begin
+    if rising_edge(clk_i) then
+      ramWr_r <= NO;
+
+      if reset_i = HI then
+        hState_r   <= H_IDLE;
+        fState_r   <= F_IDLE;
+        init_r     <= NO;
+        stream_r   <= NO;
+        numReady_r <= 0;
+        fetching_r <= 0;
+        pending_r  <= NO;
+        hndShk_r   <= NO;
+        sdHndShk_r <= NO;
+        sdRd_r     <= NO;
+        sdWr_r     <= NO;
+        hits_r     <= (others => ZERO);
+        misses_r   <= (others => ZERO);
+      else
+
+        numReady_v := numReady_r;
+        wrStart_v  := false;
+        rdMiss_v   := false;
+
+        if sdBusy_i = LO then
+          init_r <= YES;                -- The SD card is ready once the SdCardCtrl stops being busy.
+        end if;
+
+        --*********************************************************************
+        -- Give the host the blocks from the block RAM.
+        --*********************************************************************
+        case hState_r is
+
+          when H_IDLE =>
+            if init_r = YES and unsigned(sdError_i) = 0 then  -- Stall after an SdCardCtrl error.
+              if rd_i = HI then
+                if stream_r = YES and unsigned(addr_i) = headAddr_r then
+                  hits_r   <= hits_r + 1;
+                  rdWait_r <= YES;
+                  hState_r <= H_SERVE;
+                else
+                  misses_r  <= misses_r + 1;
+                  stream_r  <= NO;     -- Stop reading ahead from the old place.
+                  reqAddr_r <= unsigned(addr_i);
+                  rdMiss_v  := true;
+                  hState_r  <= H_RESTART;
+                end if;
+              elsif wr_i = HI then
+                stream_r      <= NO;
+                wrAddr_r      <= addr_i;
+                wrNumBlocks_r <= numBlocks_i;
+                wrStart_v     := true;
+                hState_r      <= H_WR_WAIT;
+              end if;
+            end if;
+
+          when H_RESTART =>  -- Start reading ahead from the host's block once any earlier read-ahead is done.
+            if fState_r = F_IDLE then
+              headAddr_r  <= reqAddr_r;
+              fetchAddr_r <= reqAddr_r;
+              fillSlot_r  <= headSlot_r;
+              fillByte_r  <= 0;
+              numReady_v  := 0;
+              serveByte_r <= 0;
+              rdWait_r    <= YES;
+              stream_r    <= YES;
+              hState_r    <= H_SERVE;
+            end if;
+
+          when H_SERVE =>
+            rdWait_r <= NO;
+            if hndShk_r = LO and hndShk_i = LO and numReady_r /= 0 and rdWait_r = NO then
+              hndShk_r <= HI;           -- The next byte is on data_o.
+            elsif hndShk_r = HI and hndShk_i = HI then
+              hndShk_r <= LO;           -- The host has the byte.
+              rdWait_r <= YES;
+              if serveByte_r = BLOCK_SIZE_G - 1 then  -- The host has the whole block, so free its slot.
+                serveByte_r <= 0;
+                headAddr_r  <= headAddr_r + ADDR_INC_C;
+                if headSlot_r = SLOTS_C - 1 then
+                  headSlot_r <= 0;
+                else
+                  headSlot_r <= headSlot_r + 1;
+                end if;
+                numReady_v := numReady_v - 1;
+                hState_r   <= H_IDLE;
+              else
+                serveByte_r <= serveByte_r + 1;
+              end if;
+            elsif numReady_r = 0 and stream_r = NO then  -- The read-ahead stopped on an error.
+              hState_r <= H_IDLE;
+            end if;
+
+          when H_WR_WAIT =>  -- Wait for any read-ahead to finish.
+            if fState_r = F_IDLE and sdBusy_i = LO then
+              numReady_v := 0;
+              sdWr_r     <= HI;
+              hState_r   <= H_WR_START;
+            end if;
+
+          when H_WR_START =>  -- Hold the request until the SdCardCtrl takes it.
+            if sdBusy_i = HI then
+              sdWr_r   <= LO;
+              hState_r <= H_WR;
+            end if;
+
+          when H_WR =>  -- The handshakes go straight between the host and the SdCardCtrl.
+            if sdBusy_i = LO then
+              hState_r <= H_IDLE;
+            end if;
+
+        end case;
+
+        --*********************************************************************
+        -- Read blocks ahead of the host into the block RAM.
+        --*********************************************************************
+        commit_v := false;
+        case fState_r is
+
+          when F_IDLE =>
+            -- Don't start reading ahead from the old place when a write or a read miss just came in.
+            if stream_r = YES and not wrStart_v and not rdMiss_v and sdBusy_i = LO and unsigned(sdError_i) = 0 and numReady_r /= SLOTS_C then
+              sdAddr_r      <= std_logic_vector(fetchAddr_r);
+              sdNumBlocks_r <= std_logic_vector(to_unsigned(SLOTS_C - numReady_r, sdNumBlocks_r'length));
+              sdRd_r        <= HI;
+              fetching_r    <= SLOTS_C - numReady_r;
+              fetchAddr_r   <= fetchAddr_r + (SLOTS_C - numReady_r) * ADDR_INC_C;
+              fState_r      <= F_START;
+            end if;
+
+          when F_START =>  -- Hold the request until the SdCardCtrl takes it.
+            if sdBusy_i = HI then
+              sdRd_r   <= LO;
+              fState_r <= F_XFER;
+            end if;
+
+          when F_XFER =>
+            if sdHndShk_i = HI and sdHndShk_r = LO then
+              ramWr_r     <= YES;       -- Store the byte from the SdCardCtrl.
+              ramWrAddr_r <= fillSlot_r * BLOCK_SIZE_G + fillByte_r;
+              ramData_r   <= sdData_i;
+              sdHndShk_r  <= HI;
+              commit_v    := pending_r = YES;  -- The block before this one had no CRC error.
+              pending_r   <= NO;
+              if fillByte_r = BLOCK_SIZE_G - 1 then
+                fillByte_r <= 0;
+                if CRC_G then
+                  pending_r <= YES;     -- Wait to see if the SdCardCtrl finds a CRC error.
+                else
+                  commit_v := true;
+                end if;
+              else
+                fillByte_r <= fillByte_r + 1;
+              end if;
+            end if;
+            if sdHndShk_i = LO and sdHndShk_r = HI then
+              sdHndShk_r <= LO;
+            end if;
+            if sdCrcErr_i = HI then
+              pending_r <= NO;          -- Read the block into the same place again.
+            end if;
+            if sdBusy_i = LO then       -- The read-ahead command is done.
+              if pending_r = YES then
+                commit_v := true;
+              end if;
+              pending_r <= NO;
+              fState_r  <= F_IDLE;
+              if fetching_r /= IntSelect(commit_v, 1, 0) then
+                stream_r <= NO;         -- The SdCardCtrl stopped early because of an error.
+              end if;
+            end if;
+
+        end case;
+        if commit_v then
+          numReady_v := numReady_v + 1;
+          fetching_r <= fetching_r - 1;
+          if fillSlot_r = SLOTS_C - 1 then
+            fillSlot_r <= 0;
+          else
+            fillSlot_r <= fillSlot_r + 1;
+          end if;
+        end if;
+
+        numReady_r <= numReady_v;
+      end if;
+    end if;
+  end process;
+
+  -- Block RAM for the blocks read ahead.
+  process(clk_i)
+  begin
+    if rising_edge(clk_i) then
+      if ramWr_r = YES then
+        ram_r(ramWrAddr_r) <= ramData_r;
+      end if;
+      ramQ_r <= ram_r(ramRdAddr_s);
+    end if;
+  end process;
+  ramRdAddr_s <= headSlot_r * BLOCK_SIZE_G + serveByte_r;
+
+  data_o        <= ramQ_r;
+  hndShk_o      <= sdHndShk_i when hState_r = H_WR else hndShk_r;
+  busy_o        <= LO when hState_r = H_IDLE and init_r = YES else HI;
+  error_o       <= sdError_i;
+  hits_o        <= std_logic_vector(hits_r);
+  misses_o      <= std_logic_vector(misses_r);
+  sdRd_o        <= sdRd_r;
+  sdWr_o        <= sdWr_r;
+  sdAddr_o      <= wrAddr_r      when hState_r = H_WR_START or hState_r = H_WR else sdAddr_r;
+  sdNumBlocks_o <= wrNumBlocks_r when hState_r = H_WR_START or hState_r = H_WR else sdNumBlocks_r;
+  sdData_o      <= data_i;
+  sdHndShk_o    <= hndShk_i when hState_r = H_WR else sdHndShk_r;
+
+end architecture;
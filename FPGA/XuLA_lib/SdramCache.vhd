@@ -0,0 +1,715 @@
+--*********************************************************************
+-- This program is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License
+-- as published by the Free Software Foundation; either version 2
+-- of the License, or (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+-- 02111-1307, USA.
+--
+-- 2013 - X Engineering Software Systems Corp. (www.xess.com)
+--*********************************************************************
+
+--*********************************************************************
+-- Cache for the SDRAM controller.
+--*********************************************************************
+
+
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use work.CommonPckg.all;
+
+package SdramCachePckg is
+
+  component SdramCache is
+    generic(
+      LINE_LEN_G    : natural := 8;  -- # of words in a cache line (power of 2, no more than NCOLS_G).
+      NUM_LINES_G   : natural := 256;   -- # of lines in each way of the cache (power of 2).
+      WAYS_G        : natural := 1;  -- 1 for a direct-mapped cache, 2 for a 2-way set-associative cache.
+      WRITE_BACK_G  : boolean := false;  -- If true, writes only go to the SDRAM when a dirty line is replaced.
+      DATA_WIDTH_G  : natural := 16;   -- Host & SDRAM data width.
+      NCOLS_G       : natural := 512;  -- Number of columns in SDRAM array.
+      HADDR_WIDTH_G : natural := 23    -- Host-side address width.
+      );
+    port(
+      clk_i              : in  std_logic;  -- Master clock.
+      rst_i              : in  std_logic                                  := NO;  -- Reset.
+      -- Host side (same as SdramCntl).
+      rd_i               : in  std_logic                                  := NO;  -- Initiate read operation.
+      wr_i               : in  std_logic                                  := NO;  -- Initiate write operation.
+      earlyOpBegun_o     : out std_logic;  -- Read/write op has begun (async).
+      opBegun_o          : out std_logic;  -- Read/write op has begun (clocked).
+      rdPending_o        : out std_logic;  -- True if read operation(s) are still in the pipeline.
+      done_o             : out std_logic;  -- Read or write operation is done.
+      rdDone_o           : out std_logic;  -- Read operation is done and data is available.
+      addr_i             : in  std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- Address from host.
+      data_i             : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host.
+      data_o             : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to host.
+      hits_o             : out std_logic_vector(31 downto 0);  -- # of reads/writes that hit in the cache.
+      misses_o           : out std_logic_vector(31 downto 0);  -- # of reads/writes that missed.
+      -- SdramCntl side.
+      cntlRd_o           : out std_logic;  -- Initiate read operation.
+      cntlWr_o           : out std_logic;  -- Initiate write operation.
+      cntlBurstLen_o     : out std_logic_vector(Log2(NCOLS_G) downto 0);  -- # of words to read/write.
+      cntlEarlyOpBegun_i : in  std_logic;  -- Read/write op has begun (async).
+      cntlBeat_i         : in  std_logic;  -- A word of the read/write op has begun (async).
+      cntlRdDone_i       : in  std_logic;  -- Read operation is done and data is available.
+      cntlAddr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- Address to SDRAM.
+      cntlData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to SDRAM.
+      cntlData_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  -- Data from SDRAM.
+      );
+  end component;
+
+  component CachedSdram is
+    generic(
+      LINE_LEN_G             : natural := 8;  -- # of words in a cache line (power of 2, no more than NCOLS_G).
+      NUM_LINES_G            : natural := 256;  -- # of lines in each way of the cache (power of 2).
+      WAYS_G                 : natural := 1;  -- 1 for a direct-mapped cache, 2 for a 2-way set-associative cache.
+      WRITE_BACK_G           : boolean := false;  -- If true, writes only go to the SDRAM when a dirty line is replaced.
+      FREQ_G                 : real    := 100.0;  -- Operating frequency in MHz.
+      IN_PHASE_G             : boolean := true;  -- SDRAM and controller work on same or opposite clock edge.
+      PIPE_EN_G              : boolean := false;  -- If true, enable pipelined read operations.
+      MAX_NOP_G              : natural := 10000;  -- Number of NOPs before entering self-refresh.
+      ENABLE_REFRESH_G       : boolean := true;  -- If true, row refreshes are automatically inserted.
+      MULTIPLE_ACTIVE_ROWS_G : boolean := false;  -- If true, allow an active row in each bank.
+      DATA_WIDTH_G           : natural := 16;  -- Host & SDRAM data width.
+      -- Parameters for Winbond W9812G6JH-75 (all times are in nanoseconds).
+      NROWS_G                : natural := 4096;  -- Number of rows in SDRAM array.
+      NCOLS_G                : natural := 512;  -- Number of columns in SDRAM array.
+      HADDR_WIDTH_G          : natural := 23;  -- Host-side address width.
+      SADDR_WIDTH_G          : natural := 12;  -- SDRAM-side address width.
+      T_INIT_G               : real    := 200_000.0;  -- min initialization interval (ns).
+      T_RAS_G                : real    := 45.0;  -- min interval between active to precharge commands (ns).
+      T_RCD_G                : real    := 20.0;  -- min interval between active and R/W commands (ns).
+      T_REF_G                : real    := 64_000_000.0;  -- maximum refresh interval (ns).
+      T_RFC_G                : real    := 65.0;  -- duration of refresh operation (ns).
+      T_RP_G                 : real    := 20.0;  -- min precharge command duration (ns).
+      T_XSR_G                : real    := 75.0  -- exit self-refresh time (ns).
+      );
+    port(
+      -- Host side.
+      clk_i          : in    std_logic;  -- Master clock.
+      lock_i         : in    std_logic                                  := YES;  -- True if clock is stable.
+      rst_i          : in    std_logic                                  := NO;  -- Reset.
+      rd_i           : in    std_logic                                  := NO;  -- Initiate read operation.
+      wr_i           : in    std_logic                                  := NO;  -- Initiate write operation.
+      earlyOpBegun_o : out   std_logic;  -- Read/write op has begun (async).
+      opBegun_o      : out   std_logic;  -- Read/write op has begun (clocked).
+      rdPending_o    : out   std_logic;  -- True if read operation(s) are still in the pipeline.
+      done_o         : out   std_logic;  -- Read or write operation is done_o.
+      rdDone_o       : out   std_logic;  -- Read operation is done_o and data is available.
+      addr_i         : in    std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- Address from host to SDRAM.
+      data_i         : in    std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host to SDRAM.
+      data_o         : out   std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data from SDRAM to host.
+      status_o       : out   std_logic_vector(3 downto 0);  -- Diagnostic status of the SDRAM controller FSM.
+      hits_o         : out   std_logic_vector(31 downto 0);  -- # of reads/writes that hit in the cache.
+      misses_o       : out   std_logic_vector(31 downto 0);  -- # of reads/writes that missed.
+
+      -- SDRAM side.
+      sdCke_o        : out   std_logic;  -- Clock-enable to SDRAM.
+      sdCe_bo        : out   std_logic;  -- Chip-select to SDRAM.
+      sdRas_bo       : out   std_logic;  -- SDRAM row address strobe.
+      sdCas_bo       : out   std_logic;  -- SDRAM column address strobe.
+      sdWe_bo        : out   std_logic;  -- SDRAM write enable.
+      sdBs_o         : out   std_logic_vector(1 downto 0);  -- SDRAM bank address.
+      sdAddr_o       : out   std_logic_vector(SADDR_WIDTH_G-1 downto 0);  -- SDRAM row/column address.
+      sdData_io      : inout std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to/from SDRAM.
+      sdDqmh_o       : out   std_logic;  -- Enable upper-byte of SDRAM databus if true.
+      sdDqml_o       : out   std_logic  -- Enable lower-byte of SDRAM databus if true.
+      );
+  end component;
+
+end package;
+
+
+
+
+--*********************************************************************
+-- Cache for the SDRAM controller.
+--
+-- This sits between a host and SdramCntl and keeps copies of recently
+-- used lines of LINE_LEN_G words in block RAM. Reads of a cached word
+-- are done in one cycle without touching the SDRAM. On a miss, the
+-- whole line is read from the SDRAM as a single burst (so SdramCntl
+-- can't have LOOKAHEAD_G > 0) and then the read is done from the cache.
+-- The data of the last read stays on data_o until the next read is done.
+-- WAYS_G = 2 lets each line go in one of two places and the least
+-- recently used one is replaced.
+--
+-- With WRITE_BACK_G = false, every write goes straight through to the
+-- SDRAM and also updates the cache if the line is there (a write miss
+-- doesn't bring the line into the cache). With WRITE_BACK_G = true, a
+-- write miss brings in the line first and writes just update the cache
+-- and mark the line as dirty. A dirty line is written back to the
+-- SDRAM as a burst before it's replaced. (The SDRAM won't see those
+-- writes until then, so nothing else should be reading the SDRAM
+-- behind the cache's back.)
+--
+-- hits_o and misses_o count the reads/writes that found or didn't find
+-- their line in the cache.
+--*********************************************************************
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use WORK.CommonPckg.all;
+
+entity SdramCache is
+  generic(
+    LINE_LEN_G    : natural := 8;  -- # of words in a cache line (power of 2, no more than NCOLS_G).
+    NUM_LINES_G   : natural := 256;   -- # of lines in each way of the cache (power of 2).
+    WAYS_G        : natural := 1;  -- 1 for a direct-mapped cache, 2 for a 2-way set-associative cache.
+    WRITE_BACK_G  : boolean := false;  -- If true, writes only go to the SDRAM when a dirty line is replaced.
+    DATA_WIDTH_G  : natural := 16;   -- Host & SDRAM data width.
+    NCOLS_G       : natural := 512;  -- Number of columns in SDRAM array.
+    HADDR_WIDTH_G : natural := 23    -- Host-side address width.
+    );
+  port(
+    clk_i              : in  std_logic;  -- Master clock.
+    rst_i              : in  std_logic                                  := NO;  -- Reset.
+    -- Host side (same as SdramCntl).
+    rd_i               : in  std_logic                                  := NO;  -- Initiate read operation.
+    wr_i               : in  std_logic                                  := NO;  -- Initiate write operation.
+    earlyOpBegun_o     : out std_logic;  -- Read/write op has begun (async).
+    opBegun_o          : out std_logic;  -- Read/write op has begun (clocked).
+    rdPending_o        : out std_logic;  -- True if read operation(s) are still in the pipeline.
+    done_o             : out std_logic;  -- Read or write operation is done.
+    rdDone_o           : out std_logic;  -- Read operation is done and data is available.
+    addr_i             : in  std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- Address from host.
+    data_i             : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host.
+    data_o             : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to host.
+    hits_o             : out std_logic_vector(31 downto 0);  -- # of reads/writes that hit in the cache.
+    misses_o           : out std_logic_vector(31 downto 0);  -- # of reads/writes that missed.
+    -- SdramCntl side.
+    cntlRd_o           : out std_logic;  -- Initiate read operation.
+    cntlWr_o           : out std_logic;  -- Initiate write operation.
+    cntlBurstLen_o     : out std_logic_vector(Log2(NCOLS_G) downto 0);  -- # of words to read/write.
+    cntlEarlyOpBegun_i : in  std_logic;  -- Read/write op has begun (async).
+    cntlBeat_i         : in  std_logic;  -- A word of the read/write op has begun (async).
+    cntlRdDone_i       : in  std_logic;  -- Read operation is done and data is available.
+    cntlAddr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- Address to SDRAM.
+    cntlData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to SDRAM.
+    cntlData_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  -- Data from SDRAM.
+    );
+end entity;
+
+
+architecture arch of SdramCache is
+  constant OFFSET_LEN_C : natural := Log2(LINE_LEN_G);  -- # of address bits for a word within a line.
+  constant INDEX_LEN_C  : natural := Log2(NUM_LINES_G);  -- # of address bits that select a line.
+  constant TAG_LEN_C    : natural := HADDR_WIDTH_G - INDEX_LEN_C - OFFSET_LEN_C;  -- # of address bits stored in a tag.
+  constant WAY_LEN_C    : natural := Log2(WAYS_G);  -- # of address bits that select a way.
+
+  subtype TagType is std_logic_vector(TAG_LEN_C-1 downto 0);
+  type TagArrayType is array(0 to WAYS_G*NUM_LINES_G-1) of TagType;
+  signal tags_r  : TagArrayType;        -- address tags of the cached lines.
+  signal valid_r : std_logic_vector(0 to WAYS_G*NUM_LINES_G-1) := (others => NO);  -- lines holding data.
+  signal dirty_r : std_logic_vector(0 to WAYS_G*NUM_LINES_G-1) := (others => NO);  -- lines changed by writes.
+  signal lru_r   : std_logic_vector(0 to NUM_LINES_G-1)        := (others => ZERO);  -- way to replace next.
+
+  -- block RAM that holds the cached data.
+  subtype WordType is std_logic_vector(DATA_WIDTH_G-1 downto 0);
+  type DataArrayType is array(0 to WAYS_G*NUM_LINES_G*LINE_LEN_G-1) of WordType;
+  signal lines_r   : DataArrayType;
+  signal ramAddr_s : natural range 0 to WAYS_G*NUM_LINES_G*LINE_LEN_G-1;  -- location in the block RAM.
+  signal ramWr_s   : std_logic;         -- write ramData_s into the block RAM.
+  signal ramData_s : WordType;          -- data to write.
+  signal ramQ_r    : WordType;          -- data read from the block RAM.
+
+  -- the host address split into tag, line index and word offset.
+  signal tag_s    : TagType;
+  signal index_s  : natural range 0 to NUM_LINES_G-1;
+  signal offset_s : natural range 0 to LINE_LEN_G-1;
+  signal hit_s    : std_logic;          -- host address is in the cache.
+  signal hitWay_s : natural range 0 to WAYS_G-1;  -- way that holds it.
+
+  type StateType is (
+    LOOKUP,                             -- look for the host's read/write in the cache.
+    EVICT_START,                        -- get the first word of a dirty line out of the block RAM.
+    EVICT,                              -- write a dirty line back to the SDRAM.
+    FILL                                -- read a line from the SDRAM into the cache.
+    );
+  signal state_r, state_x   : StateType := LOOKUP;
+  signal way_r, way_x       : natural range 0 to WAYS_G-1 := 0;  -- way being replaced.
+  signal index_r, index_x   : natural range 0 to NUM_LINES_G-1 := 0;  -- line being replaced.
+  signal tag_r, tag_x       : TagType;  -- tag of the line being brought in.
+  signal issued_r, issued_x : natural range 0 to LINE_LEN_G := 0;  -- # of words of the line that have begun.
+  signal rcvd_r, rcvd_x     : natural range 0 to LINE_LEN_G := 0;  -- # of words of the line read from the SDRAM.
+
+  signal earlyOpBegun_s : std_logic;    -- (internal copy).
+  signal rdHit_s        : std_logic;    -- a read hit has begun.
+  signal wrHit_s        : std_logic;    -- a write hit has begun.
+  signal wrBegun_s      : std_logic;    -- a write has begun.
+  signal miss_s         : std_logic;    -- a read/write missed.
+  signal rdDone_r       : std_logic := NO;  -- read hit data is available.
+  signal wrDone_r       : std_logic := NO;  -- write is done.
+  signal opBegun_r      : std_logic := NO;
+  signal filled_r       : std_logic := NO;  -- a line was just brought in for the host's read/write.
+  signal rdData_r       : WordType;     -- data from the last read.
+  signal hits_r         : unsigned(hits_o'range)   := (others => '0');
+  signal misses_r       : unsigned(misses_o'range) := (others => '0');
+begin
+
+  -- split the host address into its tag, line index and word offset.
+  tag_s    <= addr_i(HADDR_WIDTH_G-1 downto INDEX_LEN_C + OFFSET_LEN_C);
+  index_s  <= to_integer(unsigned(addr_i(INDEX_LEN_C + OFFSET_LEN_C - 1 downto OFFSET_LEN_C)));
+  offset_s <= to_integer(unsigned(addr_i(OFFSET_LEN_C - 1 downto 0)));
+
+  -- look for the host address in each way of the cache.
+  process(tag_s, index_s, tags_r, valid_r)
+  begin
+    hit_s    <= NO;
+    hitWay_s <= 0;
+    for w in 0 to WAYS_G-1 loop
+      if (valid_r(w*NUM_LINES_G + index_s) = YES) and (tags_r(w*NUM_LINES_G + index_s) = tag_s) then
+        hit_s    <= YES;
+        hitWay_s <= w;
+      end if;
+    end loop;
+  end process;
+
+  --*********************************************************************
+  -- handle host reads/writes and move lines between the cache and the SDRAM
+  --*********************************************************************
+
+  combinatorial : process(state_r, rd_i, wr_i, addr_i, data_i, hit_s, hitWay_s, index_s, offset_s, tag_s,
+                          tags_r, valid_r, dirty_r, lru_r, way_r, index_r, tag_r, issued_r, rcvd_r,
+                          ramQ_r, cntlEarlyOpBegun_i, cntlBeat_i, cntlRdDone_i, cntlData_i)
+    variable miss_v : boolean;
+    variable way_v  : natural range 0 to WAYS_G-1;
+    variable line_v : natural range 0 to WAYS_G*NUM_LINES_G-1;
+  begin
+    -- by default, nothing happens.
+    state_x        <= state_r;
+    way_x          <= way_r;
+    index_x        <= index_r;
+    tag_x          <= tag_r;
+    issued_x       <= issued_r;
+    rcvd_x         <= rcvd_r;
+    earlyOpBegun_s <= NO;
+    rdHit_s        <= NO;
+    wrHit_s        <= NO;
+    wrBegun_s      <= NO;
+    miss_s         <= NO;
+    miss_v         := false;
+    ramAddr_s      <= (hitWay_s*NUM_LINES_G + index_s)*LINE_LEN_G + offset_s;
+    ramWr_s        <= NO;
+    ramData_s      <= data_i;
+    cntlRd_o       <= NO;
+    cntlWr_o       <= NO;
+    cntlBurstLen_o <= std_logic_vector(to_unsigned(1, cntlBurstLen_o'length));
+    cntlAddr_o     <= addr_i;
+    cntlData_o     <= data_i;
+
+    case state_r is
+
+      when LOOKUP =>
+        if rd_i = YES then
+          if hit_s = YES then
+            -- read the word from the block RAM; it'll be ready on the next cycle.
+            earlyOpBegun_s <= YES;
+            rdHit_s        <= YES;
+          else
+            miss_v := true;
+          end if;
+        elsif wr_i = YES then
+          if WRITE_BACK_G then
+            if hit_s = YES then
+              -- just write the word into the cache and remember the line has changed.
+              earlyOpBegun_s <= YES;
+              wrHit_s        <= YES;
+              wrBegun_s      <= YES;
+              ramWr_s        <= YES;
+            else
+              miss_v := true;           -- bring in the line and then write it
+            end if;
+          else
+            -- write the word to the SDRAM and update the cache if the line is there.
+            cntlWr_o       <= YES;
+            earlyOpBegun_s <= cntlEarlyOpBegun_i;
+            wrBegun_s      <= cntlEarlyOpBegun_i;
+            if hit_s = YES then
+              wrHit_s <= cntlEarlyOpBegun_i;
+              ramWr_s <= cntlEarlyOpBegun_i;
+            end if;
+          end if;
+        end if;
+
+        if miss_v then
+          miss_s <= YES;
+          -- pick the line to replace: the empty or least-recently used way.
+          way_v := 0;
+          if WAYS_G = 2 then
+            if valid_r(index_s) = NO then
+              way_v := 0;
+            elsif valid_r(NUM_LINES_G + index_s) = NO then
+              way_v := 1;
+            elsif lru_r(index_s) = ONE then
+              way_v := 1;
+            end if;
+          end if;
+          line_v   := way_v*NUM_LINES_G + index_s;
+          way_x    <= way_v;
+          index_x  <= index_s;
+          tag_x    <= tag_s;
+          issued_x <= 0;
+          rcvd_x   <= 0;
+          if (valid_r(line_v) = YES) and (dirty_r(line_v) = YES) then
+            state_x <= EVICT_START;     -- write back the dirty line first
+          else
+            state_x <= FILL;
+          end if;
+        end if;
+
+      when EVICT_START =>
+        -- fetch the first word so it's ready when the write burst starts.
+        ramAddr_s <= (way_r*NUM_LINES_G + index_r)*LINE_LEN_G;
+        state_x   <= EVICT;
+
+      when EVICT =>
+        -- write the dirty line to where it came from in the SDRAM. The next word
+        -- is fetched from the block RAM as each word of the burst begins.
+        -- The address and length always cover just the words that are left in
+        -- case the SDRAM controller cuts the burst short to do a refresh.
+        cntlWr_o       <= YES;
+        cntlBurstLen_o <= std_logic_vector(to_unsigned(LINE_LEN_G - issued_r, cntlBurstLen_o'length));
+        cntlAddr_o     <= tags_r(way_r*NUM_LINES_G + index_r)
+                          & std_logic_vector(to_unsigned(index_r, INDEX_LEN_C))
+                          & std_logic_vector(to_unsigned(issued_r mod LINE_LEN_G, OFFSET_LEN_C));
+        cntlData_o     <= ramQ_r;
+        ramAddr_s      <= (way_r*NUM_LINES_G + index_r)*LINE_LEN_G + issued_r;
+        if cntlBeat_i = YES then
+          issued_x <= issued_r + 1;
+          if issued_r = LINE_LEN_G-1 then
+            issued_x <= 0;
+            state_x  <= FILL;           -- now bring in the new line
+          else
+            ramAddr_s <= (way_r*NUM_LINES_G + index_r)*LINE_LEN_G + issued_r + 1;
+          end if;
+        end if;
+
+      when FILL =>
+        -- read the whole line from the SDRAM in one burst and store the words as they arrive.
+        -- (If the burst gets cut short by a refresh, the rest of the line is read in another.)
+        if issued_r /= LINE_LEN_G then
+          cntlRd_o <= YES;
+        end if;
+        cntlBurstLen_o <= std_logic_vector(to_unsigned(LINE_LEN_G - issued_r, cntlBurstLen_o'length));
+        cntlAddr_o     <= tag_r
+                          & std_logic_vector(to_unsigned(index_r, INDEX_LEN_C))
+                          & std_logic_vector(to_unsigned(issued_r mod LINE_LEN_G, OFFSET_LEN_C));
+        if cntlBeat_i = YES then
+          issued_x <= issued_r + 1;
+        end if;
+        ramAddr_s <= (way_r*NUM_LINES_G + index_r)*LINE_LEN_G + rcvd_r;
+        ramData_s <= cntlData_i;
+        if cntlRdDone_i = YES then
+          ramWr_s <= YES;
+          rcvd_x  <= rcvd_r + 1;
+          if rcvd_r = LINE_LEN_G-1 then
+            state_x <= LOOKUP;          -- the host's read/write will hit now
+          end if;
+        end if;
+
+    end case;
+  end process combinatorial;
+
+  earlyOpBegun_o <= earlyOpBegun_s;
+  opBegun_o      <= opBegun_r;
+  data_o         <= ramQ_r when rdDone_r = YES else rdData_r;
+  rdDone_o       <= rdDone_r;
+  done_o         <= rdDone_r or wrDone_r;
+  rdPending_o    <= NO;                -- a read hit is done on the cycle after it begins
+  hits_o         <= std_logic_vector(hits_r);
+  misses_o       <= std_logic_vector(misses_r);
+
+  --*********************************************************************
+  -- block RAM for the cached data and distributed RAM for the tags
+  --*********************************************************************
+
+  process(clk_i)
+  begin
+    if rising_edge(clk_i) then
+      if ramWr_s = YES then
+        lines_r(ramAddr_s) <= ramData_s;
+      end if;
+      ramQ_r <= lines_r(ramAddr_s);
+    end if;
+  end process;
+
+  -- tags of the lines in the cache.
+  process(clk_i)
+  begin
+    if rising_edge(clk_i) then
+      if (state_r = FILL) and (state_x = LOOKUP) then
+        tags_r(way_r*NUM_LINES_G + index_r) <= tag_r;
+      end if;
+    end if;
+  end process;
+
+  --*********************************************************************
+  -- update registers on the appropriate clock edge
+  --*********************************************************************
+
+  update : process(rst_i, clk_i)
+  begin
+    if rst_i = YES then
+      state_r   <= LOOKUP;
+      valid_r   <= (others => NO);
+      dirty_r   <= (others => NO);
+      lru_r     <= (others => ZERO);
+      issued_r  <= 0;
+      rcvd_r    <= 0;
+      rdDone_r  <= NO;
+      wrDone_r  <= NO;
+      opBegun_r <= NO;
+      filled_r  <= NO;
+      hits_r    <= (others => '0');
+      misses_r  <= (others => '0');
+    elsif rising_edge(clk_i) then
+      state_r   <= state_x;
+      way_r     <= way_x;
+      index_r   <= index_x;
+      tag_r     <= tag_x;
+      issued_r  <= issued_x;
+      rcvd_r    <= rcvd_x;
+      rdDone_r  <= rdHit_s;
+      wrDone_r  <= wrBegun_s;
+      opBegun_r <= earlyOpBegun_s;
+
+      -- hold the read data for the host until the next read is done.
+      if rdDone_r = YES then
+        rdData_r <= ramQ_r;
+      end if;
+
+      -- count hits and misses. (A miss turns into a hit once the line is brought in, so
+      -- that hit isn't counted.)
+      if filled_r = YES then
+        null;
+      elsif (rdHit_s = YES) or ((wrHit_s = YES) and WRITE_BACK_G) then
+        hits_r <= hits_r + 1;
+      end if;
+      if (wrBegun_s = YES) and not WRITE_BACK_G then
+        -- every write-through is counted as a hit or a miss when it begins.
+        if hit_s = YES then
+          hits_r <= hits_r + 1;
+        else
+          misses_r <= misses_r + 1;
+        end if;
+      end if;
+      if miss_s = YES then
+        misses_r <= misses_r + 1;
+      end if;
+
+      -- mark the line that holds the host's read/write as most recently used.
+      if (rdHit_s = YES) or (wrHit_s = YES) then
+        lru_r(index_s) <= BooleanToStdLogic(hitWay_s = 0);
+      end if;
+      if (wrHit_s = YES) and WRITE_BACK_G then
+        dirty_r(hitWay_s*NUM_LINES_G + index_s) <= YES;
+      end if;
+
+      -- invalidate the line being replaced and record the new one once it's all there.
+      if (state_r = LOOKUP) and (state_x /= LOOKUP) then
+        valid_r(way_x*NUM_LINES_G + index_x) <= NO;
+      end if;
+      if earlyOpBegun_s = YES then
+        filled_r <= NO;
+      end if;
+      if (state_r = FILL) and (state_x = LOOKUP) then
+        filled_r                             <= YES;
+        valid_r(way_r*NUM_LINES_G + index_r) <= YES;
+        dirty_r(way_r*NUM_LINES_G + index_r) <= NO;
+      end if;
+    end if;
+  end process update;
+
+end architecture;
+
+
+
+
+--*********************************************************************
+-- SDRAM controller with a cache in front of it.
+--
+-- This has the same host interface as SdramCntl plus the cache hit and
+-- miss counts. Lines of up to eight words are filled using SDRAM bursts
+-- of the same length; longer lines are filled with single-word reads
+-- that still run back-to-back within the row.
+--*********************************************************************
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use WORK.CommonPckg.all;
+use WORK.SdramCntlPckg.all;
+use WORK.SdramCachePckg.all;
+
+entity CachedSdram is
+  generic(
+    LINE_LEN_G             : natural := 8;  -- # of words in a cache line (power of 2, no more than NCOLS_G).
+    NUM_LINES_G            : natural := 256;  -- # of lines in each way of the cache (power of 2).
+    WAYS_G                 : natural := 1;  -- 1 for a direct-mapped cache, 2 for a 2-way set-associative cache.
+    WRITE_BACK_G           : boolean := false;  -- If true, writes only go to the SDRAM when a dirty line is replaced.
+    FREQ_G                 : real    := 100.0;  -- Operating frequency in MHz.
+    IN_PHASE_G             : boolean := true;  -- SDRAM and controller work on same or opposite clock edge.
+    PIPE_EN_G              : boolean := false;  -- If true, enable pipelined read operations.
+    MAX_NOP_G              : natural := 10000;  -- Number of NOPs before entering self-refresh.
+    ENABLE_REFRESH_G       : boolean := true;  -- If true, row refreshes are automatically inserted.
+    MULTIPLE_ACTIVE_ROWS_G : boolean := false;  -- If true, allow an active row in each bank.
+    DATA_WIDTH_G           : natural := 16;  -- Host & SDRAM data width.
+    -- Parameters for Winbond W9812G6JH-75 (all times are in nanoseconds).
+    NROWS_G                : natural := 4096;  -- Number of rows in SDRAM array.
+    NCOLS_G                : natural := 512;  -- Number of columns in SDRAM array.
+    HADDR_WIDTH_G          : natural := 23;  -- Host-side address width.
+    SADDR_WIDTH_G          : natural := 12;  -- SDRAM-side address width.
+    T_INIT_G               : real    := 200_000.0;  -- min initialization interval (ns).
+    T_RAS_G                : real    := 45.0;  -- min interval between active to precharge commands (ns).
+    T_RCD_G                : real    := 20.0;  -- min interval between active and R/W commands (ns).
+    T_REF_G                : real    := 64_000_000.0;  -- maximum refresh interval (ns).
+    T_RFC_G                : real    := 65.0;  -- duration of refresh operation (ns).
+    T_RP_G                 : real    := 20.0;  -- min precharge command duration (ns).
+    T_XSR_G                : real    := 75.0  -- exit self-refresh time (ns).
+    );
+  port(
+    -- Host side.
+    clk_i          : in    std_logic;  -- Master clock.
+    lock_i         : in    std_logic                                  := YES;  -- True if clock is stable.
+    rst_i          : in    std_logic                                  := NO;  -- Reset.
+    rd_i           : in    std_logic                                  := NO;  -- Initiate read operation.
+    wr_i           : in    std_logic                                  := NO;  -- Initiate write operation.
+    earlyOpBegun_o : out   std_logic;  -- Read/write op has begun (async).
+    opBegun_o      : out   std_logic;  -- Read/write op has begun (clocked).
+    rdPending_o    : out   std_logic;  -- True if read operation(s) are still in the pipeline.
+    done_o         : out   std_logic;  -- Read or write operation is done_o.
+    rdDone_o       : out   std_logic;  -- Read operation is done_o and data is available.
+    addr_i         : in    std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- Address from host to SDRAM.
+    data_i         : in    std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host to SDRAM.
+    data_o         : out   std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data from SDRAM to host.
+    status_o       : out   std_logic_vector(3 downto 0);  -- Diagnostic status of the SDRAM controller FSM.
+    hits_o         : out   std_logic_vector(31 downto 0);  -- # of reads/writes that hit in the cache.
+    misses_o       : out   std_logic_vector(31 downto 0);  -- # of reads/writes that missed.
+
+    -- SDRAM side.
+    sdCke_o        : out   std_logic;  -- Clock-enable to SDRAM.
+    sdCe_bo        : out   std_logic;  -- Chip-select to SDRAM.
+    sdRas_bo       : out   std_logic;  -- SDRAM row address strobe.
+    sdCas_bo       : out   std_logic;  -- SDRAM column address strobe.
+    sdWe_bo        : out   std_logic;  -- SDRAM write enable.
+    sdBs_o         : out   std_logic_vector(1 downto 0);  -- SDRAM bank address.
+    sdAddr_o       : out   std_logic_vector(SADDR_WIDTH_G-1 downto 0);  -- SDRAM row/column address.
+    sdData_io      : inout std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to/from SDRAM.
+    sdDqmh_o       : out   std_logic;  -- Enable upper-byte of SDRAM databus if true.
+    sdDqml_o       : out   std_logic  -- Enable lower-byte of SDRAM databus if true.
+    );
+end entity;
+
+
+architecture arch of CachedSdram is
+  signal rd_s            : std_logic;
+  signal wr_s            : std_logic;
+  signal burstLen_s      : std_logic_vector(Log2(NCOLS_G) downto 0);
+  signal earlyOpBegun_s  : std_logic;
+  signal beat_s          : std_logic;
+  signal rdDone_s        : std_logic;
+  signal addr_s          : std_logic_vector(HADDR_WIDTH_G-1 downto 0);
+  signal dataToSdram_s   : std_logic_vector(DATA_WIDTH_G-1 downto 0);
+  signal dataFromSdram_s : std_logic_vector(DATA_WIDTH_G-1 downto 0);
+begin
+
+  u0 : SdramCache
+    generic map(
+      LINE_LEN_G    => LINE_LEN_G,
+      NUM_LINES_G   => NUM_LINES_G,
+      WAYS_G        => WAYS_G,
+      WRITE_BACK_G  => WRITE_BACK_G,
+      DATA_WIDTH_G  => DATA_WIDTH_G,
+      NCOLS_G       => NCOLS_G,
+      HADDR_WIDTH_G => HADDR_WIDTH_G
+      )
+    port map(
+      clk_i              => clk_i,
+      rst_i              => rst_i,
+      rd_i               => rd_i,
+      wr_i               => wr_i,
+      earlyOpBegun_o     => earlyOpBegun_o,
+      opBegun_o          => opBegun_o,
+      rdPending_o        => rdPending_o,
+      done_o             => done_o,
+      rdDone_o           => rdDone_o,
+      addr_i             => addr_i,
+      data_i             => data_i,
+      data_o             => data_o,
+      hits_o             => hits_o,
+      misses_o           => misses_o,
+      cntlRd_o           => rd_s,
+      cntlWr_o           => wr_s,
+      cntlBurstLen_o     => burstLen_s,
+      cntlEarlyOpBegun_i => earlyOpBegun_s,
+      cntlBeat_i         => beat_s,
+      cntlRdDone_i       => rdDone_s,
+      cntlAddr_o         => addr_s,
+      cntlData_o         => dataToSdram_s,
+      cntlData_i         => dataFromSdram_s
+      );
+
+  u1 : SdramCntl
+    generic map(
+      FREQ_G                 => FREQ_G,
+      IN_PHASE_G             => IN_PHASE_G,
+      PIPE_EN_G              => PIPE_EN_G,
+      MAX_NOP_G              => MAX_NOP_G,
+      ENABLE_REFRESH_G       => ENABLE_REFRESH_G,
+      MULTIPLE_ACTIVE_ROWS_G => MULTIPLE_ACTIVE_ROWS_G,
+      BURST_LEN_G            => IntSelect(LINE_LEN_G <= 8, LINE_LEN_G, 1),
+      LOOKAHEAD_G            => 0,  -- line fills are bursts, so no reordering
+      DATA_WIDTH_G           => DATA_WIDTH_G,
+      NROWS_G                => NROWS_G,
+      NCOLS_G                => NCOLS_G,
+      HADDR_WIDTH_G          => HADDR_WIDTH_G,
+      SADDR_WIDTH_G          => SADDR_WIDTH_G,
+      T_INIT_G               => T_INIT_G,
+      T_RAS_G                => T_RAS_G,
+      T_RCD_G                => T_RCD_G,
+      T_REF_G                => T_REF_G,
+      T_RFC_G                => T_RFC_G,
+      T_RP_G                 => T_RP_G,
+      T_XSR_G                => T_XSR_G
+      )
+    port map(
+      clk_i          => clk_i,
+      lock_i         => lock_i,
+      rst_i          => rst_i,
+      rd_i           => rd_s,
+      wr_i           => wr_s,
+      burstLen_i     => burstLen_s,
+      earlyOpBegun_o => earlyOpBegun_s,
+      beat_o         => beat_s,
+      opBegun_o      => open,
+      rdPending_o    => open,
+      done_o         => open,
+      rdDone_o       => rdDone_s,
+      addr_i         => addr_s,
+      data_i         => dataToSdram_s,
+      data_o         => dataFromSdram_s,
+      status_o       => status_o,
+      sdCke_o        => sdCke_o,
+      sdCe_bo        => sdCe_bo,
+      sdRas_bo       => sdRas_bo,
+      sdCas_bo       => sdCas_bo,
+      sdWe_bo        => sdWe_bo,
+      sdBs_o         => sdBs_o,
+      sdAddr_o       => sdAddr_o,
+      sdData_io      => sdData_io,
+      sdDqmh_o       => sdDqmh_o,
+      sdDqml_o       => sdDqml_o
+      );
+
+end architecture;
@@ -25,10 +25,44 @@
 
 library IEEE;
 use IEEE.std_logic_1164.all;
+use IEEE.math_real.all;
 use work.CommonPckg.all;
 
 package SdramCntlPckg is
 
+  -- Worst-case # of clock cycles a read or write can be held off by a refresh.
+  -- Clients that have to be serviced in real time need enough buffering to ride this out.
+  -- If other clients of the same controller do bursts, pass the longest one in burstLen
+  -- since a waiting request may have to sit through the rest of it as well.
+  function RfshStallCycles(
+    freq     : real    := 100.0;        -- Operating frequency in MHz.
+    tRas     : real    := 45.0;  -- min interval between active to precharge commands (ns).
+    tRp      : real    := 20.0;         -- min precharge command duration (ns).
+    tRfc     : real    := 65.0;         -- duration of refresh operation (ns).
+    burstLen : natural := 1             -- longest burst (in words) done by any client.
+    ) return natural;
+
+  -- Ways of splitting a host address into bank, row and column (see ADDR_MAP_G).
+  constant BANK_ROW_COL_C     : natural := 0;  -- Bank in the upper bits, then row, then column.
+  constant ROW_BANK_COL_C     : natural := 1;  -- Row in the upper bits, then bank, then column.
+  constant ROW_BANK_COL_XOR_C : natural := 2;  -- Like ROW_BANK_COL_C with the bank XOR'ed with the low row bits.
+
+  -- Performance counters (see PERF_CNTRS_G). Counter n occupies bits
+  -- (n+1)*PERF_CNTR_LENGTH_C-1 downto n*PERF_CNTR_LENGTH_C of perfCntrs_o.
+  constant PERF_CNTR_LENGTH_C  : natural := 32;
+  constant ROW_HITS_C          : natural := 0;  -- Reads/writes to a row that was already open.
+  constant ROW_MISSES_C        : natural := 1;  -- Rows activated for reads/writes.
+  constant BANK_CONFLICTS_C    : natural := 2;  -- Open rows closed to get to another row in the same bank.
+  constant RFSH_STALLS_C       : natural := 3;  -- Cycles where reads/writes waited on a refresh.
+  constant IDLE_CYCLES_C       : natural := 4;  -- Cycles with no reads or writes to do.
+  constant BUSY_CYCLES_C       : natural := 5;  -- Cycles with reads or writes to do.
+  constant RD_PIPE_OCCUPANCY_C : natural := 6;  -- Sum of the # of reads in the read pipeline over all cycles.
+  constant NUM_PERF_CNTRS_C    : natural := 7;
+
+  -- Per-port settings for the MultiPort arbiter.
+  type PortParamType is array(natural range <>) of natural;
+  function ParamMax(p : PortParamType) return natural;
+
   component SdramCntl is
     generic(
       FREQ_G                 : real    := 100.0;  -- Operating frequency in MHz.
@@ -36,7 +70,13 @@ package SdramCntlPckg is
       PIPE_EN_G              : boolean := false;  -- If true, enable pipelined read operations.
       MAX_NOP_G              : natural := 10000;  -- Number of NOPs before entering self-refresh.
       ENABLE_REFRESH_G       : boolean := true;  -- If true, row refreshes are automatically inserted.
+      RFSH_POSTPONE_G        : natural := 0;  -- # of refreshes that can be put off while busy (8 max).
       MULTIPLE_ACTIVE_ROWS_G : boolean := false;  -- If true, allow an active row in each bank.
+      BURST_LEN_G            : natural := 1;  -- SDRAM burst length: 1, 2, 4, 8 or NCOLS_G for a full-page burst.
+      LOOKAHEAD_G            : natural := 0;  -- # of queued requests for the bank scheduler (0 = no queue).
+      FAIRNESS_G             : natural := 8;  -- Max # of row hits that can pass the oldest queued request.
+      PERF_CNTRS_G           : boolean := false;  -- If true, count SDRAM events on perfCntrs_o.
+      ADDR_MAP_G             : natural := BANK_ROW_COL_C;  -- How the host address is split into bank, row and column.
       DATA_WIDTH_G           : natural := 16;   -- Host & SDRAM data width.
       -- Parameters for Winbond W9812G6JH-75 (all times are in nanoseconds).
       NROWS_G                : natural := 4096;  -- Number of rows in SDRAM array.
@@ -49,6 +89,7 @@ package SdramCntlPckg is
       T_REF_G                : real    := 64_000_000.0;  -- maximum refresh interval (ns).
       T_RFC_G                : real    := 65.0;  -- duration of refresh operation (ns).
       T_RP_G                 : real    := 20.0;  -- min precharge command duration (ns).
+      T_RRD_G                : real    := 15.0;  -- min interval between active commands to different banks (ns).
       T_XSR_G                : real    := 75.0  -- exit self-refresh time (ns).
       );
     port(
@@ -58,7 +99,9 @@ package SdramCntlPckg is
       rst_i          : in  std_logic                                  := NO;  -- Reset.
       rd_i           : in  std_logic                                  := NO;  -- Initiate read operation.
       wr_i           : in  std_logic                                  := NO;  -- Initiate write operation.
+      burstLen_i     : in  std_logic_vector(Log2(NCOLS_G) downto 0)   := (0 => ONE, others => ZERO);  -- # of words to read/write.
       earlyOpBegun_o : out std_logic;  -- Read/write/self-refresh op has begun (async).
+      beat_o         : out std_logic;  -- A word of the read/write op has begun (async).
       opBegun_o      : out std_logic;  -- Read/write/self-refresh op has begun (clocked).
       rdPending_o    : out std_logic;  -- True if read operation(s) are still in the pipeline.
       done_o         : out std_logic;   -- Read or write operation is done_o.
@@ -67,6 +110,8 @@ package SdramCntlPckg is
       data_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host to SDRAM.
       data_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data from SDRAM to host.
       status_o       : out std_logic_vector(3 downto 0);  -- Diagnostic status of the FSM         .
+      perfClear_i    : in  std_logic                                  := NO;  -- Clear the performance counters.
+      perfCntrs_o    : out std_logic_vector(NUM_PERF_CNTRS_C*PERF_CNTR_LENGTH_C-1 downto 0);  -- Performance counters.
 
       -- SDRAM side.
       sdCke_o   : out   std_logic;      -- Clock-enable to SDRAM.
@@ -204,12 +249,223 @@ package SdramCntlPckg is
       );
   end component;
 
+  component MultiPort is
+    generic(
+      NUM_PORTS_G   : natural        := 4;  -- # of host-side ports.
+      WEIGHTS_G     : PortParamType  := (1, 1, 1, 1);  -- # of consecutive R/W operations each port gets per turn.
+      PRIORITIES_G  : PortParamType  := (0, 0, 0, 0);  -- Priority of each port (higher wins, 255 max).
+      ISO_PERIOD_G  : PortParamType  := (0, 0, 0, 0);  -- Guaranteed one R/W op every this many cycles (0 = none).
+      ISO_CREDITS_G : natural        := 4;  -- Max # of R/W ops an isochronous port can save up.
+      MAX_RDS_G     : natural        := 8;  -- Max # of reads in flight through the SDRAM controller.
+      DATA_WIDTH_G  : natural        := 16;  -- host & SDRAM data width.
+      HADDR_WIDTH_G : natural        := 23  -- host-side address width.
+      );
+    port(
+      clk_i : in std_logic;               -- master clock.
+      rst_i : in std_logic := NO;         -- reset.
+
+      -- Host-side ports.
+      portRd_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate read operation.
+      portWr_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate write operation.
+      portEarlyOpBegun_o : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (async).
+      portOpBegun_o      : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (clocked).
+      portRdPending_o    : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- true if the port has reads in the pipeline.
+      portDone_o         : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read or write operation is done.
+      portRdDone_o       : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read operation is done and data is available.
+      portAddr_i         : in  std_logic_vector(NUM_PORTS_G*HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- addresses from hosts to SDRAM.
+      portData_i         : in  std_logic_vector(NUM_PORTS_G*DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- data from hosts to SDRAM.
+      portData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from SDRAM to all hosts.
+
+      -- SDRAM controller host-side port.
+      rst_o          : out std_logic;
+      rd_o           : out std_logic;
+      wr_o           : out std_logic;
+      earlyOpBegun_i : in  std_logic;
+      rdDone_i       : in  std_logic;
+      addr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);
+      data_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);
+      data_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)
+      );
+  end component;
+
+  component MultiPortSdram is
+    generic(
+      NUM_PORTS_G            : natural       := 4;  -- # of host-side ports.
+      WEIGHTS_G              : PortParamType := (1, 1, 1, 1);  -- # of consecutive R/W operations each port gets per turn.
+      PRIORITIES_G           : PortParamType := (0, 0, 0, 0);  -- Priority of each port (higher wins, 255 max).
+      ISO_PERIOD_G           : PortParamType := (0, 0, 0, 0);  -- Guaranteed one R/W op every this many cycles (0 = none).
+      ISO_CREDITS_G          : natural       := 4;  -- Max # of R/W ops an isochronous port can save up.
+      MAX_RDS_G              : natural       := 8;  -- Max # of reads in flight through the SDRAM controller.
+      FREQ_G                 : real          := 100.0;  -- Operating frequency in MHz.
+      IN_PHASE_G             : boolean       := true;  -- SDRAM and controller work on same or opposite clock edge.
+      PIPE_EN_G              : boolean       := false;  -- If true, enable pipelined read operations.
+      MAX_NOP_G              : natural       := 10000;  -- Number of NOPs before entering self-refresh.
+      ENABLE_REFRESH_G       : boolean       := true;  -- If true, row refreshes are automatically inserted.
+      MULTIPLE_ACTIVE_ROWS_G : boolean       := false;  -- If true, allow an active row in each bank.
+      DATA_WIDTH_G           : natural       := 16;  -- Host & SDRAM data width.
+      -- Parameters for Winbond W9812G6JH-75 (all times are in nanoseconds).
+      NROWS_G                : natural       := 4096;  -- Number of rows in SDRAM array.
+      NCOLS_G                : natural       := 512;  -- Number of columns in SDRAM array.
+      HADDR_WIDTH_G          : natural       := 23;  -- Host-side address width.
+      SADDR_WIDTH_G          : natural       := 12;  -- SDRAM-side address width.
+      T_INIT_G               : real          := 200_000.0;  -- min initialization interval (ns).
+      T_RAS_G                : real          := 45.0;  -- min interval between active to precharge commands (ns).
+      T_RCD_G                : real          := 20.0;  -- min interval between active and R/W commands (ns).
+      T_REF_G                : real          := 64_000_000.0;  -- maximum refresh interval (ns).
+      T_RFC_G                : real          := 65.0;  -- duration of refresh operation (ns).
+      T_RP_G                 : real          := 20.0;  -- min precharge command duration (ns).
+      T_XSR_G                : real          := 75.0  -- exit self-refresh time (ns).
+      );
+    port(
+      clk_i : in std_logic;               -- master clock.
+      rst_i : in std_logic := NO;         -- reset.
+
+      -- Host-side ports.
+      portRd_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate read operation.
+      portWr_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate write operation.
+      portEarlyOpBegun_o : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (async).
+      portOpBegun_o      : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (clocked).
+      portRdPending_o    : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- true if the port has reads in the pipeline.
+      portDone_o         : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read or write operation is done.
+      portRdDone_o       : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read operation is done and data is available.
+      portAddr_i         : in  std_logic_vector(NUM_PORTS_G*HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- addresses from hosts to SDRAM.
+      portData_i         : in  std_logic_vector(NUM_PORTS_G*DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- data from hosts to SDRAM.
+      portData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from SDRAM to all hosts.
+
+      -- SDRAM side.
+      sdCke_o   : out   std_logic;        -- Clock-enable to SDRAM.
+      sdCe_bo   : out   std_logic;        -- Chip-select to SDRAM.
+      sdRas_bo  : out   std_logic;        -- SDRAM row address strobe.
+      sdCas_bo  : out   std_logic;        -- SDRAM column address strobe.
+      sdWe_bo   : out   std_logic;        -- SDRAM write enable.
+      sdBs_o    : out   std_logic_vector(1 downto 0);  -- SDRAM bank address.
+      sdAddr_o  : out   std_logic_vector(SADDR_WIDTH_G-1 downto 0);  -- SDRAM row/column address.
+      sdData_io : inout std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to/from SDRAM.
+      sdDqmh_o  : out   std_logic;  -- Enable upper-byte of SDRAM databus if true.
+      sdDqml_o  : out   std_logic  -- Enable lower-byte of SDRAM databus if true.
+      );
+  end component;
+
 end package;
 
 
 
+package body SdramCntlPckg is
+
+  function RfshStallCycles(
+    freq     : real    := 100.0;
+    tRas     : real    := 45.0;
+    tRp      : real    := 20.0;
+    tRfc     : real    := 65.0;
+    burstLen : natural := 1
+    ) return natural is
+    constant FREQ_GHZ_C   : real    := freq/1000.0;  -- GHz = 1/ns.
+    constant RAS_CYCLES_C : natural := integer(ceil(tRas*FREQ_GHZ_C));
+    constant RP_CYCLES_C  : natural := integer(ceil(tRp*FREQ_GHZ_C));
+    constant RFC_CYCLES_C : natural := integer(ceil(tRfc*FREQ_GHZ_C));
+    variable stall_v      : natural;
+  begin
+    -- A forced refresh has to wait for the most recent row activation to finish,
+    -- then precharge all the banks, and then do one refresh. Postponed refreshes
+    -- are only caught up on when there's nothing else to do, and the controller
+    -- checks for reads and writes before each one, so a request that arrives
+    -- during the catch-up only waits for the refresh in progress (less than this).
+    stall_v := RAS_CYCLES_C + 1 + RP_CYCLES_C + 1 + RFC_CYCLES_C;
+    -- A burst is cut short for a forced refresh, but it picks up again afterwards, so a
+    -- request that arrived behind it waits for all of its words plus the cycle that ends it.
+    if burstLen > 1 then
+      stall_v := stall_v + burstLen + 1;
+    end if;
+    return stall_v;
+  end function;
+
+  function ParamMax(p : PortParamType) return natural is
+    variable max_v : natural := 0;
+  begin
+    for i in p'range loop
+      max_v := IntMax(max_v, p(i));
+    end loop;
+    return max_v;
+  end function;
+
+end package body;
+
+
+
 --*********************************************************************
 -- SDRAM controller.
+--
+-- Burst operations:
+--   A read or write of more than one word is requested by placing the
+--   starting address on addr_i and the number of words on burstLen_i
+--   and then raising rd_i or wr_i. The words go to/from consecutive
+--   columns of the same row, one per clock cycle, and beat_o pulses on
+--   every cycle where a word is started. For a write, the word on data_i
+--   is taken when beat_o is high so the host must present the next word
+--   on the following cycle. For a read, each word shows up on data_o
+--   when rdDone_o is high. The host keeps rd_i/wr_i high while it wants
+--   the burst to continue; lowering it early ends the burst and any
+--   remaining words of the SDRAM burst are masked or stopped.
+--   Bursts must stay within one row: the column wraps back to the
+--   start of the row if the end is reached. If a refresh comes due
+--   that can't be put off any longer, the controller cuts the burst
+--   short: beat_o stops pulsing and the controller goes off to do the
+--   refresh. A host that still has words left keeps rd_i/wr_i high and
+--   changes addr_i and burstLen_i to cover just the remaining words
+--   (the words that got a beat_o are done), and they're done as a new
+--   burst once the refresh is over. So no burst, even a full-page one,
+--   can hold off a refresh for more than a single word.
+--
+--   The SDRAM itself runs bursts of BURST_LEN_G words, so a new READ or
+--   WRITE command is only needed at the start of each BURST_LEN_G-word
+--   block of columns. A single-word read or write (burstLen_i = 1) works
+--   the same as it always has regardless of BURST_LEN_G.
+--
+-- Bank scheduling:
+--   If LOOKAHEAD_G > 0, read and write requests are accepted into a queue
+--   of that many entries (opBegun_o goes high when a request is accepted
+--   and writes are reported as done right away). Each bank keeps its own
+--   precharge/activate timers so the scheduler can precharge and activate
+--   the banks needed by queued requests while another bank is reading or
+--   writing. A queued request whose row is already open may go ahead of
+--   older requests, but no more than FAIRNESS_G times in a row, and never
+--   ahead of an older request to the same address. Reads are never
+--   reordered with respect to each other so their data still comes back
+--   in order. The scheduler needs MULTIPLE_ACTIVE_ROWS_G = true and
+--   BURST_LEN_G = 1 and is disabled otherwise; burstLen_i is ignored.
+--
+-- Refresh scheduling:
+--   A row refresh comes due every T_REF_G/NROWS_G ns. Refreshes are done
+--   right away when there are no reads or writes to do. Otherwise, up to
+--   RFSH_POSTPONE_G of them are put off until the controller goes idle and
+--   then they're done back-to-back without precharging between them, until
+--   they're caught up or a read or write comes in.
+--   A refresh is only forced on a busy controller once more than
+--   RFSH_POSTPONE_G are owed, and then just one is done, so the most a
+--   read or write is ever stalled is given by RfshStallCycles().
+--   RFSH_POSTPONE_G can't be more than 8 since that's all the JEDEC
+--   spec lets an SDRAM fall behind.
+--
+-- Performance counters:
+--   If PERF_CNTRS_G is true, the counters listed in SdramCntlPckg are
+--   kept on perfCntrs_o and cleared by raising perfClear_i. A row miss
+--   is counted for every row activation and a row hit for every read or
+--   write that found its row already open (only the first word of a
+--   burst is counted). A bank conflict is a miss that had to close
+--   another open row first. HostIoToSdramPerf lets the host read them.
+--
+-- Address mapping:
+--   ADDR_MAP_G selects how the host address is split up. The column is
+--   always in the lowest bits so a burst stays within a row.
+--   BANK_ROW_COL_C keeps the original layout where a linear stream stays
+--   in one bank and hits a new row of it every NCOLS_G words. With
+--   ROW_BANK_COL_C the stream moves on to the next bank instead, so with
+--   MULTIPLE_ACTIVE_ROWS_G (and the bank scheduler) the next row can be
+--   opened while the current one is still being read or written.
+--   ROW_BANK_COL_XOR_C also XORs the bank with the lowest row bits so
+--   accesses separated by a multiple of 4*NCOLS_G words (e.g. the same
+--   column of consecutive lines in a framebuffer with that pitch) land in
+--   different banks instead of all fighting over the same one.
 --*********************************************************************
 
 library IEEE, UNISIM;
@@ -218,6 +474,7 @@ use IEEE.std_logic_unsigned.all;
 use IEEE.numeric_std.all;
 use IEEE.math_real.all;
 use WORK.CommonPckg.all;
+use work.SdramCntlPckg.all;
 
 entity SdramCntl is
   generic(
@@ -226,7 +483,13 @@ entity SdramCntl is
     PIPE_EN_G              : boolean := false;  -- If true, enable pipelined read operations.
     MAX_NOP_G              : natural := 10000;  -- Number of NOPs before entering self-refresh.
     ENABLE_REFRESH_G       : boolean := true;  -- If true, row refreshes are automatically inserted.
+    RFSH_POSTPONE_G        : natural := 0;  -- # of refreshes that can be put off while busy (8 max).
     MULTIPLE_ACTIVE_ROWS_G : boolean := false;  -- If true, allow an active row in each bank.
+    BURST_LEN_G            : natural := 1;  -- SDRAM burst length: 1, 2, 4, 8 or NCOLS_G for a full-page burst.
+    LOOKAHEAD_G            : natural := 0;  -- # of queued requests for the bank scheduler (0 = no queue).
+    FAIRNESS_G             : natural := 8;  -- Max # of row hits that can pass the oldest queued request.
+    PERF_CNTRS_G           : boolean := false;  -- If true, count SDRAM events on perfCntrs_o.
+    ADDR_MAP_G             : natural := BANK_ROW_COL_C;  -- How the host address is split into bank, row and column.
     DATA_WIDTH_G           : natural := 16;   -- Host & SDRAM data width.
     -- Parameters for Winbond W9812G6JH-75 (all times are in nanoseconds).
     NROWS_G                : natural := 4096;  -- Number of rows in SDRAM array.
@@ -239,6 +502,7 @@ entity SdramCntl is
     T_REF_G                : real    := 64_000_000.0;  -- maximum refresh interval (ns).
     T_RFC_G                : real    := 65.0;  -- duration of refresh operation (ns).
     T_RP_G                 : real    := 20.0;  -- min precharge command duration (ns).
+    T_RRD_G                : real    := 15.0;  -- min interval between active commands to different banks (ns).
     T_XSR_G                : real    := 75.0  -- exit self-refresh time (ns).
     );
   port(
@@ -248,7 +512,9 @@ entity SdramCntl is
     rst_i          : in  std_logic                                  := NO;  -- Reset.
     rd_i           : in  std_logic                                  := NO;  -- Initiate read operation.
     wr_i           : in  std_logic                                  := NO;  -- Initiate write operation.
+    burstLen_i     : in  std_logic_vector(Log2(NCOLS_G) downto 0)   := (0 => ONE, others => ZERO);  -- # of words to read/write.
     earlyOpBegun_o : out std_logic;  -- Read/write/self-refresh op has begun (async).
+    beat_o         : out std_logic;  -- A word of the read/write op has begun (async).
     opBegun_o      : out std_logic;  -- Read/write/self-refresh op has begun (clocked).
     rdPending_o    : out std_logic;  -- True if read operation(s) are still in the pipeline.
     done_o         : out std_logic;     -- Read or write operation is done_o.
@@ -257,6 +523,8 @@ entity SdramCntl is
     data_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host to SDRAM.
     data_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data from SDRAM to host.
     status_o       : out std_logic_vector(3 downto 0);  -- Diagnostic status of the FSM         .
+    perfClear_i    : in  std_logic                                  := NO;  -- Clear the performance counters.
+    perfCntrs_o    : out std_logic_vector(NUM_PERF_CNTRS_C*PERF_CNTR_LENGTH_C-1 downto 0);  -- Performance counters.
 
     -- SDRAM side.
     sdCke_o   : out   std_logic;        -- Clock-enable to SDRAM.
@@ -292,6 +560,7 @@ architecture arch of SdramCntl is
   constant RP_CYCLES_C   : natural := integer(ceil(T_RP_G*FREQ_GHZ_C));  -- precharge operation interval.
   constant WR_CYCLES_C   : natural := 2;  -- write recovery time.
   constant XSR_CYCLES_C  : natural := integer(ceil(T_XSR_G*FREQ_GHZ_C));  -- exit self-refresh time.
+  constant RRD_CYCLES_C  : natural := integer(ceil(T_RRD_G*FREQ_GHZ_C));  -- active-to-active interval for different banks.
   constant MODE_CYCLES_C : natural := 2;  -- mode register setup time.
   constant CAS_CYCLES_C  : natural := 3;  -- CAS latency.
   constant RFSH_OPS_C    : natural := 8;  -- number of refresh operations needed to init SDRAM.
@@ -305,6 +574,7 @@ architecture arch of SdramCntl is
   signal nopCntr_r, nopCntr_x   : natural range 0 to MAX_NOP_G     := 0;  -- counts consecutive NOP_C operations.
 
   signal doSelfRfsh_s : std_logic;  -- active when the NOP counter hits zero and self-refresh can start.
+  signal idle_s       : std_logic;  -- active when there are no reads or writes waiting to be done.
 
   -- states of the SDRAM controller state machine.
   type CntlStateType is (
@@ -313,6 +583,7 @@ architecture arch of SdramCntl is
     INITSETMODE,                        -- initialization - set SDRAM mode.
     INITRFSH,  -- initialization - do initial refreshes.
     RW,                                 -- read/write/refresh the SDRAM.
+    BURST,  -- read/write the remaining words of a burst.
     ACTIVATE,  -- open a row of the SDRAM for reading/writing.
     REFRESHROW,                         -- refresh a row of the SDRAM.
     SELFREFRESH   -- keep SDRAM in self-refresh mode with CKE low.
@@ -329,11 +600,23 @@ architecture arch of SdramCntl is
   constant PCHG_CMD_C   : SdramCmdType := "001000";
   constant MODE_CMD_C   : SdramCmdType := "000000";
   constant RFSH_CMD_C   : SdramCmdType := "000100";
+  constant BST_CMD_C    : SdramCmdType := "011000";
 
   -- SDRAM mode register.
-  -- the SDRAM is placed in a non-burst mode (burst length = 1) with a 3-cycle CAS.
+  -- the SDRAM is placed in sequential burst mode (burst length = BURST_LEN_G) with a 3-cycle CAS.
+  constant FULL_PAGE_C : boolean := BURST_LEN_G > 8;  -- true if the SDRAM bursts never end by themselves.
+  function BurstLenField(len : natural) return std_logic_vector is
+  begin
+    case len is
+      when 1      => return "000";
+      when 2      => return "001";
+      when 4      => return "010";
+      when 8      => return "011";
+      when others => return "111";  -- full page.
+    end case;
+  end function;
   subtype SdramModeType is std_logic_vector(11 downto 0);
-  constant MODE_C : SdramModeType := "00" & "0" & "00" & "011" & "0" & "000";
+  constant MODE_C : SdramModeType := "00" & "0" & "00" & "011" & "0" & BurstLenField(BURST_LEN_G);
 
   -- the host address is decomposed into these sets of SDRAM address components.
   constant ROW_LEN_C : natural := Log2(NROWS_G);  -- number of row address bits.
@@ -342,6 +625,30 @@ architecture arch of SdramCntl is
   signal row_s       : std_logic_vector(ROW_LEN_C - 1 downto 0);  -- row address within bank.
   signal col_s       : std_logic_vector(sdAddr_o'range);  -- column address within row.
 
+  -- pick the bank and row fields out of a host address according to ADDR_MAP_G.
+  constant BANK_LEN_C : natural := sdBs_o'length;  -- number of bank address bits.
+  function AddrBank(a : std_logic_vector) return std_logic_vector is
+    variable bank_v : std_logic_vector(BANK_LEN_C-1 downto 0);
+  begin
+    if ADDR_MAP_G = BANK_ROW_COL_C then
+      bank_v := a(BANK_LEN_C + ROW_LEN_C + COL_LEN_C - 1 downto ROW_LEN_C + COL_LEN_C);
+    else
+      bank_v := a(BANK_LEN_C + COL_LEN_C - 1 downto COL_LEN_C);
+      if ADDR_MAP_G = ROW_BANK_COL_XOR_C then
+        bank_v := bank_v xor a(2*BANK_LEN_C + COL_LEN_C - 1 downto BANK_LEN_C + COL_LEN_C);
+      end if;
+    end if;
+    return bank_v;
+  end function;
+  function AddrRow(a : std_logic_vector) return std_logic_vector is
+  begin
+    if ADDR_MAP_G = BANK_ROW_COL_C then
+      return a(ROW_LEN_C + COL_LEN_C - 1 downto COL_LEN_C);
+    else
+      return a(ROW_LEN_C + BANK_LEN_C + COL_LEN_C - 1 downto BANK_LEN_C + COL_LEN_C);
+    end if;
+  end function;
+
   -- registers that store the currently active row in each bank of the SDRAM.
   constant NUM_ACTIVE_ROWS_C        : integer                                    := IntSelect(MULTIPLE_ACTIVE_ROWS_G = false, 1, 2**sdBs_o'length);
   type ActiveRowType is array(0 to NUM_ACTIVE_ROWS_C-1) of std_logic_vector(row_s'range);
@@ -362,10 +669,60 @@ architecture arch of SdramCntl is
   signal wrInProgress_s       : std_logic;  -- write operation in progress.
   signal rdInProgress_s       : std_logic;  -- read operation in progress.
   signal activateInProgress_s : std_logic;  -- row activation is in progress.
+  signal busBusy_s            : std_logic;  -- SDRAM is still driving the databus.
 
   -- these registers track the progress of read and write operations.
   signal rdPipeline_r, rdPipeline_x : std_logic_vector(CAS_CYCLES_C+1 downto 0) := (others => '0');  -- pipeline of read ops in progress.
   signal wrPipeline_r, wrPipeline_x : std_logic_vector(0 downto 0)              := (others => '0');  -- pipeline of write ops (only need 1 cycle).
+  signal busPipeline_r, busPipeline_x : std_logic_vector(rdPipeline_r'range)    := (others => '0');  -- pipeline of all words read onto the databus.
+
+  -- these registers track burst operations.
+  signal beatCntr_r, beatCntr_x   : natural range 0 to NCOLS_G := 0;  -- # of words left in the host's burst.
+  signal burstCol_r, burstCol_x   : std_logic_vector(COL_LEN_C-1 downto 0);  -- column of the next word in the burst.
+  signal burstWr_r, burstWr_x     : std_logic := NO;  -- true if the host's burst is a write.
+  signal sdBurst_r, sdBurst_x     : natural range 0 to BURST_LEN_G-1 := 0;  -- # of words left in the SDRAM's burst.
+  signal sdBurstWr_r, sdBurstWr_x : std_logic := NO;  -- true if the SDRAM's burst is a write.
+  signal burstCol_s               : std_logic_vector(sdAddr_o'range);  -- burst column extended to the SDRAM address width.
+
+  -- request queue and bank scheduler.
+  constant SCHED_EN_C : boolean := (LOOKAHEAD_G /= 0) and MULTIPLE_ACTIVE_ROWS_G and (BURST_LEN_G = 1);
+  constant Q_LEN_C    : natural := IntSelect(SCHED_EN_C, LOOKAHEAD_G, 1);
+  type QueueAddrType is array(0 to Q_LEN_C-1) of std_logic_vector(addr_i'range);
+  type QueueDataType is array(0 to Q_LEN_C-1) of std_logic_vector(data_i'range);
+  signal qAddr_r     : QueueAddrType;   -- addresses of the queued requests (oldest first).
+  signal qData_r     : QueueDataType;   -- data for the queued write requests.
+  signal qWr_r       : std_logic_vector(0 to Q_LEN_C-1);  -- true if a queued request is a write.
+  signal qCount_r    : natural range 0 to Q_LEN_C    := 0;  -- # of queued requests.
+  signal qPassed_r   : natural range 0 to FAIRNESS_G := 0;  -- # of times the oldest request was passed.
+  signal qPush_s     : std_logic;       -- put the host request into the queue.
+  signal qIssue_s    : std_logic;       -- the request picked by the scheduler was read/written.
+  signal qRdQueued_s : std_logic;       -- there are reads waiting in the queue.
+  signal qCol_s      : std_logic;       -- a queued request can be read/written.
+  signal qColIdx_s   : natural range 0 to Q_LEN_C-1;  -- position of that request in the queue.
+  signal qColBank_s  : natural range 0 to NUM_ACTIVE_ROWS_C-1;  -- bank of that request.
+  signal qColBa_s    : std_logic_vector(sdBs_o'range);  -- SDRAM bank address for that request.
+  signal qColSAddr_s : std_logic_vector(sdAddr_o'range);  -- SDRAM column address for that request.
+  signal qRow_s      : std_logic;       -- a bank can be precharged/activated for a queued request.
+  signal qRowPchg_s  : std_logic;  -- precharge the bank if true, otherwise activate a row in it.
+  signal qRowBank_s  : natural range 0 to NUM_ACTIVE_ROWS_C-1;  -- bank to precharge/activate.
+  signal qRowRow_s   : std_logic_vector(row_s'range);  -- row to activate.
+  type BankTimerType is array(0 to NUM_ACTIVE_ROWS_C-1) of natural range 0 to IntMax(RP_CYCLES_C, RCD_CYCLES_C);
+  type BankRasTimerType is array(0 to NUM_ACTIVE_ROWS_C-1) of natural range 0 to RAS_CYCLES_C;
+  type BankWrTimerType is array(0 to NUM_ACTIVE_ROWS_C-1) of natural range 0 to WR_CYCLES_C;
+  signal bankTimer_r, bankTimer_x : BankTimerType                   := (others => 0);  -- time until a bank can take a command.
+  signal bankRas_r, bankRas_x     : BankRasTimerType                := (others => 0);  -- time until a bank can be precharged.
+  signal bankWr_r, bankWr_x       : BankWrTimerType                 := (others => 0);  -- write-to-precharge time for a bank.
+  signal rrdTimer_r, rrdTimer_x   : natural range 0 to RRD_CYCLES_C := 0;  -- time until another bank can be activated.
+
+  -- performance counters.
+  type PerfCntrsType is array(0 to NUM_PERF_CNTRS_C-1) of std_logic_vector(PERF_CNTR_LENGTH_C-1 downto 0);
+  signal perfCntrs_r            : PerfCntrsType                                := (others => (others => '0'));
+  signal perfHit_s              : std_logic;  -- a read/write went to a row that was already open.
+  signal perfMiss_s             : std_logic;  -- a row was activated.
+  signal perfConflict_s         : std_logic;  -- an open row was closed to get to another one.
+  signal freshRow_r, freshRow_x : std_logic_vector(0 to NUM_ACTIVE_ROWS_C-1) := (others => NO);  -- row activated but not read/written yet.
+  signal rfshBusy_r, rfshBusy_x : std_logic                                    := NO;  -- a refresh is being done.
+  signal rfshPchgd_r, rfshPchgd_x : std_logic                                  := NO;  -- the banks are still precharged from the last refresh.
 
   -- registered outputs to host.
   signal opBegun_r, opBegun_x                     : std_logic                      := NO;  -- true when SDRAM read or write operation is started.
@@ -379,15 +736,26 @@ architecture arch of SdramCntl is
   signal sAddr_r, sAddr_x       : std_logic_vector(sdAddr_o'range)  := (others => '0');  -- SDRAM row/column address.
   signal sData_r, sData_x       : std_logic_vector(sdData_io'range) := (others => '0');  -- SDRAM out databus.
   signal sDataDir_r, sDataDir_x : std_logic                         := INPUT_C;  -- SDRAM databus direction control bit.
+  signal dqm_r, dqm_x           : std_logic_vector(1 downto 0)      := "00";  -- masks words in an unwanted SDRAM write burst.
 
 begin
 
+  -- an SDRAM can't fall more than 8 refreshes behind.
+  assert RFSH_POSTPONE_G <= 8
+    report "SdramCntl: RFSH_POSTPONE_G can't be more than 8." severity failure;
+
+  -- the mode register only has burst lengths of 1, 2, 4, 8 and a full page.
+  assert BURST_LEN_G = 1 or BURST_LEN_G = 2 or BURST_LEN_G = 4 or BURST_LEN_G = 8 or BURST_LEN_G = NCOLS_G
+    report "SdramCntl: BURST_LEN_G has to be 1, 2, 4, 8 or NCOLS_G." severity failure;
+
   --*********************************************************************
   -- attach some internal signals to the I/O ports 
   --*********************************************************************
 
   -- attach registered SDRAM control signals to SDRAM input pins
-  (sdCe_bo, sdRas_bo, sdCas_bo, sdWe_bo, sdDqmh_o, sdDqml_o) <= cmd_r;  -- SDRAM operation control bits
+  (sdCe_bo, sdRas_bo, sdCas_bo, sdWe_bo)                     <= cmd_r(5 downto 2);  -- SDRAM operation control bits
+  sdDqmh_o                                                   <= cmd_r(1) or dqm_r(1);  -- SDRAM databus masks
+  sdDqml_o                                                   <= cmd_r(0) or dqm_r(0);
   sdCke_o                                                    <= cke_r;  -- SDRAM clock enable
   sdBs_o                                                     <= ba_r;  -- SDRAM bank address
   sdAddr_o                                                   <= sAddr_r;  -- SDRAM address
@@ -404,7 +772,11 @@ begin
   combinatorial : process(rd_i, wr_i, addr_i, data_i, sdramData_r, sdData_io, state_r, opBegun_x,
                           activeFlag_r, activeRow_r, activeBank_r, rdPipeline_r, wrPipeline_r,
                           sdramDataOppPhase_r, nopCntr_r, lock_i, rfshCntr_r, timer_r, rasTimer_r,
-                          wrTimer_r, refTimer_r, cmd_r, col_s, ba_r, cke_r)
+                          wrTimer_r, refTimer_r, cmd_r, col_s, ba_r, cke_r, burstLen_i, beatCntr_r,
+                          burstCol_r, burstWr_r, sdBurst_r, sdBurstWr_r, busPipeline_r, burstCol_s,
+                          qCount_r, qRdQueued_s, qCol_s, qColIdx_s, qColBank_s, qData_r, qWr_r,
+                          qColBa_s, qColSAddr_s, qRow_s, qRowPchg_s, qRowBank_s, qRowRow_s, bankTimer_r, bankRas_r,
+                          bankWr_r, rrdTimer_r, freshRow_r, rfshBusy_r, rfshPchgd_r)
   begin
 
     --*********************************************************************
@@ -413,6 +785,7 @@ begin
 
     opBegun_x      <= NO;               -- no operations have begun
     earlyOpBegun_o <= opBegun_x;
+    beat_o         <= NO;               -- no words of an operation have begun
     cke_x          <= YES;              -- enable SDRAM clock
     cmd_x          <= NOP_CMD_C;        -- set SDRAM command to no-operation
     sDataDir_x     <= INPUT_C;          -- accept data from the SDRAM
@@ -422,13 +795,23 @@ begin
     activeRow_x    <= activeRow_r;
     activeBank_x   <= activeBank_r;
     rfshCntr_x     <= rfshCntr_r;
+    beatCntr_x     <= beatCntr_r;
+    burstCol_x     <= burstCol_r;
+    burstWr_x      <= burstWr_r;
+    sdBurstWr_x    <= sdBurstWr_r;
+    freshRow_x     <= freshRow_r;
+    rfshBusy_x     <= rfshBusy_r;
+    rfshPchgd_x    <= rfshPchgd_r;
+    perfHit_s      <= NO;               -- no SDRAM events to count
+    perfMiss_s     <= NO;
+    perfConflict_s <= NO;
 
     --*********************************************************************
     -- setup default value for the SDRAM address 
     --*********************************************************************
 
     -- extract bank field from host address
-    ba_x <= addr_i(sdBs_o'length + ROW_LEN_C + COL_LEN_C - 1 downto ROW_LEN_C + COL_LEN_C);
+    ba_x <= AddrBank(addr_i);
     if MULTIPLE_ACTIVE_ROWS_G = true then
       bank_s      <= (others => '0');
       bankIndex_s <= CONV_INTEGER(ba_x);
@@ -437,7 +820,7 @@ begin
       bankIndex_s <= 0;
     end if;
     -- extract row, column fields from host address
-    row_s                       <= addr_i(ROW_LEN_C + COL_LEN_C - 1 downto COL_LEN_C);
+    row_s                       <= AddrRow(addr_i);
     -- extend column (if needed) until it is as large as the (SDRAM address bus - 1)
     col_s                       <= (others => '0');  -- set it to all zeroes
     col_s(COL_LEN_C-1 downto 0) <= addr_i(COL_LEN_C-1 downto 0);
@@ -445,6 +828,9 @@ begin
     -- command bit set to disable auto-precharge
     sAddr_x                     <= col_s(col_s'high-1 downto CMDBIT_POS_C) & AUTO_PCHG_OFF_C
                                    & col_s(CMDBIT_POS_C-1 downto 0);
+    -- extend the column of the next word in a burst the same way
+    burstCol_s                             <= (others => '0');
+    burstCol_s(COL_LEN_C-1 downto 0)       <= burstCol_r;
 
     --*********************************************************************
     -- manage the read and write operation pipelines
@@ -457,11 +843,54 @@ begin
     else
       rdInProgress_s <= NO;
     end if;
-    rdPending_o <= rdInProgress_s;  -- tell the host if read operations are in progress
+    rdPending_o <= rdInProgress_s or qRdQueued_s;  -- tell the host if read operations are in progress
+
+    -- the databus stays busy while words the host doesn't want are still coming out of an SDRAM burst
+    if busPipeline_r(busPipeline_r'high downto 1) /= 0 then
+      busBusy_s <= YES;
+    else
+      busBusy_s <= NO;
+    end if;
 
     -- enter NOPs into the read and write pipeline shift registers by default
     rdPipeline_x    <= NOP_C & rdPipeline_r(rdPipeline_r'high downto 1);
     wrPipeline_x(0) <= NOP_C;
+    busPipeline_x   <= NOP_C & busPipeline_r(busPipeline_r'high downto 1);
+
+    -- an SDRAM burst keeps going after the host is done with it unless another
+    -- read or write interrupts it. Mask the words of an unwanted write burst and
+    -- let the words of an unwanted read burst go by. Full-page bursts never end
+    -- so they're stopped. (The BURST state issues the BST itself when a host's
+    -- burst ends. This catches the leftover words of a single-word read or write,
+    -- and the only commands that can replace it are READ, WRITE or PRECHARGE,
+    -- which end the SDRAM burst anyway.)
+    dqm_x     <= "00";
+    sdBurst_x <= 0;
+    if sdBurst_r /= 0 then
+      if FULL_PAGE_C then
+        cmd_x <= BST_CMD_C;
+      else
+        sdBurst_x <= sdBurst_r - 1;
+        if sdBurstWr_r = YES then
+          dqm_x <= "11";
+        else
+          busPipeline_x <= READ_C & busPipeline_r(busPipeline_r'high downto 1);
+        end if;
+      end if;
+    end if;
+
+    -- put the host's request into the queue if the scheduler is used and there's room.
+    -- Writes are done as far as the host is concerned once they're queued.
+    qPush_s  <= NO;
+    qIssue_s <= NO;
+    if SCHED_EN_C and ((rd_i = YES) or (wr_i = YES)) and (qCount_r /= Q_LEN_C) then
+      qPush_s   <= YES;
+      opBegun_x <= YES;
+      beat_o    <= YES;
+      if wr_i = YES then
+        wrPipeline_x(0) <= WRITE_C;
+      end if;
+    end if;
 
     -- transfer data from SDRAM to the host data register if a read flag has exited the pipeline
     -- (the transfer occurs 1 cycle before we tell the host the read operation is done)
@@ -501,16 +930,19 @@ begin
     --*********************************************************************
 
     -- enter self-refresh if neither a read or write is requested for MAX_NOP consecutive cycles.
-    if (rd_i = YES) or (wr_i = YES) then
+    if (rd_i = YES) or (wr_i = YES) or (qCount_r /= 0) then
       -- any read or write resets NOP counter and exits self-refresh state
+      idle_s       <= NO;
       nopCntr_x    <= 0;
       doSelfRfsh_s <= NO;
     elsif nopCntr_r /= MAX_NOP_G then
       -- increment NOP counter whenever there is no read or write operation 
+      idle_s       <= YES;
       nopCntr_x    <= nopCntr_r + 1;
       doSelfRfsh_s <= NO;
     else
       -- start self-refresh when counter hits maximum NOP count and leave counter unchanged
+      idle_s       <= YES;
       nopCntr_x    <= nopCntr_r;
       doSelfRfsh_s <= YES;
     end if;
@@ -532,6 +964,31 @@ begin
       activateInProgress_s <= NO;
     end if;
 
+    -- bank timers used by the scheduler
+    for b in bankTimer_r'range loop
+      if bankTimer_r(b) /= 0 then
+        bankTimer_x(b) <= bankTimer_r(b) - 1;
+      else
+        bankTimer_x(b) <= 0;
+      end if;
+      if bankRas_r(b) /= 0 then
+        bankRas_x(b)         <= bankRas_r(b) - 1;
+        activateInProgress_s <= YES;  -- don't let a refresh precharge a bank too soon after activation
+      else
+        bankRas_x(b) <= 0;
+      end if;
+      if bankWr_r(b) /= 0 then
+        bankWr_x(b) <= bankWr_r(b) - 1;
+      else
+        bankWr_x(b) <= 0;
+      end if;
+    end loop;
+    if rrdTimer_r /= 0 then
+      rrdTimer_x <= rrdTimer_r - 1;
+    else
+      rrdTimer_x <= 0;
+    end if;
+
     -- write operation timer            
     if wrTimer_r /= 0 then
       -- decrement a non-zero timer and set the flag
@@ -627,24 +1084,82 @@ begin
         -- process read/write/refresh operations after initialization is done 
         --*********************************************************************
         when RW =>
+          rfshBusy_x  <= NO;
+          rfshPchgd_x <= NO;
           --*********************************************************************
           -- highest priority operation: row refresh 
-          -- do a refresh operation if the refresh counter is non-zero
+          -- do a refresh operation if the refresh counter is non-zero and there's
+          -- nothing else to do, or if too many refreshes have been put off
           --*********************************************************************
-          if rfshCntr_r /= 0 then
+          if (rfshCntr_r > RFSH_POSTPONE_G) or ((rfshCntr_r /= 0) and (idle_s = YES)) then
+            if rfshPchgd_r = YES then
+              -- catch up on postponed refreshes one at a time: nothing has been done since
+              -- the last refresh, so the banks are still precharged and another refresh can go now.
+              cmd_x       <= RFSH_CMD_C;
+              timer_x     <= RFC_CYCLES_C;
+              rfshCntr_x  <= rfshCntr_r - 1;
+              rfshPchgd_x <= YES;
             -- wait for any row activations, writes or reads to finish before doing a precharge
-            if (activateInProgress_s = NO) and (wrInProgress_s = NO) and (rdInProgress_s = NO) then
+            elsif (activateInProgress_s = NO) and (wrInProgress_s = NO) and (rdInProgress_s = NO) then
               cmd_x                 <= PCHG_CMD_C;  -- initiate precharge of the SDRAM
               sAddr_x(CMDBIT_POS_C) <= ALL_BANKS_C;  -- precharge all banks
               timer_x               <= RP_CYCLES_C;  -- set timer for this operation
               activeFlag_x          <= (others => NO);  -- all rows are inactive after a precharge operation
+              sdBurst_x             <= 0;  -- the precharge also ends any SDRAM burst
               state_x               <= REFRESHROW;  -- refresh the SDRAM after the precharge
             end if;
-            status_o <= "0101";
+            rfshBusy_x <= YES;
+            status_o   <= "0101";
+          --*********************************************************************
+          -- read/write a queued request whose row is already open
+          --*********************************************************************
+          elsif SCHED_EN_C and (qCol_s = YES) then
+            qIssue_s <= YES;             -- remove the request from the queue
+            ba_x     <= qColBa_s;
+            sAddr_x  <= qColSAddr_s;
+            perfHit_s              <= not freshRow_r(qColBank_s);
+            freshRow_x(qColBank_s) <= NO;
+            if qWr_r(qColIdx_s) = YES then
+              cmd_x                <= WRITE_CMD_C;
+              sDataDir_x           <= OUTPUT_C;  -- turn on drivers to send data to SDRAM
+              sData_x              <= qData_r(qColIdx_s);
+              wrTimer_x            <= WR_CYCLES_C;
+              bankWr_x(qColBank_s) <= WR_CYCLES_C;  -- only this bank has to wait to be precharged
+              status_o             <= "0111";
+            else
+              cmd_x         <= READ_CMD_C;
+              rdPipeline_x  <= READ_C & rdPipeline_r(rdPipeline_r'high downto 1);
+              busPipeline_x <= READ_C & busPipeline_r(busPipeline_r'high downto 1);
+              status_o      <= "0110";
+            end if;
+          --*********************************************************************
+          -- precharge a bank or activate a row in it for a queued request
+          --*********************************************************************
+          elsif SCHED_EN_C and (qRow_s = YES) then
+            ba_x <= std_logic_vector(to_unsigned(qRowBank_s, ba_x'length));
+            if qRowPchg_s = YES then
+              cmd_x                    <= PCHG_CMD_C;
+              sAddr_x(CMDBIT_POS_C)    <= ONE_BANK_C;  -- precharge just this bank
+              activeFlag_x(qRowBank_s) <= NO;
+              bankTimer_x(qRowBank_s)  <= RP_CYCLES_C;
+              perfConflict_s           <= YES;  -- only open rows are precharged
+            else
+              cmd_x                    <= ACTIVE_CMD_C;
+              sAddr_x                  <= (others => '0');
+              sAddr_x(row_s'range)     <= qRowRow_s;
+              activeRow_x(qRowBank_s)  <= qRowRow_s;
+              activeFlag_x(qRowBank_s) <= YES;
+              bankRas_x(qRowBank_s)    <= RAS_CYCLES_C;
+              bankTimer_x(qRowBank_s)  <= RCD_CYCLES_C;
+              rrdTimer_x               <= RRD_CYCLES_C;
+              freshRow_x(qRowBank_s)   <= YES;
+              perfMiss_s               <= YES;
+            end if;
+            status_o <= "1010";
           --*********************************************************************
           -- do a host-initiated read operation 
           --*********************************************************************
-          elsif rd_i = YES then
+          elsif (rd_i = YES) and not SCHED_EN_C then
             -- Wait one clock cycle if the bank address has just changed and each bank has its own active row.
             -- This gives extra time for the row activation circuitry.
             if (ba_x = ba_r) or (MULTIPLE_ACTIVE_ROWS_G = false) then
@@ -656,24 +1171,40 @@ begin
                   sAddr_x(CMDBIT_POS_C)     <= ONE_BANK_C;  -- precharge this bank
                   timer_x                   <= RP_CYCLES_C;  -- set timer for this operation
                   activeFlag_x(bankIndex_s) <= NO;  -- rows in this bank are inactive after a precharge operation
+                  sdBurst_x                 <= 0;  -- the precharge also ends any SDRAM burst
+                  perfConflict_s            <= activeFlag_r(bankIndex_s);  -- another row was open
                   state_x                   <= ACTIVATE;  -- activate the new row after the precharge is done
                 end if;
               -- read from the currently active row if no previous read operation
               -- is in progress or if pipeline reads are enabled
               -- we can always initiate a read even if a write is already in progress
               elsif (rdInProgress_s = NO) or PIPE_EN_G then
-                cmd_x        <= READ_CMD_C;   -- initiate a read of the SDRAM
+                cmd_x         <= READ_CMD_C;   -- initiate a read of the SDRAM
+                perfHit_s               <= not freshRow_r(bankIndex_s);
+                freshRow_x(bankIndex_s) <= NO;
                 -- insert a flag into the pipeline shift register that will exit the end
                 -- of the shift register when the data from the SDRAM is available
-                rdPipeline_x <= READ_C & rdPipeline_r(rdPipeline_r'high downto 1);
-                opBegun_x    <= YES;  -- tell the host the requested operation has begun
+                rdPipeline_x  <= READ_C & rdPipeline_r(rdPipeline_r'high downto 1);
+                busPipeline_x <= READ_C & busPipeline_r(busPipeline_r'high downto 1);
+                opBegun_x     <= YES;  -- tell the host the requested operation has begun
+                beat_o        <= YES;
+                -- the SDRAM burst runs to the end of the block of columns this one is in
+                sdBurst_x     <= BURST_LEN_G - 1 - (CONV_INTEGER(addr_i(COL_LEN_C-1 downto 0)) mod BURST_LEN_G);
+                sdBurstWr_x   <= NO;
+                if burstLen_i > 1 then
+                  -- read the rest of the words in the BURST state
+                  beatCntr_x <= CONV_INTEGER(burstLen_i) - 1;
+                  burstCol_x <= addr_i(COL_LEN_C-1 downto 0) + 1;
+                  burstWr_x  <= NO;
+                  state_x    <= BURST;
+                end if;
               end if;
             end if;
             status_o <= "0110";
           --*********************************************************************
           -- do a host-initiated write operation 
           --*********************************************************************
-          elsif wr_i = YES then
+          elsif (wr_i = YES) and not SCHED_EN_C then
             -- Wait one clock cycle if the bank address has just changed and each bank has its own active row.
             -- This gives extra time for the row activation circuitry.
             if (ba_x = ba_r) or (MULTIPLE_ACTIVE_ROWS_G = false) then
@@ -685,11 +1216,15 @@ begin
                   sAddr_x(CMDBIT_POS_C)     <= ONE_BANK_C;  -- precharge this bank
                   timer_x                   <= RP_CYCLES_C;  -- set timer for this operation
                   activeFlag_x(bankIndex_s) <= NO;  -- rows in this bank are inactive after a precharge operation
+                  sdBurst_x                 <= 0;  -- the precharge also ends any SDRAM burst
+                  perfConflict_s            <= activeFlag_r(bankIndex_s);  -- another row was open
                   state_x                   <= ACTIVATE;  -- activate the new row after the precharge is done
                 end if;
               -- write to the currently active row if no previous read operations are in progress
-              elsif rdInProgress_s = NO then
+              elsif busBusy_s = NO then
                 cmd_x           <= WRITE_CMD_C;  -- initiate the write operation
+                perfHit_s               <= not freshRow_r(bankIndex_s);
+                freshRow_x(bankIndex_s) <= NO;
                 sDataDir_x      <= OUTPUT_C;  -- turn on drivers to send data to SDRAM
                 -- set timer so precharge doesn't occur too soon after write operation
                 wrTimer_x       <= WR_CYCLES_C;
@@ -697,6 +1232,18 @@ begin
                 -- next cycle.  The write into SDRAM is not actually done by that time, but
                 -- this doesn't matter to the host
                 wrPipeline_x(0) <= WRITE_C;
+                beat_o          <= YES;
+                -- the SDRAM burst runs to the end of the block of columns this one is in
+                sdBurst_x       <= BURST_LEN_G - 1 - (CONV_INTEGER(addr_i(COL_LEN_C-1 downto 0)) mod BURST_LEN_G);
+                sdBurstWr_x     <= YES;
+                dqm_x           <= "00";  -- don't mask this word if it interrupts an unwanted burst
+                if burstLen_i > 1 then
+                  -- write the rest of the words in the BURST state
+                  beatCntr_x <= CONV_INTEGER(burstLen_i) - 1;
+                  burstCol_x <= addr_i(COL_LEN_C-1 downto 0) + 1;
+                  burstWr_x  <= YES;
+                  state_x    <= BURST;
+                end if;
                 opBegun_x       <= YES;  -- tell the host the requested operation has begun
               end if;
             end if;
@@ -711,6 +1258,7 @@ begin
               sAddr_x(CMDBIT_POS_C) <= ALL_BANKS_C;  -- precharge all banks
               timer_x               <= RP_CYCLES_C;  -- set timer for this operation
               activeFlag_x          <= (others => NO);  -- all rows are inactive after a precharge operation
+              sdBurst_x             <= 0;  -- the precharge also ends any SDRAM burst
               state_x               <= SELFREFRESH;  -- self-refresh the SDRAM after the precharge
             end if;
             status_o <= "1000";
@@ -722,6 +1270,55 @@ begin
             status_o <= "1001";
           end if;
 
+        --*********************************************************************
+        -- read/write the remaining words of a burst
+        --*********************************************************************
+        when BURST =>
+          ba_x    <= ba_r;  -- the burst stays in the same bank and row
+          sAddr_x <= burstCol_s(burstCol_s'high-1 downto CMDBIT_POS_C) & AUTO_PCHG_OFF_C
+                     & burstCol_s(CMDBIT_POS_C-1 downto 0);
+          if (beatCntr_r /= 0) and (rfshCntr_r <= RFSH_POSTPONE_G)
+            and (((burstWr_r = YES) and (wr_i = YES)) or ((burstWr_r = NO) and (rd_i = YES))) then
+            beat_o     <= YES;    -- tell the host another word has begun
+            beatCntr_x <= beatCntr_r - 1;
+            burstCol_x <= burstCol_r + 1;
+            dqm_x      <= "00";
+            if CONV_INTEGER(burstCol_r) mod BURST_LEN_G = 0 then
+              -- the SDRAM burst has reached the end of its block of columns so start another
+              if burstWr_r = YES then
+                cmd_x <= WRITE_CMD_C;
+              else
+                cmd_x <= READ_CMD_C;
+              end if;
+              sdBurst_x <= BURST_LEN_G - 1;
+            else
+              -- otherwise the SDRAM burst just continues with the next column
+              cmd_x     <= NOP_CMD_C;
+              sdBurst_x <= sdBurst_r - 1;
+            end if;
+            if burstWr_r = YES then
+              sDataDir_x      <= OUTPUT_C;  -- send data_i to the SDRAM
+              wrTimer_x       <= WR_CYCLES_C;
+              wrPipeline_x(0) <= WRITE_C;
+            else
+              rdPipeline_x  <= READ_C & rdPipeline_r(rdPipeline_r'high downto 1);
+              busPipeline_x <= READ_C & busPipeline_r(busPipeline_r'high downto 1);
+            end if;
+            if (beatCntr_r = 1) and not FULL_PAGE_C then
+              state_x <= RW;      -- that was the last word of the burst
+            end if;
+          else
+            -- the host's burst is done, the host ended it early, or a refresh can't wait any
+            -- longer. The rest of a 2/4/8-word SDRAM burst is masked or let go by, but a
+            -- full-page burst has to be stopped right here.
+            if FULL_PAGE_C and (sdBurst_r /= 0) then
+              cmd_x <= BST_CMD_C;
+            end if;
+            beatCntr_x <= 0;
+            state_x    <= RW;
+          end if;
+          status_o <= "1110";
+
         --*********************************************************************
         -- activate a row of the SDRAM 
         --*********************************************************************
@@ -732,6 +1329,8 @@ begin
           activeBank_x              <= bank_s;
           activeRow_x(bankIndex_s)  <= row_s;  -- store the new active SDRAM row address
           activeFlag_x(bankIndex_s) <= YES;    -- the SDRAM is now active
+          freshRow_x(bankIndex_s)   <= YES;    -- the next read/write of this row isn't a hit
+          perfMiss_s                <= YES;
           rasTimer_x                <= RAS_CYCLES_C;  -- minimum time before another precharge can occur 
           timer_x                   <= RCD_CYCLES_C;  -- minimum time before a read/write operation can occur
           state_x                   <= RW;  -- return to do read/write operation that initiated this activation
@@ -745,6 +1344,9 @@ begin
           timer_x    <= RFC_CYCLES_C;   -- refresh operation interval
           rfshCntr_x <= rfshCntr_r - 1;  -- decrement the number of needed row refreshes
           state_x    <= RW;  -- process more SDRAM operations after refresh is done
+          -- any more postponed refreshes are done from RW, which checks for waiting
+          -- reads and writes once this refresh is finished.
+          rfshPchgd_x <= YES;
           status_o   <= "1011";
 
         --*********************************************************************
@@ -777,6 +1379,198 @@ begin
   end process combinatorial;
 
 
+  --*********************************************************************
+  -- pick a queued request to read/write and a bank to precharge/activate
+  --*********************************************************************
+
+  scheduler : process(qCount_r, qAddr_r, qWr_r, qPassed_r, activeFlag_r, activeRow_r, bankTimer_r,
+                      bankRas_r, bankWr_r, rrdTimer_r, rdInProgress_s, busBusy_s)
+    variable bank_v     : natural range 0 to NUM_ACTIVE_ROWS_C-1;  -- bank of a queued request.
+    variable row_v      : std_logic_vector(row_s'range);  -- row of a queued request.
+    variable col_v      : std_logic_vector(sdAddr_o'range);  -- column of a queued request.
+    variable hit_v      : boolean;      -- the row of the request is open.
+    variable hazard_v   : boolean;      -- an older request goes to the same address.
+    variable olderRd_v  : boolean;      -- an older request is a read.
+    variable claimed_v  : std_logic_vector(0 to NUM_ACTIVE_ROWS_C-1);  -- banks wanted by older requests.
+    variable colFound_v : boolean;      -- a request to read/write has been found.
+    variable rowFound_v : boolean;      -- a bank to precharge/activate has been found.
+  begin
+    qCol_s      <= NO;
+    qColIdx_s   <= 0;
+    qColBank_s  <= 0;
+    qColBa_s    <= (others => '0');
+    qColSAddr_s <= (others => '0');
+    qRow_s      <= NO;
+    qRowPchg_s  <= NO;
+    qRowBank_s  <= 0;
+    qRowRow_s   <= (others => '0');
+    qRdQueued_s <= NO;
+    olderRd_v   := false;
+    claimed_v   := (others => NO);
+    colFound_v  := false;
+    rowFound_v  := false;
+
+    -- go through the queued requests from oldest to youngest
+    for i in 0 to Q_LEN_C-1 loop
+      if i < qCount_r then
+        -- split the request address into bank, row and column
+        if MULTIPLE_ACTIVE_ROWS_G then
+          bank_v := CONV_INTEGER(AddrBank(qAddr_r(i)));
+        else
+          bank_v := 0;
+        end if;
+        row_v                       := AddrRow(qAddr_r(i));
+        col_v                       := (others => '0');
+        col_v(COL_LEN_C-1 downto 0) := qAddr_r(i)(COL_LEN_C-1 downto 0);
+        hit_v                       := (activeFlag_r(bank_v) = YES) and (activeRow_r(bank_v) = row_v);
+        hazard_v                    := false;
+        for j in 0 to Q_LEN_C-1 loop
+          if (j < i) and (qAddr_r(j) = qAddr_r(i)) then
+            hazard_v := true;
+          end if;
+        end loop;
+
+        -- read/write the oldest request whose row is open and ready. A younger request can only
+        -- go ahead of older ones if it doesn't pass an older read or an older request to the same
+        -- address, and the oldest request hasn't already been passed too many times.
+        if (not colFound_v) and hit_v and (bankTimer_r(bank_v) = 0) then
+          if (i = 0) or ((not hazard_v) and (qPassed_r /= FAIRNESS_G) and ((qWr_r(i) = YES) or not olderRd_v)) then
+            -- writes wait for the databus to be free of read data; reads wait
+            -- for the previous read to finish unless reads are pipelined
+            if ((qWr_r(i) = YES) and (busBusy_s = NO)) or ((qWr_r(i) = NO) and ((rdInProgress_s = NO) or PIPE_EN_G)) then
+              colFound_v  := true;
+              qCol_s      <= YES;
+              qColIdx_s   <= i;
+              qColBank_s  <= bank_v;
+              qColBa_s    <= AddrBank(qAddr_r(i));
+              qColSAddr_s <= col_v(col_v'high-1 downto CMDBIT_POS_C) & AUTO_PCHG_OFF_C
+                             & col_v(CMDBIT_POS_C-1 downto 0);
+            end if;
+          end if;
+        end if;
+
+        -- open the row for the oldest request that needs it, but leave a bank alone if an older request wants it
+        if (not rowFound_v) and (not hit_v) and (claimed_v(bank_v) = NO) and (bankTimer_r(bank_v) = 0) then
+          if activeFlag_r(bank_v) = YES then
+            -- close the open row once it has been open long enough and the last write to it is done
+            if (bankRas_r(bank_v) = 0) and (bankWr_r(bank_v) = 0) then
+              rowFound_v := true;
+              qRow_s     <= YES;
+              qRowPchg_s <= YES;
+              qRowBank_s <= bank_v;
+            end if;
+          elsif rrdTimer_r = 0 then
+            rowFound_v := true;
+            qRow_s     <= YES;
+            qRowBank_s <= bank_v;
+            qRowRow_s  <= row_v;
+          end if;
+        end if;
+
+        claimed_v(bank_v) := YES;
+        if qWr_r(i) = NO then
+          olderRd_v   := true;
+          qRdQueued_s <= YES;
+        end if;
+      end if;
+    end loop;
+  end process scheduler;
+
+
+  --*********************************************************************
+  -- update the request queue
+  --*********************************************************************
+
+  queue : process(rst_i, clk_i)
+    variable count_v : natural range 0 to Q_LEN_C;  -- # of requests in the queue.
+  begin
+    if rst_i = YES then
+      qCount_r  <= 0;
+      qPassed_r <= 0;
+    elsif rising_edge(clk_i) then
+      count_v := qCount_r;
+      if qIssue_s = YES then
+        -- remove the request that was just read/written and move the younger ones up
+        for i in 0 to Q_LEN_C-2 loop
+          if i >= qColIdx_s then
+            qAddr_r(i) <= qAddr_r(i+1);
+            qData_r(i) <= qData_r(i+1);
+            qWr_r(i)   <= qWr_r(i+1);
+          end if;
+        end loop;
+        count_v := count_v - 1;
+        -- keep track of how many times the oldest request gets passed
+        if qColIdx_s = 0 then
+          qPassed_r <= 0;
+        elsif qPassed_r /= FAIRNESS_G then
+          qPassed_r <= qPassed_r + 1;
+        end if;
+      end if;
+      if qPush_s = YES then
+        -- add the host's request to the end of the queue
+        qAddr_r(count_v) <= addr_i;
+        qData_r(count_v) <= data_i;
+        qWr_r(count_v)   <= wr_i;
+        count_v          := count_v + 1;
+      end if;
+      qCount_r <= count_v;
+    end if;
+  end process queue;
+
+
+  --*********************************************************************
+  -- count SDRAM events for the host to look at
+  --*********************************************************************
+
+  UPerfCntrs : if PERF_CNTRS_G generate
+    perf : process(rst_i, clk_i)
+      variable rds_v : natural range 0 to rdPipeline_r'length;  -- # of reads in the read pipeline.
+    begin
+      if rst_i = YES then
+        perfCntrs_r <= (others => (others => '0'));
+      elsif rising_edge(clk_i) then
+        if perfClear_i = YES then
+          perfCntrs_r <= (others => (others => '0'));
+        else
+          if perfHit_s = YES then
+            perfCntrs_r(ROW_HITS_C) <= perfCntrs_r(ROW_HITS_C) + 1;
+          end if;
+          if perfMiss_s = YES then
+            perfCntrs_r(ROW_MISSES_C) <= perfCntrs_r(ROW_MISSES_C) + 1;
+          end if;
+          if perfConflict_s = YES then
+            perfCntrs_r(BANK_CONFLICTS_C) <= perfCntrs_r(BANK_CONFLICTS_C) + 1;
+          end if;
+          if idle_s = YES then
+            perfCntrs_r(IDLE_CYCLES_C) <= perfCntrs_r(IDLE_CYCLES_C) + 1;
+          else
+            perfCntrs_r(BUSY_CYCLES_C) <= perfCntrs_r(BUSY_CYCLES_C) + 1;
+            -- a refresh only stalls the host if there's something waiting to be done
+            if rfshBusy_r = YES then
+              perfCntrs_r(RFSH_STALLS_C) <= perfCntrs_r(RFSH_STALLS_C) + 1;
+            end if;
+          end if;
+          rds_v := 0;
+          for i in 1 to rdPipeline_r'high loop
+            if rdPipeline_r(i) = READ_C then
+              rds_v := rds_v + 1;
+            end if;
+          end loop;
+          perfCntrs_r(RD_PIPE_OCCUPANCY_C) <= perfCntrs_r(RD_PIPE_OCCUPANCY_C) + rds_v;
+        end if;
+      end if;
+    end process perf;
+
+    UPerfOut : for i in 0 to NUM_PERF_CNTRS_C-1 generate
+      perfCntrs_o((i+1)*PERF_CNTR_LENGTH_C-1 downto i*PERF_CNTR_LENGTH_C) <= perfCntrs_r(i);
+    end generate;
+  end generate;
+
+  UNoPerfCntrs : if not PERF_CNTRS_G generate
+    perfCntrs_o <= (others => '0');
+  end generate;
+
+
   --*********************************************************************
   -- update registers on the appropriate clock edge     
   --*********************************************************************
@@ -797,12 +1591,25 @@ begin
       opBegun_r    <= NO;
       rdPipeline_r <= (others => '0');
       wrPipeline_r <= (others => '0');
+      busPipeline_r <= (others => '0');
+      bankTimer_r  <= (others => 0);
+      bankRas_r    <= (others => 0);
+      bankWr_r     <= (others => 0);
+      rrdTimer_r   <= 0;
+      beatCntr_r   <= 0;
+      burstWr_r    <= NO;
+      sdBurst_r    <= 0;
+      sdBurstWr_r  <= NO;
+      freshRow_r   <= (others => NO);
+      rfshBusy_r   <= NO;
+      rfshPchgd_r  <= NO;
       cke_r        <= NO;
       cmd_r        <= NOP_CMD_C;
       ba_r         <= (others => '0');
       sAddr_r      <= (others => '0');
       sData_r      <= (others => '0');
       sDataDir_r   <= INPUT_C;
+      dqm_r        <= "00";
       sdramData_r  <= (others => '0');
     elsif rising_edge(clk_i) then
       state_r      <= state_x;
@@ -818,12 +1625,26 @@ begin
       opBegun_r    <= opBegun_x;
       rdPipeline_r <= rdPipeline_x;
       wrPipeline_r <= wrPipeline_x;
+      busPipeline_r <= busPipeline_x;
+      bankTimer_r  <= bankTimer_x;
+      bankRas_r    <= bankRas_x;
+      bankWr_r     <= bankWr_x;
+      rrdTimer_r   <= rrdTimer_x;
+      beatCntr_r   <= beatCntr_x;
+      burstCol_r   <= burstCol_x;
+      burstWr_r    <= burstWr_x;
+      sdBurst_r    <= sdBurst_x;
+      sdBurstWr_r  <= sdBurstWr_x;
+      freshRow_r   <= freshRow_x;
+      rfshBusy_r   <= rfshBusy_x;
+      rfshPchgd_r  <= rfshPchgd_x;
       cke_r        <= cke_x;
       cmd_r        <= cmd_x;
       ba_r         <= ba_x;
       sAddr_r      <= sAddr_x;
       sData_r      <= sData_x;
       sDataDir_r   <= sDataDir_x;
+      dqm_r        <= dqm_x;
       sdramData_r  <= sdramData_x;
     end if;
 
@@ -1084,6 +1905,288 @@ end architecture;
 
 
 
+--*********************************************************************
+-- N-port arbiter for the SDRAM controller.
+--
+-- Each port has the same host-side signals as SdramCntl but they're
+-- packed into vectors: port n uses bit n of portRd_i, portWr_i, etc. and
+-- bits (n+1)*HADDR_WIDTH_G-1 downto n*HADDR_WIDTH_G of portAddr_i (and
+-- likewise for portData_i). Read data from the SDRAM goes to all the
+-- ports on portData_o; a port knows the data is its own when its bit in
+-- portRdDone_o is high. Ports should only do single-word reads/writes.
+--
+-- One port at a time is granted access to the SDRAM controller. The
+-- grant is re-evaluated on every cycle and moves to the winning port
+-- among the ones with a read or write waiting:
+--   1) A port with ISO_PERIOD_G(n) /= 0 is isochronous. It earns a credit
+--      every ISO_PERIOD_G(n) cycles (up to ISO_CREDITS_G of them) and,
+--      while it has credits, its requests win over everything else.
+--      This guarantees the port one read/write every ISO_PERIOD_G(n)
+--      cycles as long as the total guaranteed bandwidth fits.
+--   2) Otherwise, the port with the highest PRIORITIES_G(n) wins.
+--   3) Ports with the same priority take turns in round-robin order,
+--      and each one keeps the grant for up to WEIGHTS_G(n) consecutive
+--      reads/writes before it has to let the next one have a turn.
+-- Since ports only do single-word operations, deficit round-robin would
+-- work out the same as this weighted round-robin so only that's done.
+--
+-- The grant can move to another port while reads from the previous one
+-- are still in the SDRAM read pipeline. The port of each read is kept
+-- in a FIFO so the data is sent to the right port as it comes out.
+-- This keeps pipelined reads (PIPE_EN_G) flowing when the ports switch.
+--*********************************************************************
+
+library IEEE, UNISIM;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use WORK.CommonPckg.all;
+use work.SdramCntlPckg.all;
+
+entity MultiPort is
+  generic(
+    NUM_PORTS_G   : natural        := 4;  -- # of host-side ports.
+    WEIGHTS_G     : PortParamType  := (1, 1, 1, 1);  -- # of consecutive R/W operations each port gets per turn.
+    PRIORITIES_G  : PortParamType  := (0, 0, 0, 0);  -- Priority of each port (higher wins, 255 max).
+    ISO_PERIOD_G  : PortParamType  := (0, 0, 0, 0);  -- Guaranteed one R/W op every this many cycles (0 = none).
+    ISO_CREDITS_G : natural        := 4;  -- Max # of R/W ops an isochronous port can save up.
+    MAX_RDS_G     : natural        := 8;  -- Max # of reads in flight through the SDRAM controller.
+    DATA_WIDTH_G  : natural        := 16;  -- host & SDRAM data width.
+    HADDR_WIDTH_G : natural        := 23  -- host-side address width.
+    );
+  port(
+    clk_i : in std_logic;               -- master clock.
+    rst_i : in std_logic := NO;         -- reset.
+
+    -- Host-side ports.
+    portRd_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate read operation.
+    portWr_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate write operation.
+    portEarlyOpBegun_o : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (async).
+    portOpBegun_o      : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (clocked).
+    portRdPending_o    : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- true if the port has reads in the pipeline.
+    portDone_o         : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read or write operation is done.
+    portRdDone_o       : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read operation is done and data is available.
+    portAddr_i         : in  std_logic_vector(NUM_PORTS_G*HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- addresses from hosts to SDRAM.
+    portData_i         : in  std_logic_vector(NUM_PORTS_G*DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- data from hosts to SDRAM.
+    portData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from SDRAM to all hosts.
+
+    -- SDRAM controller host-side port.
+    rst_o          : out std_logic;
+    rd_o           : out std_logic;
+    wr_o           : out std_logic;
+    earlyOpBegun_i : in  std_logic;
+    rdDone_i       : in  std_logic;
+    addr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);
+    data_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);
+    data_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)
+    );
+end entity;
+
+
+
+architecture arch of MultiPort is
+  constant ISO_KEY_C : natural := 256;  -- added to the priority of an isochronous port with credits.
+
+  subtype PortIndexType is natural range 0 to NUM_PORTS_G-1;
+  type PortIndexArrayType is array(natural range <>) of PortIndexType;
+  type CreditArrayType is array(0 to NUM_PORTS_G-1) of natural range 0 to ISO_CREDITS_G;
+  type IsoTimerArrayType is array(0 to NUM_PORTS_G-1) of natural range 0 to ParamMax(ISO_PERIOD_G);
+
+  signal grant_r, grant_x   : PortIndexType := 0;  -- port connected to the SDRAM controller.
+  signal used_r, used_x     : natural range 0 to ParamMax(WEIGHTS_G) := 0;  -- # of R/W ops done by the port during its turn.
+  signal credit_r, credit_x : CreditArrayType := (others => 0);  -- R/W ops owed to isochronous ports.
+  signal isoTimer_r         : IsoTimerArrayType := (others => 0);  -- time until the next credit is earned.
+  signal req_s              : std_logic_vector(NUM_PORTS_G-1 downto 0);  -- ports with a R/W op waiting.
+  signal rd_s               : std_logic;  -- read signal to the SDRAM controller (internal copy).
+  signal wr_s               : std_logic;  -- write signal to the SDRAM controller (internal copy).
+  signal earlyOpBegun_s     : std_logic_vector(NUM_PORTS_G-1 downto 0);  -- (internal copy).
+
+  -- FIFO that holds the port of each read that's in flight (oldest at index 0).
+  signal rdTag_r   : PortIndexArrayType(0 to MAX_RDS_G-1) := (others => 0);
+  signal rdCount_r : natural range 0 to MAX_RDS_G        := 0;  -- # of reads in flight.
+  signal rdFull_s  : std_logic;  -- no room to track any more reads.
+
+  -- registers that tell a port when its write is done.
+  signal wrDone_r : std_logic     := NO;
+  signal wrPort_r : PortIndexType := 0;
+begin
+
+  -- every port needs its own weight, priority and isochronous period.
+  assert (WEIGHTS_G'length = NUM_PORTS_G) and (PRIORITIES_G'length = NUM_PORTS_G) and (ISO_PERIOD_G'length = NUM_PORTS_G)
+    report "MultiPort: WEIGHTS_G, PRIORITIES_G and ISO_PERIOD_G need NUM_PORTS_G entries each." severity failure;
+
+  -- an isochronous port with credits has to beat any port that's only got a high priority.
+  assert ParamMax(PRIORITIES_G) < ISO_KEY_C
+    report "MultiPort: PRIORITIES_G can't be more than " & integer'image(ISO_KEY_C-1) & "." severity failure;
+
+  --*********************************************************************
+  -- multiplex the SDRAM controller port signals to/from the host-side ports
+  --*********************************************************************
+
+  req_s <= portRd_i or portWr_i;
+
+  -- send the SDRAM controller the address and data from the port with the grant.
+  addr_o <= portAddr_i((grant_r+1)*HADDR_WIDTH_G-1 downto grant_r*HADDR_WIDTH_G);
+  data_o <= portData_i((grant_r+1)*DATA_WIDTH_G-1 downto grant_r*DATA_WIDTH_G);
+
+  -- all ports get the data from the SDRAM but only the one whose read is done will use it.
+  portData_o <= data_i;
+
+  rst_o <= rst_i;
+
+  -- reads are held off if their ports couldn't be kept track of.
+  rdFull_s <= YES when rdCount_r = MAX_RDS_G else NO;
+  rd_s     <= portRd_i(grant_r) and not rdFull_s;
+  rd_o     <= rd_s;
+  wr_s     <= portWr_i(grant_r);
+  wr_o     <= wr_s;
+
+  -- send the status of the SDRAM controller operations back to the right ports.
+  process(grant_r, earlyOpBegun_i, rd_s, wr_s, rdDone_i, rdTag_r, rdCount_r, wrDone_r, wrPort_r)
+  begin
+    for i in 0 to NUM_PORTS_G-1 loop
+      earlyOpBegun_s(i)  <= NO;
+      portRdPending_o(i) <= NO;
+      portRdDone_o(i)    <= NO;
+      portDone_o(i)      <= NO;
+      if (grant_r = i) and ((rd_s = YES) or (wr_s = YES)) then
+        earlyOpBegun_s(i) <= earlyOpBegun_i;
+      end if;
+      for j in 0 to MAX_RDS_G-1 loop
+        if (j < rdCount_r) and (rdTag_r(j) = i) then
+          portRdPending_o(i) <= YES;
+        end if;
+      end loop;
+      if (rdCount_r /= 0) and (rdTag_r(0) = i) then
+        portRdDone_o(i) <= rdDone_i;
+        portDone_o(i)   <= rdDone_i;
+      end if;
+      if (wrDone_r = YES) and (wrPort_r = i) then
+        portDone_o(i) <= YES;
+      end if;
+    end loop;
+  end process;
+  portEarlyOpBegun_o <= earlyOpBegun_s;
+
+  --*********************************************************************
+  -- pick the port that gets the grant on the next cycle
+  --*********************************************************************
+
+  arbiter : process(grant_r, used_r, credit_r, isoTimer_r, req_s, earlyOpBegun_i, rd_s, wr_s)
+    variable begun_v   : boolean;
+    variable credit_v  : CreditArrayType;
+    variable used_v    : natural range 0 to ParamMax(WEIGHTS_G);
+    variable key_v     : natural;
+    variable bestKey_v : integer;
+    variable best_v    : PortIndexType;
+    variable port_v    : PortIndexType;
+    variable curKey_v  : natural;
+  begin
+    begun_v := (earlyOpBegun_i = YES) and ((rd_s = YES) or (wr_s = YES));
+
+    -- isochronous ports earn a credit every period and spend one on each R/W op they do.
+    credit_v := credit_r;
+    for i in 0 to NUM_PORTS_G-1 loop
+      if (ISO_PERIOD_G(i) /= 0) and (isoTimer_r(i) = 0) and (credit_v(i) /= ISO_CREDITS_G) then
+        credit_v(i) := credit_v(i) + 1;
+      end if;
+    end loop;
+    if begun_v and (credit_v(grant_r) /= 0) then
+      credit_v(grant_r) := credit_v(grant_r) - 1;
+    end if;
+    credit_x <= credit_v;
+
+    used_v := used_r;
+    if begun_v then
+      used_v := used_r + 1;
+    end if;
+
+    -- find the winning port with a R/W op waiting, looking at the ports in
+    -- round-robin order starting with the one after the port that has the grant.
+    bestKey_v := -1;
+    best_v    := grant_r;
+    for k in 1 to NUM_PORTS_G loop
+      port_v := (grant_r + k) mod NUM_PORTS_G;
+      key_v  := PRIORITIES_G(port_v);
+      if credit_v(port_v) /= 0 then
+        key_v := key_v + ISO_KEY_C;
+      end if;
+      if (req_s(port_v) = YES) and (key_v > bestKey_v) then
+        bestKey_v := key_v;
+        best_v    := port_v;
+      end if;
+    end loop;
+
+    curKey_v := PRIORITIES_G(grant_r);
+    if credit_v(grant_r) /= 0 then
+      curKey_v := curKey_v + ISO_KEY_C;
+    end if;
+
+    grant_x <= grant_r;
+    used_x  <= used_v;
+    if (req_s(grant_r) = YES) and (used_v < WEIGHTS_G(grant_r)) and (curKey_v >= bestKey_v) then
+      null;  -- the port keeps the grant until its turn is used up or a more important port shows up
+    elsif bestKey_v >= 0 then
+      grant_x <= best_v;                -- give the grant to the winner and start its turn
+      used_x  <= 0;
+    end if;
+  end process arbiter;
+
+  --*********************************************************************
+  -- update registers on the appropriate clock edge.
+  --*********************************************************************
+  update : process(rst_i, clk_i)
+    variable count_v : natural range 0 to MAX_RDS_G;
+  begin
+    if rst_i = YES then
+      -- asynchronous reset.
+      grant_r       <= 0;
+      used_r        <= 0;
+      credit_r      <= (others => 0);
+      isoTimer_r    <= (others => 0);
+      rdCount_r     <= 0;
+      wrDone_r      <= NO;
+      portOpBegun_o <= (others => NO);
+    elsif rising_edge(clk_i) then
+      grant_r  <= grant_x;
+      used_r   <= used_x;
+      credit_r <= credit_x;
+      for i in 0 to NUM_PORTS_G-1 loop
+        if isoTimer_r(i) = 0 then
+          isoTimer_r(i) <= IntMax(ISO_PERIOD_G(i), 1) - 1;
+        else
+          isoTimer_r(i) <= isoTimer_r(i) - 1;
+        end if;
+      end loop;
+
+      -- remove the oldest read from the FIFO when its data comes out and
+      -- add a read to the end when it is started.
+      count_v := rdCount_r;
+      if (rdDone_i = YES) and (count_v /= 0) then
+        for j in 0 to MAX_RDS_G-2 loop
+          rdTag_r(j) <= rdTag_r(j+1);
+        end loop;
+        count_v := count_v - 1;
+      end if;
+      if (earlyOpBegun_i = YES) and (rd_s = YES) then
+        rdTag_r(count_v) <= grant_r;
+        count_v          := count_v + 1;
+      end if;
+      rdCount_r <= count_v;
+
+      -- writes are done on the cycle after they start.
+      wrDone_r <= earlyOpBegun_i and wr_s;
+      wrPort_r <= grant_r;
+
+      -- opBegun signals are cycle-delayed versions of earlyOpBegun signals.
+      portOpBegun_o <= earlyOpBegun_s;
+    end if;
+  end process update;
+
+end architecture;
+
+
+
+
 --*********************************************************************
 -- Dual-port interface + SDRAM controller.
 --*********************************************************************
@@ -1272,3 +2375,174 @@ begin
       );
 
 end architecture;
+
+
+
+
+--*********************************************************************
+-- N-port arbiter + SDRAM controller.
+--*********************************************************************
+
+library IEEE, UNISIM;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use WORK.CommonPckg.all;
+use work.SdramCntlPckg.all;
+
+entity MultiPortSdram is
+  generic(
+    NUM_PORTS_G            : natural       := 4;  -- # of host-side ports.
+    WEIGHTS_G              : PortParamType := (1, 1, 1, 1);  -- # of consecutive R/W operations each port gets per turn.
+    PRIORITIES_G           : PortParamType := (0, 0, 0, 0);  -- Priority of each port (higher wins, 255 max).
+    ISO_PERIOD_G           : PortParamType := (0, 0, 0, 0);  -- Guaranteed one R/W op every this many cycles (0 = none).
+    ISO_CREDITS_G          : natural       := 4;  -- Max # of R/W ops an isochronous port can save up.
+    MAX_RDS_G              : natural       := 8;  -- Max # of reads in flight through the SDRAM controller.
+    FREQ_G                 : real          := 100.0;  -- Operating frequency in MHz.
+    IN_PHASE_G             : boolean       := true;  -- SDRAM and controller work on same or opposite clock edge.
+    PIPE_EN_G              : boolean       := false;  -- If true, enable pipelined read operations.
+    MAX_NOP_G              : natural       := 10000;  -- Number of NOPs before entering self-refresh.
+    ENABLE_REFRESH_G       : boolean       := true;  -- If true, row refreshes are automatically inserted.
+    MULTIPLE_ACTIVE_ROWS_G : boolean       := false;  -- If true, allow an active row in each bank.
+    DATA_WIDTH_G           : natural       := 16;  -- Host & SDRAM data width.
+    -- Parameters for Winbond W9812G6JH-75 (all times are in nanoseconds).
+    NROWS_G                : natural       := 4096;  -- Number of rows in SDRAM array.
+    NCOLS_G                : natural       := 512;  -- Number of columns in SDRAM array.
+    HADDR_WIDTH_G          : natural       := 23;  -- Host-side address width.
+    SADDR_WIDTH_G          : natural       := 12;  -- SDRAM-side address width.
+    T_INIT_G               : real          := 200_000.0;  -- min initialization interval (ns).
+    T_RAS_G                : real          := 45.0;  -- min interval between active to precharge commands (ns).
+    T_RCD_G                : real          := 20.0;  -- min interval between active and R/W commands (ns).
+    T_REF_G                : real          := 64_000_000.0;  -- maximum refresh interval (ns).
+    T_RFC_G                : real          := 65.0;  -- duration of refresh operation (ns).
+    T_RP_G                 : real          := 20.0;  -- min precharge command duration (ns).
+    T_XSR_G                : real          := 75.0  -- exit self-refresh time (ns).
+    );
+  port(
+    clk_i : in std_logic;               -- master clock.
+    rst_i : in std_logic := NO;         -- reset.
+
+    -- Host-side ports.
+    portRd_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate read operation.
+    portWr_i           : in  std_logic_vector(NUM_PORTS_G-1 downto 0)               := (others => NO);  -- initiate write operation.
+    portEarlyOpBegun_o : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (async).
+    portOpBegun_o      : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read/write op has begun (clocked).
+    portRdPending_o    : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- true if the port has reads in the pipeline.
+    portDone_o         : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read or write operation is done.
+    portRdDone_o       : out std_logic_vector(NUM_PORTS_G-1 downto 0);  -- read operation is done and data is available.
+    portAddr_i         : in  std_logic_vector(NUM_PORTS_G*HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- addresses from hosts to SDRAM.
+    portData_i         : in  std_logic_vector(NUM_PORTS_G*DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- data from hosts to SDRAM.
+    portData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- data from SDRAM to all hosts.
+
+    -- SDRAM side.
+    sdCke_o   : out   std_logic;        -- Clock-enable to SDRAM.
+    sdCe_bo   : out   std_logic;        -- Chip-select to SDRAM.
+    sdRas_bo  : out   std_logic;        -- SDRAM row address strobe.
+    sdCas_bo  : out   std_logic;        -- SDRAM column address strobe.
+    sdWe_bo   : out   std_logic;        -- SDRAM write enable.
+    sdBs_o    : out   std_logic_vector(1 downto 0);  -- SDRAM bank address.
+    sdAddr_o  : out   std_logic_vector(SADDR_WIDTH_G-1 downto 0);  -- SDRAM row/column address.
+    sdData_io : inout std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to/from SDRAM.
+    sdDqmh_o  : out   std_logic;  -- Enable upper-byte of SDRAM databus if true.
+    sdDqml_o  : out   std_logic  -- Enable lower-byte of SDRAM databus if true.
+    );
+end entity;
+
+
+architecture arch of MultiPortSdram is
+  signal rst_s          : std_logic;
+  signal rd_s           : std_logic;
+  signal wr_s           : std_logic;
+  signal earlyOpBegun_s : std_logic;
+  signal rdDone_s       : std_logic;
+  signal addr_s         : std_logic_vector(HADDR_WIDTH_G-1 downto 0);
+  signal dataFromHost_s : std_logic_vector(sdData_io'range);
+  signal dataToHost_s   : std_logic_vector(sdData_io'range);
+begin
+
+  -- every port needs its own weight, priority and isochronous period.
+  assert (WEIGHTS_G'length = NUM_PORTS_G) and (PRIORITIES_G'length = NUM_PORTS_G) and (ISO_PERIOD_G'length = NUM_PORTS_G)
+    report "MultiPortSdram: WEIGHTS_G, PRIORITIES_G and ISO_PERIOD_G need NUM_PORTS_G entries each." severity failure;
+
+  u0 : MultiPort
+    generic map(
+      NUM_PORTS_G   => NUM_PORTS_G,
+      WEIGHTS_G     => WEIGHTS_G,
+      PRIORITIES_G  => PRIORITIES_G,
+      ISO_PERIOD_G  => ISO_PERIOD_G,
+      ISO_CREDITS_G => ISO_CREDITS_G,
+      MAX_RDS_G     => MAX_RDS_G,
+      DATA_WIDTH_G  => DATA_WIDTH_G,
+      HADDR_WIDTH_G => HADDR_WIDTH_G
+      )
+    port map(
+      clk_i => clk_i,
+      rst_i => rst_i,
+
+      -- Host-side ports.
+      portRd_i           => portRd_i,
+      portWr_i           => portWr_i,
+      portEarlyOpBegun_o => portEarlyOpBegun_o,
+      portOpBegun_o      => portOpBegun_o,
+      portRdPending_o    => portRdPending_o,
+      portDone_o         => portDone_o,
+      portRdDone_o       => portRdDone_o,
+      portAddr_i         => portAddr_i,
+      portData_i         => portData_i,
+      portData_o         => portData_o,
+
+      -- SDRAM controller host-side port.
+      rst_o          => rst_s,
+      rd_o           => rd_s,
+      wr_o           => wr_s,
+      earlyOpBegun_i => earlyOpBegun_s,
+      rdDone_i       => rdDone_s,
+      addr_o         => addr_s,
+      data_o         => dataFromHost_s,
+      data_i         => dataToHost_s
+      );
+
+  u1 : SdramCntl
+    generic map(
+      FREQ_G                 => FREQ_G,
+      IN_PHASE_G             => IN_PHASE_G,
+      PIPE_EN_G              => PIPE_EN_G,
+      MAX_NOP_G              => MAX_NOP_G,
+      ENABLE_REFRESH_G       => ENABLE_REFRESH_G,
+      MULTIPLE_ACTIVE_ROWS_G => MULTIPLE_ACTIVE_ROWS_G,
+      DATA_WIDTH_G           => DATA_WIDTH_G,
+      NROWS_G                => NROWS_G,
+      NCOLS_G                => NCOLS_G,
+      HADDR_WIDTH_G          => HADDR_WIDTH_G,
+      SADDR_WIDTH_G          => SADDR_WIDTH_G,
+      T_INIT_G               => T_INIT_G,
+      T_RAS_G                => T_RAS_G,
+      T_RCD_G                => T_RCD_G,
+      T_REF_G                => T_REF_G,
+      T_RFC_G                => T_RFC_G,
+      T_RP_G                 => T_RP_G,
+      T_XSR_G                => T_XSR_G
+      )
+    port map(
+      clk_i          => clk_i,  -- master clock from external clock source (unbuffered)
+      lock_i         => YES,   -- no DLLs, so frequency is always locked
+      rst_i          => rst_s,          -- reset
+      rd_i           => rd_s,           -- host-side SDRAM read control from the arbiter
+      wr_i           => wr_s,           -- host-side SDRAM write control from the arbiter
+      earlyOpBegun_o => earlyOpBegun_s,  -- early indicator that memory operation has begun
+      rdDone_o       => rdDone_s,  -- indicates SDRAM memory read operation is done
+      addr_i         => addr_s,         -- host-side address from the arbiter
+      data_i         => dataFromHost_s,  -- data from the arbiter to SDRAM
+      data_o         => dataToHost_s,   -- SDRAM data output to the arbiter
+      sdCke_o        => sdCke_o,        -- Clock-enable to SDRAM.
+      sdCe_bo        => sdCe_bo,        -- Chip-select to SDRAM.
+      sdRas_bo       => sdRas_bo,       -- SDRAM RAS
+      sdCas_bo       => sdCas_bo,       -- SDRAM CAS
+      sdWe_bo        => sdWe_bo,        -- SDRAM write-enable
+      sdBs_o         => sdBs_o,         -- SDRAM bank address
+      sdAddr_o       => sdAddr_o,       -- SDRAM address
+      sdData_io      => sdData_io,      -- data to/from SDRAM
+      sdDqmh_o       => sdDqmh_o,  -- Enable upper-byte of SDRAM databus if true.
+      sdDqml_o       => sdDqml_o  -- Enable lower-byte of SDRAM databus if true.
+      );
+
+end architecture;
@@ -0,0 +1,313 @@
+--*********************************************************************
+-- This program is free software; you can redistribute it and/or
+-- modify it under the terms of the GNU General Public License
+-- as published by the Free Software Foundation; either version 2
+-- of the License, or (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program; if not, write to the Free Software
+-- Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+-- 02111-1307, USA.
+--
+-- 2013 - X Engineering Software Systems Corp. (www.xess.com)
+--*********************************************************************
+
+--*********************************************************************
+-- Posted-write queue for the SDRAM controller.
+--*********************************************************************
+
+
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use work.CommonPckg.all;
+
+package SdramWrQueuePckg is
+
+  component SdramWrQueue is
+    generic(
+      DEPTH_G       : natural := 8;    -- # of writes that can be waiting in the queue.
+      MAX_RDS_G     : natural := 8;    -- Max # of host reads in flight through the SdramCntl.
+      DATA_WIDTH_G  : natural := 16;   -- Host & SDRAM data width.
+      NCOLS_G       : natural := 512;  -- Number of columns in SDRAM array.
+      HADDR_WIDTH_G : natural := 23    -- Host-side address width.
+      );
+    port(
+      clk_i              : in  std_logic;  -- Master clock.
+      rst_i              : in  std_logic                                  := NO;  -- Reset.
+      -- Host side (same as SdramCntl).
+      rd_i               : in  std_logic                                  := NO;  -- Initiate read operation.
+      wr_i               : in  std_logic                                  := NO;  -- Initiate write operation.
+      earlyOpBegun_o     : out std_logic;  -- Read/write op has begun (async).
+      opBegun_o          : out std_logic;  -- Read/write op has begun (clocked).
+      rdPending_o        : out std_logic;  -- True if read operation(s) are still in the pipeline.
+      done_o             : out std_logic;  -- Read or write operation is done.
+      rdDone_o           : out std_logic;  -- Read operation is done and data is available.
+      addr_i             : in  std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- Address from host.
+      data_i             : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host.
+      data_o             : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to host.
+      empty_o            : out std_logic;  -- True when all the queued writes have gone to the SDRAM.
+      -- SdramCntl side.
+      cntlRd_o           : out std_logic;  -- Initiate read operation.
+      cntlWr_o           : out std_logic;  -- Initiate write operation.
+      cntlEarlyOpBegun_i : in  std_logic;  -- Read/write op has begun (async).
+      cntlRdDone_i       : in  std_logic;  -- Read operation is done and data is available.
+      cntlAddr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- Address to SDRAM.
+      cntlData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to SDRAM.
+      cntlData_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  -- Data from SDRAM.
+      );
+  end component;
+
+end package;
+
+
+
+
+--*********************************************************************
+-- Posted-write queue for the SDRAM controller.
+--
+-- This sits between a host and SdramCntl. A write is taken into the
+-- queue and finished on the next cycle so the host can go on without
+-- waiting for the SDRAM. (A write to an address that's already in the
+-- queue just replaces its data.) The host only has to wait when all
+-- DEPTH_G places in the queue are full.
+--
+-- Host reads go to the SDRAM ahead of the queued writes. If a read is
+-- for an address that's still in the queue, its data comes straight
+-- from the queue instead and is done on the next cycle. The data of the
+-- last read stays on data_o until the next read is done. No more than
+-- MAX_RDS_G reads are sent to the SdramCntl before the first one comes
+-- back, so set it to at least the SdramCntl read pipeline length plus
+-- LOOKAHEAD_G or pipelined reads will be held off.
+--
+-- While the host isn't reading, the queued writes are sent to the
+-- SdramCntl. Writes in the same row as the previous one go first so
+-- the row can stay open for the whole batch; otherwise the queue is
+-- emptied in round-robin order. empty_o goes high once every queued
+-- write has been handed to the SdramCntl.
+--*********************************************************************
+
+library IEEE;
+use IEEE.std_logic_1164.all;
+use IEEE.numeric_std.all;
+use WORK.CommonPckg.all;
+
+entity SdramWrQueue is
+  generic(
+    DEPTH_G       : natural := 8;    -- # of writes that can be waiting in the queue.
+    MAX_RDS_G     : natural := 8;    -- Max # of host reads in flight through the SdramCntl.
+    DATA_WIDTH_G  : natural := 16;   -- Host & SDRAM data width.
+    NCOLS_G       : natural := 512;  -- Number of columns in SDRAM array.
+    HADDR_WIDTH_G : natural := 23    -- Host-side address width.
+    );
+  port(
+    clk_i              : in  std_logic;  -- Master clock.
+    rst_i              : in  std_logic                                  := NO;  -- Reset.
+    -- Host side (same as SdramCntl).
+    rd_i               : in  std_logic                                  := NO;  -- Initiate read operation.
+    wr_i               : in  std_logic                                  := NO;  -- Initiate write operation.
+    earlyOpBegun_o     : out std_logic;  -- Read/write op has begun (async).
+    opBegun_o          : out std_logic;  -- Read/write op has begun (clocked).
+    rdPending_o        : out std_logic;  -- True if read operation(s) are still in the pipeline.
+    done_o             : out std_logic;  -- Read or write operation is done.
+    rdDone_o           : out std_logic;  -- Read operation is done and data is available.
+    addr_i             : in  std_logic_vector(HADDR_WIDTH_G-1 downto 0) := (others => ZERO);  -- Address from host.
+    data_i             : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  := (others => ZERO);  -- Data from host.
+    data_o             : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to host.
+    empty_o            : out std_logic;  -- True when all the queued writes have gone to the SDRAM.
+    -- SdramCntl side.
+    cntlRd_o           : out std_logic;  -- Initiate read operation.
+    cntlWr_o           : out std_logic;  -- Initiate write operation.
+    cntlEarlyOpBegun_i : in  std_logic;  -- Read/write op has begun (async).
+    cntlRdDone_i       : in  std_logic;  -- Read operation is done and data is available.
+    cntlAddr_o         : out std_logic_vector(HADDR_WIDTH_G-1 downto 0);  -- Address to SDRAM.
+    cntlData_o         : out std_logic_vector(DATA_WIDTH_G-1 downto 0);  -- Data to SDRAM.
+    cntlData_i         : in  std_logic_vector(DATA_WIDTH_G-1 downto 0)  -- Data from SDRAM.
+    );
+end entity;
+
+
+architecture arch of SdramWrQueue is
+  constant COL_LEN_C : natural := Log2(NCOLS_G);  -- # of address bits for the column in a row.
+
+  subtype AddrType is std_logic_vector(HADDR_WIDTH_G-1 downto 0);
+  subtype WordType is std_logic_vector(DATA_WIDTH_G-1 downto 0);
+  type AddrArrayType is array(0 to DEPTH_G-1) of AddrType;
+  type DataArrayType is array(0 to DEPTH_G-1) of WordType;
+  signal addrs_r : AddrArrayType;       -- addresses of the queued writes.
+  signal data_r  : DataArrayType;       -- data of the queued writes.
+  signal valid_r : std_logic_vector(0 to DEPTH_G-1) := (others => NO);  -- queue places holding a write.
+
+  signal match_s    : std_logic;        -- host address is in the queue.
+  signal matchPos_s : natural range 0 to DEPTH_G-1;  -- where it is.
+  signal free_s     : std_logic;        -- there's an empty place in the queue.
+  signal freePos_s  : natural range 0 to DEPTH_G-1;  -- where it is.
+  signal drain_s    : std_logic;        -- there's a write to send to the SdramCntl.
+  signal drainPos_s : natural range 0 to DEPTH_G-1;  -- where it is.
+
+  signal put_s          : std_logic;    -- put the host write into the queue.
+  signal putPos_s       : natural range 0 to DEPTH_G-1;  -- place where it goes.
+  signal fwd_s          : std_logic;    -- read data is coming from the queue.
+  signal cntlRd_s       : std_logic;    -- host read is going to the SdramCntl.
+  signal drained_s      : std_logic;    -- queued write has gone to the SdramCntl.
+  signal earlyOpBegun_s : std_logic;    -- (internal copy).
+
+  signal lastRow_r   : std_logic_vector(HADDR_WIDTH_G-1 downto COL_LEN_C) := (others => ZERO);  -- row of the last write sent.
+  signal nextPos_r   : natural range 0 to DEPTH_G-1 := 0;  -- where round-robin draining starts.
+  signal rdsInCntl_r : natural range 0 to MAX_RDS_G := 0;  -- # of host reads still in the SdramCntl.
+  signal fwdDone_r   : std_logic                    := NO;  -- forwarded read data is available.
+  signal rdData_r    : WordType;        -- data from the last read.
+  signal wrDone_r    : std_logic                    := NO;  -- host write is done.
+  signal opBegun_r   : std_logic                    := NO;
+begin
+
+  -- find the host address in the queue, an empty place for a new write, and the next write to send.
+  search : process(addr_i, addrs_r, valid_r, lastRow_r, nextPos_r)
+    variable rrFound_v : boolean;
+  begin
+    match_s    <= NO;
+    matchPos_s <= 0;
+    free_s     <= NO;
+    freePos_s  <= 0;
+    drain_s    <= NO;
+    drainPos_s <= 0;
+    rrFound_v  := false;
+    for i in DEPTH_G-1 downto 0 loop
+      if valid_r(i) = YES then
+        if addrs_r(i) = addr_i then
+          match_s    <= YES;
+          matchPos_s <= i;
+        end if;
+      else
+        free_s    <= YES;
+        freePos_s <= i;
+      end if;
+    end loop;
+    -- the first queued write at or after the round-robin position ...
+    for j in DEPTH_G-1 downto 0 loop
+      if valid_r((nextPos_r + j) mod DEPTH_G) = YES then
+        drain_s    <= YES;
+        drainPos_s <= (nextPos_r + j) mod DEPTH_G;
+      end if;
+    end loop;
+    -- ... unless there's one in the same row as the last write.
+    for i in DEPTH_G-1 downto 0 loop
+      if (valid_r(i) = YES) and (addrs_r(i)(HADDR_WIDTH_G-1 downto COL_LEN_C) = lastRow_r) then
+        drain_s    <= YES;
+        drainPos_s <= i;
+      end if;
+    end loop;
+  end process search;
+
+  --*********************************************************************
+  -- pass host reads to the SdramCntl or answer them from the queue, and
+  -- send queued writes to the SdramCntl whenever it isn't needed for reads
+  --*********************************************************************
+
+  combinatorial : process(rd_i, wr_i, addr_i, match_s, matchPos_s, free_s, freePos_s, drain_s, drainPos_s,
+                          addrs_r, data_r, rdsInCntl_r, cntlEarlyOpBegun_i)
+  begin
+    earlyOpBegun_s <= NO;
+    put_s          <= NO;
+    putPos_s       <= freePos_s;
+    fwd_s          <= NO;
+    cntlRd_s       <= NO;
+    drained_s      <= NO;
+    cntlRd_o       <= NO;
+    cntlWr_o       <= NO;
+    cntlAddr_o     <= addrs_r(drainPos_s);
+    cntlData_o     <= data_r(drainPos_s);
+
+    if rd_i = YES then
+      if (match_s = NO) and (rdsInCntl_r /= MAX_RDS_G) then
+        -- the data isn't in the queue, so get it from the SDRAM.
+        cntlRd_o       <= YES;
+        cntlAddr_o     <= addr_i;
+        cntlRd_s       <= cntlEarlyOpBegun_i;
+        earlyOpBegun_s <= cntlEarlyOpBegun_i;
+      elsif (match_s = YES) and (rdsInCntl_r = 0) then
+        -- the data is in the queue. (Wait for any earlier reads to come out of the SdramCntl first.)
+        fwd_s          <= YES;
+        earlyOpBegun_s <= YES;
+      end if;
+    elsif wr_i = YES then
+      if match_s = YES then
+        put_s          <= YES;          -- replace the data of the queued write to the same address
+        putPos_s       <= matchPos_s;
+        earlyOpBegun_s <= YES;
+      elsif free_s = YES then
+        put_s          <= YES;
+        earlyOpBegun_s <= YES;
+      end if;
+    end if;
+
+    if (drain_s = YES) and ((rd_i = NO) or (match_s = YES)) then
+      -- the host isn't using the SdramCntl, so send it a queued write.
+      cntlWr_o  <= YES;
+      drained_s <= cntlEarlyOpBegun_i;
+    end if;
+  end process combinatorial;
+
+  earlyOpBegun_o <= earlyOpBegun_s;
+  opBegun_o      <= opBegun_r;
+  rdDone_o       <= fwdDone_r or cntlRdDone_i;
+  done_o         <= fwdDone_r or cntlRdDone_i or wrDone_r;
+  data_o         <= cntlData_i when cntlRdDone_i = YES else rdData_r;
+  rdPending_o    <= BooleanToStdLogic(rdsInCntl_r /= 0);
+  empty_o        <= not drain_s;
+
+  --*********************************************************************
+  -- update registers on the appropriate clock edge
+  --*********************************************************************
+
+  update : process(rst_i, clk_i)
+  begin
+    if rst_i = YES then
+      valid_r     <= (others => NO);
+      lastRow_r   <= (others => ZERO);
+      nextPos_r   <= 0;
+      rdsInCntl_r <= 0;
+      fwdDone_r   <= NO;
+      wrDone_r    <= NO;
+      opBegun_r   <= NO;
+    elsif rising_edge(clk_i) then
+      opBegun_r <= earlyOpBegun_s;
+      wrDone_r  <= put_s;
+      fwdDone_r <= fwd_s;
+
+      -- hold the read data for the host until the next read is done.
+      if fwd_s = YES then
+        rdData_r <= data_r(matchPos_s);
+      elsif cntlRdDone_i = YES then
+        rdData_r <= cntlData_i;
+      end if;
+
+      -- keep track of the host reads in the SdramCntl so the read data comes back in order.
+      if (cntlRd_s = YES) and (cntlRdDone_i = NO) then
+        rdsInCntl_r <= rdsInCntl_r + 1;
+      elsif (cntlRd_s = NO) and (cntlRdDone_i = YES) then
+        rdsInCntl_r <= rdsInCntl_r - 1;
+      end if;
+
+      -- remove a write from the queue once the SdramCntl has it ...
+      if drained_s = YES then
+        valid_r(drainPos_s) <= NO;
+        lastRow_r           <= addrs_r(drainPos_s)(HADDR_WIDTH_G-1 downto COL_LEN_C);
+        nextPos_r           <= (drainPos_s + 1) mod DEPTH_G;
+      end if;
+      -- ... and add the host write. (If it goes to the place that was just emptied, the
+      -- new data for that address stays in the queue.)
+      if put_s = YES then
+        valid_r(putPos_s) <= YES;
+        addrs_r(putPos_s) <= addr_i;
+        data_r(putPos_s)  <= data_i;
+      end if;
+    end if;
+  end process update;
+
+end architecture;
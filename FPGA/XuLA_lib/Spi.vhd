@@ -14,6 +14,64 @@
 -- along with this program.  If not, see <http://www.gnu.org/licenses/>.
 --**********************************************************************
 
+--**********************************************************************
+-- SPI master with these registers:
+--
+--   000: Any R/W resets the SPI master, even in the middle of a burst
+--        or transaction list.
+--   001: Write sends a byte and returns the byte received from the
+--        slave. The chip-select is released after the byte.
+--   010: Same as 001, but the chip-select is held for the next byte.
+--   011: Burst data. A write pushes a byte into the TX FIFO and a read
+--        pops a byte from the RX FIFO. Writes stall while the TX FIFO
+--        is full and reads stall while the RX FIFO is empty.
+--   100: Burst length in words, bits 7..0.
+--   101: Burst length in words, bits 15..8.
+--   110: Burst control/status. A write starts a burst:
+--          bits 1..0: word size (00=8, 01=16, 10=32 bits).
+--          bit 2:     1 = don't store the bytes from the slave.
+--        A read returns the status:
+--          bit 0: burst or transaction list in progress.
+--          bit 1: TX FIFO empty.   bit 2: TX FIFO full.
+--          bit 3: RX FIFO empty.   bit 4: RX FIFO full.
+--   111: Transaction list. A write pushes a list byte into the TX
+--        FIFO and the list is executed as it arrives. The TX FIFO must
+--        be empty when a list starts, and no bursts or single/multi-byte
+--        transfers can run until the list ends.
+--        A read returns the number of bytes in the RX FIFO (255 if
+--        there are more) and the next read of 111 takes the first byte
+--        out of the RX FIFO and returns it, or returns 00 if the count
+--        was 0. (An access to any other register in between makes the
+--        next read of 111 return the count again.)
+--        The list is a sequence of these commands:
+--          00:          End of list.
+--          01:          Assert the chip-select.
+--          02:          Release the chip-select.
+--          03 n d...:   Send n+1 bytes d... and discard the bytes from the slave.
+--          04 n:        Send n+1 FF bytes and store the bytes from the slave.
+--          05 n d...:   Send n+1 bytes d... and store the bytes from the slave.
+--          06 n:        Wait n microseconds.
+--        Unknown commands are ignored.
+--
+-- A burst holds the chip-select for its whole length and shifts the
+-- bytes from the TX FIFO out back-to-back, with the SCK only pausing
+-- if the TX FIFO runs dry or the RX FIFO fills. Words go out MSB
+-- first as consecutive bytes, so a 16 or 32-bit word is written to
+-- the TX FIFO most-significant byte first.
+--
+-- A JTAG scan can't wait for a stalled read of register 011, so the
+-- bytes stored by a transaction list are read back through register
+-- 111 instead. A single scan writes the list to register 111 and then
+-- reads register 111 in pairs: the number of bytes in the RX FIFO and
+-- then a byte from the slave. A pair whose count is 0 was read before
+-- the list stored its next byte, so its second byte is 00 and is just
+-- padding. The host reads enough pairs to cover the time the list
+-- takes to run and keeps the bytes from the pairs with nonzero counts.
+-- A list that's missing its 00 or was cut short keeps bit 0 of
+-- register 110 set, so the host has to give up on it after a while and
+-- write register 000 to abort it and empty the FIFOs.
+--**********************************************************************
+
 library ieee;
 use ieee.std_logic_1164.all;
 use work.CommonPckg.all;
@@ -22,15 +80,16 @@ package SpiPckg is
 
   component SpiMaster is
     generic (
-      FREQ_G     : real      := 100.0;  -- Main clock frequency (MHz).
-      SPI_FREQ_G : real      := 25.0;   -- SPI clock frequency (MHz).
-      CPOL_G     : std_logic := LO;  -- SCK polarity (0=normally low, 1=normally high).
-      CPHA_G     : std_logic := HI  -- SCK phase (0=sample on leading edge, 1=sample on trailing edge).
+      FREQ_G       : real      := 100.0;  -- Main clock frequency (MHz).
+      SPI_FREQ_G   : real      := 25.0;   -- SPI clock frequency (MHz).
+      CPOL_G       : std_logic := LO;  -- SCK polarity (0=normally low, 1=normally high).
+      CPHA_G       : std_logic := HI;  -- SCK phase (0=sample on leading edge, 1=sample on trailing edge).
+      FIFO_DEPTH_G : natural   := 512  -- # of bytes in each of the burst TX and RX FIFOs.
       );
     port (
       rst_i   : in  std_logic := NO;    -- Active-high reset input.
       clk_i   : in  std_logic;          -- Master clock input.
-      addr_i  : in  std_logic_vector(1 downto 0);  -- Register address from PC.
+      addr_i  : in  std_logic_vector(2 downto 0);  -- Register address from PC.
       data_i  : in  std_logic_vector(7 downto 0);  -- Data from PC.
       data_o  : out std_logic_vector(7 downto 0);  -- Data to PC.
       wr_i    : in  std_logic := LO;    -- Write control from PC.
@@ -53,20 +112,22 @@ use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 use ieee.math_real.all;
 use work.CommonPckg.all;
+use work.fifoPckg.all;
 --library unisim;
 --use unisim.vcomponents.all;
 
 entity SpiMaster is
   generic (
-    FREQ_G     : real      := 100.0;    -- Main clock frequency (MHz).
-    SPI_FREQ_G : real      := 25.0;     -- SPI clock frequency (MHz).
-    CPOL_G     : std_logic := LO;  -- SCK polarity (0=normally low, 1=normally high).
-    CPHA_G     : std_logic := HI  -- SCK phase (0=sample on leading edge, 1=sample on trailing edge).
+    FREQ_G       : real      := 100.0;    -- Main clock frequency (MHz).
+    SPI_FREQ_G   : real      := 25.0;     -- SPI clock frequency (MHz).
+    CPOL_G       : std_logic := LO;  -- SCK polarity (0=normally low, 1=normally high).
+    CPHA_G       : std_logic := HI;  -- SCK phase (0=sample on leading edge, 1=sample on trailing edge).
+    FIFO_DEPTH_G : natural   := 512  -- # of bytes in each of the burst TX and RX FIFOs.
     );
   port (
     rst_i   : in  std_logic := NO;      -- Active-high reset input.
     clk_i   : in  std_logic;            -- Master clock input.
-    addr_i  : in  std_logic_vector(1 downto 0);  -- Register address from PC.
+    addr_i  : in  std_logic_vector(2 downto 0);  -- Register address from PC.
     data_i  : in  std_logic_vector(7 downto 0);  -- Data from PC.
     data_o  : out std_logic_vector(7 downto 0);  -- Data to PC.
     wr_i    : in  std_logic := LO;      -- Write control from PC.
@@ -82,9 +143,24 @@ end entity;
 
 architecture arch of SpiMaster is
   subtype regAddr_t is std_logic_vector(addr_i'range);
-  constant RESET_ADDR            : regAddr_t := "00";
-  constant SINGLE_XFER_ADDR      : regAddr_t := "01";
-  constant MULTI_XFER_ADDR       : regAddr_t := "10";
+  constant RESET_ADDR            : regAddr_t := "000";
+  constant SINGLE_XFER_ADDR      : regAddr_t := "001";
+  constant MULTI_XFER_ADDR       : regAddr_t := "010";
+  constant BURST_DATA_ADDR       : regAddr_t := "011";
+  constant BURST_LEN_LO_ADDR     : regAddr_t := "100";
+  constant BURST_LEN_HI_ADDR     : regAddr_t := "101";
+  constant BURST_CTRL_ADDR       : regAddr_t := "110";
+  constant LIST_ADDR             : regAddr_t := "111";
+  constant MAX_BURST_BYTES_C     : natural   := 4 * (2**16 - 1);
+  constant CLKS_PER_US_C         : natural   := integer(round(FREQ_G));
+  subtype listCmd_t is std_logic_vector(data_i'range);
+  constant LIST_END_C            : listCmd_t := x"00";
+  constant LIST_SSEL_ON_C        : listCmd_t := x"01";
+  constant LIST_SSEL_OFF_C       : listCmd_t := x"02";
+  constant LIST_WR_C             : listCmd_t := x"03";
+  constant LIST_RD_C             : listCmd_t := x"04";
+  constant LIST_XFER_C           : listCmd_t := x"05";
+  constant LIST_DELAY_C          : listCmd_t := x"06";
   constant CLKS_PER_SCLK_PHASE_C : natural   := integer(round(0.5 * FREQ_G / SPI_FREQ_G));
   constant DISABLE_TIME_C        : natural   := 10;
   constant ENABLE_SETUP_TIME_C   : natural   := 5;
@@ -93,14 +169,89 @@ architecture arch of SpiMaster is
   signal sck_r     : std_logic := CPOL_G;
   signal sr_r      : std_logic_vector(data_i'range);
   signal enabled_r : boolean;
+
+  -- Burst registers and FIFOs.
+  signal burstLen_r     : std_logic_vector(15 downto 0) := (others => ZERO);  -- # of words in a burst.
+  signal storeRx_r      : std_logic                     := YES;  -- Store bytes from the slave in the RX FIFO.
+  signal busy_r         : std_logic                     := NO;  -- A burst or list is in progress.
+  signal dataOut_r      : std_logic_vector(data_o'range);  -- Register or RX FIFO data to the PC.
+  signal regRead_r      : boolean                       := false;  -- Send dataOut_r to the PC instead of sr_r.
+  signal fifoRst_r      : std_logic                     := NO;
+  signal txWr_r         : std_logic                     := NO;
+  signal txRd_r         : std_logic                     := NO;
+  signal txIn_r         : std_logic_vector(data_i'range);
+  signal txOut_s        : std_logic_vector(data_i'range);
+  signal txEmpty_s      : std_logic;
+  signal txFull_s       : std_logic;
+  signal rxWr_r         : std_logic                     := NO;
+  signal rxRd_r         : std_logic                     := NO;
+  signal rxIn_r         : std_logic_vector(data_i'range);
+  signal rxOut_s        : std_logic_vector(data_i'range);
+  signal rxEmpty_s      : std_logic;
+  signal rxFull_s       : std_logic;
+  signal rxAlmostFull_s : std_logic;
+  signal rxLevel_s      : std_logic_vector(Log2(FIFO_DEPTH_G) downto 0);  -- # of bytes in the RX FIFO.
 begin
 
+  -- Bytes from the PC waiting to go out during a burst.
+  uTxFifo : FifoSync
+    generic map(
+      DATA_WIDTH_G => data_i'length,
+      DEPTH_G      => FIFO_DEPTH_G,
+      FWFT_G       => true
+      )
+    port map(
+      clk_i   => clk_i,
+      rst_i   => fifoRst_r,
+      rd_i    => txRd_r,
+      wr_i    => txWr_r,
+      data_i  => txIn_r,
+      data_o  => txOut_s,
+      full_o  => txFull_s,
+      empty_o => txEmpty_s
+      );
+
+  -- Bytes from the slave waiting to be read by the PC.
+  -- The almost-full flag leaves room for the byte being stored and
+  -- the one being shifted in after it.
+  uRxFifo : FifoSync
+    generic map(
+      DATA_WIDTH_G  => data_o'length,
+      DEPTH_G       => FIFO_DEPTH_G,
+      FWFT_G        => true,
+      ALMOST_FULL_G => FIFO_DEPTH_G - 1
+      )
+    port map(
+      clk_i        => clk_i,
+      rst_i        => fifoRst_r,
+      rd_i         => rxRd_r,
+      wr_i         => rxWr_r,
+      data_i       => rxIn_r,
+      data_o       => rxOut_s,
+      full_o       => rxFull_s,
+      empty_o      => rxEmpty_s,
+      almostFull_o => rxAlmostFull_s,
+      level_o      => rxLevel_s
+      );
+
   process (clk_i)
     variable rst_v              : boolean := false;
     variable sclkPhaseTimer_v   : natural range 0 to CLKS_PER_SCLK_PHASE_C;
     variable sselTimer_v        : natural range 0 to DISABLE_TIME_C;
     variable disableAfterXfer_v : boolean;
-    variable bitCntr_v          : natural range 0 to sr_r'length;
+    variable bitCntr_v          : natural range 0 to sr_r'length + 1;
+    variable ackd_v             : boolean := false;  -- R/W of a burst register was acknowledged.
+    variable burst_v            : boolean := false;
+    variable burstBytes_v       : natural range 0 to MAX_BURST_BYTES_C;  -- Bytes left in the burst.
+    variable sr_v               : std_logic_vector(sr_r'range);
+    variable fillTx_v           : boolean := false;  -- Send FF bytes instead of the TX FIFO contents.
+    variable byteReady_v        : boolean;  -- The next byte of a burst can be sent.
+    variable list_v             : boolean := false;  -- A transaction list is in progress.
+    variable listArg_v          : boolean := false;  -- The next list byte is a command argument.
+    variable listCmd_v          : listCmd_t;
+    variable listPair_v         : boolean := false;  -- The next read of register 111 is the 2nd of a pair.
+    variable listPop_v          : boolean := false;  -- The 1st read of the pair found a byte in the RX FIFO.
+    variable delay_v            : natural range 0 to 255 * CLKS_PER_US_C;
   begin
     if rising_edge(clk_i) then
 
@@ -108,9 +259,131 @@ begin
       done_o  <= NO;
       begun_o <= NO;
 
+      -- These FIFO controls are pulsed for a single cycle.
+      fifoRst_r <= NO;
+      txWr_r    <= NO;
+      txRd_r    <= NO;
+      rxWr_r    <= NO;
+      rxRd_r    <= NO;
+
+      -- The R/W controls from the PC stay active for a few cycles after
+      -- an operation is acknowledged, so don't repeat a burst register
+      -- operation until they go inactive.
+      if wr_i = NO and rd_i = NO then
+        ackd_v := false;
+      end if;
+
+      -- Any access to another register, or a write, ends a pair of
+      -- list result reads.
+      if (wr_i = YES or rd_i = YES) and (addr_i /= LIST_ADDR or wr_i = YES) then
+        listPair_v := false;
+      end if;
+
+      -- A burst byte can be sent once it's available and there's room
+      -- for what comes back from the slave.
+      byteReady_v := (fillTx_v or (txEmpty_s = NO and txRd_r = NO)) and (storeRx_r = NO or rxAlmostFull_s = NO);
+
+      -- Handle R/W operations on the reset and burst registers. The FIFOs
+      -- can be filled and emptied while a burst is in progress, and a reset
+      -- is taken right away so a burst that's waiting for more bytes can't
+      -- lock up the SPI master.
+      if rst_i = NO and not rst_v and not ackd_v and (wr_i = YES or rd_i = YES) then
+        case addr_i is
+          when RESET_ADDR =>
+            dataOut_r <= (others => ZERO);
+            rst_v     := true;
+            ackd_v    := true;
+          when BURST_DATA_ADDR =>
+            if wr_i = YES and txFull_s = NO and txWr_r = NO then
+              txIn_r <= data_i;
+              txWr_r <= YES;
+              ackd_v := true;
+            elsif rd_i = YES and rxEmpty_s = NO and rxRd_r = NO then
+              dataOut_r <= rxOut_s;
+              rxRd_r    <= YES;
+              ackd_v    := true;
+            end if;
+          when BURST_LEN_LO_ADDR =>
+            if wr_i = YES then
+              burstLen_r(7 downto 0) <= data_i;
+            end if;
+            dataOut_r <= burstLen_r(7 downto 0);
+            ackd_v    := true;
+          when BURST_LEN_HI_ADDR =>
+            if wr_i = YES then
+              burstLen_r(15 downto 8) <= data_i;
+            end if;
+            dataOut_r <= burstLen_r(15 downto 8);
+            ackd_v    := true;
+          when BURST_CTRL_ADDR =>
+            if rd_i = YES then
+              dataOut_r <= "000" & rxFull_s & rxEmpty_s & txFull_s & txEmpty_s & busy_r;
+              ackd_v    := true;
+            -- Start a burst once any previous transfer is done.
+            elsif not burst_v and not list_v and bitCntr_v = 0 and sselTimer_v = 0 and not disableAfterXfer_v then
+              case data_i(1 downto 0) is
+                when "00"   => burstBytes_v := 1 * to_integer(unsigned(burstLen_r));
+                when "01"   => burstBytes_v := 2 * to_integer(unsigned(burstLen_r));
+                when others => burstBytes_v := 4 * to_integer(unsigned(burstLen_r));
+              end case;
+              storeRx_r <= not data_i(2);
+              fillTx_v  := false;
+              if burstBytes_v /= 0 then
+                burst_v := true;
+                if not enabled_r then
+                  enabled_r   <= true;
+                  sselTimer_v := ENABLE_SETUP_TIME_C;
+                end if;
+              end if;
+              ackd_v := true;
+            end if;
+          when LIST_ADDR =>
+            if rd_i = YES then
+              if listPair_v and listPop_v then
+                -- The count read before this one saw this byte, so send it.
+                dataOut_r <= rxOut_s;
+                rxRd_r    <= YES;
+              elsif listPair_v then
+                -- The RX FIFO was empty, so pad the results instead of stalling.
+                dataOut_r <= (others => ZERO);
+              else
+                -- Send the count.
+                if unsigned(rxLevel_s) > 255 then
+                  dataOut_r <= (others => ONE);
+                else
+                  dataOut_r <= std_logic_vector(resize(unsigned(rxLevel_s), dataOut_r'length));
+                end if;
+                listPop_v := rxEmpty_s = NO;
+              end if;
+              listPair_v := not listPair_v;
+              ackd_v := true;
+            -- A list can only start on an empty TX FIFO when no burst is running.
+            elsif txFull_s = NO and txWr_r = NO and (list_v or (not burst_v and txEmpty_s = YES)) then
+              txIn_r <= data_i;
+              txWr_r <= YES;
+              list_v := true;
+              ackd_v := true;
+            end if;
+          when others =>
+            null;
+        end case;
+        if ackd_v then
+          regRead_r <= true;
+          begun_o   <= YES;
+          done_o    <= YES;
+        end if;
+      end if;
+
       -- Reset the SPI module.
       if rst_i = YES or rst_v then
         rst_v              := false;
+        burst_v            := false;
+        list_v             := false;
+        listArg_v          := false;
+        listPair_v         := false;
+        fillTx_v           := false;
+        delay_v            := 0;
+        fifoRst_r          <= YES;
         sck_r              <= CPOL_G;
         sclkPhaseTimer_v   := 0;
         sselTimer_v        := 0;
@@ -128,16 +401,75 @@ begin
         disableAfterXfer_v := false;
         sselTimer_v        := DISABLE_TIME_C - 1;
 
+      -- Release the chip-select once all the bytes of a burst are sent,
+      -- or send the next byte when it's available and there's room for
+      -- what comes back from the slave.
+      -- (A list leaves the chip-select alone.)
+      elsif bitCntr_v = 0 and burst_v then
+        if burstBytes_v = 0 then
+          burst_v := false;
+          if not list_v then
+            disableAfterXfer_v := true;
+            sselTimer_v        := ENABLE_HOLD_TIME_C - 1;
+          end if;
+        elsif byteReady_v then
+          sclkPhaseTimer_v := CLKS_PER_SCLK_PHASE_C - 1;
+          if fillTx_v then
+            sr_r <= (others => ONE);
+          else
+            sr_r   <= txOut_s;
+            txRd_r <= YES;
+          end if;
+          bitCntr_v := sr_r'length;
+        end if;
+
+      -- Execute the next command of a transaction list.
+      elsif bitCntr_v = 0 and list_v then
+        if delay_v /= 0 then
+          delay_v := delay_v - 1;
+        elsif txEmpty_s = NO and txRd_r = NO then
+          txRd_r <= YES;
+          if listArg_v then
+            -- The argument is either a delay or the # of bytes to transfer.
+            listArg_v := false;
+            if listCmd_v = LIST_DELAY_C then
+              delay_v := to_integer(unsigned(txOut_s)) * CLKS_PER_US_C;
+            else
+              burstBytes_v := to_integer(unsigned(txOut_s)) + 1;
+              burst_v      := true;
+              fillTx_v     := listCmd_v = LIST_RD_C;
+              storeRx_r    <= BooleanToStdLogic(listCmd_v /= LIST_WR_C);
+            end if;
+          else
+            listCmd_v := txOut_s;
+            case txOut_s is
+              when LIST_END_C =>
+                list_v := false;
+              when LIST_SSEL_ON_C =>
+                if not enabled_r then
+                  enabled_r   <= true;
+                  sselTimer_v := ENABLE_SETUP_TIME_C;
+                end if;
+              when LIST_SSEL_OFF_C =>
+                if enabled_r then
+                  disableAfterXfer_v := true;
+                  sselTimer_v        := ENABLE_HOLD_TIME_C - 1;
+                end if;
+              when LIST_WR_C | LIST_RD_C | LIST_XFER_C | LIST_DELAY_C =>
+                listArg_v := true;
+              when others =>
+                null;
+            end case;
+          end if;
+        end if;
+
       -- If bit xfer is not active, then look for R/W operations from the host.
       elsif bitCntr_v = 0 then
-        if wr_i = YES or rd_i = YES then
-          if addr_i = RESET_ADDR then
-            rst_v   := true;
-            begun_o <= YES;
-            done_o  <= YES;
-          else
+        if (wr_i = YES or rd_i = YES) and not ackd_v then
+          if addr_i = SINGLE_XFER_ADDR or addr_i = MULTI_XFER_ADDR then
             sclkPhaseTimer_v   := CLKS_PER_SCLK_PHASE_C - 1;
             sr_r               <= data_i;
+            regRead_r          <= false;
             begun_o            <= YES;
             enabled_r          <= true;
             sselTimer_v        := ENABLE_SETUP_TIME_C;
@@ -155,10 +487,11 @@ begin
 
       -- Generate SPI clock transition and handle bit xfer.
       else
+        sr_v := sr_r;
         if sck_r = (CPOL_G xor CPHA_G) then
           -- Sample data from the slave on the leading edge of SCK when CPHA_G=0
           -- and the trailing edge when CPHA_G=1.
-          sr_r <= sr_r(sr_r'high-1 downto 0) & miso_i;
+          sr_v := sr_r(sr_r'high-1 downto 0) & miso_i;
         else
           -- Propagate data to the slave on the opposite edge of SCK.
           mosi_o <= sr_r(sr_r'high);
@@ -166,7 +499,22 @@ begin
         -- Decrement bit counter on the trailing edge of SCK.
         if sck_r = not CPOL_G then
           if bitCntr_v /= 0 then
-            if bitCntr_v = 1 then
+            if bitCntr_v = 1 and burst_v then
+              -- Store the byte from the slave and, if the next byte is
+              -- ready, load it now so the SCK keeps running without a gap.
+              rxIn_r       <= sr_v;
+              rxWr_r       <= storeRx_r;
+              burstBytes_v := burstBytes_v - 1;
+              if burstBytes_v /= 0 and byteReady_v then
+                if fillTx_v then
+                  sr_v := (others => ONE);
+                else
+                  sr_v   := txOut_s;
+                  txRd_r <= YES;
+                end if;
+                bitCntr_v := sr_r'length + 1;
+              end if;
+            elsif bitCntr_v = 1 then
               done_o <= YES;
               if disableAfterXfer_v = true then
                 sselTimer_v := ENABLE_HOLD_TIME_C - 1;
@@ -175,17 +523,20 @@ begin
             bitCntr_v := bitCntr_v - 1;
           end if;
         end if;
+        sr_r <= sr_v;
 
         -- Transition the SPI clock and set the phase interval.
         sck_r            <= not sck_r;
         sclkPhaseTimer_v := CLKS_PER_SCLK_PHASE_C - 1;
       end if;
+
+      busy_r <= BooleanToStdLogic(burst_v or list_v);
       
     end if;
   end process;
 
   ssel_o <= LO when enabled_r = true else HI;
   sck_o  <= sck_r;
-  data_o <= sr_r;
+  data_o <= dataOut_r when regRead_r else sr_r;
 
 end architecture;
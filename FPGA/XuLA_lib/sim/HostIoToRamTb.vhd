@@ -0,0 +1,227 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Testbench for the HostIoToRam read prefetch.
+--
+-- The JTAG side is driven bit-by-bit the same way the host does it: an instruction header
+-- (ID, then the number of payload bits) followed by a READ opcode, the starting address and
+-- enough bits to shift back NUM_WORDS_G words plus the garbage word that leads them.
+-- The memory is a model that takes MEM_LATENCY_G clock cycles to finish each read.
+--
+-- The read is repeated with the DRCK period cut in half each time until the data coming
+-- back is wrong. The fastest DRCK that returns good data gives the sustained read rate
+-- in words/s. Run it once with RD_PREFETCH_G => 0 and once with RD_PREFETCH_G > 0 to see
+-- what the prefetch buffer buys you against a slow memory.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.STD_LOGIC_ARITH.all;
+use IEEE.STD_LOGIC_UNSIGNED.all;
+use work.CommonPckg.all;
+use work.HostIoPckg.all;
+
+entity HostIoToRamTb is
+  generic (
+    RD_PREFETCH_G     : natural := 8;      -- Prefetch depth of the HostIoToRam under test (0 = none).
+    MEM_LATENCY_G     : natural := 20;     -- Clock cycles for the memory to finish a read.
+    NUM_WORDS_G       : natural := 256;    -- Number of words in each read from the host.
+    CLK_PERIOD_G      : time    := 10 ns;  -- Memory clock period.
+    DRCK_PERIOD_G     : time    := 2 us;   -- Starting DRCK period. This gets halved after each good read.
+    MIN_DRCK_PERIOD_G : time    := 10 ns   -- Stop when the DRCK period gets this short.
+    );
+end entity;
+
+
+architecture arch of HostIoToRamTb is
+  constant ID_C         : std_logic_vector(7 downto 0) := "11111111";
+  constant ADDR_WIDTH_C : natural                      := 12;
+  constant DATA_WIDTH_C : natural                      := 16;
+  constant START_ADDR_C : natural                      := 16#123#;
+
+  signal clk_s          : std_logic := LO;
+  signal inShiftDr_s    : std_logic := LO;
+  signal drck_s         : std_logic := LO;
+  signal tdi_s          : std_logic := LO;
+  signal tdo_s          : std_logic;
+  signal addr_s         : std_logic_vector(ADDR_WIDTH_C-1 downto 0);
+  signal wr_s           : std_logic;
+  signal rd_s           : std_logic;
+  signal dataFromHost_s : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal dataToHost_s   : std_logic_vector(DATA_WIDTH_C-1 downto 0) := (others => ZERO);
+  signal begun_s        : std_logic := LO;
+  signal done_s         : std_logic := LO;
+  signal memRds_s       : natural   := 0;  -- Number of reads performed by the memory.
+  signal simDone_s      : boolean   := false;
+
+  -- The value stored at each memory address.
+  function MemData(addr : natural) return std_logic_vector is
+  begin
+    return CONV_STD_LOGIC_VECTOR((addr * 40503 + 16#5A5A#) mod 2**DATA_WIDTH_C, DATA_WIDTH_C);
+  end function;
+begin
+
+  clk_s <= not clk_s after CLK_PERIOD_G / 2 when not simDone_s else clk_s;
+
+  UDut : HostIoToRam
+    generic map (
+      ID_G          => ID_C,
+      SIMPLE_G      => false,
+      SYNC_G        => true,
+      RD_PREFETCH_G => RD_PREFETCH_G
+      )
+    port map (
+      inShiftDr_i    => inShiftDr_s,
+      drck_i         => drck_s,
+      tdi_i          => tdi_s,
+      tdo_o          => tdo_s,
+      clk_i          => clk_s,
+      addr_o         => addr_s,
+      wr_o           => wr_s,
+      dataFromHost_o => dataFromHost_s,
+      rd_o           => rd_s,
+      dataToHost_i   => dataToHost_s,
+      opBegun_i      => begun_s,
+      done_i         => done_s
+      );
+
+  -- Slow memory model. It accepts a read or write, pulses begun_s, and then pulses done_s
+  -- MEM_LATENCY_G cycles later. The read data is held until the next read finishes.
+  process(clk_s)
+    variable busy_v  : boolean := false;
+    variable rd_v    : boolean;
+    variable addr_v  : natural;
+    variable cntr_v  : natural;
+  begin
+    if rising_edge(clk_s) then
+      begun_s <= LO;
+      done_s  <= LO;
+      if busy_v then
+        if cntr_v <= 1 then
+          if rd_v then
+            dataToHost_s <= MemData(addr_v);
+            memRds_s     <= memRds_s + 1;
+          end if;
+          done_s <= HI;
+          busy_v := false;
+        else
+          cntr_v := cntr_v - 1;
+        end if;
+      elsif (rd_s = HI or wr_s = HI) and done_s = LO then
+        busy_v  := true;
+        rd_v    := rd_s = HI;
+        addr_v  := CONV_INTEGER(addr_s);
+        cntr_v  := MEM_LATENCY_G;
+        begun_s <= HI;
+      end if;
+    end if;
+  end process;
+
+  -- Act like the host and read the memory through the JTAG port.
+  process
+    constant PYLD_LEN_C    : natural := 2 + ADDR_WIDTH_C + (NUM_WORDS_G+1) * DATA_WIDTH_C;
+    constant FIRST_BIT_C   : natural := 1 + ADDR_WIDTH_C;  -- Payload bit where the garbage word starts coming back.
+    variable drckPeriod_v  : time;
+    variable start_v       : time;
+    variable elapsed_v     : time;
+    variable pyldLen_v     : std_logic_vector(31 downto 0);
+    variable pyld_v        : std_logic_vector(PYLD_LEN_C-1 downto 0);
+    variable word_v        : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+    variable tdo_v         : std_logic;
+    variable wordIndex_v   : natural;
+    variable bitIndex_v    : natural;
+    variable errors_v      : natural;
+    variable memRds_v      : natural;
+    variable rate_v        : real;
+    variable bestRate_v    : real    := 0.0;
+
+    -- Send one bit to the HostIo module and return the bit it sends back.
+    procedure ShiftBit(tdi : in std_logic; tdo : out std_logic) is
+    begin
+      tdi_s  <= tdi;
+      wait for drckPeriod_v / 2;
+      drck_s <= HI;                     -- TDI is clocked in on the rising edge.
+      wait for drckPeriod_v / 2;
+      tdo    := tdo_s;                  -- TDO is sampled on the falling edge.
+      drck_s <= LO;
+    end procedure;
+
+  begin
+    drckPeriod_v := DRCK_PERIOD_G;
+    wait for 20 * CLK_PERIOD_G;
+
+    while drckPeriod_v >= MIN_DRCK_PERIOD_G loop
+
+      -- Build the instruction payload: READ opcode, starting address and then
+      -- zeroes while the garbage word and the data words are shifted back.
+      pyldLen_v                       := CONV_STD_LOGIC_VECTOR(PYLD_LEN_C, 32);
+      pyld_v                          := (others => ZERO);
+      pyld_v(1 downto 0)              := READ_OPCODE_C;
+      pyld_v(ADDR_WIDTH_C+1 downto 2) := CONV_STD_LOGIC_VECTOR(START_ADDR_C, ADDR_WIDTH_C);
+
+      errors_v    := 0;
+      memRds_v    := memRds_s;
+      inShiftDr_s <= HI;
+
+      -- Instruction header: ID and the number of payload bits, both LSB first.
+      for i in 0 to ID_C'high loop
+        ShiftBit(ID_C(i), tdo_v);
+      end loop;
+      for i in 0 to pyldLen_v'high loop
+        ShiftBit(pyldLen_v(i), tdo_v);
+      end loop;
+
+      -- Shift the payload and check each data word as its last bit comes back.
+      start_v := now;
+      for p in 0 to PYLD_LEN_C-1 loop
+        ShiftBit(pyld_v(p), tdo_v);
+        if p >= FIRST_BIT_C + DATA_WIDTH_C and p < FIRST_BIT_C + (NUM_WORDS_G+1) * DATA_WIDTH_C then
+          wordIndex_v        := (p - FIRST_BIT_C) / DATA_WIDTH_C;
+          bitIndex_v         := (p - FIRST_BIT_C) mod DATA_WIDTH_C;
+          word_v(bitIndex_v) := tdo_v;
+          if bitIndex_v = DATA_WIDTH_C-1 and word_v /= MemData(START_ADDR_C + wordIndex_v - 1) then
+            if errors_v = 0 then
+              report "Word " & integer'image(wordIndex_v - 1) & " is " & integer'image(CONV_INTEGER(word_v))
+                & " but should be " & integer'image(CONV_INTEGER(MemData(START_ADDR_C + wordIndex_v - 1)));
+            end if;
+            errors_v := errors_v + 1;
+          end if;
+        end if;
+      end loop;
+      elapsed_v := now - start_v;
+
+      inShiftDr_s <= LO;
+      wait for 100 * CLK_PERIOD_G;      -- Let the prefetch buffer flush.
+
+      rate_v := real(NUM_WORDS_G) / (real(elapsed_v / 1 ns) * 1.0E-9);
+      report "DRCK period " & time'image(drckPeriod_v) & ": " & integer'image(errors_v) & " bad words, "
+        & integer'image(integer(rate_v)) & " words/s, " & integer'image(memRds_s - memRds_v) & " memory reads";
+      exit when errors_v /= 0;
+      bestRate_v   := rate_v;
+      drckPeriod_v := drckPeriod_v / 2;
+    end loop;
+
+    report "RD_PREFETCH_G = " & integer'image(RD_PREFETCH_G) & ", MEM_LATENCY_G = " & integer'image(MEM_LATENCY_G)
+      & ": sustained read rate is " & integer'image(integer(bestRate_v)) & " words/s";
+    assert bestRate_v > 0.0 report "No read returned good data." severity error;
+
+    simDone_s <= true;
+    wait;
+  end process;
+
+end architecture;
@@ -0,0 +1,245 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Per-port bandwidth and latency benchmark for the MultiPort SDRAM arbiter.
+--
+-- Four ports share the SDRAM through MultiPortSdram. Each port writes a word to its own part
+-- of the SDRAM, reads it back and checks it, and then moves on to the next address. A port
+-- waits GAP_G(n) cycles between operations (0 keeps it asking all the time). After RUN_TIME_G,
+-- every port reports how many operations it got done, its bandwidth in MB/s and the average
+-- and worst latency in clock cycles from raising its request to finishing the operation.
+--
+-- Change WEIGHTS_G, PRIORITIES_G and ISO_PERIOD_G to see how the arbiter shares the SDRAM.
+-- An isochronous port should never wait much longer than its ISO_PERIOD_G no matter how busy
+-- the other ports are, as long as the total guaranteed bandwidth fits.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use work.CommonPckg.all;
+use work.SdramCntlPckg.all;
+use work.SdramModelPckg.all;
+
+entity MultiPortTb is
+  generic (
+    FREQ_G       : real          := 100.0;  -- Clock frequency in MHz.
+    PIPE_EN_G    : boolean       := false;  -- Pipelined reads in the SDRAM controller.
+    WEIGHTS_G    : PortParamType := (4, 1, 1, 1);  -- Consecutive R/W operations each port gets per turn.
+    PRIORITIES_G : PortParamType := (0, 0, 1, 0);  -- Priority of each port.
+    ISO_PERIOD_G : PortParamType := (0, 0, 0, 32);  -- Guaranteed R/W operation period of each port (0 = none).
+    GAP_G        : PortParamType := (0, 0, 8, 24);  -- Idle cycles each port waits between its operations.
+    RUN_TIME_G   : time          := 200 us  -- How long the ports run.
+    );
+end entity;
+
+
+architecture arch of MultiPortTb is
+  constant NUM_PORTS_C   : natural := 4;
+  constant CLK_PERIOD_C  : time    := 1 us / FREQ_G;
+  constant START_TIME_C  : time    := 250 us;  -- Give the SDRAM time to initialize.
+  constant NROWS_C       : natural := 4096;
+  constant NCOLS_C       : natural := 512;
+  constant HADDR_WIDTH_C : natural := 23;
+  constant SADDR_WIDTH_C : natural := 12;
+  constant DATA_WIDTH_C  : natural := 16;
+  constant REGION_C      : natural := 2**20;  -- Words in the part of the SDRAM each port uses.
+
+  signal clk_s          : std_logic                                                := LO;
+  signal rd_s           : std_logic_vector(NUM_PORTS_C-1 downto 0)                 := (others => NO);
+  signal wr_s           : std_logic_vector(NUM_PORTS_C-1 downto 0)                 := (others => NO);
+  signal earlyOpBegun_s : std_logic_vector(NUM_PORTS_C-1 downto 0);
+  signal opBegun_s      : std_logic_vector(NUM_PORTS_C-1 downto 0);
+  signal rdPending_s    : std_logic_vector(NUM_PORTS_C-1 downto 0);
+  signal done_s         : std_logic_vector(NUM_PORTS_C-1 downto 0);
+  signal rdDone_s       : std_logic_vector(NUM_PORTS_C-1 downto 0);
+  signal addr_s         : std_logic_vector(NUM_PORTS_C*HADDR_WIDTH_C-1 downto 0) := (others => ZERO);
+  signal dataIn_s       : std_logic_vector(NUM_PORTS_C*DATA_WIDTH_C-1 downto 0)  := (others => ZERO);
+  signal dataOut_s      : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal sdCke_s        : std_logic;
+  signal sdCe_bs        : std_logic;
+  signal sdRas_bs       : std_logic;
+  signal sdCas_bs       : std_logic;
+  signal sdWe_bs        : std_logic;
+  signal sdBs_s         : std_logic_vector(1 downto 0);
+  signal sdAddr_s       : std_logic_vector(SADDR_WIDTH_C-1 downto 0);
+  signal sdData_s       : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal sdDqmh_s       : std_logic;
+  signal sdDqml_s       : std_logic;
+  signal rfshes_s       : natural;
+  signal finished_s     : std_logic_vector(NUM_PORTS_C-1 downto 0)                 := (others => NO);
+  signal simDone_s      : boolean                                                  := false;
+
+  -- The value a port writes to each address in its part of the SDRAM.
+  function Pattern(prt : natural; addr : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned((addr * 251 + prt * 16#1111# + 16#5A5A#) mod 65536, DATA_WIDTH_C));
+  end function;
+begin
+
+  clk_s <= not clk_s after CLK_PERIOD_C / 2 when not simDone_s else clk_s;
+
+  UDut : MultiPortSdram
+    generic map (
+      NUM_PORTS_G   => NUM_PORTS_C,
+      WEIGHTS_G     => WEIGHTS_G,
+      PRIORITIES_G  => PRIORITIES_G,
+      ISO_PERIOD_G  => ISO_PERIOD_G,
+      FREQ_G        => FREQ_G,
+      PIPE_EN_G     => PIPE_EN_G,
+      DATA_WIDTH_G  => DATA_WIDTH_C,
+      NROWS_G       => NROWS_C,
+      NCOLS_G       => NCOLS_C,
+      HADDR_WIDTH_G => HADDR_WIDTH_C,
+      SADDR_WIDTH_G => SADDR_WIDTH_C
+      )
+    port map (
+      clk_i              => clk_s,
+      portRd_i           => rd_s,
+      portWr_i           => wr_s,
+      portEarlyOpBegun_o => earlyOpBegun_s,
+      portOpBegun_o      => opBegun_s,
+      portRdPending_o    => rdPending_s,
+      portDone_o         => done_s,
+      portRdDone_o       => rdDone_s,
+      portAddr_i         => addr_s,
+      portData_i         => dataIn_s,
+      portData_o         => dataOut_s,
+      sdCke_o            => sdCke_s,
+      sdCe_bo            => sdCe_bs,
+      sdRas_bo           => sdRas_bs,
+      sdCas_bo           => sdCas_bs,
+      sdWe_bo            => sdWe_bs,
+      sdBs_o             => sdBs_s,
+      sdAddr_o           => sdAddr_s,
+      sdData_io          => sdData_s,
+      sdDqmh_o           => sdDqmh_s,
+      sdDqml_o           => sdDqml_s
+      );
+
+  USdram : SdramModel
+    generic map (
+      NROWS_G         => NROWS_C,
+      NCOLS_G         => NCOLS_C,
+      SADDR_WIDTH_G   => SADDR_WIDTH_C,
+      DATA_WIDTH_G    => DATA_WIDTH_C,
+      MAX_RFSH_DEBT_G => 1
+      )
+    port map (
+      clk_i    => clk_s,
+      cke_i    => sdCke_s,
+      ce_bi    => sdCe_bs,
+      ras_bi   => sdRas_bs,
+      cas_bi   => sdCas_bs,
+      we_bi    => sdWe_bs,
+      ba_i     => sdBs_s,
+      addr_i   => sdAddr_s,
+      data_io  => sdData_s,
+      dqmh_i   => sdDqmh_s,
+      dqml_i   => sdDqml_s,
+      rfshes_o => rfshes_s
+      );
+
+  -- Each port writes a word, reads it back, and then goes on to the next address.
+  GenPorts : for i in 0 to NUM_PORTS_C-1 generate
+    process
+      variable addr_v     : natural := 0;
+      variable wr_v       : boolean := true;
+      variable t0_v       : time;
+      variable start_v    : time;
+      variable ops_v      : natural := 0;
+      variable errors_v   : natural := 0;
+      variable lat_v      : natural;
+      variable totalLat_v : natural := 0;
+      variable maxLat_v   : natural := 0;
+    begin
+      wait for START_TIME_C;
+      wait until rising_edge(clk_s);
+      t0_v := now;
+
+      while now - t0_v < RUN_TIME_G loop
+        addr_s((i+1)*HADDR_WIDTH_C-1 downto i*HADDR_WIDTH_C) <= std_logic_vector(to_unsigned(i * REGION_C + addr_v, HADDR_WIDTH_C));
+        dataIn_s((i+1)*DATA_WIDTH_C-1 downto i*DATA_WIDTH_C) <= Pattern(i, addr_v);
+        if wr_v then
+          wr_s(i) <= YES;
+        else
+          rd_s(i) <= YES;
+        end if;
+        start_v := now;
+
+        -- Hold the request until the arbiter lets it through and then wait for it to finish.
+        loop
+          wait until rising_edge(clk_s);
+          exit when earlyOpBegun_s(i) = YES;
+        end loop;
+        wr_s(i) <= NO;
+        rd_s(i) <= NO;
+        loop
+          wait until rising_edge(clk_s);
+          exit when done_s(i) = YES;
+        end loop;
+
+        if not wr_v then
+          if dataOut_s /= Pattern(i, addr_v) then
+            if errors_v = 0 then
+              report "Port " & integer'image(i) & " read address " & integer'image(addr_v) & " back wrong." severity error;
+            end if;
+            errors_v := errors_v + 1;
+          end if;
+          addr_v := (addr_v + 1) mod REGION_C;
+        end if;
+        wr_v := not wr_v;
+
+        lat_v      := (now - start_v) / CLK_PERIOD_C;
+        totalLat_v := totalLat_v + lat_v;
+        if lat_v > maxLat_v then
+          maxLat_v := lat_v;
+        end if;
+        ops_v := ops_v + 1;
+
+        for c in 1 to GAP_G(i) loop
+          wait until rising_edge(clk_s);
+        end loop;
+      end loop;
+
+      report "Port " & integer'image(i) & ": " & integer'image(ops_v) & " ops, "
+        & integer'image(integer(real(ops_v * DATA_WIDTH_C / 8) / real((now - t0_v) / 1 ns) * 1000.0)) & " MB/s, latency "
+        & integer'image(totalLat_v / IntMax(ops_v, 1)) & " cycles average and " & integer'image(maxLat_v)
+        & " cycles worst, " & integer'image(errors_v) & " errors.";
+      assert errors_v = 0 report "Port " & integer'image(i) & " read some words back wrong." severity error;
+      finished_s(i) <= YES;
+      wait;
+    end process;
+  end generate;
+
+  process
+    constant ALL_FINISHED_C : std_logic_vector(NUM_PORTS_C-1 downto 0) := (others => YES);
+  begin
+    wait until finished_s = ALL_FINISHED_C;
+    report "WEIGHTS_G = (" & integer'image(WEIGHTS_G(0)) & "," & integer'image(WEIGHTS_G(1)) & ","
+      & integer'image(WEIGHTS_G(2)) & "," & integer'image(WEIGHTS_G(3)) & "), PRIORITIES_G = ("
+      & integer'image(PRIORITIES_G(0)) & "," & integer'image(PRIORITIES_G(1)) & ","
+      & integer'image(PRIORITIES_G(2)) & "," & integer'image(PRIORITIES_G(3)) & "), ISO_PERIOD_G = ("
+      & integer'image(ISO_PERIOD_G(0)) & "," & integer'image(ISO_PERIOD_G(1)) & ","
+      & integer'image(ISO_PERIOD_G(2)) & "," & integer'image(ISO_PERIOD_G(3)) & ") with "
+      & integer'image(rfshes_s) & " refreshes.";
+    simDone_s <= true;
+    wait;
+  end process;
+
+end architecture;
@@ -0,0 +1,472 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Simulation model of an SD card in SPI mode.
+--
+-- It does the commands SdCardCtrl uses: CMD0, CMD8, CMD55/ACMD41 (the card stays idle for
+-- the first INIT_RETRIES_G ACMD41's), CMD59, CMD6 (switching to high-speed mode if
+-- HIGH_SPEED_G is true), CMD17/CMD18 block reads, CMD12 and CMD24/CMD25 block writes with
+-- the stop-transfer token. Anything else gets an illegal-command R1 response.
+--
+-- The card takes time like a real one does so transfer rates come out close to what a real
+-- card gives:
+--   T_RD_G:       from a read command to when the first block is ready to send.
+--   T_RD_NEXT_G:  from the start of one block of a multi-block read until the next one is ready.
+--   T_WR_G:       busy time after a block of a single-block write.
+--   T_WR_NEXT_G:  busy time after each block of a multi-block write.
+--   T_STOP_G:     busy time after CMD12 or the stop-transfer token.
+-- Until a block is ready the card sends 0xFF, and while it's busy it holds MISO low.
+--
+-- The card holds NUM_BLOCKS_G blocks (addresses wrap around) that start out holding
+-- SdCardByte(block, offset). Read blocks always go out with their real CRC16. Once CMD59
+-- turns CRC checking on, commands and written blocks with a bad CRC are rejected.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+
+package SdCardModelPckg is
+
+  component SdCardModel is
+    generic (
+      SDHC_G         : boolean := false;   -- Block addressing if true, byte addressing if false.
+      HIGH_SPEED_G   : boolean := true;    -- Card can switch to high-speed mode.
+      NUM_BLOCKS_G   : natural := 1024;    -- Number of blocks in the card.
+      INIT_RETRIES_G : natural := 2;       -- Number of ACMD41's the card stays idle for.
+      NCR_G          : natural := 1;       -- Bytes between the end of a command and its response (1-8).
+      T_RD_G         : time    := 100 us;  -- Read command to first block ready.
+      T_RD_NEXT_G    : time    := 20 us;   -- Start of a block to next block ready in a multi-block read.
+      T_WR_G         : time    := 250 us;  -- Busy time after a single-block write.
+      T_WR_NEXT_G    : time    := 50 us;   -- Busy time after each block of a multi-block write.
+      T_STOP_G       : time    := 10 us    -- Busy time after a multi-block transfer is stopped.
+      );
+    port (
+      cs_bi  : in  std_logic;
+      sclk_i : in  std_logic;
+      mosi_i : in  std_logic;
+      miso_o : out std_logic;
+      cmds_o : out natural  -- Number of commands received so far.
+      );
+  end component;
+
+  constant SD_BLOCK_SIZE_C : natural := 512;
+
+  -- The byte the card starts out with at each offset of each block.
+  function SdCardByte(blk : natural; offset : natural) return natural;
+
+end package;
+
+
+
+package body SdCardModelPckg is
+
+  function SdCardByte(blk : natural; offset : natural) return natural is
+  begin
+    return (blk * 29 + offset * 7 + offset / 256 + 16#3C#) mod 256;
+  end function;
+
+end package body;
+
+
+
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use work.CommonPckg.all;
+use work.SdCardModelPckg.all;
+
+entity SdCardModel is
+  generic (
+    SDHC_G         : boolean := false;
+    HIGH_SPEED_G   : boolean := true;
+    NUM_BLOCKS_G   : natural := 1024;
+    INIT_RETRIES_G : natural := 2;
+    NCR_G          : natural := 1;
+    T_RD_G         : time    := 100 us;
+    T_RD_NEXT_G    : time    := 20 us;
+    T_WR_G         : time    := 250 us;
+    T_WR_NEXT_G    : time    := 50 us;
+    T_STOP_G       : time    := 10 us
+    );
+  port (
+    cs_bi  : in  std_logic;
+    sclk_i : in  std_logic;
+    mosi_i : in  std_logic;
+    miso_o : out std_logic := HI;
+    cmds_o : out natural   := 0
+    );
+end entity;
+
+
+architecture arch of SdCardModel is
+  constant BLK_SZ_C : natural := SD_BLOCK_SIZE_C;
+
+  type Mem_t is array (natural range <>) of natural range 0 to 255;
+  type MemPtr_t is access Mem_t;  -- The array is too big for the stack, so it goes on the heap.
+  type Queue_t is array (0 to 2*BLK_SZ_C-1) of natural range 0 to 255;
+
+  -- What the card is sending when it has no response bytes waiting to go out.
+  type TxMode_t is (IDLE_E, READ_E, BUSY_E);
+  -- What the card is doing with the bits coming in on MOSI.
+  type RxMode_t is (CMD_E, WR_TOKEN_E, WR_DATA_E, IGNORE_E);
+
+  constant START_TOKEN_C       : std_logic_vector(7 downto 0) := x"FE";
+  constant START_MULTI_TOKEN_C : std_logic_vector(7 downto 0) := x"FC";
+  constant STOP_TRAN_TOKEN_C   : std_logic_vector(7 downto 0) := x"FD";
+  constant DATA_ACCEPTED_C     : natural                      := 16#05#;
+  constant DATA_REJ_CRC_C      : natural                      := 16#0B#;
+  constant R1_IDLE_C           : natural                      := 16#01#;
+  constant R1_ILLEGAL_C        : natural                      := 16#04#;
+  constant R1_CRC_ERR_C        : natural                      := 16#08#;
+
+  -- CRC7 (x^7 + x^3 + 1) of the bits of a command, MSB first.
+  function Crc7(d : std_logic_vector) return std_logic_vector is
+    variable crc_v : std_logic_vector(6 downto 0) := (others => ZERO);
+    variable fb_v  : std_logic;
+  begin
+    for i in d'range loop
+      fb_v     := d(i) xor crc_v(6);
+      crc_v    := crc_v(5 downto 0) & fb_v;
+      crc_v(3) := crc_v(3) xor fb_v;
+    end loop;
+    return crc_v;
+  end function;
+
+  -- CRC16 (x^16 + x^12 + x^5 + 1) updated with the next byte, MSB first.
+  function Crc16(crc : std_logic_vector(15 downto 0); b : natural) return std_logic_vector is
+    variable d_v   : std_logic_vector(7 downto 0) := std_logic_vector(to_unsigned(b, 8));
+    variable crc_v : std_logic_vector(15 downto 0) := crc;
+    variable fb_v  : std_logic;
+  begin
+    for i in d_v'range loop
+      fb_v      := d_v(i) xor crc_v(15);
+      crc_v     := crc_v(14 downto 0) & fb_v;
+      crc_v(5)  := crc_v(5) xor fb_v;
+      crc_v(12) := crc_v(12) xor fb_v;
+    end loop;
+    return crc_v;
+  end function;
+begin
+
+  process
+    variable mem_v       : MemPtr_t := null;
+    -- Bytes waiting to go out on MISO ahead of anything else.
+    variable q_v         : Queue_t;
+    variable qLen_v      : natural  := 0;
+    variable qPos_v      : natural  := 0;
+    variable txByte_v    : std_logic_vector(7 downto 0);
+    variable txBits_v    : natural  := 0;  -- Bits of txByte_v that haven't gone out.
+    variable txMode_v    : TxMode_t := IDLE_E;
+    variable readyTime_v : time     := 0 ns;  -- When the next read block is ready or the card stops being busy.
+    variable multi_v     : boolean  := false;  -- A multi-block read or write is going on.
+    variable blk_v       : natural  := 0;  -- Block being read or written.
+    -- Incoming bits.
+    variable rxMode_v    : RxMode_t := CMD_E;
+    variable rx_v        : std_logic_vector(47 downto 0);
+    variable rxBits_v    : natural  := 0;  -- Bits received for the command or the current data byte.
+    variable rxBytes_v   : natural  := 0;  -- Bytes received of the block being written.
+    variable wrCrc_v     : std_logic_vector(15 downto 0);
+    variable wrBuf_v     : Mem_t(0 to BLK_SZ_C+1);
+    -- Card state.
+    variable idle_v      : boolean  := true;
+    variable appCmd_v    : boolean  := false;
+    variable crcOn_v     : boolean  := false;
+    variable acmd41s_v   : natural  := 0;
+    variable cmds_v      : natural  := 0;
+    variable cmd_v       : natural;
+    variable arg_v       : std_logic_vector(31 downto 0);
+    variable r1_v        : natural;
+    variable crc_v       : std_logic_vector(15 downto 0);
+
+    procedure Flush is
+    begin
+      qLen_v   := 0;
+      qPos_v   := 0;
+      txBits_v := 0;
+    end procedure;
+
+    procedure Push(b : natural) is
+    begin
+      q_v(qLen_v) := b;
+      qLen_v      := qLen_v + 1;
+    end procedure;
+
+    -- Queue a data block: start token, the bytes and their CRC.
+    procedure PushBlock(data : Mem_t) is
+    begin
+      Push(to_integer(unsigned(START_TOKEN_C)));
+      crc_v := (others => ZERO);
+      for i in data'range loop
+        Push(data(i));
+        crc_v := Crc16(crc_v, data(i));
+      end loop;
+      Push(to_integer(unsigned(crc_v(15 downto 8))));
+      Push(to_integer(unsigned(crc_v(7 downto 0))));
+    end procedure;
+
+    -- Index of the first byte of a block in the card memory.
+    function BlkIndex(blk : natural) return natural is
+    begin
+      return (blk mod NUM_BLOCKS_G) * BLK_SZ_C;
+    end function;
+
+    -- The next byte to send on MISO.
+    procedure NextByte(b : out natural) is
+    begin
+      if qLen_v /= 0 then
+        b      := q_v(qPos_v);
+        qPos_v := qPos_v + 1;
+        if qPos_v = qLen_v then
+          qLen_v := 0;
+          qPos_v := 0;
+        end if;
+        return;
+      end if;
+      b := 16#FF#;
+      case txMode_v is
+        when READ_E =>
+          if now >= readyTime_v then  -- The next block is ready, so start sending it.
+            PushBlock(mem_v(BlkIndex(blk_v) to BlkIndex(blk_v) + BLK_SZ_C - 1));
+            NextByte(b);
+            blk_v       := blk_v + 1;
+            readyTime_v := now + T_RD_NEXT_G;
+            if not multi_v then
+              txMode_v := IDLE_E;
+            end if;
+          end if;
+        when BUSY_E =>
+          if now < readyTime_v then
+            b := 16#00#;
+          else  -- Done being busy, so go back to listening.
+            txMode_v := IDLE_E;
+            if rxMode_v = IGNORE_E then
+              if multi_v then
+                rxMode_v := WR_TOKEN_E;
+                rx_v     := (others => ONE);
+              else
+                rxMode_v := CMD_E;
+                rxBits_v := 0;
+              end if;
+            end if;
+          end if;
+        when others =>
+          null;
+      end case;
+    end procedure;
+
+    -- Respond to the command in rx_v.
+    procedure DoCommand is
+      variable blkAddr_v : natural;
+      variable status_v  : Mem_t(0 to 63);
+    begin
+      cmds_v := cmds_v + 1;
+      cmds_o <= cmds_v;
+      cmd_v  := to_integer(unsigned(rx_v(45 downto 40)));
+      arg_v  := rx_v(39 downto 8);
+      if SDHC_G then
+        blkAddr_v := to_integer(unsigned(arg_v(30 downto 0)));
+      else
+        blkAddr_v := to_integer(unsigned(arg_v(31 downto 9)));
+      end if;
+      r1_v := 0;
+      if idle_v then
+        r1_v := R1_IDLE_C;
+      end if;
+
+      Flush;
+      for i in 1 to NCR_G loop
+        Push(16#FF#);
+      end loop;
+
+      -- CMD0 and CMD8 always have their CRC checked.
+      if (crcOn_v or cmd_v = 0 or cmd_v = 8) and Crc7(rx_v(47 downto 8)) /= rx_v(7 downto 1) then
+        Push(r1_v + R1_CRC_ERR_C);
+        appCmd_v := false;
+        return;
+      end if;
+
+      if appCmd_v and cmd_v = 41 then
+        if acmd41s_v < INIT_RETRIES_G then
+          acmd41s_v := acmd41s_v + 1;
+        else
+          idle_v := false;
+          r1_v   := 0;
+        end if;
+        Push(r1_v);
+      else
+        case cmd_v is
+          when 0 =>
+            idle_v    := true;
+            acmd41s_v := 0;
+            crcOn_v   := false;
+            multi_v   := false;
+            txMode_v  := IDLE_E;
+            Push(R1_IDLE_C);
+          when 8 =>
+            Push(r1_v);
+            Push(0);
+            Push(0);
+            Push(to_integer(unsigned(arg_v(15 downto 8))));
+            Push(to_integer(unsigned(arg_v(7 downto 0))));
+          when 55 =>
+            Push(r1_v);
+          when 59 =>
+            crcOn_v := arg_v(0) = ONE;
+            Push(r1_v);
+          when 6 =>
+            Push(r1_v);
+            Push(16#FF#);
+            status_v := (others => 0);
+            if HIGH_SPEED_G and arg_v(31) = ONE and arg_v(3 downto 0) = "0001" then
+              status_v(16) := 16#01#;  -- Function group 1 switched to high-speed.
+            end if;
+            PushBlock(status_v);
+          when 12 =>
+            -- Stop a multi-block read. A stuff byte goes out before the response.
+            Flush;
+            Push(16#FF#);
+            Push(r1_v);
+            multi_v     := false;
+            txMode_v    := BUSY_E;
+            readyTime_v := now + T_STOP_G;
+          when 17 | 18 =>
+            Push(r1_v);
+            blk_v       := blkAddr_v;
+            multi_v     := cmd_v = 18;
+            txMode_v    := READ_E;
+            readyTime_v := now + T_RD_G;
+          when 24 | 25 =>
+            Push(r1_v);
+            blk_v    := blkAddr_v;
+            multi_v  := cmd_v = 25;
+            rxMode_v := WR_TOKEN_E;
+            rx_v     := (others => ONE);
+          when others =>
+            Push(r1_v + R1_ILLEGAL_C);
+        end case;
+      end if;
+      appCmd_v := cmd_v = 55;
+    end procedure;
+
+    variable b_v : natural;
+  begin
+    if mem_v = null then
+      mem_v := new Mem_t(0 to NUM_BLOCKS_G*BLK_SZ_C-1);
+      for i in 0 to NUM_BLOCKS_G-1 loop
+        for j in 0 to BLK_SZ_C-1 loop
+          mem_v(i*BLK_SZ_C + j) := SdCardByte(i, j);
+        end loop;
+      end loop;
+    end if;
+
+    wait on cs_bi, sclk_i;
+
+    if cs_bi /= LO then
+      -- Deselected. Whatever was being sent or received is dropped, but a busy card stays busy.
+      miso_o <= HI;
+      Flush;
+      if txMode_v = READ_E then
+        txMode_v := IDLE_E;
+      end if;
+      if txMode_v /= BUSY_E then
+        multi_v  := false;
+        rxMode_v := CMD_E;
+      end if;
+      rxBits_v := 0;
+
+    elsif falling_edge(sclk_i) then
+      -- Send the next bit, MSB first.
+      if txBits_v = 0 then
+        NextByte(b_v);
+        txByte_v := std_logic_vector(to_unsigned(b_v, 8));
+        txBits_v := 8;
+      end if;
+      miso_o   <= txByte_v(7);
+      txByte_v := txByte_v(6 downto 0) & ONE;
+      txBits_v := txBits_v - 1;
+
+    elsif rising_edge(sclk_i) then
+      -- Take in the next bit.
+      case rxMode_v is
+        when CMD_E =>  -- A command starts with a 0 bit and is 48 bits long.
+          if rxBits_v /= 0 or mosi_i = LO then
+            rx_v     := rx_v(46 downto 0) & mosi_i;
+            rxBits_v := rxBits_v + 1;
+            if rxBits_v = 48 then
+              rxBits_v := 0;
+              if rx_v(46) = ONE then  -- Transmission bit must be set.
+                DoCommand;
+              end if;
+            end if;
+          end if;
+
+        when WR_TOKEN_E =>  -- Wait for the start of a data block (or the end of a multi-block write).
+          rx_v := rx_v(46 downto 0) & mosi_i;
+          if (rx_v(7 downto 0) = START_TOKEN_C and not multi_v)
+            or (rx_v(7 downto 0) = START_MULTI_TOKEN_C and multi_v) then
+            rxMode_v  := WR_DATA_E;
+            rxBits_v  := 0;
+            rxBytes_v := 0;
+          elsif rx_v(7 downto 0) = STOP_TRAN_TOKEN_C and multi_v then
+            Flush;
+            Push(16#FF#);
+            multi_v     := false;
+            rxMode_v    := IGNORE_E;
+            txMode_v    := BUSY_E;
+            readyTime_v := now + T_STOP_G;
+          end if;
+
+        when WR_DATA_E =>  -- Get the data bytes and the CRC, then send the data response and go busy.
+          rx_v     := rx_v(46 downto 0) & mosi_i;
+          rxBits_v := rxBits_v + 1;
+          if rxBits_v = 8 then
+            rxBits_v           := 0;
+            wrBuf_v(rxBytes_v) := to_integer(unsigned(rx_v(7 downto 0)));
+            rxBytes_v          := rxBytes_v + 1;
+            if rxBytes_v = BLK_SZ_C + 2 then
+              crc_v := (others => ZERO);
+              for i in 0 to BLK_SZ_C-1 loop
+                crc_v := Crc16(crc_v, wrBuf_v(i));
+              end loop;
+              Flush;
+              rxMode_v := IGNORE_E;
+              if crcOn_v and crc_v /= rx_v(15 downto 0) then
+                Push(DATA_REJ_CRC_C);
+                multi_v := false;
+              else
+                mem_v(BlkIndex(blk_v) to BlkIndex(blk_v) + BLK_SZ_C - 1) := wrBuf_v(0 to BLK_SZ_C-1);
+                blk_v := blk_v + 1;
+                Push(DATA_ACCEPTED_C);
+                txMode_v := BUSY_E;
+                if multi_v then
+                  readyTime_v := now + T_WR_NEXT_G;
+                else
+                  readyTime_v := now + T_WR_G;
+                end if;
+              end if;
+            end if;
+          end if;
+
+        when IGNORE_E =>  -- MOSI doesn't mean anything while the card is busy.
+          null;
+      end case;
+    end if;
+  end process;
+
+end architecture;
@@ -0,0 +1,229 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Benchmark for SdCardCtrl single and multi-block transfers.
+--
+-- TOTAL_BLOCKS_G blocks are written to the SdCardModel and then read back and checked. The
+-- blocks go NUM_BLOCKS_G at a time: with NUM_BLOCKS_G = 1 every block is a separate CMD24 or
+-- CMD17, otherwise each group of blocks is one CMD25 or CMD18. Each transfer after the first
+-- uses continue_i so it starts with the block after the last one. The host takes each byte
+-- as soon as the controller has it. The sustained write and read rates are reported in MB/s
+-- along with the number of commands the card got.
+--
+-- Run it with NUM_BLOCKS_G = 1 and then with 8 or more to see what the multi-block commands
+-- buy against a card that takes T_RD_G to start a read and T_WR_G to finish a written block.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use work.CommonPckg.all;
+use work.SdCardPckg.all;
+use work.SdCardModelPckg.all;
+
+entity SdCardTb is
+  generic (
+    FREQ_G         : real    := 100.0;  -- Master clock frequency (MHz).
+    HIGH_SPEED_G   : boolean := false;  -- Switch the card to high-speed mode.
+    CRC_G          : boolean := false;  -- Have the card and the controller check CRCs.
+    NUM_BLOCKS_G   : natural := 8;      -- Blocks moved with each read or write command.
+    TOTAL_BLOCKS_G : natural := 32;     -- Blocks to write and then read.
+    START_BLOCK_G  : natural := 100;    -- First block written and read.
+    T_RD_G         : time    := 100 us;  -- Card read command to first block ready.
+    T_RD_NEXT_G    : time    := 20 us;  -- Card time between blocks of a multi-block read.
+    T_WR_G         : time    := 250 us;  -- Card busy time after a single-block write.
+    T_WR_NEXT_G    : time    := 50 us   -- Card busy time after each block of a multi-block write.
+    );
+end entity;
+
+
+architecture arch of SdCardTb is
+  constant CLK_PERIOD_C : time := 1 us / FREQ_G;
+
+  signal clk_s       : std_logic                     := LO;
+  signal reset_s     : std_logic                     := YES;
+  signal rd_s        : std_logic                     := NO;
+  signal wr_s        : std_logic                     := NO;
+  signal continue_s  : std_logic                     := NO;
+  signal numBlocks_s : std_logic_vector(15 downto 0) := x"0001";
+  signal addr_s      : std_logic_vector(31 downto 0) := (others => ZERO);
+  signal dataIn_s    : std_logic_vector(7 downto 0)  := (others => ZERO);
+  signal dataOut_s   : std_logic_vector(7 downto 0);
+  signal busy_s      : std_logic;
+  signal hndShkIn_s  : std_logic                     := LO;
+  signal hndShkOut_s : std_logic;
+  signal error_s     : std_logic_vector(15 downto 0);
+  signal crcErr_s    : std_logic;
+  signal cs_bs       : std_logic;
+  signal sclk_s      : std_logic;
+  signal mosi_s      : std_logic;
+  signal miso_s      : std_logic;
+  signal cmds_s      : natural;
+  signal simDone_s   : boolean                       := false;
+
+  -- The byte written to each offset of each block. (It's different from what the card starts with.)
+  function WrByte(blk : natural; offset : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned((SdCardByte(blk, offset) + blk + 16#A5#) mod 256, 8));
+  end function;
+begin
+
+  clk_s <= not clk_s after CLK_PERIOD_C / 2 when not simDone_s else clk_s;
+
+  UDut : SdCardCtrl
+    generic map (
+      FREQ_G       => FREQ_G,
+      HIGH_SPEED_G => HIGH_SPEED_G,
+      CRC_G        => CRC_G
+      )
+    port map (
+      clk_i       => clk_s,
+      reset_i     => reset_s,
+      rd_i        => rd_s,
+      wr_i        => wr_s,
+      continue_i  => continue_s,
+      numBlocks_i => numBlocks_s,
+      addr_i      => addr_s,
+      data_i      => dataIn_s,
+      data_o      => dataOut_s,
+      busy_o      => busy_s,
+      hndShk_i    => hndShkIn_s,
+      hndShk_o    => hndShkOut_s,
+      error_o     => error_s,
+      crcErr_o    => crcErr_s,
+      cs_bo       => cs_bs,
+      sclk_o      => sclk_s,
+      mosi_o      => mosi_s,
+      miso_i      => miso_s
+      );
+
+  UCard : SdCardModel
+    generic map (
+      HIGH_SPEED_G => HIGH_SPEED_G,
+      T_RD_G       => T_RD_G,
+      T_RD_NEXT_G  => T_RD_NEXT_G,
+      T_WR_G       => T_WR_G,
+      T_WR_NEXT_G  => T_WR_NEXT_G
+      )
+    port map (
+      cs_bi  => cs_bs,
+      sclk_i => sclk_s,
+      mosi_i => mosi_s,
+      miso_o => miso_s,
+      cmds_o => cmds_s
+      );
+
+  process
+    variable blk_v    : natural;
+    variable n_v      : natural;
+    variable errors_v : natural := 0;
+    variable cmds_v   : natural;
+    variable start_v  : time;
+    variable wrTime_v : time;
+    variable rdTime_v : time;
+
+    -- Rate in MB/s (with two decimal places) for moving TOTAL_BLOCKS_G blocks in the given time.
+    function MBytesPerSec(t : time) return string is
+      variable r_v : natural;
+    begin
+      r_v := integer(real(TOTAL_BLOCKS_G * SD_BLOCK_SIZE_C) / real(t / 1 ns) * 100_000.0);
+      if r_v mod 100 < 10 then
+        return integer'image(r_v / 100) & ".0" & integer'image(r_v mod 100);
+      end if;
+      return integer'image(r_v / 100) & "." & integer'image(r_v mod 100);
+    end function;
+
+    -- Wait for the controller to finish what it's doing and make sure it didn't stall on an error.
+    procedure WaitNotBusy is
+    begin
+      if busy_s /= NO then
+        wait until busy_s = NO;
+      end if;
+      assert error_s = x"0000" report "SdCardCtrl error " & integer'image(to_integer(unsigned(error_s))) severity failure;
+    end procedure;
+
+  begin
+    wait for 10 * CLK_PERIOD_C;
+    reset_s <= NO;
+    wait until rising_edge(clk_s) and busy_s = NO;  -- Wait for the card to be initialized.
+    WaitNotBusy;
+
+    for phase in 0 to 1 loop            -- 0 = write, 1 = read.
+      cmds_v  := cmds_s;
+      start_v := now;
+      blk_v   := 0;
+      while blk_v < TOTAL_BLOCKS_G loop
+        n_v := NUM_BLOCKS_G;
+        if TOTAL_BLOCKS_G - blk_v < n_v then
+          n_v := TOTAL_BLOCKS_G - blk_v;
+        end if;
+
+        -- Start the transfer. The first one gives the address and the rest just continue on.
+        numBlocks_s <= std_logic_vector(to_unsigned(n_v, numBlocks_s'length));
+        addr_s      <= std_logic_vector(to_unsigned(START_BLOCK_G * SD_BLOCK_SIZE_C, addr_s'length));
+        continue_s  <= BooleanToStdLogic(blk_v /= 0);
+        if phase = 0 then
+          wr_s <= YES;
+        else
+          rd_s <= YES;
+        end if;
+        wait until busy_s = YES;
+        wr_s <= NO;
+        rd_s <= NO;
+
+        -- Pass the bytes of all the blocks through the handshake.
+        for b in 0 to n_v * SD_BLOCK_SIZE_C - 1 loop
+          wait until hndShkOut_s = HI;
+          if phase = 0 then
+            dataIn_s <= WrByte(START_BLOCK_G + blk_v + b / SD_BLOCK_SIZE_C, b mod SD_BLOCK_SIZE_C);
+          elsif dataOut_s /= WrByte(START_BLOCK_G + blk_v + b / SD_BLOCK_SIZE_C, b mod SD_BLOCK_SIZE_C) then
+            if errors_v = 0 then
+              report "Byte " & integer'image(b mod SD_BLOCK_SIZE_C) & " of block "
+                & integer'image(START_BLOCK_G + blk_v + b / SD_BLOCK_SIZE_C) & " read back wrong." severity error;
+            end if;
+            errors_v := errors_v + 1;
+          end if;
+          hndShkIn_s <= HI;
+          wait until hndShkOut_s = LO;
+          hndShkIn_s <= LO;
+        end loop;
+        WaitNotBusy;
+        blk_v := blk_v + n_v;
+      end loop;
+
+      if phase = 0 then
+        wrTime_v := now - start_v;
+        report "Wrote " & integer'image(TOTAL_BLOCKS_G) & " blocks in " & time'image(wrTime_v) & " at "
+          & MBytesPerSec(wrTime_v) & " MB/s with " & integer'image(cmds_s - cmds_v) & " commands.";
+      else
+        rdTime_v := now - start_v;
+        report "Read " & integer'image(TOTAL_BLOCKS_G) & " blocks in " & time'image(rdTime_v) & " at "
+          & MBytesPerSec(rdTime_v) & " MB/s with " & integer'image(cmds_s - cmds_v) & " commands and "
+          & integer'image(errors_v) & " bad bytes.";
+      end if;
+    end loop;
+
+    report "NUM_BLOCKS_G = " & integer'image(NUM_BLOCKS_G) & ": write " & MBytesPerSec(wrTime_v)
+      & " MB/s, read " & MBytesPerSec(rdTime_v) & " MB/s";
+    assert errors_v = 0 report "Some bytes read back wrong." severity error;
+
+    simDone_s <= true;
+    wait;
+  end process;
+
+end architecture;
@@ -0,0 +1,279 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Benchmark for SdReadAhead.
+--
+-- The host reads TOTAL_BLOCKS_G consecutive blocks one at a time through SdReadAhead and an
+-- SdCardCtrl from an SdCardModel that takes T_RD_G to start a read, and it checks every byte.
+-- After each block the host spends HOST_GAP_G doing something else, which is time the
+-- read-ahead can use to get the next blocks. The read rate in MB/s is reported along with the
+-- hits, misses and number of commands the card got. Run it with DEPTH_G = 0 to see the rate
+-- without any read-ahead.
+--
+-- Then, while the read-ahead is still going, the host writes the block just past the one it
+-- read last and reads back the blocks around it to make sure the write went to the right block
+-- and the blocks that were read ahead before the write weren't handed out stale.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use work.CommonPckg.all;
+use work.SdCardPckg.all;
+use work.SdReadAheadPckg.all;
+use work.SdCardModelPckg.all;
+
+entity SdReadAheadTb is
+  generic (
+    FREQ_G         : real    := 100.0;  -- Master clock frequency (MHz).
+    DEPTH_G        : natural := 3;      -- # of blocks to read ahead of the host.
+    CRC_G          : boolean := false;  -- Have the card and the controller check CRCs.
+    TOTAL_BLOCKS_G : natural := 32;     -- Blocks the host reads in a row.
+    START_BLOCK_G  : natural := 100;    -- First block the host reads.
+    HOST_GAP_G     : time    := 20 us;  -- Time the host spends on each block after reading it.
+    T_RD_G         : time    := 100 us;  -- Card read command to first block ready.
+    T_RD_NEXT_G    : time    := 20 us;  -- Card time between blocks of a multi-block read.
+    T_WR_G         : time    := 250 us  -- Card busy time after a single-block write.
+    );
+end entity;
+
+
+architecture arch of SdReadAheadTb is
+  constant CLK_PERIOD_C : time    := 1 us / FREQ_G;
+  constant WR_BLOCK_C   : natural := START_BLOCK_G + TOTAL_BLOCKS_G;  -- Block written while reading ahead.
+
+  signal clk_s         : std_logic                     := LO;
+  signal reset_s       : std_logic                     := YES;
+  signal rd_s          : std_logic                     := NO;
+  signal wr_s          : std_logic                     := NO;
+  signal addr_s        : std_logic_vector(31 downto 0) := (others => ZERO);
+  signal dataIn_s      : std_logic_vector(7 downto 0)  := (others => ZERO);
+  signal dataOut_s     : std_logic_vector(7 downto 0);
+  signal busy_s        : std_logic;
+  signal hndShkIn_s    : std_logic                     := LO;
+  signal hndShkOut_s   : std_logic;
+  signal error_s       : std_logic_vector(15 downto 0);
+  signal hits_s        : std_logic_vector(31 downto 0);
+  signal misses_s      : std_logic_vector(31 downto 0);
+  signal sdRd_s        : std_logic;
+  signal sdWr_s        : std_logic;
+  signal sdNumBlocks_s : std_logic_vector(15 downto 0);
+  signal sdAddr_s      : std_logic_vector(31 downto 0);
+  signal sdDataIn_s    : std_logic_vector(7 downto 0);
+  signal sdDataOut_s   : std_logic_vector(7 downto 0);
+  signal sdBusy_s      : std_logic;
+  signal sdHndShkIn_s  : std_logic;
+  signal sdHndShkOut_s : std_logic;
+  signal sdError_s     : std_logic_vector(15 downto 0);
+  signal sdCrcErr_s    : std_logic;
+  signal cs_bs         : std_logic;
+  signal sclk_s        : std_logic;
+  signal mosi_s        : std_logic;
+  signal miso_s        : std_logic;
+  signal cmds_s        : natural;
+  signal simDone_s     : boolean                       := false;
+
+  -- The byte written to each offset of WR_BLOCK_C. (It's different from what the card starts with.)
+  function WrByte(offset : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned((SdCardByte(WR_BLOCK_C, offset) + 16#A5#) mod 256, 8));
+  end function;
+
+  -- The byte that should be read back from each offset of each block.
+  function RdByte(blk : natural; offset : natural) return std_logic_vector is
+  begin
+    if blk = WR_BLOCK_C then
+      return WrByte(offset);
+    end if;
+    return std_logic_vector(to_unsigned(SdCardByte(blk, offset), 8));
+  end function;
+begin
+
+  clk_s <= not clk_s after CLK_PERIOD_C / 2 when not simDone_s else clk_s;
+
+  UDut : SdReadAhead
+    generic map (
+      DEPTH_G => DEPTH_G,
+      CRC_G   => CRC_G
+      )
+    port map (
+      clk_i         => clk_s,
+      reset_i       => reset_s,
+      rd_i          => rd_s,
+      wr_i          => wr_s,
+      addr_i        => addr_s,
+      data_i        => dataIn_s,
+      data_o        => dataOut_s,
+      busy_o        => busy_s,
+      hndShk_i      => hndShkIn_s,
+      hndShk_o      => hndShkOut_s,
+      error_o       => error_s,
+      hits_o        => hits_s,
+      misses_o      => misses_s,
+      sdRd_o        => sdRd_s,
+      sdWr_o        => sdWr_s,
+      sdNumBlocks_o => sdNumBlocks_s,
+      sdAddr_o      => sdAddr_s,
+      sdData_o      => sdDataIn_s,
+      sdData_i      => sdDataOut_s,
+      sdBusy_i      => sdBusy_s,
+      sdHndShk_i    => sdHndShkOut_s,
+      sdHndShk_o    => sdHndShkIn_s,
+      sdError_i     => sdError_s,
+      sdCrcErr_i    => sdCrcErr_s
+      );
+
+  USdCtrl : SdCardCtrl
+    generic map (
+      FREQ_G => FREQ_G,
+      CRC_G  => CRC_G
+      )
+    port map (
+      clk_i       => clk_s,
+      reset_i     => reset_s,
+      rd_i        => sdRd_s,
+      wr_i        => sdWr_s,
+      numBlocks_i => sdNumBlocks_s,
+      addr_i      => sdAddr_s,
+      data_i      => sdDataIn_s,
+      data_o      => sdDataOut_s,
+      busy_o      => sdBusy_s,
+      hndShk_i    => sdHndShkIn_s,
+      hndShk_o    => sdHndShkOut_s,
+      error_o     => sdError_s,
+      crcErr_o    => sdCrcErr_s,
+      cs_bo       => cs_bs,
+      sclk_o      => sclk_s,
+      mosi_o      => mosi_s,
+      miso_i      => miso_s
+      );
+
+  UCard : SdCardModel
+    generic map (
+      HIGH_SPEED_G => false,
+      T_RD_G       => T_RD_G,
+      T_RD_NEXT_G  => T_RD_NEXT_G,
+      T_WR_G       => T_WR_G
+      )
+    port map (
+      cs_bi  => cs_bs,
+      sclk_i => sclk_s,
+      mosi_i => mosi_s,
+      miso_o => miso_s,
+      cmds_o => cmds_s
+      );
+
+  process
+    variable errors_v : natural := 0;
+    variable hits_v   : natural;
+    variable misses_v : natural;
+    variable cmds_v   : natural;
+    variable start_v  : time;
+    variable rdTime_v : time;
+
+    -- Rate in MB/s (with two decimal places) for reading TOTAL_BLOCKS_G blocks in the given time.
+    function MBytesPerSec(t : time) return string is
+      variable r_v : natural;
+    begin
+      r_v := integer(real(TOTAL_BLOCKS_G * SD_BLOCK_SIZE_C) / real(t / 1 ns) * 100_000.0);
+      if r_v mod 100 < 10 then
+        return integer'image(r_v / 100) & ".0" & integer'image(r_v mod 100);
+      end if;
+      return integer'image(r_v / 100) & "." & integer'image(r_v mod 100);
+    end function;
+
+    -- Wait for the read-ahead to finish what it's doing and make sure it didn't stall on an error.
+    procedure WaitNotBusy is
+    begin
+      if busy_s /= NO then
+        wait until busy_s = NO;
+      end if;
+      assert error_s = x"0000" report "SdCardCtrl error " & integer'image(to_integer(unsigned(error_s))) severity failure;
+    end procedure;
+
+    -- Read a block and check its bytes.
+    procedure ReadBlock(blk : natural) is
+    begin
+      addr_s <= std_logic_vector(to_unsigned(blk * SD_BLOCK_SIZE_C, addr_s'length));
+      rd_s   <= YES;
+      wait until busy_s = YES;
+      rd_s   <= NO;
+      for b in 0 to SD_BLOCK_SIZE_C - 1 loop
+        wait until hndShkOut_s = HI;
+        if dataOut_s /= RdByte(blk, b) then
+          if errors_v = 0 then
+            report "Byte " & integer'image(b) & " of block " & integer'image(blk) & " read back wrong." severity error;
+          end if;
+          errors_v := errors_v + 1;
+        end if;
+        hndShkIn_s <= HI;
+        wait until hndShkOut_s = LO;
+        hndShkIn_s <= LO;
+      end loop;
+      WaitNotBusy;
+    end procedure;
+
+  begin
+    wait for 10 * CLK_PERIOD_C;
+    reset_s <= NO;
+    wait until rising_edge(clk_s) and busy_s = NO;  -- Wait for the card to be initialized.
+    WaitNotBusy;
+
+    -- Read the blocks in a row with some time between them.
+    hits_v   := to_integer(unsigned(hits_s));
+    misses_v := to_integer(unsigned(misses_s));
+    cmds_v   := cmds_s;
+    start_v  := now;
+    for blk in START_BLOCK_G to START_BLOCK_G + TOTAL_BLOCKS_G - 1 loop
+      ReadBlock(blk);
+      wait for HOST_GAP_G;
+    end loop;
+    rdTime_v := now - start_v;
+    report "Read " & integer'image(TOTAL_BLOCKS_G) & " blocks in " & time'image(rdTime_v) & " at "
+      & MBytesPerSec(rdTime_v) & " MB/s with " & integer'image(to_integer(unsigned(hits_s)) - hits_v) & " hits, "
+      & integer'image(to_integer(unsigned(misses_s)) - misses_v) & " misses and "
+      & integer'image(cmds_s - cmds_v) & " commands.";
+
+    -- Write the next block while it's being read ahead.
+    addr_s <= std_logic_vector(to_unsigned(WR_BLOCK_C * SD_BLOCK_SIZE_C, addr_s'length));
+    wr_s   <= YES;
+    wait until busy_s = YES;
+    wr_s   <= NO;
+    for b in 0 to SD_BLOCK_SIZE_C - 1 loop
+      wait until hndShkOut_s = HI;
+      dataIn_s   <= WrByte(b);
+      hndShkIn_s <= HI;
+      wait until hndShkOut_s = LO;
+      hndShkIn_s <= LO;
+    end loop;
+    WaitNotBusy;
+
+    -- Read back the written block and the ones around it.
+    for blk in WR_BLOCK_C - 1 to WR_BLOCK_C + DEPTH_G + 1 loop
+      ReadBlock(blk);
+    end loop;
+
+    report "DEPTH_G = " & integer'image(DEPTH_G) & ", HOST_GAP_G = " & time'image(HOST_GAP_G) & ": read "
+      & MBytesPerSec(rdTime_v) & " MB/s, " & integer'image(errors_v) & " bad bytes.";
+    assert errors_v = 0 report "Some bytes read back wrong." severity error;
+
+    simDone_s <= true;
+    wait;
+  end process;
+
+end architecture;
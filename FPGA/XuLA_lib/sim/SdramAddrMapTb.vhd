@@ -0,0 +1,291 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Benchmark for the SdramCntl address maps.
+--
+-- NUM_WORDS_G single words are written and then read back and checked using one of three
+-- address patterns picked by PATTERN_G:
+--   0 = linear:  consecutive addresses.
+--   1 = strided: down the columns of a framebuffer with a line pitch of STRIDE_G words, so
+--                consecutive accesses are STRIDE_G words apart.
+--   2 = random:  addresses picked at random from the whole SDRAM.
+-- The sustained write and read rates in MB/s are reported along with the row hits, row
+-- misses and bank conflicts from the controller's performance counters.
+--
+-- Run each pattern with ADDR_MAP_G set to BANK_ROW_COL_C (0), ROW_BANK_COL_C (1) and
+-- ROW_BANK_COL_XOR_C (2) to compare them. The address maps only pay off when more than one
+-- row can be open, so keep MULTIPLE_ACTIVE_ROWS_G true and use LOOKAHEAD_G to let the bank
+-- scheduler open the next row while the current one is busy.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use IEEE.MATH_REAL.all;
+use work.CommonPckg.all;
+use work.SdramCntlPckg.all;
+use work.SdramModelPckg.all;
+
+entity SdramAddrMapTb is
+  generic (
+    FREQ_G                 : real    := 100.0;  -- Clock frequency in MHz.
+    ADDR_MAP_G             : natural := ROW_BANK_COL_XOR_C;  -- Address map of the controller under test.
+    PATTERN_G              : natural := 1;  -- Address pattern: 0 = linear, 1 = strided, 2 = random.
+    STRIDE_G               : natural := 2048;  -- Framebuffer line pitch in words for the strided pattern.
+    PIPE_EN_G              : boolean := true;  -- Pipelined reads in the controller.
+    MULTIPLE_ACTIVE_ROWS_G : boolean := true;  -- Keep a row open in each bank.
+    LOOKAHEAD_G            : natural := 4;  -- Depth of the bank scheduler queue (0 = none).
+    NUM_WORDS_G            : natural := 8192  -- Number of words to write and then read.
+    );
+end entity;
+
+
+architecture arch of SdramAddrMapTb is
+  constant CLK_PERIOD_C  : time    := 1 us / FREQ_G;
+  constant NROWS_C       : natural := 4096;
+  constant NCOLS_C       : natural := 512;
+  constant HADDR_WIDTH_C : natural := 23;
+  constant SADDR_WIDTH_C : natural := 12;
+  constant DATA_WIDTH_C  : natural := 16;
+  constant LINES_C       : natural := 64;  -- Lines in the framebuffer for the strided pattern.
+
+  constant LINEAR_C  : natural := 0;
+  constant STRIDED_C : natural := 1;
+  constant RANDOM_C  : natural := 2;
+
+  signal clk_s       : std_logic                                              := LO;
+  signal rd_s        : std_logic                                              := NO;
+  signal wr_s        : std_logic                                              := NO;
+  signal begun_s     : std_logic;
+  signal rdDone_s    : std_logic;
+  signal addr_s      : std_logic_vector(HADDR_WIDTH_C-1 downto 0)             := (others => ZERO);
+  signal dataIn_s    : std_logic_vector(DATA_WIDTH_C-1 downto 0)              := (others => ZERO);
+  signal dataOut_s   : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal perfClear_s : std_logic                                              := NO;
+  signal perf_s      : std_logic_vector(NUM_PERF_CNTRS_C*PERF_CNTR_LENGTH_C-1 downto 0);
+  signal sdCke_s     : std_logic;
+  signal sdCe_bs     : std_logic;
+  signal sdRas_bs    : std_logic;
+  signal sdCas_bs    : std_logic;
+  signal sdWe_bs     : std_logic;
+  signal sdBs_s      : std_logic_vector(1 downto 0);
+  signal sdAddr_s    : std_logic_vector(SADDR_WIDTH_C-1 downto 0);
+  signal sdData_s    : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal sdDqmh_s    : std_logic;
+  signal sdDqml_s    : std_logic;
+  signal rfshes_s    : natural;
+  signal rdWords_s   : natural                                                := 0;  -- Number of words read back so far.
+  signal rdErrors_s  : natural                                                := 0;
+  signal lastRd_s    : time                                                   := 0 ns;  -- When the last word came back.
+  signal simDone_s   : boolean                                                := false;
+
+  -- The value written to each address.
+  function Pattern(addr : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(((addr mod 65536) * 251 + addr / 65536 + 16#5A5A#) mod 65536, DATA_WIDTH_C));
+  end function;
+
+  -- The address of the k'th word in the pattern. The random pattern needs the same seeds
+  -- to give the same addresses again.
+  procedure NextAddr(k : in natural; s1, s2 : inout positive; addr : out natural) is
+    variable r_v : real;
+  begin
+    case PATTERN_G is
+      when LINEAR_C =>
+        addr := k;
+      when STRIDED_C =>
+        addr := (k mod LINES_C) * STRIDE_G + k / LINES_C;
+      when others =>
+        uniform(s1, s2, r_v);
+        addr := integer(trunc(r_v * real(2**HADDR_WIDTH_C)));
+    end case;
+  end procedure;
+
+  -- Get one of the performance counters.
+  function PerfCntr(perf : std_logic_vector; n : natural) return natural is
+  begin
+    return to_integer(unsigned(perf((n+1)*PERF_CNTR_LENGTH_C-1 downto n*PERF_CNTR_LENGTH_C)));
+  end function;
+begin
+
+  clk_s <= not clk_s after CLK_PERIOD_C / 2 when not simDone_s else clk_s;
+
+  UDut : SdramCntl
+    generic map (
+      FREQ_G                 => FREQ_G,
+      PIPE_EN_G              => PIPE_EN_G,
+      MULTIPLE_ACTIVE_ROWS_G => MULTIPLE_ACTIVE_ROWS_G,
+      LOOKAHEAD_G            => LOOKAHEAD_G,
+      PERF_CNTRS_G           => true,
+      ADDR_MAP_G             => ADDR_MAP_G,
+      NROWS_G                => NROWS_C,
+      NCOLS_G                => NCOLS_C,
+      HADDR_WIDTH_G          => HADDR_WIDTH_C,
+      SADDR_WIDTH_G          => SADDR_WIDTH_C
+      )
+    port map (
+      clk_i          => clk_s,
+      rd_i           => rd_s,
+      wr_i           => wr_s,
+      earlyOpBegun_o => begun_s,
+      rdDone_o       => rdDone_s,
+      addr_i         => addr_s,
+      data_i         => dataIn_s,
+      data_o         => dataOut_s,
+      perfClear_i    => perfClear_s,
+      perfCntrs_o    => perf_s,
+      sdCke_o        => sdCke_s,
+      sdCe_bo        => sdCe_bs,
+      sdRas_bo       => sdRas_bs,
+      sdCas_bo       => sdCas_bs,
+      sdWe_bo        => sdWe_bs,
+      sdBs_o         => sdBs_s,
+      sdAddr_o       => sdAddr_s,
+      sdData_io      => sdData_s,
+      sdDqmh_o       => sdDqmh_s,
+      sdDqml_o       => sdDqml_s
+      );
+
+  USdram : SdramModel
+    generic map (
+      NROWS_G         => NROWS_C,
+      NCOLS_G         => NCOLS_C,
+      SADDR_WIDTH_G   => SADDR_WIDTH_C,
+      DATA_WIDTH_G    => DATA_WIDTH_C,
+      MAX_RFSH_DEBT_G => 1
+      )
+    port map (
+      clk_i    => clk_s,
+      cke_i    => sdCke_s,
+      ce_bi    => sdCe_bs,
+      ras_bi   => sdRas_bs,
+      cas_bi   => sdCas_bs,
+      we_bi    => sdWe_bs,
+      ba_i     => sdBs_s,
+      addr_i   => sdAddr_s,
+      data_io  => sdData_s,
+      dqmh_i   => sdDqmh_s,
+      dqml_i   => sdDqml_s,
+      rfshes_o => rfshes_s
+      );
+
+  -- Check the words as they come back. Reads finish in the order they were requested
+  -- so the addresses can be generated again here.
+  process(clk_s)
+    variable s1_v   : positive := 1;
+    variable s2_v   : positive := 2;
+    variable addr_v : natural;
+  begin
+    if rising_edge(clk_s) then
+      if rdDone_s = YES then
+        NextAddr(rdWords_s, s1_v, s2_v, addr_v);
+        if dataOut_s /= Pattern(addr_v) then
+          if rdErrors_s = 0 then
+            report "Address " & integer'image(addr_v) & " read back wrong." severity error;
+          end if;
+          rdErrors_s <= rdErrors_s + 1;
+        end if;
+        rdWords_s <= rdWords_s + 1;
+        lastRd_s  <= now;
+      end if;
+    end if;
+  end process;
+
+  -- Write all the words and then read them back.
+  process
+    variable s1_v     : positive;
+    variable s2_v     : positive;
+    variable addr_v   : natural;
+    variable k_v      : natural;
+    variable start_v  : time;
+    variable wrTime_v : time;
+    variable rdTime_v : time;
+
+    -- Rate in MB/s for moving NUM_WORDS_G words in the given time.
+    function MBytesPerSec(t : time) return integer is
+    begin
+      return integer(real(NUM_WORDS_G * DATA_WIDTH_C / 8) / real(t / 1 ns) * 1000.0);
+    end function;
+
+    procedure ReportCntrs(phase : string) is
+    begin
+      report phase & ": " & integer'image(PerfCntr(perf_s, ROW_HITS_C)) & " row hits, "
+        & integer'image(PerfCntr(perf_s, ROW_MISSES_C)) & " row misses, "
+        & integer'image(PerfCntr(perf_s, BANK_CONFLICTS_C)) & " bank conflicts.";
+    end procedure;
+
+  begin
+    for phase in 0 to 1 loop            -- 0 = write, 1 = read.
+      s1_v := 1;
+      s2_v := 2;
+      k_v  := 0;
+      NextAddr(k_v, s1_v, s2_v, addr_v);
+      while k_v < NUM_WORDS_G loop
+        -- Keep the request up and move on to the next address each time one is taken.
+        addr_s   <= std_logic_vector(to_unsigned(addr_v, addr_s'length));
+        dataIn_s <= Pattern(addr_v);
+        if phase = 0 then
+          wr_s <= YES;
+        else
+          rd_s <= YES;
+        end if;
+        wait until rising_edge(clk_s);
+        if begun_s = YES then
+          if k_v = 0 then
+            start_v := now;
+          end if;
+          k_v := k_v + 1;
+          if k_v < NUM_WORDS_G then
+            NextAddr(k_v, s1_v, s2_v, addr_v);
+          end if;
+        end if;
+      end loop;
+      wr_s <= NO;
+      rd_s <= NO;
+
+      if phase = 0 then
+        wrTime_v := now - start_v;
+        for i in 1 to 50 loop           -- Let the queued writes finish.
+          wait until rising_edge(clk_s);
+        end loop;
+        ReportCntrs("Write");
+      else
+        if rdWords_s /= NUM_WORDS_G then
+          wait until rdWords_s = NUM_WORDS_G;
+        end if;
+        rdTime_v := lastRd_s - start_v + CLK_PERIOD_C;
+        ReportCntrs("Read");
+      end if;
+
+      -- Clear the counters for the next phase.
+      perfClear_s <= YES;
+      wait until rising_edge(clk_s);
+      perfClear_s <= NO;
+    end loop;
+
+    report "ADDR_MAP_G = " & integer'image(ADDR_MAP_G) & ", PATTERN_G = " & integer'image(PATTERN_G)
+      & ", LOOKAHEAD_G = " & integer'image(LOOKAHEAD_G) & ": write " & integer'image(MBytesPerSec(wrTime_v))
+      & " MB/s, read " & integer'image(MBytesPerSec(rdTime_v)) & " MB/s, "
+      & integer'image(rdErrors_s) & " errors.";
+    assert rdErrors_s = 0 report "Some words read back wrong." severity error;
+
+    simDone_s <= true;
+    wait;
+  end process;
+
+end architecture;
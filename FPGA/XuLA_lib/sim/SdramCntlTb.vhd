@@ -0,0 +1,239 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Testbench for SdramCntl burst reads and writes.
+--
+-- NUM_WORDS_G words are written to consecutive addresses in bursts of HOST_BURST_G words,
+-- and then they're read back the same way and checked. The SDRAM runs bursts of BURST_LEN_G
+-- words. The sustained write and read rates are reported in MB/s along with the number of
+-- refreshes that were done. The host side acts like any burst client should: it keeps its
+-- request up until every word has gotten a beat, and it moves the address and length along
+-- with each beat so a burst that gets cut short for a refresh picks up where it left off.
+--
+-- Try it with BURST_LEN_G = 1, 2, 4, 8 and 512 (a full page) to see what the longer SDRAM
+-- bursts buy, and with RFSH_POSTPONE_G to see what putting off refreshes does. SdramModel
+-- checks the SDRAM timing and that no more refreshes are owed than RFSH_POSTPONE_G allows.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use work.CommonPckg.all;
+use work.SdramCntlPckg.all;
+use work.SdramModelPckg.all;
+
+entity SdramCntlTb is
+  generic (
+    FREQ_G          : real    := 100.0;  -- Clock frequency in MHz.
+    BURST_LEN_G     : natural := 8;      -- SDRAM burst length: 1, 2, 4, 8 or 512.
+    HOST_BURST_G    : natural := 64;     -- Words in each host burst (a power of 2 no bigger than 512).
+    RFSH_POSTPONE_G : natural := 0;      -- Refreshes the controller can put off while busy.
+    NUM_WORDS_G     : natural := 65536   -- Number of words to write and then read.
+    );
+end entity;
+
+
+architecture arch of SdramCntlTb is
+  constant CLK_PERIOD_C  : time    := 1 us / FREQ_G;
+  constant NROWS_C       : natural := 4096;
+  constant NCOLS_C       : natural := 512;
+  constant HADDR_WIDTH_C : natural := 23;
+  constant SADDR_WIDTH_C : natural := 12;
+  constant DATA_WIDTH_C  : natural := 16;
+
+  signal clk_s       : std_logic                                    := LO;
+  signal rd_s        : std_logic                                    := NO;
+  signal wr_s        : std_logic                                    := NO;
+  signal burstLen_s  : std_logic_vector(Log2(NCOLS_C) downto 0)     := (0 => ONE, others => ZERO);
+  signal beat_s      : std_logic;
+  signal rdDone_s    : std_logic;
+  signal addr_s      : std_logic_vector(HADDR_WIDTH_C-1 downto 0)   := (others => ZERO);
+  signal dataIn_s    : std_logic_vector(DATA_WIDTH_C-1 downto 0)    := (others => ZERO);
+  signal dataOut_s   : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal sdCke_s     : std_logic;
+  signal sdCe_bs     : std_logic;
+  signal sdRas_bs    : std_logic;
+  signal sdCas_bs    : std_logic;
+  signal sdWe_bs     : std_logic;
+  signal sdBs_s      : std_logic_vector(1 downto 0);
+  signal sdAddr_s    : std_logic_vector(SADDR_WIDTH_C-1 downto 0);
+  signal sdData_s    : std_logic_vector(DATA_WIDTH_C-1 downto 0);
+  signal sdDqmh_s    : std_logic;
+  signal sdDqml_s    : std_logic;
+  signal rfshes_s    : natural;
+  signal rdWords_s   : natural := 0;  -- Number of words read back so far.
+  signal rdErrors_s  : natural := 0;
+  signal lastRd_s    : time    := 0 ns;  -- When the last word came back.
+  signal simDone_s   : boolean := false;
+
+  -- The value written to each address.
+  function Pattern(addr : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(((addr mod 65536) * 251 + addr / 65536 + 16#5A5A#) mod 65536, DATA_WIDTH_C));
+  end function;
+begin
+
+  clk_s <= not clk_s after CLK_PERIOD_C / 2 when not simDone_s else clk_s;
+
+  UDut : SdramCntl
+    generic map (
+      FREQ_G          => FREQ_G,
+      RFSH_POSTPONE_G => RFSH_POSTPONE_G,
+      BURST_LEN_G     => BURST_LEN_G,
+      NROWS_G         => NROWS_C,
+      NCOLS_G         => NCOLS_C,
+      HADDR_WIDTH_G   => HADDR_WIDTH_C,
+      SADDR_WIDTH_G   => SADDR_WIDTH_C
+      )
+    port map (
+      clk_i      => clk_s,
+      rd_i       => rd_s,
+      wr_i       => wr_s,
+      burstLen_i => burstLen_s,
+      beat_o     => beat_s,
+      rdDone_o   => rdDone_s,
+      addr_i     => addr_s,
+      data_i     => dataIn_s,
+      data_o     => dataOut_s,
+      sdCke_o    => sdCke_s,
+      sdCe_bo    => sdCe_bs,
+      sdRas_bo   => sdRas_bs,
+      sdCas_bo   => sdCas_bs,
+      sdWe_bo    => sdWe_bs,
+      sdBs_o     => sdBs_s,
+      sdAddr_o   => sdAddr_s,
+      sdData_io  => sdData_s,
+      sdDqmh_o   => sdDqmh_s,
+      sdDqml_o   => sdDqml_s
+      );
+
+  USdram : SdramModel
+    generic map (
+      NROWS_G         => NROWS_C,
+      NCOLS_G         => NCOLS_C,
+      SADDR_WIDTH_G   => SADDR_WIDTH_C,
+      DATA_WIDTH_G    => DATA_WIDTH_C,
+      MAX_RFSH_DEBT_G => RFSH_POSTPONE_G + 1
+      )
+    port map (
+      clk_i    => clk_s,
+      cke_i    => sdCke_s,
+      ce_bi    => sdCe_bs,
+      ras_bi   => sdRas_bs,
+      cas_bi   => sdCas_bs,
+      we_bi    => sdWe_bs,
+      ba_i     => sdBs_s,
+      addr_i   => sdAddr_s,
+      data_io  => sdData_s,
+      dqmh_i   => sdDqmh_s,
+      dqml_i   => sdDqml_s,
+      rfshes_o => rfshes_s
+      );
+
+  -- Check the words as they come back. Reads finish in the order they were requested.
+  process(clk_s)
+  begin
+    if rising_edge(clk_s) then
+      if rdDone_s = YES then
+        if dataOut_s /= Pattern(rdWords_s) then
+          if rdErrors_s = 0 then
+            report "Address " & integer'image(rdWords_s) & " read back wrong." severity error;
+          end if;
+          rdErrors_s <= rdErrors_s + 1;
+        end if;
+        rdWords_s <= rdWords_s + 1;
+        lastRd_s  <= now;
+      end if;
+    end if;
+  end process;
+
+  -- Write all the words and then read them back.
+  process
+    variable done_v   : natural;  -- Words that have gotten a beat.
+    variable issued_v : natural;  -- Words of the current host burst that have gotten a beat.
+    variable len_v    : natural;
+    variable start_v  : time;
+    variable wrTime_v : time;
+    variable rdTime_v : time;
+    variable rfshes_v : natural;
+
+    -- Rate in MB/s for moving NUM_WORDS_G words in the given time.
+    function MBytesPerSec(t : time) return integer is
+    begin
+      return integer(real(NUM_WORDS_G * DATA_WIDTH_C / 8) / real(t / 1 ns) * 1000.0);
+    end function;
+
+  begin
+    for phase in 0 to 1 loop            -- 0 = write, 1 = read.
+      done_v   := 0;
+      rfshes_v := rfshes_s;
+      while done_v < NUM_WORDS_G loop
+        len_v    := HOST_BURST_G;
+        if NUM_WORDS_G - done_v < len_v then
+          len_v := NUM_WORDS_G - done_v;
+        end if;
+        issued_v := 0;
+        while issued_v < len_v loop
+          -- Keep asking for the words that are left. The next word to write goes on
+          -- data_i the cycle after the controller takes the previous one.
+          addr_s     <= std_logic_vector(to_unsigned(done_v + issued_v, addr_s'length));
+          burstLen_s <= std_logic_vector(to_unsigned(len_v - issued_v, burstLen_s'length));
+          dataIn_s   <= Pattern(done_v + issued_v);
+          if phase = 0 then
+            wr_s <= YES;
+          else
+            rd_s <= YES;
+          end if;
+          wait until rising_edge(clk_s);
+          if beat_s = YES then
+            if done_v = 0 and issued_v = 0 then
+              start_v := now;
+            end if;
+            issued_v := issued_v + 1;
+          end if;
+        end loop;
+        done_v := done_v + len_v;
+        wr_s   <= NO;
+        rd_s   <= NO;
+      end loop;
+
+      if phase = 0 then
+        wrTime_v := now - start_v;
+        report "Wrote " & integer'image(NUM_WORDS_G) & " words at " & integer'image(MBytesPerSec(wrTime_v))
+          & " MB/s with " & integer'image(rfshes_s - rfshes_v) & " refreshes.";
+      else
+        if rdWords_s /= NUM_WORDS_G then
+          wait until rdWords_s = NUM_WORDS_G;
+        end if;
+        rdTime_v := lastRd_s - start_v + CLK_PERIOD_C;
+        report "Read " & integer'image(NUM_WORDS_G) & " words at " & integer'image(MBytesPerSec(rdTime_v))
+          & " MB/s with " & integer'image(rfshes_s - rfshes_v) & " refreshes and "
+          & integer'image(rdErrors_s) & " errors.";
+      end if;
+    end loop;
+
+    report "BURST_LEN_G = " & integer'image(BURST_LEN_G) & ", HOST_BURST_G = " & integer'image(HOST_BURST_G)
+      & ", RFSH_POSTPONE_G = " & integer'image(RFSH_POSTPONE_G) & ": write " & integer'image(MBytesPerSec(wrTime_v))
+      & " MB/s, read " & integer'image(MBytesPerSec(rdTime_v)) & " MB/s";
+    assert rdErrors_s = 0 report "Some words read back wrong." severity error;
+
+    simDone_s <= true;
+    wait;
+  end process;
+
+end architecture;
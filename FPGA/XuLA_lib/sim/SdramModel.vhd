@@ -0,0 +1,339 @@
+--**********************************************************************
+-- Copyright 2013 by XESS Corp <http://www.xess.com>.
+-- This program is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU General Public License as published by
+-- the Free Software Foundation, either version 3 of the License, or
+-- (at your option) any later version.
+--
+-- This program is distributed in the hope that it will be useful,
+-- but WITHOUT ANY WARRANTY; without even the implied warranty of
+-- MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+-- GNU General Public License for more details.
+--
+-- You should have received a copy of the GNU General Public License
+-- along with this program.  If not, see <http://www.gnu.org/licenses/>.
+--**********************************************************************
+
+
+--**************************************************************************************************
+-- Simulation model of a four-bank SDR SDRAM like the one on the XuLA board.
+--
+-- It does ACTIVE, READ, WRITE, BURST STOP, PRECHARGE (one or all banks), AUTO REFRESH and
+-- LOAD MODE REGISTER, with sequential bursts of 1, 2, 4, 8 words or a full page. Write words
+-- are masked by DQMH/DQML. Read data comes out CAS latency cycles after the READ is sampled.
+-- Nothing happens while CKE is low (self-refresh).
+--
+-- The model checks the things a controller is most likely to get wrong and reports them as
+-- errors: reads/writes to a bank with no open row, activating an open bank, the tRCD, tRAS,
+-- tRP and tRFC intervals, refreshing with a bank open, read data colliding with the controller
+-- driving the databus, and letting more than MAX_RFSH_DEBT_G refreshes come due without doing them.
+--
+-- A word that's never been written reads back as all U's.
+--**************************************************************************************************
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+
+package SdramModelPckg is
+
+  component SdramModel is
+    generic (
+      NROWS_G         : natural := 4096;  -- Number of rows in each bank.
+      NCOLS_G         : natural := 512;   -- Number of columns in each row.
+      SADDR_WIDTH_G   : natural := 12;    -- Width of the SDRAM address bus.
+      DATA_WIDTH_G    : natural := 16;    -- Width of the SDRAM databus.
+      T_AC_G          : time    := 5 ns;  -- Clock to read data valid.
+      T_OH_G          : time    := 2 ns;  -- Read data hold time after the next clock.
+      T_RAS_G         : time    := 45 ns;  -- Min interval between ACTIVE and PRECHARGE.
+      T_RCD_G         : time    := 20 ns;  -- Min interval between ACTIVE and READ/WRITE.
+      T_RP_G          : time    := 20 ns;  -- Min interval between PRECHARGE and ACTIVE/REFRESH.
+      T_RFC_G         : time    := 65 ns;  -- Min interval between REFRESH and the next command.
+      T_REF_G         : time    := 64 ms;  -- Every row has to be refreshed this often.
+      MAX_RFSH_DEBT_G : natural := 9      -- Most refreshes that can be owed at any time (8 postponed + 1).
+      );
+    port (
+      clk_i    : in    std_logic;
+      cke_i    : in    std_logic;
+      ce_bi    : in    std_logic;
+      ras_bi   : in    std_logic;
+      cas_bi   : in    std_logic;
+      we_bi    : in    std_logic;
+      ba_i     : in    std_logic_vector(1 downto 0);
+      addr_i   : in    std_logic_vector(SADDR_WIDTH_G-1 downto 0);
+      data_io  : inout std_logic_vector(DATA_WIDTH_G-1 downto 0);
+      dqmh_i   : in    std_logic;
+      dqml_i   : in    std_logic;
+      rfshes_o : out   natural  -- Number of refreshes done so far.
+      );
+  end component;
+
+end package;
+
+
+
+
+library IEEE;
+use IEEE.STD_LOGIC_1164.all;
+use IEEE.NUMERIC_STD.all;
+use work.CommonPckg.all;
+
+entity SdramModel is
+  generic (
+    NROWS_G         : natural := 4096;
+    NCOLS_G         : natural := 512;
+    SADDR_WIDTH_G   : natural := 12;
+    DATA_WIDTH_G    : natural := 16;
+    T_AC_G          : time    := 5 ns;
+    T_OH_G          : time    := 2 ns;
+    T_RAS_G         : time    := 45 ns;
+    T_RCD_G         : time    := 20 ns;
+    T_RP_G          : time    := 20 ns;
+    T_RFC_G         : time    := 65 ns;
+    T_REF_G         : time    := 64 ms;
+    MAX_RFSH_DEBT_G : natural := 9
+    );
+  port (
+    clk_i    : in    std_logic;
+    cke_i    : in    std_logic;
+    ce_bi    : in    std_logic;
+    ras_bi   : in    std_logic;
+    cas_bi   : in    std_logic;
+    we_bi    : in    std_logic;
+    ba_i     : in    std_logic_vector(1 downto 0);
+    addr_i   : in    std_logic_vector(SADDR_WIDTH_G-1 downto 0);
+    data_io  : inout std_logic_vector(DATA_WIDTH_G-1 downto 0);
+    dqmh_i   : in    std_logic;
+    dqml_i   : in    std_logic;
+    rfshes_o : out   natural := 0
+    );
+end entity;
+
+
+architecture arch of SdramModel is
+  constant NBANKS_C       : natural := 4;
+  constant COL_LEN_C      : natural := Log2(NCOLS_G);
+  constant MAX_CAS_C      : natural := 3;
+  constant UNWRITTEN_C    : integer := -1;  -- Value of a word that's never been written.
+  constant REF_INTERVAL_C : time    := T_REF_G / NROWS_G;  -- A refresh comes due this often.
+
+  type Mem_t is array (natural range <>) of integer;
+  type MemPtr_t is access Mem_t;  -- The array is too big for the stack, so it goes on the heap.
+  type BankTimes_t is array (0 to NBANKS_C-1) of time;
+  type BankRows_t is array (0 to NBANKS_C-1) of natural;
+  type RdPipe_t is array (1 to MAX_CAS_C) of integer;
+  type RdValid_t is array (1 to MAX_CAS_C) of boolean;
+
+  signal drive_s : boolean := false;  -- True while the model is driving read data.
+begin
+
+  process
+    variable mem_v        : MemPtr_t    := new Mem_t'(0 to NBANKS_C*NROWS_G*NCOLS_G-1 => UNWRITTEN_C);
+    variable open_v       : std_logic_vector(0 to NBANKS_C-1) := (others => NO);
+    variable row_v        : BankRows_t  := (others => 0);
+    variable actTime_v    : BankTimes_t := (others => -1 sec);
+    variable pchgTime_v   : BankTimes_t := (others => -1 sec);
+    variable rfshTime_v   : time        := -1 sec;
+    variable cas_v        : natural     := 3;
+    variable burstLen_v   : natural     := 1;
+    -- The burst in progress.
+    variable burst_v      : boolean     := false;
+    variable burstWr_v    : boolean     := false;
+    variable burstBank_v  : natural     := 0;
+    variable burstStart_v : natural     := 0;
+    variable burstCnt_v   : natural     := 0;
+    -- Read words on their way out to the databus.
+    variable rdPipe_v     : RdPipe_t    := (others => UNWRITTEN_C);
+    variable rdValid_v    : RdValid_t   := (others => false);
+    -- Refresh bookkeeping.
+    variable rfshes_v     : natural     := 0;
+    variable initDone_v   : boolean     := false;  -- Refreshes start coming due once the mode is set.
+    variable nextDue_v    : time        := REF_INTERVAL_C;
+    variable debt_v       : natural     := 0;
+    variable cmd_v        : std_logic_vector(2 downto 0);
+    variable bank_v       : natural;
+    variable newBurst_v   : boolean;
+
+    -- Column of the Nth word of a sequential burst.
+    function BurstCol(start : natural; n : natural; len : natural) return natural is
+    begin
+      if len >= NCOLS_G then
+        return (start + n) mod NCOLS_G;
+      end if;
+      return (start - start mod len) + (start + n) mod len;
+    end function;
+
+    -- Read or write the next word of the burst.
+    procedure BurstWord is
+      variable index_v : natural;
+      variable word_v  : std_logic_vector(DATA_WIDTH_G-1 downto 0);
+    begin
+      index_v := (burstBank_v*NROWS_G + row_v(burstBank_v))*NCOLS_G + BurstCol(burstStart_v, burstCnt_v, burstLen_v);
+      if burstWr_v then
+        if dqml_i = LO or dqmh_i = LO then  -- Only the bytes that aren't masked get written.
+          word_v := (others => ZERO);
+          if mem_v(index_v) /= UNWRITTEN_C then
+            word_v := std_logic_vector(to_unsigned(mem_v(index_v), DATA_WIDTH_G));
+          end if;
+          if dqml_i = LO then
+            word_v(7 downto 0) := data_io(7 downto 0);
+          end if;
+          if dqmh_i = LO then
+            word_v(DATA_WIDTH_G-1 downto 8) := data_io(DATA_WIDTH_G-1 downto 8);
+          end if;
+          assert not Is_X(word_v) report "SdramModel: writing an unknown value." severity error;
+          if not Is_X(word_v) then
+            mem_v(index_v) := to_integer(unsigned(word_v));
+          end if;
+        end if;
+      else
+        rdPipe_v(cas_v)  := mem_v(index_v);
+        rdValid_v(cas_v) := true;
+      end if;
+      burstCnt_v := burstCnt_v + 1;
+      if burstCnt_v = burstLen_v and burstLen_v < NCOLS_G then
+        burst_v := false;  -- Only full-page bursts go on until something stops them.
+      end if;
+    end procedure;
+
+  begin
+    wait until rising_edge(clk_i);
+
+    -- Keep track of how many refreshes are owed once the SDRAM is initialized.
+    while initDone_v and now >= nextDue_v loop
+      debt_v    := debt_v + 1;
+      nextDue_v := nextDue_v + REF_INTERVAL_C;
+    end loop;
+
+    -- Shift the read data pipeline. The word that reaches the end is driven onto the databus
+    -- so it's there for the controller at the next rising edge.
+    for i in 1 to MAX_CAS_C-1 loop
+      rdPipe_v(i)  := rdPipe_v(i+1);
+      rdValid_v(i) := rdValid_v(i+1);
+    end loop;
+    rdValid_v(MAX_CAS_C) := false;
+
+    if cke_i = LO then
+      -- Self-refresh takes care of the refreshes and nothing else happens while CKE is low.
+      debt_v  := 0;
+      burst_v := false;
+
+    else
+      cmd_v      := ras_bi & cas_bi & we_bi;
+      bank_v     := to_integer(unsigned(ba_i));
+      newBurst_v := false;
+      if ce_bi = HI then
+        cmd_v := "111";                 -- The chip isn't selected, so it's a NOP.
+      end if;
+
+      case cmd_v is
+
+        when "011" =>                   -- ACTIVE
+          assert open_v(bank_v) = NO report "SdramModel: activating a bank that's already open." severity error;
+          assert now - pchgTime_v(bank_v) >= T_RP_G report "SdramModel: tRP violated by ACTIVE." severity error;
+          assert now - rfshTime_v >= T_RFC_G report "SdramModel: tRFC violated by ACTIVE." severity error;
+          open_v(bank_v)    := YES;
+          row_v(bank_v)     := to_integer(unsigned(addr_i)) mod NROWS_G;
+          actTime_v(bank_v) := now;
+
+        when "101" | "100" =>           -- READ or WRITE ends any burst in progress and starts another.
+          assert open_v(bank_v) = YES report "SdramModel: read/write of a bank with no open row." severity error;
+          assert now - actTime_v(bank_v) >= T_RCD_G report "SdramModel: tRCD violated." severity error;
+          assert addr_i(10) = LO report "SdramModel: auto-precharge isn't modeled." severity warning;
+          burst_v := false;
+          if open_v(bank_v) = YES then
+            burst_v      := true;
+            newBurst_v   := true;
+            burstWr_v    := cmd_v(0) = LO;
+            burstBank_v  := bank_v;
+            burstStart_v := to_integer(unsigned(addr_i(COL_LEN_C-1 downto 0)));
+            burstCnt_v   := 0;
+            BurstWord;  -- The first word of the burst goes with the command.
+          end if;
+
+        when "110" =>                   -- BURST STOP
+          burst_v := false;
+
+        when "010" =>                   -- PRECHARGE
+          for b in 0 to NBANKS_C-1 loop
+            if addr_i(10) = HI or b = bank_v then
+              if open_v(b) = YES then
+                assert now - actTime_v(b) >= T_RAS_G report "SdramModel: tRAS violated by PRECHARGE." severity error;
+              end if;
+              open_v(b)     := NO;
+              pchgTime_v(b) := now;
+              if burstBank_v = b then
+                burst_v := false;
+              end if;
+            end if;
+          end loop;
+
+        when "001" =>                   -- AUTO REFRESH
+          assert open_v = "0000" report "SdramModel: refreshing with a bank open." severity error;
+          for b in 0 to NBANKS_C-1 loop
+            assert now - pchgTime_v(b) >= T_RP_G report "SdramModel: tRP violated by REFRESH." severity error;
+          end loop;
+          assert now - rfshTime_v >= T_RFC_G report "SdramModel: tRFC violated by REFRESH." severity error;
+          rfshTime_v := now;
+          rfshes_v   := rfshes_v + 1;
+          rfshes_o   <= rfshes_v;
+          if debt_v /= 0 then
+            debt_v := debt_v - 1;
+          end if;
+
+        when "000" =>                   -- LOAD MODE REGISTER
+          cas_v := to_integer(unsigned(addr_i(6 downto 4)));
+          case addr_i(2 downto 0) is
+            when "000"  => burstLen_v := 1;
+            when "001"  => burstLen_v := 2;
+            when "010"  => burstLen_v := 4;
+            when "011"  => burstLen_v := 8;
+            when others => burstLen_v := NCOLS_G;
+          end case;
+          if not initDone_v then
+            initDone_v := true;
+            nextDue_v  := now + REF_INTERVAL_C;
+          end if;
+          assert cas_v = 2 or cas_v = 3 report "SdramModel: only CAS latencies of 2 and 3 are modeled." severity failure;
+
+        when others =>                  -- NOP
+          null;
+      end case;
+
+      -- Any other command lets a burst that's already going continue with its next word.
+      if burst_v and not newBurst_v then
+        BurstWord;
+      end if;
+    end if;
+
+    assert debt_v <= MAX_RFSH_DEBT_G
+      report "SdramModel: " & integer'image(debt_v) & " refreshes are owed." severity error;
+    if debt_v > MAX_RFSH_DEBT_G then
+      debt_v := MAX_RFSH_DEBT_G;  -- Don't keep reporting the same shortfall.
+    end if;
+
+    -- Drive the word that comes out at the end of the pipeline, or let go of the databus.
+    if rdValid_v(1) then
+      if rdPipe_v(1) = UNWRITTEN_C then
+        data_io <= transport (others => 'U') after T_AC_G;
+      else
+        data_io <= transport std_logic_vector(to_unsigned(rdPipe_v(1), DATA_WIDTH_G)) after T_AC_G;
+      end if;
+      drive_s <= transport true after T_AC_G;
+    else
+      data_io <= transport (others => 'Z') after T_OH_G;
+      drive_s <= transport false after T_OH_G;
+    end if;
+  end process;
+
+  -- The controller shouldn't be driving the databus while the SDRAM is.
+  process(data_io, drive_s)
+  begin
+    if drive_s then
+      for i in data_io'range loop
+        assert data_io(i) /= 'X'
+          report "SdramModel: the controller and the SDRAM are both driving the databus." severity error;
+      end loop;
+    end if;
+  end process;
+
+end architecture;
@@ -57,4 +57,14 @@ typedef enum
     RESET_CMD              = 0xff   // Cause a power-on reset.
 } USBCMD;
 
+// Definitions for JTAG_CMD
+#define JTAG_CMD_HDR_LEN 6                      // Command byte + 4-byte # of TCK pulses + flag byte.
+
+// Flag bits for JTAG_CMD
+#define GET_TDO_MASK 0x01                       // Set if gathering TDO bits.
+#define PUT_TMS_MASK 0x02                       // Set if TMS bits are included in the packets.
+#define TMS_VAL_MASK 0x04                       // Static value for TMS if PUT_TMS_MASK is cleared.
+#define PUT_TDI_MASK 0x08                       // Set if TDI bits are included in the packets.
+#define TDI_VAL_MASK 0x10                       // Static value for TDI if PUT_TDI_MASK is cleared.
+
 #endif
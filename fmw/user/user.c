@@ -121,16 +121,6 @@ typedef union DATA_PACKET
     };
 } DATA_PACKET;
 
-// Definitions for JTAG_CMD
-#define JTAG_CMD_HDR_LEN 6
-
-// Flag bits for JTAG_CMD
-#define GET_TDO_MASK 0x01                       // Set if gathering TDO bits.
-#define PUT_TMS_MASK 0x02                       // Set if TMS bits are included in the packets.
-#define TMS_VAL_MASK 0x04                       // Static value for TMS if PUT_TMS_MASK is cleared.
-#define PUT_TDI_MASK 0x08                       // Set if TDI bits are included in the packets.
-#define TDI_VAL_MASK 0x10                       // Static value for TDI if PUT_TDI_MASK is cleared.
-
 #define MIPS 12                         // Number of processor instructions per microsecond.
 #define MAX_BYTE_VAL 0xFF               // Maximum value that can be stored in a byte.
 #define NUM_ACTIVITY_BLINKS 10          // Indicate activity by blinking the LED this many times.
@@ -0,0 +1,345 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Host side of the HostIo modules in FPGA/XuLA_lib/HostIo.vhd.
+//
+//********************************************************************
+
+#include <chrono>
+#include "HostIo.h"
+
+namespace xula
+{
+
+#define IR_LENGTH        6              // Instruction register length of the Spartan-3A/6.
+#define ID_LENGTH        8              // Length of the HostIo module ID.
+#define PYLD_CNTR_LENGTH 32             // Length of the HostIo payload bit counter.
+#define OPCODE_LENGTH    2              // Length of the HostIoToRam opcode.
+#define PARAM_SIZE       16             // Length of the HostIoToRam size parameters.
+#define LIST_LEN_SIZE    16             // Length of the word count in a list descriptor.
+#define MAX_LIST_LEN     ( ( 1 << LIST_LEN_SIZE ) - 1 )
+
+
+void BitStream::Append( uint64_t value, unsigned len )
+{
+    for ( unsigned i = 0; i < len; i++, num_bits++ )
+    {
+        if ( num_bits % 8 == 0 )
+            bytes.push_back( 0 );
+        if ( ( value >> i ) & 1 )
+            bytes.back() |= 1 << ( num_bits % 8 );
+    }
+}
+
+
+void BitStream::Append( const BitStream &bits )
+{
+    if ( num_bits % 8 == 0 )
+    {
+        // Byte-aligned, so just tack on the bytes.
+        bytes.insert( bytes.end(), bits.bytes.begin(), bits.bytes.end() );
+        num_bits += bits.num_bits;
+        return;
+    }
+    for ( size_t i = 0; i < bits.num_bits; i++ )
+        Append( bits.Get( i, 1 ), 1 );
+}
+
+
+uint64_t BitStream::Get( size_t offset, unsigned len ) const
+{
+    uint64_t value = 0;
+    for ( unsigned i = 0; i < len && offset + i < num_bits; i++ )
+        if ( ( bytes[( offset + i ) / 8] >> ( ( offset + i ) % 8 ) ) & 1 )
+            value |= (uint64_t)1 << i;
+    return value;
+}
+
+
+BitStream BitStream::FromBytes( const Bytes &bytes, size_t num_bits )
+{
+    BitStream b;
+    b.bytes    = bytes;
+    b.num_bits = std::min( num_bits, bytes.size() * 8 );
+    b.bytes.resize( ( b.num_bits + 7 ) / 8 );
+    return b;
+}
+
+
+HostIoJtag::HostIoJtag( XulaJtag &jtag, unsigned user_instr )
+    : jtag( jtag ), user_instr( user_instr ), instr_loaded( false )
+{
+}
+
+
+void HostIoJtag::Reset()
+{
+    BitStream tms;
+    tms.Append( 0x1F, 6 );      // Five 1's get to Test-Logic-Reset from anywhere, then a 0 to Run-Test/Idle.
+    jtag.ShiftTms( tms.Data(), (uint32_t)tms.Size() );
+    instr_loaded = false;
+}
+
+
+void HostIoJtag::ShiftIr( unsigned instr )
+{
+    // Run-Test/Idle -> Select-DR -> Select-IR -> Capture-IR -> Shift-IR, shift the instruction
+    // (raising TMS on the last bit), then Exit1-IR -> Update-IR -> Run-Test/Idle.
+    BitStream tms, tdi;
+    tms.Append( 0x3, 4 );
+    tdi.Append( 0, 4 );
+    tms.Append( (uint64_t)1 << ( IR_LENGTH - 1 ), IR_LENGTH );
+    tdi.Append( instr, IR_LENGTH );
+    tms.Append( 0x1, 2 );
+    tdi.Append( 0, 2 );
+    jtag.Jtag( (uint32_t)tms.Size(), tms.Data().data(), false, tdi.Data().data(), false, false );
+}
+
+
+std::future<Bytes> HostIoJtag::ShiftDr( const BitStream &tdi, bool get_tdo )
+{
+    if ( !instr_loaded )
+    {
+        Reset();
+        ShiftIr( user_instr );
+        instr_loaded = true;
+    }
+
+    // Run-Test/Idle -> Select-DR -> Capture-DR -> Shift-DR.
+    BitStream to_shift;
+    to_shift.Append( 0x1, 3 );
+    jtag.ShiftTms( to_shift.Data(), (uint32_t)to_shift.Size() );
+
+    // Shift all but the last bit with TMS held low so only TDI bits go over USB.
+    std::future<Bytes> body;
+    size_t             n = tdi.Size();
+    if ( n > 1 )
+        body = jtag.ShiftTdi( tdi.Data(), (uint32_t)( n - 1 ), get_tdo );
+
+    // Shift the last bit with TMS high to reach Exit1-DR, then go through Update-DR to Run-Test/Idle.
+    BitStream last_tms, last_tdi;
+    last_tms.Append( 0x3, 3 );
+    last_tdi.Append( n ? tdi.Get( n - 1, 1 ) : 0, 3 );
+    std::future<Bytes> last = jtag.Jtag( 3, last_tms.Data().data(), false, last_tdi.Data().data(), false, get_tdo );
+
+    if ( !get_tdo )
+    {
+        std::promise<Bytes> none;
+        none.set_value( Bytes() );
+        return none.get_future();
+    }
+
+    // Stitch the TDO bits of the two shifts back together once they've arrived.
+    std::shared_future<Bytes> body_tdo = body.valid() ? body.share() : std::shared_future<Bytes>();
+    std::shared_future<Bytes> last_tdo = last.share();
+    return std::async( std::launch::deferred, [body_tdo, last_tdo, n] ()
+                       {
+                           BitStream bits;
+                           if ( body_tdo.valid() )
+                               bits = BitStream::FromBytes( body_tdo.get(), n - 1 );
+                           bits.Append( last_tdo.get()[0] & 1, 1 );
+                           return bits.Data();
+                       } );
+}
+
+
+RamAccess RamAccess::Write( uint32_t addr, const std::vector<uint32_t> &data )
+{
+    RamAccess a;
+    a.write     = true;
+    a.addr      = addr;
+    a.num_words = data.size();
+    a.data      = data;
+    return a;
+}
+
+
+RamAccess RamAccess::Read( uint32_t addr, size_t num_words )
+{
+    RamAccess a;
+    a.write     = false;
+    a.addr      = addr;
+    a.num_words = num_words;
+    return a;
+}
+
+
+HostIoRam::HostIoRam( HostIoJtag &jtag, uint8_t id )
+    : jtag( jtag ), id( id ), addr_width( 0 ), data_width( 0 ), has_drain_status( false )
+{
+}
+
+
+BitStream HostIoRam::Header( size_t num_payload_bits ) const
+{
+    BitStream hdr;
+    hdr.Append( id, ID_LENGTH );
+    hdr.Append( num_payload_bits, PYLD_CNTR_LENGTH );
+    return hdr;
+}
+
+
+bool HostIoRam::GetSize()
+{
+    // The parameters come back in the PARAM_SIZE bits after the opcode plus one cycle to load them.
+    size_t    num_payload_bits = OPCODE_LENGTH + 1 + PARAM_SIZE;
+    BitStream instr            = Header( num_payload_bits );
+    size_t    start            = instr.Size() + OPCODE_LENGTH + 1;
+    instr.Append( 1, OPCODE_LENGTH );   // SIZE_OPCODE_C
+    instr.Append( 0, num_payload_bits - OPCODE_LENGTH );
+
+    BitStream tdo   = BitStream::FromBytes( jtag.ShiftDr( instr, true ).get(), instr.Size() );
+    uint64_t  param = tdo.Get( start, PARAM_SIZE );
+    addr_width      = param & 0xFF;
+    data_width      = ( param >> ( PARAM_SIZE / 2 ) ) & 0xFF;
+    if ( addr_width == 0 || data_width == 0 )
+        return false;
+
+    // With nothing posted yet, a module with the drain status says it's drained.
+    // Modules built before the status bit existed return zeroes instead.
+    has_drain_status = WritesDrained();
+    return true;
+}
+
+
+bool HostIoRam::WritesDrained()
+{
+    // A NOP returns the status bit in every bit after the opcode plus one cycle to load it.
+    size_t    num_payload_bits = OPCODE_LENGTH + 2;
+    BitStream instr            = Header( num_payload_bits );
+    size_t    start            = instr.Size() + OPCODE_LENGTH + 1;
+    instr.Append( 0, num_payload_bits );    // NOP_OPCODE_C
+
+    BitStream tdo = BitStream::FromBytes( jtag.ShiftDr( instr, true ).get(), instr.Size() );
+    return tdo.Get( start, 1 ) != 0;
+}
+
+
+bool HostIoRam::WaitWritesDrained( unsigned timeout_ms )
+{
+    if ( !has_drain_status )
+        return true;
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeout_ms );
+    while ( !WritesDrained() )
+        if ( std::chrono::steady_clock::now() > deadline )
+            return false;
+    return true;
+}
+
+
+bool HostIoRam::Execute( std::vector<RamAccess> &list )
+{
+    struct Chunk
+    {
+        RamAccess *access;
+        size_t     index;       // Position of the first word in the RamAccess.
+        size_t     num_words;
+        size_t     start;       // Bit position of the first word on TDO (reads only).
+    };
+    std::vector<Chunk> chunks;
+
+    BitStream payload;
+    payload.Append( 0, OPCODE_LENGTH );     // NOP_OPCODE_C
+    payload.Append( 1, OPCODE_LENGTH );     // LIST_XOPCODE_C
+    for ( size_t i = 0; i < list.size(); i++ )
+    {
+        RamAccess &a     = list[i];
+        size_t     total = a.write ? a.data.size() : a.num_words;
+        if ( !a.write )
+            a.data.assign( total, 0 );
+
+        // Split long accesses into descriptors that fit the word count.
+        for ( size_t index = 0; index < total; index += MAX_LIST_LEN )
+        {
+            Chunk c;
+            c.access    = &a;
+            c.index     = index;
+            c.num_words = std::min( total - index, (size_t)MAX_LIST_LEN );
+            payload.Append( a.write ? 2 : 3, OPCODE_LENGTH );   // WRITE_OPCODE_C or READ_OPCODE_C
+            payload.Append( a.addr + index, addr_width );
+            payload.Append( c.num_words, LIST_LEN_SIZE );
+            if ( a.write )
+                for ( size_t w = 0; w < c.num_words; w++ )
+                    payload.Append( a.data[index + w], data_width );
+            else
+            {
+                // The first word of a read is garbage and the last is the status.
+                c.start = payload.Size() + data_width;
+                payload.Append( 0, ( c.num_words + 2 ) * data_width );
+                chunks.push_back( c );
+            }
+        }
+    }
+
+    BitStream instr = Header( payload.Size() );
+    size_t    hdr   = instr.Size();
+    instr.Append( payload );
+
+    bool      get_tdo = !chunks.empty();
+    BitStream tdo     = BitStream::FromBytes( jtag.ShiftDr( instr, get_tdo ).get(), instr.Size() );
+    bool      valid   = true;
+    for ( size_t i = 0; i < chunks.size(); i++ )
+    {
+        for ( size_t w = 0; w < chunks[i].num_words; w++ )
+            chunks[i].access->data[chunks[i].index + w] =
+                (uint32_t)tdo.Get( hdr + chunks[i].start + w * data_width, data_width );
+        if ( !tdo.Get( hdr + chunks[i].start + chunks[i].num_words * data_width, 1 ) )
+            valid = false;      // The memory didn't return some words in time.
+    }
+    return valid;
+}
+
+
+void HostIoRam::Write( uint32_t addr, const std::vector<uint32_t> &data )
+{
+    BitStream payload;
+    payload.Append( 2, OPCODE_LENGTH );     // WRITE_OPCODE_C
+    payload.Append( addr, addr_width );
+    for ( size_t i = 0; i < data.size(); i++ )
+        payload.Append( data[i], data_width );
+
+    BitStream instr = Header( payload.Size() );
+    instr.Append( payload );
+    jtag.ShiftDr( instr, false );
+}
+
+
+std::vector<uint32_t> HostIoRam::Read( uint32_t addr, size_t num_words )
+{
+    // The first data word on TDO is garbage while the first read of the memory completes.
+    BitStream payload;
+    payload.Append( 3, OPCODE_LENGTH );     // READ_OPCODE_C
+    payload.Append( addr, addr_width );
+    size_t start = payload.Size() + data_width;
+    payload.Append( 0, ( num_words + 1 ) * data_width );
+
+    BitStream instr = Header( payload.Size() );
+    start          += instr.Size();
+    instr.Append( payload );
+
+    BitStream             tdo = BitStream::FromBytes( jtag.ShiftDr( instr, true ).get(), instr.Size() );
+    std::vector<uint32_t> data( num_words );
+    for ( size_t i = 0; i < num_words; i++ )
+        data[i] = (uint32_t)tdo.Get( start + i * data_width, data_width );
+    return data;
+}
+
+} // namespace xula
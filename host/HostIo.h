@@ -0,0 +1,130 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Host side of the HostIo modules in FPGA/XuLA_lib/HostIo.vhd.
+//  HostIoRam sends HostIoToRam instructions through the FPGA USER
+//  instruction to read and write memories inside the FPGA design.
+//
+//********************************************************************
+
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include <vector>
+#include "XulaJtag.h"
+
+namespace xula
+{
+
+// A stream of bits, first bit in the LSB of the first byte.
+class BitStream
+{
+public:
+    BitStream() : num_bits( 0 ) {}
+
+    void     Append( uint64_t value, unsigned len );        // Append the len LSBs of value, LSB first.
+    void     Append( const BitStream &bits );
+    uint64_t Get( size_t offset, unsigned len ) const;      // Get len bits starting at offset.
+    size_t   Size() const { return num_bits; }
+    const Bytes &Data() const { return bytes; }
+
+    static BitStream FromBytes( const Bytes &bytes, size_t num_bits );
+
+private:
+    Bytes  bytes;
+    size_t num_bits;
+};
+
+// JTAG access to the USER instructions of the FPGA on the XuLA.
+// The TAP is always left in Run-Test/Idle between operations.
+class HostIoJtag
+{
+public:
+    explicit HostIoJtag( XulaJtag &jtag, unsigned user_instr = 0x02 );
+
+    void Reset();       // Go to Test-Logic-Reset and then Run-Test/Idle.
+
+    // Load the USER instruction (if it isn't already loaded) and shift the bits through the data register.
+    // The future holds the TDO bits if get_tdo is true.
+    std::future<Bytes> ShiftDr( const BitStream &tdi, bool get_tdo );
+
+    XulaJtag &Jtag() { return jtag; }
+
+private:
+    void ShiftIr( unsigned instr );
+
+    XulaJtag &jtag;
+    unsigned  user_instr;
+    bool      instr_loaded;
+};
+
+// One read or write in a list performed by HostIoRam::Execute().
+struct RamAccess
+{
+    bool                  write;        // True to write data, false to read num_words into data.
+    uint32_t              addr;
+    size_t                num_words;    // # of words to read (ignored for writes).
+    std::vector<uint32_t> data;
+
+    static RamAccess Write( uint32_t addr, const std::vector<uint32_t> &data );
+    static RamAccess Read( uint32_t addr, size_t num_words );
+};
+
+// Read and write a memory attached to a HostIoToRam module.
+class HostIoRam
+{
+public:
+    HostIoRam( HostIoJtag &jtag, uint8_t id );
+
+    // Ask the module for the widths of its address and data buses. Returns false if nothing answered.
+    // This also checks whether the module reports the drain status of posted writes, so call it
+    // before any writes are sent.
+    bool GetSize();
+    unsigned AddrWidth() const { return addr_width; }
+    unsigned DataWidth() const { return data_width; }
+
+    void                  Write( uint32_t addr, const std::vector<uint32_t> &data );
+    std::vector<uint32_t> Read( uint32_t addr, size_t num_words );
+
+    // Returns true once every write posted by the module (see WR_POST_G) has reached the memory.
+    bool WritesDrained();
+
+    // Wait for the posted writes to drain. Returns false if they haven't after timeout_ms.
+    // Modules that don't report the drain status never post writes, so this returns true at once for them.
+    bool WaitWritesDrained( unsigned timeout_ms = 1000 );
+    bool HasDrainStatus() const { return has_drain_status; }
+
+    // Perform a list of reads and writes with a single instruction. The data of each read is stored in its RamAccess.
+    // Returns false if the memory was too slow to return some of the words read, so they hold stale data.
+    bool Execute( std::vector<RamAccess> &list );
+
+protected:
+    BitStream Header( size_t num_payload_bits ) const;
+
+    HostIoJtag &jtag;
+    uint8_t     id;
+    unsigned    addr_width;
+    unsigned    data_width;
+    bool        has_drain_status;
+};
+
+} // namespace xula
+
+#endif // HOST_IO_H
@@ -0,0 +1,217 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  UsbTransport that talks to a real XuLA board through the
+//  asynchronous API of libusb-1.0.
+//
+//********************************************************************
+
+#include <cstring>
+#include <mutex>
+#include <set>
+#include "LibusbTransport.h"
+
+namespace xula
+{
+
+#define XULA_INTERFACE 0                // The XuLA has a single vendor-specific interface.
+
+// Bookkeeping that rides along with each libusb transfer.
+struct TransferCtx
+{
+    UsbTransport::Callback cb;
+    uint8_t               *buffer;
+};
+
+// Transfers that have been submitted but haven't completed yet. Kept so they can be
+// cancelled when the transport is closed.
+static std::mutex                      pending_lock;
+static std::set<libusb_transfer *>     pending;
+
+
+LibusbTransport::LibusbTransport( int index )
+    : context( NULL ), handle( NULL )
+{
+    if ( libusb_init( &context ) != 0 )
+    {
+        context = NULL;
+        return;
+    }
+
+    // Look for the index'th device with the XuLA VID/PID.
+    libusb_device **devs;
+    ssize_t num_devs = libusb_get_device_list( context, &devs );
+    for ( ssize_t i = 0; i < num_devs; i++ )
+    {
+        libusb_device_descriptor desc;
+        if ( libusb_get_device_descriptor( devs[i], &desc ) != 0 )
+            continue;
+        if ( desc.idVendor != XULA_VID || desc.idProduct != XULA_PID )
+            continue;
+        if ( index-- != 0 )
+            continue;
+        if ( libusb_open( devs[i], &handle ) != 0 )
+            handle = NULL;
+        break;
+    }
+    if ( num_devs >= 0 )
+        libusb_free_device_list( devs, 1 );
+
+    if ( handle == NULL )
+        return;
+
+    libusb_set_auto_detach_kernel_driver( handle, 1 );
+    if ( libusb_set_configuration( handle, 1 ) != 0 || libusb_claim_interface( handle, XULA_INTERFACE ) != 0 )
+    {
+        libusb_close( handle );
+        handle = NULL;
+    }
+}
+
+
+LibusbTransport::~LibusbTransport()
+{
+    if ( handle != NULL )
+    {
+        // Cancel anything still in flight and let the callbacks run so the buffers get released.
+        {
+            std::lock_guard<std::mutex> lock( pending_lock );
+            for ( std::set<libusb_transfer *>::iterator t = pending.begin(); t != pending.end(); ++t )
+                if ( ( *t )->dev_handle == handle )
+                    libusb_cancel_transfer( *t );
+        }
+        for ( ;; )
+        {
+            bool busy = false;
+            {
+                std::lock_guard<std::mutex> lock( pending_lock );
+                for ( std::set<libusb_transfer *>::iterator t = pending.begin(); t != pending.end(); ++t )
+                    if ( ( *t )->dev_handle == handle )
+                        busy = true;
+            }
+            if ( !busy )
+                break;
+            HandleEvents( 100 );
+        }
+        libusb_release_interface( handle, XULA_INTERFACE );
+        libusb_close( handle );
+    }
+    if ( context != NULL )
+        libusb_exit( context );
+}
+
+
+bool LibusbTransport::SubmitOut( const uint8_t *data, size_t len, const Callback &cb )
+{
+    uint8_t *buffer = new uint8_t[len ? len : 1];
+    memcpy( buffer, data, len );
+    return Submit( XULA_EP_OUT, buffer, len, cb );
+}
+
+
+bool LibusbTransport::SubmitIn( size_t max_len, const Callback &cb )
+{
+    return Submit( XULA_EP_IN, new uint8_t[max_len ? max_len : 1], max_len, cb );
+}
+
+
+bool LibusbTransport::Submit( uint8_t endpoint, uint8_t *buffer, size_t len, const Callback &cb )
+{
+    if ( handle == NULL )
+    {
+        delete [] buffer;
+        return false;
+    }
+
+    TransferCtx *ctx = new TransferCtx;
+    ctx->cb     = cb;
+    ctx->buffer = buffer;
+
+    libusb_transfer *transfer = libusb_alloc_transfer( 0 );
+    libusb_fill_bulk_transfer( transfer, handle, endpoint, buffer, (int)len, TransferDone, ctx, 0 );
+
+    {
+        std::lock_guard<std::mutex> lock( pending_lock );
+        pending.insert( transfer );
+    }
+    if ( libusb_submit_transfer( transfer ) != 0 )
+    {
+        {
+            std::lock_guard<std::mutex> lock( pending_lock );
+            pending.erase( transfer );
+        }
+        libusb_free_transfer( transfer );
+        delete [] buffer;
+        delete ctx;
+        return false;
+    }
+    return true;
+}
+
+
+void LIBUSB_CALL LibusbTransport::TransferDone( struct libusb_transfer *transfer )
+{
+    TransferCtx *ctx = static_cast<TransferCtx *>( transfer->user_data );
+
+    {
+        std::lock_guard<std::mutex> lock( pending_lock );
+        pending.erase( transfer );
+    }
+
+    TransferStatus status;
+    switch ( transfer->status )
+    {
+        case LIBUSB_TRANSFER_COMPLETED:
+            status = TRANSFER_OK;
+            break;
+        case LIBUSB_TRANSFER_CANCELLED:
+            status = TRANSFER_CANCELLED;
+            break;
+        default:
+            status = TRANSFER_ERROR;
+            break;
+    }
+
+    ctx->cb( status, ctx->buffer, (size_t)transfer->actual_length );
+
+    delete [] ctx->buffer;
+    delete ctx;
+    libusb_free_transfer( transfer );
+}
+
+
+void LibusbTransport::HandleEvents( int timeout_ms )
+{
+    if ( context == NULL )
+        return;
+    struct timeval tv;
+    tv.tv_sec  = timeout_ms / 1000;
+    tv.tv_usec = ( timeout_ms % 1000 ) * 1000;
+    libusb_handle_events_timeout_completed( context, &tv, NULL );
+}
+
+
+void LibusbTransport::Interrupt()
+{
+    if ( context != NULL )
+        libusb_interrupt_event_handler( context );
+}
+
+} // namespace xula
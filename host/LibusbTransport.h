@@ -0,0 +1,62 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  UsbTransport that talks to a real XuLA board through the
+//  asynchronous API of libusb-1.0.
+//
+//********************************************************************
+
+#ifndef LIBUSB_TRANSPORT_H
+#define LIBUSB_TRANSPORT_H
+
+#include <libusb-1.0/libusb.h>
+#include "UsbTransport.h"
+
+namespace xula
+{
+
+class LibusbTransport : public UsbTransport
+{
+public:
+    // Open the index'th XuLA board found on the USB buses.
+    explicit LibusbTransport( int index = 0 );
+    virtual ~LibusbTransport();
+
+    bool IsOpen() const { return handle != NULL; }
+
+    virtual bool SubmitOut( const uint8_t *data, size_t len, const Callback &cb );
+    virtual bool SubmitIn( size_t max_len, const Callback &cb );
+    virtual void HandleEvents( int timeout_ms );
+    virtual void Interrupt();
+
+private:
+    LibusbTransport( const LibusbTransport & );
+    LibusbTransport &operator=( const LibusbTransport & );
+
+    bool Submit( uint8_t endpoint, uint8_t *buffer, size_t len, const Callback &cb );
+    static void LIBUSB_CALL TransferDone( struct libusb_transfer *transfer );
+
+    libusb_context       *context;
+    libusb_device_handle *handle;
+};
+
+} // namespace xula
+
+#endif // LIBUSB_TRANSPORT_H
@@ -0,0 +1,155 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  The JTAG TAP of a simulated Spartan-3A FPGA.
+//
+//********************************************************************
+
+#include "SimFpga.h"
+
+namespace xula
+{
+
+#define IR_CAPTURE 0x01                 // Value loaded into the IR in Capture-IR (LSBs must be 01).
+
+
+SimFpga::SimFpga( uint32_t idcode )
+    : idcode( idcode ),
+      state( TEST_LOGIC_RESET ),
+      ir( FPGA_IDCODE_INSTR ),
+      ir_shift( 0 ),
+      dr_shift( 0 ),
+      tdo( false ),
+      configured( true )
+{
+}
+
+
+void SimFpga::AddHostIo( SimHostIoModule *module, unsigned user_instr )
+{
+    Attached a;
+    a.module = module;
+    a.instr  = user_instr;
+    host_io.push_back( a );
+}
+
+
+TapState SimFpga::NextState( TapState s, bool tms )
+{
+    switch ( s )
+    {
+        case TEST_LOGIC_RESET: return tms ? TEST_LOGIC_RESET : RUN_TEST_IDLE;
+        case RUN_TEST_IDLE:    return tms ? SELECT_DR_SCAN : RUN_TEST_IDLE;
+        case SELECT_DR_SCAN:   return tms ? SELECT_IR_SCAN : CAPTURE_DR;
+        case CAPTURE_DR:       return tms ? EXIT1_DR : SHIFT_DR;
+        case SHIFT_DR:         return tms ? EXIT1_DR : SHIFT_DR;
+        case EXIT1_DR:         return tms ? UPDATE_DR : PAUSE_DR;
+        case PAUSE_DR:         return tms ? EXIT2_DR : PAUSE_DR;
+        case EXIT2_DR:         return tms ? UPDATE_DR : SHIFT_DR;
+        case UPDATE_DR:        return tms ? SELECT_DR_SCAN : RUN_TEST_IDLE;
+        case SELECT_IR_SCAN:   return tms ? TEST_LOGIC_RESET : CAPTURE_IR;
+        case CAPTURE_IR:       return tms ? EXIT1_IR : SHIFT_IR;
+        case SHIFT_IR:         return tms ? EXIT1_IR : SHIFT_IR;
+        case EXIT1_IR:         return tms ? UPDATE_IR : PAUSE_IR;
+        case PAUSE_IR:         return tms ? EXIT2_IR : PAUSE_IR;
+        case EXIT2_IR:         return tms ? UPDATE_IR : SHIFT_IR;
+        case UPDATE_IR:        return tms ? SELECT_DR_SCAN : RUN_TEST_IDLE;
+    }
+    return TEST_LOGIC_RESET;
+}
+
+
+// OR of the TDO outputs of the HostIo modules on the current USER instruction.
+bool SimFpga::UserTdo() const
+{
+    bool t = false;
+    for ( size_t i = 0; i < host_io.size(); i++ )
+        if ( host_io[i].instr == ir )
+            t = t || host_io[i].module->Tdo();
+    return t;
+}
+
+
+bool SimFpga::Clock( bool tms, bool tdi )
+{
+    bool tdo_out = tdo;         // TDO was set up on the previous falling edge.
+    bool user    = configured && ( ir == FPGA_USER1_INSTR || ir == FPGA_USER2_INSTR );
+
+    // Rising edge of TCK.
+    switch ( state )
+    {
+        case TEST_LOGIC_RESET:
+            ir = FPGA_IDCODE_INSTR;
+            break;
+
+        case CAPTURE_IR:
+            ir_shift = IR_CAPTURE;
+            break;
+
+        case SHIFT_IR:
+            ir_shift = ( (unsigned)tdi << ( FPGA_IR_LENGTH - 1 ) ) | ( ir_shift >> 1 );
+            break;
+
+        case UPDATE_IR:
+            ir = ir_shift;
+            break;
+
+        case CAPTURE_DR:
+        case SHIFT_DR:
+            if ( user )
+            {
+                // DRCK pulses in Capture-DR and Shift-DR, but SHIFT is only high in Shift-DR.
+                for ( size_t i = 0; i < host_io.size(); i++ )
+                    if ( host_io[i].instr == ir )
+                        host_io[i].module->Clock( state == SHIFT_DR, tdi );
+            }
+            else if ( state == CAPTURE_DR )
+                dr_shift = ir == FPGA_IDCODE_INSTR ? idcode : 0;
+            else if ( ir == FPGA_IDCODE_INSTR )
+                dr_shift = ( (uint32_t)tdi << 31 ) | ( dr_shift >> 1 );
+            else
+                dr_shift = tdi;     // Everything else acts like BYPASS.
+            break;
+
+        default:
+            break;
+    }
+
+    state = NextState( state, tms );
+
+    // Falling edge of TCK.
+    if ( state == SHIFT_IR )
+        tdo = ir_shift & 1;
+    else if ( state == SHIFT_DR )
+        tdo = user ? UserTdo() : ( dr_shift & 1 );
+    else
+        tdo = false;
+
+    return tdo_out;
+}
+
+
+void SimFpga::SetProg( bool level )
+{
+    // Pulling PROGRAM# low erases the FPGA so the USER instructions no longer reach the HostIo modules.
+    configured = level;
+}
+
+} // namespace xula
@@ -0,0 +1,90 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  The JTAG TAP of a simulated Spartan-3A FPGA. The USER1 and USER2
+//  instructions connect the data register path to HostIo module
+//  models the same way the BSCAN_SPARTAN3A primitive does.
+//
+//********************************************************************
+
+#ifndef SIM_FPGA_H
+#define SIM_FPGA_H
+
+#include <vector>
+#include "SimXula.h"
+#include "SimHostIo.h"
+
+namespace xula
+{
+
+// IEEE 1149.1 TAP controller states.
+enum TapState
+{
+    TEST_LOGIC_RESET, RUN_TEST_IDLE,
+    SELECT_DR_SCAN, CAPTURE_DR, SHIFT_DR, EXIT1_DR, PAUSE_DR, EXIT2_DR, UPDATE_DR,
+    SELECT_IR_SCAN, CAPTURE_IR, SHIFT_IR, EXIT1_IR, PAUSE_IR, EXIT2_IR, UPDATE_IR
+};
+
+// Instruction register of the Spartan-3A.
+const unsigned FPGA_IR_LENGTH   = 6;
+const unsigned FPGA_USER1_INSTR = 0x02;
+const unsigned FPGA_USER2_INSTR = 0x03;
+const unsigned FPGA_IDCODE_INSTR = 0x09;
+const unsigned FPGA_BYPASS_INSTR = 0x3F;
+
+const uint32_t XC3S50A_IDCODE  = 0x02210093;     // XuLA-50.
+const uint32_t XC3S200A_IDCODE = 0x02218093;     // XuLA-200.
+
+class SimFpga : public JtagTarget
+{
+public:
+    explicit SimFpga( uint32_t idcode = XC3S200A_IDCODE );
+
+    // Attach a HostIo module to the USER1 or USER2 instruction (the module is not owned by SimFpga).
+    void AddHostIo( SimHostIoModule *module, unsigned user_instr = FPGA_USER1_INSTR );
+
+    virtual bool Clock( bool tms, bool tdi );
+    virtual void SetProg( bool level );
+
+    TapState State() const { return state; }
+
+private:
+    struct Attached
+    {
+        SimHostIoModule *module;
+        unsigned         instr;
+    };
+
+    static TapState NextState( TapState s, bool tms );
+    bool UserTdo() const;
+
+    uint32_t              idcode;
+    TapState              state;
+    unsigned              ir;           // Current instruction.
+    unsigned              ir_shift;     // Instruction shift register.
+    uint32_t              dr_shift;     // IDCODE or BYPASS shift register.
+    bool                  tdo;          // TDO level (changes on the falling edge of TCK).
+    bool                  configured;   // False while PROGRAM# is held low.
+    std::vector<Attached> host_io;
+};
+
+} // namespace xula
+
+#endif // SIM_FPGA_H
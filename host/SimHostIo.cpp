@@ -0,0 +1,352 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Cycle models of the HostIo modules in FPGA/XuLA_lib/HostIo.vhd.
+//
+//********************************************************************
+
+#include <algorithm>
+#include "SimHostIo.h"
+
+namespace xula
+{
+
+#define ID_LENGTH      8                // Length of the ID field in the instruction header.
+#define PARAM_SIZE     16               // Length of the SIZE_OPCODE reply.
+
+
+SimHostIoHdrScanner::SimHostIoHdrScanner( uint8_t id, unsigned pyld_cntr_length )
+    : id( id ), pyld_len( pyld_cntr_length )
+{
+    Clear();
+}
+
+
+void SimHostIoHdrScanner::Clear()
+{
+    id_r      = 0;
+    pyld_cntr = (uint64_t)1 << ( pyld_len - 1 );
+    hdr_rcvd  = false;
+}
+
+
+void SimHostIoHdrScanner::Clock( bool in_shift_dr, bool tdi )
+{
+    if ( !in_shift_dr || ( hdr_rcvd && pyld_cntr == 1 ) )
+        Clear();
+    else if ( !hdr_rcvd )
+    {
+        // The header bits ripple through the payload counter and then the ID register.
+        bool id_lsb = id_r & 1;
+        id_r        = (uint8_t)( ( ( pyld_cntr & 1 ) << ( ID_LENGTH - 1 ) ) | ( id_r >> 1 ) );
+        pyld_cntr   = ( (uint64_t)tdi << ( pyld_len - 1 ) ) | ( pyld_cntr >> 1 );
+        hdr_rcvd    = id_lsb;
+    }
+    else
+        pyld_cntr--;
+}
+
+
+SimHostIoToRam::SimHostIoToRam( uint8_t id, unsigned addr_width, unsigned data_width, uint32_t addr_inc )
+    : hdr( id ),
+      addr_width( addr_width ),
+      data_width( data_width ),
+      sr_width( std::max( (unsigned)PARAM_SIZE, data_width ) ),
+      addr_inc( addr_inc ),
+      addr_mask( ( (uint64_t)1 << addr_width ) - 1 ),
+      data_mask( ( (uint64_t)1 << data_width ) - 1 ),
+      data_from_memory( 0 ),
+      data_from_host( 0 )
+{
+    Reset();
+}
+
+
+void SimHostIoToRam::Reset()
+{
+    opcode      = 2;            // MSbit set so we can tell when the opcode is complete.
+    opcode_rcvd = false;
+    addr        = (uint64_t)1 << ( addr_width - 1 );
+    addr_rcvd   = false;
+    shift_reg   = (uint64_t)1 << ( data_width - 1 );
+    bit_cntr    = 0;
+    wr          = false;
+    rd          = false;
+    xopcode      = 2;
+    xopcode_rcvd = false;
+    ResetDescriptor();
+}
+
+
+void SimHostIoToRam::ResetDescriptor()
+{
+    desc_opcode      = 2;
+    desc_opcode_rcvd = false;
+    desc_addr        = (uint64_t)1 << ( addr_width - 1 );
+    desc_addr_rcvd   = false;
+    desc_len         = 1 << ( LIST_LEN_SIZE - 1 );
+    desc_len_rcvd    = false;
+    rd_late          = false;
+    rd_status_sent   = false;
+}
+
+
+//
+// One rising edge of DRCK while performing a descriptor list (the LIST_XOPCODE branch of HostIoToRamCore).
+//
+void SimHostIoToRam::List( bool tdi, bool &latched )
+{
+    if ( wr )   // The memory finishes the write right away.
+    {
+        wr   = false;
+        addr = ( addr + addr_inc ) & addr_mask;
+    }
+
+    if ( !desc_opcode_rcvd )
+    {
+        desc_opcode_rcvd = desc_opcode & 1;
+        desc_opcode      = ( (unsigned)tdi << 1 ) | ( desc_opcode >> 1 );
+    }
+    else if ( !desc_addr_rcvd )
+    {
+        desc_addr_rcvd = desc_addr & 1;
+        desc_addr      = ( (uint64_t)tdi << ( addr_width - 1 ) ) | ( desc_addr >> 1 );
+    }
+    else if ( !desc_len_rcvd )
+    {
+        bool     last = desc_len & 1;
+        uint32_t len  = ( (uint32_t)tdi << ( LIST_LEN_SIZE - 1 ) ) | ( desc_len >> 1 );
+        desc_len_rcvd = last;
+        desc_len      = len;
+        if ( last )
+        {
+            word_cntr = len;
+            addr      = desc_addr;
+            bit_cntr  = data_width - 1;
+            shift_reg = (uint64_t)1 << ( data_width - 1 );
+            if ( len == 0 || ( desc_opcode != WRITE_OPCODE && desc_opcode != READ_OPCODE ) )
+                ResetDescriptor();
+            else if ( desc_opcode == READ_OPCODE )
+                rd = true;
+        }
+    }
+    else if ( desc_opcode == WRITE_OPCODE )
+    {
+        if ( !( shift_reg & 1 ) )
+            shift_reg = ( shift_reg & ~data_mask ) | ( (uint64_t)tdi << ( data_width - 1 ) ) | ( ( shift_reg & data_mask ) >> 1 );
+        else
+        {
+            data_from_host = (uint32_t)( ( (uint64_t)tdi << ( data_width - 1 ) ) | ( ( shift_reg & data_mask ) >> 1 ) );
+            shift_reg      = (uint64_t)1 << ( data_width - 1 );
+            wr             = true;
+            latched        = true;
+            if ( word_cntr-- == 1 )
+                ResetDescriptor();
+        }
+    }
+    else
+    {
+        uint32_t prev_data = data_from_memory;
+        bool     prev_rd   = rd;
+        if ( rd )
+        {
+            rd               = false;
+            data_from_memory = MemRead( (uint32_t)addr );
+        }
+        if ( bit_cntr == 0 )
+        {
+            if ( word_cntr != 0 )
+            {
+                shift_reg = ( shift_reg & ~data_mask ) | prev_data;
+                bit_cntr  = data_width - 1;
+                rd_late   = rd_late || prev_rd;     // The word went out before its read was done.
+                if ( word_cntr-- > 1 )
+                {
+                    addr = ( addr + addr_inc ) & addr_mask;
+                    rd   = true;
+                }
+            }
+            else if ( !rd_status_sent )
+            {
+                shift_reg      = rd_late ? 0 : 1;
+                bit_cntr       = data_width - 1;
+                rd_status_sent = true;
+                rd             = false;
+            }
+            else
+                ResetDescriptor();
+        }
+        else
+        {
+            shift_reg >>= 1;
+            bit_cntr--;
+        }
+    }
+}
+
+
+//
+// One rising edge of DRCK. All the decisions use the register values from before the edge,
+// just like the signal assignments in the HostIoToRamCore process.
+//
+void SimHostIoToRam::Clock( bool in_shift_dr, bool tdi )
+{
+    bool     active  = hdr.Active();
+    uint64_t pyld    = hdr.PyldCntr();
+    bool     wr_next = wr;
+    bool     latched = false;   // Set when a complete word from the host is handed to the memory.
+
+    if ( active || wr )
+    {
+        if ( !opcode_rcvd )
+        {
+            opcode_rcvd = opcode & 1;
+            opcode      = ( (unsigned)tdi << 1 ) | ( opcode >> 1 );
+        }
+        else
+        {
+            switch ( opcode )
+            {
+                case SIZE_OPCODE:
+                    if ( bit_cntr == 0 )
+                    {
+                        shift_reg = ( (uint64_t)( data_width & 0xFF ) << ( PARAM_SIZE / 2 ) ) | ( addr_width & 0xFF );
+                        bit_cntr  = PARAM_SIZE;
+                    }
+                    else
+                    {
+                        shift_reg >>= 1;
+                        bit_cntr--;
+                    }
+                    break;
+
+                case WRITE_OPCODE:
+                    if ( !addr_rcvd )
+                    {
+                        addr_rcvd = addr & 1;
+                        addr      = ( (uint64_t)tdi << ( addr_width - 1 ) ) | ( addr >> 1 );
+                        wr_next   = false;
+                        shift_reg = (uint64_t)1 << ( data_width - 1 );
+                    }
+                    else
+                    {
+                        uint64_t addr_next = addr;
+                        if ( wr )       // The memory finishes the write right away.
+                        {
+                            wr_next   = false;
+                            addr_next = ( addr + addr_inc ) & addr_mask;
+                        }
+                        if ( !( shift_reg & 1 ) )
+                            shift_reg = ( shift_reg & ~data_mask )
+                                        | ( (uint64_t)tdi << ( data_width - 1 ) ) | ( ( shift_reg & data_mask ) >> 1 );
+                        else
+                        {
+                            data_from_host = (uint32_t)( ( (uint64_t)tdi << ( data_width - 1 ) )
+                                                         | ( ( shift_reg & data_mask ) >> 1 ) );
+                            shift_reg      = (uint64_t)1 << ( data_width - 1 );
+                            wr_next        = true;
+                            latched        = true;
+                        }
+                        addr = addr_next;
+                    }
+                    break;
+
+                case READ_OPCODE:
+                    if ( !addr_rcvd )
+                    {
+                        addr_rcvd = addr & 1;
+                        rd        = addr & 1;   // Start reading as soon as the address is in.
+                        addr      = ( (uint64_t)tdi << ( addr_width - 1 ) ) | ( addr >> 1 );
+                        bit_cntr  = data_width - 1;
+                    }
+                    else
+                    {
+                        uint32_t prev_data = data_from_memory;
+                        if ( rd )       // The memory finishes the read right away.
+                        {
+                            rd               = false;
+                            data_from_memory = MemRead( (uint32_t)addr );
+                        }
+                        if ( bit_cntr == 0 )
+                        {
+                            shift_reg = ( shift_reg & ~data_mask ) | prev_data;
+                            bit_cntr  = data_width - 1;
+                            if ( pyld >= sr_width )
+                            {
+                                addr = ( addr + addr_inc ) & addr_mask;
+                                rd   = true;
+                            }
+                        }
+                        else
+                        {
+                            shift_reg >>= 1;
+                            bit_cntr--;
+                        }
+                    }
+                    break;
+
+                default:        // NOP: writes are never posted, so the status always says they're drained.
+                    if ( !xopcode_rcvd )
+                    {
+                        xopcode_rcvd = xopcode & 1;
+                        xopcode      = ( (unsigned)tdi << 1 ) | ( xopcode >> 1 );
+                        shift_reg   |= 1;
+                    }
+                    else if ( xopcode == LIST_XOPCODE )
+                    {
+                        List( tdi, latched );
+                        wr_next = wr;
+                    }
+                    else
+                        shift_reg |= 1;
+                    break;
+            }
+        }
+        wr = wr_next;
+    }
+    else
+        Reset();
+
+    hdr.Clock( in_shift_dr, tdi );
+
+    if ( latched )
+        MemWrite( (uint32_t)addr, data_from_host );
+}
+
+
+bool SimHostIoToRam::Tdo() const
+{
+    return hdr.Active() && ( shift_reg & 1 );
+}
+
+
+uint32_t SimHostIoToRam::Peek( uint32_t addr ) const
+{
+    std::unordered_map<uint32_t, uint32_t>::const_iterator m = mem.find( addr );
+    return m == mem.end() ? 0 : m->second;
+}
+
+
+void SimHostIoToRam::Poke( uint32_t addr, uint32_t data )
+{
+    mem[addr] = (uint32_t)( data & data_mask );
+}
+
+} // namespace xula
@@ -0,0 +1,138 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Cycle models of the HostIo modules in FPGA/XuLA_lib/HostIo.vhd.
+//  Each call to Clock() is one rising edge of DRCK and updates the
+//  registers exactly as the VHDL processes do, so host software sees
+//  the same TDO bit stream it would get from the FPGA.
+//
+//********************************************************************
+
+#ifndef SIM_HOST_IO_H
+#define SIM_HOST_IO_H
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace xula
+{
+
+// Opcodes of HostIoToRam (HostIoPckg).
+const unsigned NOP_OPCODE   = 0;
+const unsigned SIZE_OPCODE  = 1;
+const unsigned WRITE_OPCODE = 2;
+const unsigned READ_OPCODE  = 3;
+
+// Extended opcodes that follow a NOP_OPCODE.
+const unsigned STATUS_XOPCODE  = 0;
+const unsigned LIST_XOPCODE    = 1;
+const unsigned LIST_LEN_SIZE   = 16;    // Width of the word count in a list descriptor.
+
+// A HostIo module attached to the BSCAN primitive.
+class SimHostIoModule
+{
+public:
+    virtual ~SimHostIoModule() {}
+
+    // Rising edge of DRCK. in_shift_dr is high when the USER instruction is active and the TAP is in Shift-DR.
+    virtual void Clock( bool in_shift_dr, bool tdi ) = 0;
+
+    // TDO output of the module (low when the module is not selected so outputs can be OR'ed together).
+    virtual bool Tdo() const = 0;
+};
+
+// HostIoHdrScanner: extracts the ID and payload bit count from the bit stream.
+class SimHostIoHdrScanner
+{
+public:
+    SimHostIoHdrScanner( uint8_t id, unsigned pyld_cntr_length = 32 );
+
+    void     Clock( bool in_shift_dr, bool tdi );
+    bool     Active() const { return hdr_rcvd && id_r == id; }
+    uint64_t PyldCntr() const { return pyld_cntr; }
+
+private:
+    void Clear();
+
+    uint8_t  id;
+    unsigned pyld_len;
+    uint8_t  id_r;
+    uint64_t pyld_cntr;
+    bool     hdr_rcvd;
+};
+
+// HostIoToRam with a memory that finishes every read or write immediately.
+class SimHostIoToRam : public SimHostIoModule
+{
+public:
+    SimHostIoToRam( uint8_t id, unsigned addr_width, unsigned data_width, uint32_t addr_inc = 1 );
+
+    virtual void Clock( bool in_shift_dr, bool tdi );
+    virtual bool Tdo() const;
+
+    // Direct access to the memory contents (unwritten locations read as zero).
+    uint32_t Peek( uint32_t addr ) const;
+    void     Poke( uint32_t addr, uint32_t data );
+
+protected:
+    // Memory operations. Override these to model something other than a plain RAM.
+    virtual uint32_t MemRead( uint32_t addr ) { return Peek( addr ); }
+    virtual void     MemWrite( uint32_t addr, uint32_t data ) { Poke( addr, data ); }
+
+private:
+    void Reset();
+    void ResetDescriptor();
+    void List( bool tdi, bool &latched );
+
+    SimHostIoHdrScanner hdr;
+    unsigned addr_width;
+    unsigned data_width;
+    unsigned sr_width;          // Width of the shift register (at least 16 for the size parameters).
+    uint32_t addr_inc;
+    uint64_t addr_mask;
+    uint64_t data_mask;
+    // Registers of HostIoToRamCore.
+    unsigned opcode;
+    bool     opcode_rcvd;
+    uint64_t addr;
+    bool     addr_rcvd;
+    uint64_t shift_reg;
+    unsigned bit_cntr;
+    bool     wr;
+    bool     rd;
+    uint32_t data_from_memory;
+    uint32_t data_from_host;
+    unsigned xopcode;
+    bool     xopcode_rcvd;
+    unsigned desc_opcode;
+    bool     desc_opcode_rcvd;
+    uint64_t desc_addr;
+    bool     desc_addr_rcvd;
+    uint32_t desc_len;
+    bool     desc_len_rcvd;
+    uint32_t word_cntr;
+    bool     rd_late;
+    bool     rd_status_sent;
+    std::unordered_map<uint32_t, uint32_t> mem;
+};
+
+} // namespace xula
+
+#endif // SIM_HOST_IO_H
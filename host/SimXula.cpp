@@ -0,0 +1,394 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  A simulated XuLA board and the transport that connects it to
+//  the XulaJtag class.
+//
+//********************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "SimXula.h"
+
+extern "C" {
+#include "../fmw/user/usbcmd.h"
+}
+
+namespace xula
+{
+
+#define DO_DELAY_THRESHOLD 5461UL       // Above this, RUNTEST waits on a timer instead of pulsing TCK (see user.c).
+#define DESC_STR_LEN       26           // Size of the description string in the INFO_CMD reply.
+#define EEDATA_HDR_LEN     5            // Command, length and 3-byte address of EEPROM commands.
+
+
+// Get a 32-bit little-endian value from a packet.
+static uint32_t get_dword( const uint8_t *p )
+{
+    return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) | ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+
+SimXula::SimXula( JtagTarget &target )
+    : target( target ), tms( false ), tdi( false ), mode( IDLE ), cmd( 0 ), flags( 0 ), clks_left( 0 )
+{
+    memset( eeprom, 0xFF, sizeof( eeprom ) );   // Erased EEPROM.
+}
+
+
+bool SimXula::Clock( bool tms, bool tdi )
+{
+    this->tms = tms;
+    this->tdi = tdi;
+    return target.Clock( tms, tdi );
+}
+
+
+//
+// Shift up to eight bits taken from the LSB upward. A NULL byte pointer holds that pin at its current level.
+//
+uint8_t SimXula::ShiftByte( const uint8_t *tms_byte, const uint8_t *tdi_byte, bool exit_on_last )
+{
+    uint8_t tdo_byte = 0;
+    for ( int b = 0; b < 8 && clks_left != 0; b++, clks_left-- )
+    {
+        bool tms_bit = tms_byte != NULL ? ( *tms_byte >> b ) & 1 : tms;
+        bool tdi_bit = tdi_byte != NULL ? ( *tdi_byte >> b ) & 1 : tdi;
+        if ( exit_on_last && clks_left == 1 )
+            tms_bit = true;     // Raise TMS on the final bit to exit Shift-IR or Shift-DR.
+        if ( Clock( tms_bit, tdi_bit ) )
+            tdo_byte |= 1 << b;
+    }
+    return tdo_byte;
+}
+
+
+void SimXula::Receive( const uint8_t *pkt, size_t len, std::vector<Bytes> &replies )
+{
+    if ( len == 0 )
+        return;
+
+    // Packets that continue a multi-packet command.
+    if ( mode == JTAG_DATA )
+    {
+        JtagBytes( pkt, len, replies );
+        return;
+    }
+    if ( mode == LEGACY_DATA )
+    {
+        LegacyBytes( pkt, len, replies );
+        return;
+    }
+
+    Bytes reply;
+    cmd = pkt[0];
+    switch ( cmd )
+    {
+        case ID_BOARD_CMD:
+            reply.push_back( cmd );
+            break;
+
+        case INFO_CMD:
+            {
+                static const char desc[] = "XuLA";
+                reply.push_back( cmd );
+                reply.push_back( 0x00 );    // Product ID.
+                reply.push_back( 0x02 );
+                reply.push_back( 1 );       // Version.
+                reply.push_back( 1 );
+                for ( size_t i = 0; i < DESC_STR_LEN; i++ )
+                    reply.push_back( i < sizeof( desc ) ? desc[i] : 0 );
+                uint8_t checksum = 0;
+                for ( size_t i = 0; i < reply.size(); i++ )
+                    checksum += reply[i];
+                reply.push_back( (uint8_t)-checksum );
+            }
+            break;
+
+        case TMS_TDI_CMD:
+            if ( len >= 2 )
+                Clock( pkt[1] & 0x01, pkt[1] & 0x02 );
+            break;
+
+        case TMS_TDI_TDO_CMD:
+            if ( len >= 2 )
+            {
+                reply.push_back( cmd );
+                reply.push_back( Clock( pkt[1] & 0x01, pkt[1] & 0x02 ) ? 0x04 : 0x00 );
+            }
+            break;
+
+        case TDI_CMD:
+        case TDI_TDO_CMD:
+        case TDO_CMD:
+            if ( len < 5 || ( clks_left = get_dword( &pkt[1] ) ) == 0 )
+                break;
+            tms = false;        // Stay in Shift-DR or Shift-IR until the last bit.
+            if ( cmd == TDO_CMD )
+                TdoOnly( true, replies );
+            else
+                mode = LEGACY_DATA;
+            break;
+
+        case JTAG_CMD:
+            if ( len < JTAG_CMD_HDR_LEN || ( clks_left = get_dword( &pkt[1] ) ) == 0 )
+                break;
+            flags = pkt[5];
+            if ( !( flags & PUT_TMS_MASK ) )
+                tms = ( flags & TMS_VAL_MASK ) != 0;
+            if ( !( flags & PUT_TDI_MASK ) )
+                tdi = ( flags & TDI_VAL_MASK ) != 0;
+            if ( !( flags & ( PUT_TMS_MASK | PUT_TDI_MASK ) ) )
+            {
+                std::vector<Bytes> tdo;
+                TdoOnly( false, tdo );
+                if ( flags & GET_TDO_MASK )
+                    replies.insert( replies.end(), tdo.begin(), tdo.end() );
+            }
+            else
+            {
+                mode = JTAG_DATA;
+                JtagBytes( pkt + JTAG_CMD_HDR_LEN, len - JTAG_CMD_HDR_LEN, replies );
+            }
+            break;
+
+        case RUNTEST_CMD:
+            if ( len < 5 )
+                break;
+            if ( get_dword( &pkt[1] ) <= DO_DELAY_THRESHOLD )
+                for ( uint32_t i = get_dword( &pkt[1] ); i != 0; i-- )
+                    Clock( tms, tdi );
+            reply.assign( pkt, pkt + 5 );
+            break;
+
+        case PROG_CMD:
+            if ( len >= 2 )
+                target.SetProg( pkt[1] & 0x01 );
+            break;
+
+        case FLASH_ONOFF_CMD:
+            reply.assign( pkt, pkt + std::min( len, (size_t)2 ) );
+            break;
+
+        case AIO0_ADC_CMD:
+        case AIO1_ADC_CMD:
+            reply.push_back( cmd );
+            reply.push_back( 0 );
+            reply.push_back( 0 );
+            break;
+
+        case READ_EEDATA_CMD:
+            if ( len < EEDATA_HDR_LEN )
+                break;
+            reply.assign( pkt, pkt + EEDATA_HDR_LEN );
+            for ( size_t i = 0; i < pkt[1] && EEDATA_HDR_LEN + i < XULA_PACKET_SIZE; i++ )
+                reply.push_back( eeprom[(uint8_t)( pkt[2] + i )] );
+            break;
+
+        case WRITE_EEDATA_CMD:
+            if ( len < EEDATA_HDR_LEN )
+                break;
+            for ( size_t i = 0; i < pkt[1] && EEDATA_HDR_LEN + i < len; i++ )
+                eeprom[(uint8_t)( pkt[2] + i )] = pkt[EEDATA_HDR_LEN + i];
+            reply.push_back( cmd );
+            break;
+
+        default:
+            break;
+    }
+
+    if ( !reply.empty() )
+        replies.push_back( reply );
+}
+
+
+//
+// Process the TMS and/or TDI bytes of a JTAG_CMD. Each packet of bytes produces one packet of TDO bytes.
+//
+void SimXula::JtagBytes( const uint8_t *data, size_t len, std::vector<Bytes> &replies )
+{
+    bool  put_tms = ( flags & PUT_TMS_MASK ) != 0;
+    bool  put_tdi = ( flags & PUT_TDI_MASK ) != 0;
+    Bytes tdo;
+
+    for ( size_t i = 0; i < len && clks_left != 0; )
+    {
+        const uint8_t *tms_byte = put_tms ? &data[i++] : NULL;
+        const uint8_t *tdi_byte = NULL;
+        if ( put_tdi && i < len )
+            tdi_byte = &data[i++];
+        tdo.push_back( ShiftByte( tms_byte, tdi_byte, false ) );
+    }
+
+    if ( ( flags & GET_TDO_MASK ) && !tdo.empty() )
+        replies.push_back( tdo );
+    if ( clks_left == 0 )
+        mode = IDLE;
+}
+
+
+//
+// Process the TDI bytes of a TDI_CMD or TDI_TDO_CMD.
+//
+void SimXula::LegacyBytes( const uint8_t *data, size_t len, std::vector<Bytes> &replies )
+{
+    Bytes tdo;
+    for ( size_t i = 0; i < len && clks_left != 0; i++ )
+        tdo.push_back( ShiftByte( NULL, &data[i], true ) );
+
+    if ( cmd == TDI_TDO_CMD )
+        replies.push_back( tdo );
+    if ( clks_left == 0 )
+        mode = IDLE;
+}
+
+
+//
+// Clock out all the remaining bits of a command that only gathers TDO bits and return them in full packets.
+//
+void SimXula::TdoOnly( bool exit_on_last, std::vector<Bytes> &replies )
+{
+    static const uint8_t zero = 0;
+    Bytes tdo;
+    while ( clks_left != 0 )
+    {
+        tdo.push_back( ShiftByte( NULL, exit_on_last ? &zero : NULL, exit_on_last ) );
+        if ( tdo.size() == XULA_PACKET_SIZE || clks_left == 0 )
+        {
+            replies.push_back( tdo );
+            tdo.clear();
+        }
+    }
+}
+
+
+bool FillInTransfer( std::deque<Bytes> &in_packets, Bytes &data, size_t max_len, bool &overrun )
+{
+    while ( !in_packets.empty() )
+    {
+        Bytes &pkt = in_packets.front();
+        overrun    = data.size() + pkt.size() > max_len;
+        if ( !overrun )
+            data.insert( data.end(), pkt.begin(), pkt.end() );
+        bool finished = overrun || pkt.size() < XULA_PACKET_SIZE || data.size() == max_len;
+        in_packets.pop_front();
+        if ( finished )
+            return true;
+    }
+    return false;
+}
+
+
+SimTransport::SimTransport( SimXula &device )
+    : device( device ), interrupted( false )
+{
+}
+
+
+bool SimTransport::SubmitOut( const uint8_t *data, size_t len, const Callback &cb )
+{
+    Transfer t;
+    t.data.assign( data, data + len );
+    t.max_len = len;
+    t.cb      = cb;
+    std::lock_guard<std::mutex> guard( lock );
+    outs.push_back( t );
+    wakeup.notify_all();
+    return true;
+}
+
+
+bool SimTransport::SubmitIn( size_t max_len, const Callback &cb )
+{
+    Transfer t;
+    t.max_len = max_len;
+    t.cb      = cb;
+    std::lock_guard<std::mutex> guard( lock );
+    ins.push_back( t );
+    wakeup.notify_all();
+    return true;
+}
+
+
+//
+// Deliver OUT packets to the device and fill IN transfers from the packets it returns.
+// Callbacks are run after the lock is released so they can submit more transfers.
+//
+void SimTransport::HandleEvents( int timeout_ms )
+{
+    struct Done
+    {
+        Transfer       t;
+        TransferStatus status;
+    };
+    std::vector<Done> done;
+
+    {
+        std::unique_lock<std::mutex> guard( lock );
+
+        bool ready = !outs.empty() || ( !ins.empty() && !in_packets.empty() );
+        if ( !ready && !interrupted )
+        {
+            wakeup.wait_for( guard, std::chrono::milliseconds( timeout_ms ) );
+        }
+        interrupted = false;
+
+        while ( !outs.empty() )
+        {
+            Done d;
+            d.t      = outs.front();
+            d.status = TRANSFER_OK;
+            outs.pop_front();
+            std::vector<Bytes> replies;
+            for ( size_t offset = 0; offset < d.t.data.size(); offset += XULA_PACKET_SIZE )
+                device.Receive( &d.t.data[offset], std::min( XULA_PACKET_SIZE, d.t.data.size() - offset ), replies );
+            in_packets.insert( in_packets.end(), replies.begin(), replies.end() );
+            done.push_back( d );
+        }
+
+        while ( !ins.empty() && !in_packets.empty() )
+        {
+            Transfer &t       = ins.front();
+            bool      overrun = false;
+            if ( FillInTransfer( in_packets, t.data, t.max_len, overrun ) )
+            {
+                Done d;
+                d.t      = t;
+                d.status = overrun ? TRANSFER_ERROR : TRANSFER_OK;
+                ins.pop_front();
+                done.push_back( d );
+            }
+        }
+    }
+
+    for ( size_t i = 0; i < done.size(); i++ )
+        done[i].t.cb( done[i].status, done[i].t.data.data(), done[i].t.data.size() );
+}
+
+
+void SimTransport::Interrupt()
+{
+    std::lock_guard<std::mutex> guard( lock );
+    interrupted = true;
+    wakeup.notify_all();
+}
+
+} // namespace xula
@@ -0,0 +1,125 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  A simulated XuLA board. SimXula processes USB packets the same
+//  way ServiceRequests() in fmw/user/user.c does and drives the
+//  resulting TCK pulses into a JtagTarget. SimTransport lets the
+//  XulaJtag class talk to a SimXula instead of a real board.
+//
+//********************************************************************
+
+#ifndef SIM_XULA_H
+#define SIM_XULA_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "UsbTransport.h"
+
+namespace xula
+{
+
+// Whatever is hanging off the JTAG pins of the simulated uC.
+class JtagTarget
+{
+public:
+    virtual ~JtagTarget() {}
+
+    // Return the current TDO level and then apply a rising edge of TCK with the given TMS and TDI levels.
+    // (The firmware samples TDO just before it raises TCK.)
+    virtual bool Clock( bool tms, bool tdi ) = 0;
+
+    // Called when the host changes the level of the FPGA PROGRAM# pin.
+    virtual void SetProg( bool level ) { (void)level; }
+};
+
+// A one-bit register between TDI and TDO, like a device in BYPASS.
+class LoopbackTarget : public JtagTarget
+{
+public:
+    LoopbackTarget() : bit( false ) {}
+    virtual bool Clock( bool tms, bool tdi ) { (void)tms; bool tdo = bit; bit = tdi; return tdo; }
+
+private:
+    bool bit;
+};
+
+class SimXula
+{
+public:
+    explicit SimXula( JtagTarget &target );
+
+    // Process a packet from the host. Any packets the board sends back are appended to replies.
+    void Receive( const uint8_t *pkt, size_t len, std::vector<Bytes> &replies );
+
+private:
+    enum Mode { IDLE, JTAG_DATA, LEGACY_DATA };
+
+    bool Clock( bool tms, bool tdi );
+    void JtagBytes( const uint8_t *data, size_t len, std::vector<Bytes> &replies );
+    void LegacyBytes( const uint8_t *data, size_t len, std::vector<Bytes> &replies );
+    void TdoOnly( bool exit_on_last, std::vector<Bytes> &replies );
+    uint8_t ShiftByte( const uint8_t *tms_byte, const uint8_t *tdi_byte, bool exit_on_last );
+
+    JtagTarget &target;
+    bool        tms;            // Current levels of the JTAG pins.
+    bool        tdi;
+    Mode        mode;           // Set while a multi-packet command is in progress.
+    uint8_t     cmd;            // Command that started the multi-packet sequence.
+    uint8_t     flags;          // JTAG_CMD flags.
+    uint32_t    clks_left;      // TCK pulses still to be sent for the current command.
+    uint8_t     eeprom[256];    // Contents of the uC EEPROM.
+};
+
+// Move packets the device sent into an IN transfer of up to max_len bytes. Returns true when the transfer
+// is finished (short packet, full, or overrun because a packet wouldn't fit).
+bool FillInTransfer( std::deque<Bytes> &in_packets, Bytes &data, size_t max_len, bool &overrun );
+
+// UsbTransport that delivers packets to a SimXula in-process.
+class SimTransport : public UsbTransport
+{
+public:
+    explicit SimTransport( SimXula &device );
+
+    virtual bool SubmitOut( const uint8_t *data, size_t len, const Callback &cb );
+    virtual bool SubmitIn( size_t max_len, const Callback &cb );
+    virtual void HandleEvents( int timeout_ms );
+    virtual void Interrupt();
+
+private:
+    struct Transfer
+    {
+        Bytes    data;
+        size_t   max_len;
+        Callback cb;
+    };
+
+    SimXula                &device;
+    std::mutex              lock;
+    std::condition_variable wakeup;
+    std::deque<Transfer>    outs;           // OUT transfers waiting to be delivered.
+    std::deque<Transfer>    ins;            // IN transfers waiting for data.
+    std::deque<Bytes>       in_packets;     // Packets sent by the device but not yet read.
+    bool                    interrupted;
+};
+
+} // namespace xula
+
+#endif // SIM_XULA_H
@@ -0,0 +1,81 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Abstract interface to the bulk endpoints of a XuLA board. The
+//  XulaJtag class queues transfers through this interface so it can
+//  run against a real board (LibusbTransport) or a simulated one
+//  (SimTransport).
+//
+//********************************************************************
+
+#ifndef USB_TRANSPORT_H
+#define USB_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace xula
+{
+
+// USB identifiers and endpoint layout of the XuLA (see fmw/user/usb_descriptors.c).
+const uint16_t XULA_VID         = 0x04D8;   // Vendor ID (Microchip).
+const uint16_t XULA_PID         = 0xFF8C;   // Product ID: XSUSB Board.
+const uint8_t  XULA_EP_OUT      = 0x01;     // Bulk endpoint for packets from the host.
+const uint8_t  XULA_EP_IN       = 0x81;     // Bulk endpoint for packets to the host.
+const size_t   XULA_PACKET_SIZE = 32;       // Max. packet size of the bulk endpoints (USBGEN_EP_SIZE).
+
+typedef std::vector<uint8_t> Bytes;
+
+// Completion status of a transfer.
+enum TransferStatus
+{
+    TRANSFER_OK = 0,        // Transfer finished normally.
+    TRANSFER_ERROR,         // Transfer failed (stall, timeout, device gone, ...).
+    TRANSFER_CANCELLED      // Transfer was cancelled before it finished.
+};
+
+class UsbTransport
+{
+public:
+    // Called when a transfer finishes. For IN transfers, data/len hold the received bytes.
+    // For OUT transfers, len is the number of bytes actually sent.
+    typedef std::function<void ( TransferStatus status, const uint8_t *data, size_t len )> Callback;
+
+    virtual ~UsbTransport() {}
+
+    // Queue a bulk OUT transfer. The data is copied so the caller's buffer can be reused immediately.
+    // Transfers larger than XULA_PACKET_SIZE are split into max-size packets with a short packet at the end.
+    virtual bool SubmitOut( const uint8_t *data, size_t len, const Callback &cb ) = 0;
+
+    // Queue a bulk IN transfer that completes when max_len bytes or a short packet arrives.
+    virtual bool SubmitIn( size_t max_len, const Callback &cb ) = 0;
+
+    // Run any completed transfer callbacks, waiting up to timeout_ms for something to happen.
+    virtual void HandleEvents( int timeout_ms ) = 0;
+
+    // Wake up a thread that is blocked inside HandleEvents().
+    virtual void Interrupt() = 0;
+};
+
+} // namespace xula
+
+#endif // USB_TRANSPORT_H
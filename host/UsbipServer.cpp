@@ -0,0 +1,472 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  USB/IP server for a SimXula. The descriptors are copies of the
+//  ones in fmw/user/usb_descriptors.c.
+//
+//  All USB/IP fields are big-endian. Once a client imports the
+//  device, the connection carries 48-byte URB headers:
+//
+//      CMD_SUBMIT: command, seqnum, devid, direction, ep,
+//                  transfer_flags, transfer_buffer_length,
+//                  start_frame, number_of_packets, interval, setup[8]
+//                  followed by the OUT data.
+//      RET_SUBMIT: command, seqnum, devid, direction, ep, status,
+//                  actual_length, start_frame, number_of_packets,
+//                  error_count, padding[8] followed by the IN data.
+//      CMD_UNLINK: command, seqnum, devid, direction, ep,
+//                  unlink_seqnum, padding[24].
+//      RET_UNLINK: command, seqnum, devid, direction, ep, status,
+//                  padding[24].
+//
+//********************************************************************
+
+#include <cstring>
+#include <cstdio>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "UsbipServer.h"
+
+namespace xula
+{
+
+#define USBIP_VERSION     0x0111
+#define OP_REQ_DEVLIST    0x8005
+#define OP_REP_DEVLIST    0x0005
+#define OP_REQ_IMPORT     0x8003
+#define OP_REP_IMPORT     0x0003
+#define OP_HDR_LEN        8             // version, code, status.
+#define BUSID_LEN         32
+#define PATH_LEN          256
+
+#define USBIP_CMD_SUBMIT  1
+#define USBIP_CMD_UNLINK  2
+#define USBIP_RET_SUBMIT  3
+#define USBIP_RET_UNLINK  4
+#define URB_HDR_LEN       48
+#define USBIP_DIR_IN      1
+
+#define USB_SPEED_FULL    2
+#define ERR_PIPE          ( -32 )       // Stall.
+#define ERR_OVERFLOW      ( -75 )       // Device sent more than the URB could hold.
+#define ERR_CONNRESET     ( -104 )      // URB was unlinked.
+
+#define BCD_DEVICE        0x0101        // USB_FMW_VERSION in fmw/user/version.h.
+
+static const uint8_t device_dsc[] = {
+    0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x08,
+    XULA_VID & 0xFF, XULA_VID >> 8, XULA_PID & 0xFF, XULA_PID >> 8,
+    BCD_DEVICE & 0xFF, BCD_DEVICE >> 8, 0x01, 0x02, 0x00, 0x01
+};
+
+static const uint8_t config_dsc[] = {
+    0x09, 0x02, 0x20, 0x00, 1, 1, 0, 0x80, 50,                 // Configuration.
+    0x09, 0x04, 0, 0, 2, 0xFF, 0xFF, 0xFF, 0,                  // Vendor-specific interface.
+    0x07, 0x05, XULA_EP_OUT, 0x02, XULA_PACKET_SIZE, 0x00, 1,  // Bulk OUT.
+    0x07, 0x05, XULA_EP_IN, 0x02, XULA_PACKET_SIZE, 0x00, 1    // Bulk IN.
+};
+
+static const char *const strings[] = { "X Engineering Software Systems Corp.", "XuLA - XESS Micro Logic Array" };
+
+
+static void put16( Bytes &b, uint16_t v )
+{
+    b.push_back( v >> 8 );
+    b.push_back( v & 0xFF );
+}
+
+
+static void put32( Bytes &b, uint32_t v )
+{
+    put16( b, v >> 16 );
+    put16( b, v & 0xFFFF );
+}
+
+
+static uint32_t get32( const uint8_t *p )
+{
+    return ( (uint32_t)p[0] << 24 ) | ( (uint32_t)p[1] << 16 ) | ( (uint32_t)p[2] << 8 ) | p[3];
+}
+
+
+static bool recv_all( int sock, uint8_t *buf, size_t len )
+{
+    while ( len )
+    {
+        ssize_t n = recv( sock, buf, len, 0 );
+        if ( n <= 0 )
+            return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+
+static bool send_all( int sock, const Bytes &b )
+{
+    size_t sent = 0;
+    while ( sent < b.size() )
+    {
+        ssize_t n = send( sock, &b[sent], b.size() - sent, MSG_NOSIGNAL );
+        if ( n <= 0 )
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+
+UsbipServer::UsbipServer( SimXula &device, uint16_t port, const std::string &busid )
+    : device( device ), port( port ), busid( busid ), listen_sock( -1 )
+{
+}
+
+
+UsbipServer::~UsbipServer()
+{
+    if ( listen_sock >= 0 )
+        close( listen_sock );
+}
+
+
+bool UsbipServer::Run()
+{
+    listen_sock = socket( AF_INET, SOCK_STREAM, 0 );
+    if ( listen_sock < 0 )
+    {
+        perror( "socket" );
+        return false;
+    }
+    int on = 1;
+    setsockopt( listen_sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) );
+
+    sockaddr_in addr;
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons( port );
+    addr.sin_addr.s_addr = htonl( INADDR_ANY );
+    if ( bind( listen_sock, (sockaddr *)&addr, sizeof( addr ) ) < 0 || listen( listen_sock, 1 ) < 0 )
+    {
+        perror( "bind/listen" );
+        return false;
+    }
+
+    for ( ;; )
+    {
+        int sock = accept( listen_sock, NULL, NULL );
+        if ( sock < 0 )
+        {
+            perror( "accept" );
+            return false;
+        }
+        setsockopt( sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on ) );
+        Serve( sock );
+        close( sock );
+        in_packets.clear();
+        pending_ins.clear();
+    }
+}
+
+
+Bytes UsbipServer::DeviceRecord() const
+{
+    Bytes rec( PATH_LEN + BUSID_LEN, 0 );
+    std::string path = "/sys/devices/platform/xula/" + busid;
+    memcpy( &rec[0], path.c_str(), std::min( path.size(), (size_t)PATH_LEN - 1 ) );
+    memcpy( &rec[PATH_LEN], busid.c_str(), std::min( busid.size(), (size_t)BUSID_LEN - 1 ) );
+    put32( rec, 1 );                    // busnum
+    put32( rec, 1 );                    // devnum
+    put32( rec, USB_SPEED_FULL );
+    put16( rec, XULA_VID );
+    put16( rec, XULA_PID );
+    put16( rec, BCD_DEVICE );
+    rec.push_back( 0 );                 // bDeviceClass
+    rec.push_back( 0 );                 // bDeviceSubClass
+    rec.push_back( 0 );                 // bDeviceProtocol
+    rec.push_back( 1 );                 // bConfigurationValue
+    rec.push_back( 1 );                 // bNumConfigurations
+    rec.push_back( 1 );                 // bNumInterfaces
+    return rec;
+}
+
+
+bool UsbipServer::Serve( int sock )
+{
+    // Device list and import requests come first.
+    uint8_t op[OP_HDR_LEN];
+    if ( !recv_all( sock, op, sizeof( op ) ) )
+        return false;
+    uint16_t code = ( op[2] << 8 ) | op[3];
+    if ( code != OP_REQ_IMPORT )
+        return HandleOp( sock, code );
+    if ( !HandleOp( sock, code ) )
+        return false;
+
+    // The device is imported, so everything from here on is URBs.
+    for ( ;; )
+    {
+        uint8_t hdr[URB_HDR_LEN];
+        if ( !recv_all( sock, hdr, sizeof( hdr ) ) )
+            return true;
+        switch ( get32( hdr ) )
+        {
+            case USBIP_CMD_SUBMIT:
+                if ( !HandleSubmit( sock, hdr ) )
+                    return false;
+                break;
+
+            case USBIP_CMD_UNLINK:
+                if ( !HandleUnlink( sock, hdr ) )
+                    return false;
+                break;
+
+            default:
+                fprintf( stderr, "usbip: unknown command %u\n", get32( hdr ) );
+                return false;
+        }
+    }
+}
+
+
+bool UsbipServer::HandleOp( int sock, uint16_t code )
+{
+    Bytes rep;
+    put16( rep, USBIP_VERSION );
+    switch ( code )
+    {
+        case OP_REQ_DEVLIST:
+        {
+            put16( rep, OP_REP_DEVLIST );
+            put32( rep, 0 );
+            put32( rep, 1 );            // One device.
+            Bytes rec = DeviceRecord();
+            rep.insert( rep.end(), rec.begin(), rec.end() );
+            rep.push_back( 0xFF );      // Interface class, subclass, protocol, padding.
+            rep.push_back( 0xFF );
+            rep.push_back( 0xFF );
+            rep.push_back( 0 );
+            send_all( sock, rep );
+            return false;               // The client closes the connection after a device list.
+        }
+
+        case OP_REQ_IMPORT:
+        {
+            uint8_t req_busid[BUSID_LEN];
+            if ( !recv_all( sock, req_busid, sizeof( req_busid ) ) )
+                return false;
+            req_busid[BUSID_LEN - 1] = 0;
+            bool found = busid == (const char *)req_busid;
+            put16( rep, OP_REP_IMPORT );
+            put32( rep, found ? 0 : 1 );
+            if ( found )
+            {
+                Bytes rec = DeviceRecord();
+                rep.insert( rep.end(), rec.begin(), rec.end() );
+            }
+            return send_all( sock, rep ) && found;
+        }
+
+        default:
+            fprintf( stderr, "usbip: unknown operation 0x%04x\n", code );
+            return false;
+    }
+}
+
+
+bool UsbipServer::HandleSubmit( int sock, const uint8_t *hdr )
+{
+    uint32_t seqnum  = get32( hdr + 4 );
+    bool     dir_in  = get32( hdr + 12 ) == USBIP_DIR_IN;
+    uint32_t ep      = get32( hdr + 16 );
+    uint32_t buf_len = get32( hdr + 24 );
+    Bytes    out;
+    if ( !dir_in )
+    {
+        out.resize( buf_len );
+        if ( buf_len && !recv_all( sock, &out[0], buf_len ) )
+            return false;
+    }
+
+    if ( ep == 0 )
+    {
+        Bytes in;
+        bool  ok = Control( hdr + 40, out, in );
+        if ( in.size() > buf_len )
+            in.resize( buf_len );
+        return SendRetSubmit( sock, seqnum, ok ? 0 : ERR_PIPE, ok ? in : Bytes(), dir_in );
+    }
+
+    if ( ep != ( XULA_EP_OUT & 0x0F ) )
+        return SendRetSubmit( sock, seqnum, ERR_PIPE, Bytes(), dir_in );
+
+    if ( dir_in )
+    {
+        PendingIn p;
+        p.seqnum  = seqnum;
+        p.max_len = buf_len;
+        pending_ins.push_back( p );
+        return FillPendingIns( sock );
+    }
+
+    // The firmware handles each 32-byte packet of a bulk OUT transfer as it arrives.
+    std::vector<Bytes> replies;
+    for ( size_t offset = 0; offset < out.size(); offset += XULA_PACKET_SIZE )
+        device.Receive( &out[offset], std::min( XULA_PACKET_SIZE, out.size() - offset ), replies );
+    in_packets.insert( in_packets.end(), replies.begin(), replies.end() );
+    if ( !SendRetSubmit( sock, seqnum, 0, Bytes( out.size() ), false ) )
+        return false;
+    return FillPendingIns( sock );
+}
+
+
+bool UsbipServer::FillPendingIns( int sock )
+{
+    while ( !pending_ins.empty() && !in_packets.empty() )
+    {
+        PendingIn &p       = pending_ins.front();
+        bool       overrun = false;
+        if ( !FillInTransfer( in_packets, p.data, p.max_len, overrun ) )
+            break;
+        PendingIn done = p;
+        pending_ins.pop_front();
+        if ( !SendRetSubmit( sock, done.seqnum, overrun ? ERR_OVERFLOW : 0, done.data, true ) )
+            return false;
+    }
+    return true;
+}
+
+
+bool UsbipServer::HandleUnlink( int sock, const uint8_t *hdr )
+{
+    uint32_t seqnum        = get32( hdr + 4 );
+    uint32_t unlink_seqnum = get32( hdr + 20 );
+    int32_t  status        = 0;     // Zero means the URB already completed.
+    for ( std::deque<PendingIn>::iterator p = pending_ins.begin(); p != pending_ins.end(); ++p )
+        if ( p->seqnum == unlink_seqnum )
+        {
+            pending_ins.erase( p );
+            status = ERR_CONNRESET;
+            break;
+        }
+
+    Bytes rep;
+    put32( rep, USBIP_RET_UNLINK );
+    put32( rep, seqnum );
+    put32( rep, 0 );
+    put32( rep, 0 );
+    put32( rep, 0 );
+    put32( rep, (uint32_t)status );
+    rep.resize( URB_HDR_LEN, 0 );
+    return send_all( sock, rep );
+}
+
+
+bool UsbipServer::SendRetSubmit( int sock, uint32_t seqnum, int32_t status, const Bytes &data, bool dir_in )
+{
+    Bytes rep;
+    put32( rep, USBIP_RET_SUBMIT );
+    put32( rep, seqnum );
+    put32( rep, 0 );                    // devid, direction and ep aren't used in replies.
+    put32( rep, 0 );
+    put32( rep, 0 );
+    put32( rep, (uint32_t)status );
+    put32( rep, (uint32_t)data.size() );
+    put32( rep, 0 );                    // start_frame
+    put32( rep, 0 );                    // number_of_packets
+    put32( rep, 0 );                    // error_count
+    rep.resize( URB_HDR_LEN, 0 );
+    if ( dir_in )
+        rep.insert( rep.end(), data.begin(), data.end() );
+    return send_all( sock, rep );
+}
+
+
+//
+// Standard requests on the default control pipe. The firmware has no vendor requests, so those stall.
+//
+bool UsbipServer::Control( const uint8_t *setup, const Bytes &out, Bytes &in )
+{
+    (void)out;
+    uint8_t  request_type = setup[0];
+    uint8_t  request      = setup[1];
+    uint16_t value        = setup[2] | ( setup[3] << 8 );
+
+    if ( ( request_type & 0x60 ) != 0 )
+        return false;
+
+    switch ( request )
+    {
+        case 0x00:                      // GET_STATUS
+            in.assign( 2, 0 );
+            return true;
+
+        case 0x01:                      // CLEAR_FEATURE
+        case 0x03:                      // SET_FEATURE
+        case 0x09:                      // SET_CONFIGURATION
+        case 0x0B:                      // SET_INTERFACE
+            return true;
+
+        case 0x08:                      // GET_CONFIGURATION
+            in.assign( 1, 1 );
+            return true;
+
+        case 0x0A:                      // GET_INTERFACE
+            in.assign( 1, 0 );
+            return true;
+
+        case 0x06:                      // GET_DESCRIPTOR
+        {
+            uint8_t type  = value >> 8;
+            uint8_t index = value & 0xFF;
+            if ( type == 0x01 )
+                in.assign( device_dsc, device_dsc + sizeof( device_dsc ) );
+            else if ( type == 0x02 )
+                in.assign( config_dsc, config_dsc + sizeof( config_dsc ) );
+            else if ( type == 0x03 && index == 0 )
+            {
+                static const uint8_t lang[] = { 4, 0x03, 0x09, 0x04 };
+                in.assign( lang, lang + sizeof( lang ) );
+            }
+            else if ( type == 0x03 && index <= sizeof( strings ) / sizeof( strings[0] ) )
+            {
+                const char *s = strings[index - 1];
+                in.push_back( (uint8_t)( 2 + 2 * strlen( s ) ) );
+                in.push_back( 0x03 );
+                for ( ; *s; s++ )
+                {
+                    in.push_back( *s );
+                    in.push_back( 0 );
+                }
+            }
+            else
+                return false;
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+} // namespace xula
@@ -0,0 +1,80 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Exports a SimXula as a USB device over the USB/IP protocol so the
+//  Linux vhci-hcd driver can attach it. The simulated board then
+//  shows up with the same VID/PID and descriptors as a real XuLA and
+//  unmodified libusb programs can talk to it:
+//
+//      modprobe vhci-hcd
+//      usbip attach -r localhost -b 1-1
+//
+//********************************************************************
+
+#ifndef USBIP_SERVER_H
+#define USBIP_SERVER_H
+
+#include <deque>
+#include <string>
+#include "SimXula.h"
+
+namespace xula
+{
+
+const uint16_t USBIP_PORT = 3240;       // Standard USB/IP TCP port.
+
+class UsbipServer
+{
+public:
+    UsbipServer( SimXula &device, uint16_t port = USBIP_PORT, const std::string &busid = "1-1" );
+    ~UsbipServer();
+
+    // Accept connections and serve them one at a time. Only returns if the listening socket fails.
+    bool Run();
+
+private:
+    // A bulk IN request waiting for the device to send something.
+    struct PendingIn
+    {
+        uint32_t seqnum;
+        size_t   max_len;
+        Bytes    data;
+    };
+
+    bool Serve( int sock );                     // Returns after the client disconnects.
+    bool HandleOp( int sock, uint16_t code );   // Device list and import requests.
+    bool HandleSubmit( int sock, const uint8_t *hdr );
+    bool HandleUnlink( int sock, const uint8_t *hdr );
+    bool Control( const uint8_t *setup, const Bytes &out, Bytes &in );
+    bool FillPendingIns( int sock );
+    bool SendRetSubmit( int sock, uint32_t seqnum, int32_t status, const Bytes &data, bool dir_in );
+    Bytes DeviceRecord() const;
+
+    SimXula              &device;
+    uint16_t              port;
+    std::string           busid;
+    int                   listen_sock;
+    std::deque<Bytes>     in_packets;       // Packets sent by the device but not yet read.
+    std::deque<PendingIn> pending_ins;
+};
+
+} // namespace xula
+
+#endif // USBIP_SERVER_H
@@ -0,0 +1,401 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Host-side driver for the USBCMD protocol spoken by the XuLA
+//  firmware (fmw/user/user.c).
+//
+//********************************************************************
+
+#include <algorithm>
+#include <stdexcept>
+#include "XulaJtag.h"
+
+namespace xula
+{
+
+#define EVENT_TIMEOUT_MS 100            // Max. time the event thread sleeps before checking for shutdown.
+#define LEGACY_HDR_LEN   5              // Command byte + 4-byte # of TCK pulses for TDI/TDO commands.
+
+
+// Store a 32-bit value into a packet in the little-endian order the PIC uses.
+static void put_dword( Bytes &pkt, uint32_t v )
+{
+    pkt.push_back( (uint8_t)( v ) );
+    pkt.push_back( (uint8_t)( v >> 8 ) );
+    pkt.push_back( (uint8_t)( v >> 16 ) );
+    pkt.push_back( (uint8_t)( v >> 24 ) );
+}
+
+
+//
+// Compute the sizes of the packets of TDO bytes the firmware returns for a JTAG_CMD.
+// This mirrors the packet loop in ServiceRequests(): each OUT packet of TMS/TDI bytes
+// produces one IN packet of TDO bytes. The first OUT packet also carries the command
+// header, so it holds fewer data bytes.
+//
+static std::vector<size_t> jtag_tdo_packets( uint32_t num_clks, uint8_t flags )
+{
+    std::vector<size_t> pkts;
+    if ( !( flags & GET_TDO_MASK ) )
+        return pkts;
+
+    bool   both      = ( flags & PUT_TMS_MASK ) && ( flags & PUT_TDI_MASK );
+    size_t num_bytes = ( ( num_clks + 7 ) / 8 ) * ( both ? 2 : 1 );
+    size_t pkt_len   = ( flags & ( PUT_TMS_MASK | PUT_TDI_MASK ) ) ? XULA_PACKET_SIZE - JTAG_CMD_HDR_LEN : XULA_PACKET_SIZE;
+    while ( num_bytes > pkt_len )
+    {
+        num_bytes -= pkt_len;
+        pkts.push_back( both ? pkt_len / 2 : pkt_len );
+        pkt_len    = XULA_PACKET_SIZE;
+    }
+    pkts.push_back( both ? num_bytes / 2 : num_bytes );
+    return pkts;
+}
+
+
+//
+// Compute the sizes of the packets of TDO bytes returned for TDI_TDO_CMD and TDO_CMD.
+// The TDI bits (if any) arrive in packets that follow the command packet.
+//
+static std::vector<size_t> legacy_tdo_packets( uint32_t num_clks )
+{
+    std::vector<size_t> pkts;
+    size_t num_bytes = ( num_clks + 7 ) / 8;
+    for ( ; num_bytes > XULA_PACKET_SIZE; num_bytes -= XULA_PACKET_SIZE )
+        pkts.push_back( XULA_PACKET_SIZE );
+    pkts.push_back( num_bytes );
+    return pkts;
+}
+
+
+XulaJtag::XulaJtag( UsbTransport &transport, const Options &options )
+    : transport( transport ),
+      options( options ),
+      outs_in_flight( 0 ),
+      ins_in_flight( 0 ),
+      cmds_pending( 0 ),
+      stop( false )
+{
+    // Bulk transfers have to hold whole packets or else a command stream would be split mid-packet.
+    this->options.max_transfer_size -= this->options.max_transfer_size % XULA_PACKET_SIZE;
+    this->options.max_transfer_size  = std::max( this->options.max_transfer_size, XULA_PACKET_SIZE );
+    this->options.max_out_transfers  = std::max( this->options.max_out_transfers, (size_t)1 );
+    this->options.max_in_transfers   = std::max( this->options.max_in_transfers, (size_t)1 );
+    event_thread = std::thread( &XulaJtag::EventLoop, this );
+}
+
+
+XulaJtag::~XulaJtag()
+{
+    Flush();
+    {
+        std::lock_guard<std::mutex> guard( lock );
+        stop = true;
+    }
+    transport.Interrupt();
+    event_thread.join();
+}
+
+
+std::future<Bytes> XulaJtag::Jtag( uint32_t num_clks, const uint8_t *tms, bool tms_val, const uint8_t *tdi,
+                                   bool tdi_val, bool get_tdo )
+{
+    // The firmware doesn't answer a JTAG_CMD with no clocks, so don't send one.
+    if ( num_clks == 0 )
+    {
+        std::promise<Bytes> none;
+        none.set_value( Bytes() );
+        return none.get_future();
+    }
+
+    // The firmware never finishes a JTAG_CMD that neither sends nor receives bits, so gather TDO in that case.
+    if ( tms == NULL && tdi == NULL )
+        get_tdo = true;
+
+    uint8_t flags = 0;
+    if ( get_tdo )
+        flags |= GET_TDO_MASK;
+    if ( tms != NULL )
+        flags |= PUT_TMS_MASK;
+    else if ( tms_val )
+        flags |= TMS_VAL_MASK;
+    if ( tdi != NULL )
+        flags |= PUT_TDI_MASK;
+    else if ( tdi_val )
+        flags |= TDI_VAL_MASK;
+
+    // Command header followed by the TMS and/or TDI bytes. When both are sent, they're interleaved a byte at a time.
+    Bytes stream;
+    stream.push_back( JTAG_CMD );
+    put_dword( stream, num_clks );
+    stream.push_back( flags );
+    size_t num_bytes = ( num_clks + 7 ) / 8;
+    for ( size_t i = 0; i < num_bytes; i++ )
+    {
+        if ( tms != NULL )
+            stream.push_back( tms[i] );
+        if ( tdi != NULL )
+            stream.push_back( tdi[i] );
+    }
+
+    return Queue( std::vector<Bytes>( 1, stream ), jtag_tdo_packets( num_clks, flags ) );
+}
+
+
+std::future<Bytes> XulaJtag::ShiftTms( const Bytes &tms, uint32_t num_bits )
+{
+    return Jtag( num_bits, tms.data(), false, NULL, false, false );
+}
+
+
+std::future<Bytes> XulaJtag::ShiftTdi( const Bytes &tdi, uint32_t num_bits, bool get_tdo )
+{
+    return Jtag( num_bits, NULL, false, tdi.data(), false, get_tdo );
+}
+
+
+std::future<Bytes> XulaJtag::ReadTdo( uint32_t num_bits, bool tdi_val )
+{
+    return Jtag( num_bits, NULL, false, NULL, tdi_val, true );
+}
+
+
+std::future<Bytes> XulaJtag::TdiTdo( USBCMD cmd, const Bytes &tdi, uint32_t num_bits )
+{
+    // The command goes in a packet by itself and the TDI bits stream in the packets after it.
+    std::vector<Bytes> segments( 1 );
+    segments[0].push_back( (uint8_t)cmd );
+    put_dword( segments[0], num_bits );
+    if ( cmd == TDI_CMD || cmd == TDI_TDO_CMD )
+        segments.push_back( Bytes( tdi.begin(), tdi.begin() + std::min( tdi.size(), (size_t)( num_bits + 7 ) / 8 ) ) );
+
+    std::vector<size_t> in_packets;
+    if ( cmd == TDI_TDO_CMD || cmd == TDO_CMD )
+        in_packets = legacy_tdo_packets( num_bits );
+    return Queue( segments, in_packets );
+}
+
+
+std::future<Bytes> XulaJtag::Info()
+{
+    return Command( Bytes( 1, INFO_CMD ), XULA_PACKET_SIZE );
+}
+
+
+std::future<Bytes> XulaJtag::RunTest( uint32_t num_tck_pulses )
+{
+    Bytes pkt( 1, RUNTEST_CMD );
+    put_dword( pkt, num_tck_pulses );
+    return Command( pkt, LEGACY_HDR_LEN );     // The command is echoed back once the pulses are done.
+}
+
+
+std::future<Bytes> XulaJtag::SetProg( bool level )
+{
+    Bytes pkt( 1, PROG_CMD );
+    pkt.push_back( level ? 1 : 0 );
+    return Command( pkt, 0 );
+}
+
+
+std::future<Bytes> XulaJtag::FlashOnOff( bool on )
+{
+    Bytes pkt( 1, FLASH_ONOFF_CMD );
+    pkt.push_back( on ? 1 : 0 );
+    return Command( pkt, 2 );
+}
+
+
+std::future<Bytes> XulaJtag::Command( const Bytes &packet, size_t reply_len )
+{
+    std::vector<size_t> in_packets;
+    if ( reply_len != 0 )
+        in_packets.push_back( reply_len );
+    return Queue( std::vector<Bytes>( 1, packet ), in_packets );
+}
+
+
+void XulaJtag::Flush()
+{
+    std::unique_lock<std::mutex> guard( lock );
+    while ( cmds_pending != 0 )
+        idle.wait( guard );
+}
+
+
+//
+// Break a command into bulk transfers and queue them.
+// Each segment must start on a packet boundary, so segments are never merged.
+// IN transfers gather runs of full-size packets and end at the first short packet
+// because a short packet always terminates a bulk transfer.
+//
+std::future<Bytes> XulaJtag::Queue( const std::vector<Bytes> &segments, const std::vector<size_t> &in_packets )
+{
+    CmdPtr cmd( new Cmd );
+    cmd->out_pending = 0;
+    cmd->in_pending  = 0;
+    cmd->failed      = false;
+    std::future<Bytes> result = cmd->promise.get_future();
+
+    std::lock_guard<std::mutex> guard( lock );
+
+    for ( size_t s = 0; s < segments.size(); s++ )
+    {
+        const Bytes &seg = segments[s];
+        for ( size_t offset = 0; offset < seg.size(); offset += options.max_transfer_size )
+        {
+            OutChunk chunk;
+            chunk.cmd  = cmd;
+            chunk.data.assign( seg.begin() + offset,
+                               seg.begin() + std::min( seg.size(), offset + options.max_transfer_size ) );
+            out_queue.push_back( chunk );
+            cmd->out_pending++;
+        }
+    }
+
+    size_t reply_len = 0;
+    InChunk chunk;
+    chunk.cmd    = cmd;
+    chunk.offset = 0;
+    chunk.len    = 0;
+    for ( size_t p = 0; p < in_packets.size(); p++ )
+    {
+        chunk.len += in_packets[p];
+        reply_len += in_packets[p];
+        if ( in_packets[p] < XULA_PACKET_SIZE || chunk.len + XULA_PACKET_SIZE > options.max_transfer_size
+             || p == in_packets.size() - 1 )
+        {
+            in_queue.push_back( chunk );
+            cmd->in_pending++;
+            chunk.offset += chunk.len;
+            chunk.len     = 0;
+        }
+    }
+    cmd->reply.resize( reply_len );
+
+    cmds_pending++;
+    if ( cmd->out_pending == 0 && cmd->in_pending == 0 )
+        Finish( cmd );
+    Pump();
+    return result;
+}
+
+
+void XulaJtag::Pump()
+{
+    while ( outs_in_flight < options.max_out_transfers && !out_queue.empty() )
+    {
+        OutChunk chunk = out_queue.front();
+        out_queue.pop_front();
+        CmdPtr   cmd   = chunk.cmd;
+        outs_in_flight++;
+        if ( !transport.SubmitOut( chunk.data.data(), chunk.data.size(),
+                                   [this, cmd] ( TransferStatus status, const uint8_t *, size_t )
+                                   {
+                                       OutDone( cmd, status );
+                                   } ) )
+        {
+            outs_in_flight--;
+            Fail( cmd, "USB OUT transfer could not be submitted" );
+            if ( --cmd->out_pending == 0 && cmd->in_pending == 0 )
+                Finish( cmd );
+        }
+    }
+
+    while ( ins_in_flight < options.max_in_transfers && !in_queue.empty() )
+    {
+        InChunk chunk = in_queue.front();
+        in_queue.pop_front();
+        ins_in_flight++;
+        if ( !transport.SubmitIn( chunk.len,
+                                  [this, chunk] ( TransferStatus status, const uint8_t *data, size_t len )
+                                  {
+                                      InDone( chunk, status, data, len );
+                                  } ) )
+        {
+            ins_in_flight--;
+            Fail( chunk.cmd, "USB IN transfer could not be submitted" );
+            if ( --chunk.cmd->in_pending == 0 && chunk.cmd->out_pending == 0 )
+                Finish( chunk.cmd );
+        }
+    }
+}
+
+
+void XulaJtag::OutDone( const CmdPtr &cmd, TransferStatus status )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    outs_in_flight--;
+    if ( status != TRANSFER_OK )
+        Fail( cmd, "USB OUT transfer failed" );
+    if ( --cmd->out_pending == 0 && cmd->in_pending == 0 )
+        Finish( cmd );
+    Pump();
+}
+
+
+void XulaJtag::InDone( const InChunk &chunk, TransferStatus status, const uint8_t *data, size_t len )
+{
+    std::lock_guard<std::mutex> guard( lock );
+    ins_in_flight--;
+    if ( status != TRANSFER_OK )
+        Fail( chunk.cmd, "USB IN transfer failed" );
+    else if ( len != chunk.len )
+        Fail( chunk.cmd, "USB IN transfer returned the wrong number of bytes" );
+    else
+        std::copy( data, data + len, chunk.cmd->reply.begin() + chunk.offset );
+    if ( --chunk.cmd->in_pending == 0 && chunk.cmd->out_pending == 0 )
+        Finish( chunk.cmd );
+    Pump();
+}
+
+
+void XulaJtag::Finish( const CmdPtr &cmd )
+{
+    if ( !cmd->failed )
+        cmd->promise.set_value( cmd->reply );
+    if ( --cmds_pending == 0 )
+        idle.notify_all();
+}
+
+
+void XulaJtag::Fail( const CmdPtr &cmd, const char *why )
+{
+    if ( cmd->failed )
+        return;
+    cmd->failed = true;
+    cmd->promise.set_exception( std::make_exception_ptr( std::runtime_error( why ) ) );
+}
+
+
+void XulaJtag::EventLoop()
+{
+    for ( ;; )
+    {
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            if ( stop )
+                break;
+        }
+        transport.HandleEvents( EVENT_TIMEOUT_MS );
+    }
+}
+
+} // namespace xula
@@ -0,0 +1,141 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Host-side driver for the USBCMD protocol spoken by the XuLA
+//  firmware (fmw/user/user.c). Commands are framed into packets,
+//  queued, and streamed to the board with several OUT and IN
+//  transfers kept in flight. Each command returns a future that
+//  holds the bytes the board sends back (e.g., TDO bits).
+//
+//  Bit streams (TMS, TDI, TDO) are packed eight bits per byte,
+//  first bit in the LSB of the first byte, just as the firmware
+//  expects them.
+//
+//********************************************************************
+
+#ifndef XULA_JTAG_H
+#define XULA_JTAG_H
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "UsbTransport.h"
+
+extern "C" {
+#include "../fmw/user/usbcmd.h"
+}
+
+namespace xula
+{
+
+class XulaJtag
+{
+public:
+    struct Options
+    {
+        size_t max_out_transfers;   // Max. # of OUT transfers in flight.
+        size_t max_in_transfers;    // Max. # of IN transfers in flight.
+        size_t max_transfer_size;   // Max. # of bytes in a single bulk transfer (rounded down to a packet multiple).
+
+        Options() : max_out_transfers( 4 ), max_in_transfers( 4 ), max_transfer_size( 4096 ) {}
+    };
+
+    explicit XulaJtag( UsbTransport &transport, const Options &options = Options() );
+    ~XulaJtag();    // Waits for all queued commands to finish.
+
+    // Send num_clks TCK pulses with a JTAG_CMD. If tms (tdi) is NULL, TMS (TDI) is held at tms_val (tdi_val);
+    // otherwise it points to num_clks bits. If get_tdo is true, the future holds (num_clks + 7) / 8 bytes of TDO bits.
+    // With num_clks = 0 nothing is sent and the future is ready and empty.
+    std::future<Bytes> Jtag( uint32_t num_clks, const uint8_t *tms, bool tms_val, const uint8_t *tdi, bool tdi_val,
+                             bool get_tdo );
+
+    // Common JTAG_CMD variants.
+    std::future<Bytes> ShiftTms( const Bytes &tms, uint32_t num_bits );                 // TDI held low.
+    std::future<Bytes> ShiftTdi( const Bytes &tdi, uint32_t num_bits, bool get_tdo );   // TMS held low.
+    std::future<Bytes> ReadTdo( uint32_t num_bits, bool tdi_val = false );              // TMS held low.
+
+    // Older TDI_CMD, TDI_TDO_CMD and TDO_CMD shifts that raise TMS on the last bit to exit Shift-DR/IR.
+    std::future<Bytes> TdiTdo( USBCMD cmd, const Bytes &tdi, uint32_t num_bits );
+
+    // Single-packet commands. The future holds the reply packet (empty if the command has no reply).
+    std::future<Bytes> Info();
+    std::future<Bytes> RunTest( uint32_t num_tck_pulses );
+    std::future<Bytes> SetProg( bool level );
+    std::future<Bytes> FlashOnOff( bool on );
+    std::future<Bytes> Command( const Bytes &packet, size_t reply_len );
+
+    // Block until every queued command has finished.
+    void Flush();
+
+private:
+    XulaJtag( const XulaJtag & );
+    XulaJtag &operator=( const XulaJtag & );
+
+    // A command that has been queued but hasn't finished yet.
+    struct Cmd
+    {
+        std::promise<Bytes> promise;
+        Bytes  reply;           // Bytes returned by the board.
+        size_t out_pending;     // # of OUT transfers not yet completed.
+        size_t in_pending;      // # of IN transfers not yet completed.
+        bool   failed;          // Set once the promise holds an exception.
+    };
+    typedef std::shared_ptr<Cmd> CmdPtr;
+
+    struct OutChunk
+    {
+        CmdPtr cmd;
+        Bytes  data;
+    };
+
+    struct InChunk
+    {
+        CmdPtr cmd;
+        size_t offset;          // Where the received bytes go in the reply.
+        size_t len;             // # of bytes expected.
+    };
+
+    std::future<Bytes> Queue( const std::vector<Bytes> &segments, const std::vector<size_t> &in_packets );
+    void Pump();                // Submit queued transfers while the in-flight limits allow. Call with lock held.
+    void OutDone( const CmdPtr &cmd, TransferStatus status );
+    void InDone( const InChunk &chunk, TransferStatus status, const uint8_t *data, size_t len );
+    void Finish( const CmdPtr &cmd );
+    void Fail( const CmdPtr &cmd, const char *why );
+    void EventLoop();
+
+    UsbTransport           &transport;
+    Options                 options;
+    std::mutex              lock;
+    std::condition_variable idle;
+    std::deque<OutChunk>    out_queue;      // OUT transfers waiting to be submitted.
+    std::deque<InChunk>     in_queue;       // IN transfers waiting to be submitted.
+    size_t                  outs_in_flight;
+    size_t                  ins_in_flight;
+    size_t                  cmds_pending;   // # of commands queued but not finished.
+    bool                    stop;
+    std::thread             event_thread;
+};
+
+} // namespace xula
+
+#endif // XULA_JTAG_H
@@ -0,0 +1,152 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Measures the command latency and HostIoToRam throughput of a XuLA.
+//
+//      xula_bench [--sim] [--id N] [--words N] [--reps N]
+//
+//  Without --sim, the first XuLA found by libusb is used (either a
+//  real board or one attached through xula_usbip). With --sim, the
+//  board is simulated in-process so the numbers show the overhead of
+//  the host code alone.
+//
+//********************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "HostIo.h"
+#include "SimFpga.h"
+
+#ifndef XULA_BENCH_NO_LIBUSB
+#include "LibusbTransport.h"
+#endif
+
+using namespace xula;
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since( Clock::time_point start )
+{
+    return std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+
+static int bench( XulaJtag &jtag, uint8_t id, size_t num_words, int reps )
+{
+    // Round-trip latency of a single command and reply.
+    Clock::time_point start = Clock::now();
+    for ( int i = 0; i < reps; i++ )
+        jtag.Info().get();
+    printf( "INFO round trip:  %8.1f us\n", seconds_since( start ) / reps * 1e6 );
+
+    HostIoJtag host_io( jtag );
+    HostIoRam  ram( host_io, id );
+    if ( !ram.GetSize() )
+    {
+        fprintf( stderr, "No HostIoToRam module with ID %u.\n", id );
+        return 1;
+    }
+    size_t bytes_per_word = ( ram.DataWidth() + 7 ) / 8;
+    printf( "HostIoToRam %u:   %u-bit address, %u-bit data\n", id, ram.AddrWidth(), ram.DataWidth() );
+
+    std::vector<uint32_t> wr( num_words );
+    for ( size_t i = 0; i < num_words; i++ )
+        wr[i] = (uint32_t)( rand() & ( ( 1ULL << ram.DataWidth() ) - 1 ) );
+
+    start = Clock::now();
+    for ( int i = 0; i < reps; i++ )
+        ram.Write( 0, wr );
+    if ( !ram.WaitWritesDrained( 2000 ) )     // Wait for any posted writes to reach the memory.
+    {
+        fprintf( stderr, "The posted writes didn't drain within 2 seconds.\n" );
+        return 1;
+    }
+    double wr_secs = seconds_since( start );
+
+    std::vector<uint32_t> rd;
+    start = Clock::now();
+    for ( int i = 0; i < reps; i++ )
+        rd = ram.Read( 0, num_words );
+    double rd_secs = seconds_since( start );
+
+    double mbytes = (double)num_words * bytes_per_word * reps / 1e6;
+    printf( "RAM write:        %8.3f MB/s\n", mbytes / wr_secs );
+    printf( "RAM read:         %8.3f MB/s\n", mbytes / rd_secs );
+
+    size_t errors = 0;
+    for ( size_t i = 0; i < num_words; i++ )
+        errors += rd[i] != wr[i];
+    printf( "Verify:           %s (%zu errors)\n", errors ? "FAILED" : "passed", errors );
+    return errors ? 1 : 0;
+}
+
+
+int main( int argc, char **argv )
+{
+    bool   sim       = false;
+    int    id        = 255;
+    size_t num_words = 65536;
+    int    reps      = 4;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( !strcmp( argv[i], "--sim" ) )
+            sim = true;
+        else if ( !strcmp( argv[i], "--id" ) && i + 1 < argc )
+            id = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "--words" ) && i + 1 < argc )
+            num_words = strtoul( argv[++i], NULL, 0 );
+        else if ( !strcmp( argv[i], "--reps" ) && i + 1 < argc )
+            reps = atoi( argv[++i] );
+        else
+        {
+            fprintf( stderr, "Usage: %s [--sim] [--id N] [--words N] [--reps N]\n", argv[0] );
+            return 2;
+        }
+    }
+
+    if ( sim )
+    {
+        SimHostIoToRam sdram( 255, 24, 16 );
+        SimFpga        fpga( XC3S200A_IDCODE );
+        fpga.AddHostIo( &sdram );
+        SimXula        board( fpga );
+        SimTransport   transport( board );
+        XulaJtag       jtag( transport );
+        return bench( jtag, (uint8_t)id, num_words, reps );
+    }
+
+#ifndef XULA_BENCH_NO_LIBUSB
+    LibusbTransport transport;
+    if ( !transport.IsOpen() )
+    {
+        fprintf( stderr, "No XuLA found.\n" );
+        return 1;
+    }
+    XulaJtag jtag( transport );
+    return bench( jtag, (uint8_t)id, num_words, reps );
+#else
+    fprintf( stderr, "Built without libusb, so only --sim is available.\n" );
+    return 1;
+#endif
+}
@@ -0,0 +1,206 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Watches the performance counters of an SdramCntl through the
+//  HostIoToSdramPerf module in FPGA/XuLA_lib/HostIoToSdramPerf.vhd
+//  and prints their rates while a workload runs in the FPGA.
+//
+//      xula_sdram_perf [--sim] [--id N] [--interval SECS] [--count N] [--clear]
+//
+//  The counters are 32 bits wide, so the interval has to be short
+//  enough that the cycle counters don't wrap more than once (about
+//  40 seconds at 100 MHz). With --clear the counters are zeroed
+//  before the first reading. With --sim the board and a synthetic
+//  workload are simulated in-process.
+//
+//********************************************************************
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "HostIo.h"
+#include "SimFpga.h"
+
+#ifndef XULA_BENCH_NO_LIBUSB
+#include "LibusbTransport.h"
+#endif
+
+using namespace xula;
+
+typedef std::chrono::steady_clock Clock;
+
+// Counter addresses (same as the counter indices in SdramCntlPckg).
+#define ROW_HITS          0
+#define ROW_MISSES        1
+#define BANK_CONFLICTS    2
+#define RFSH_STALLS       3
+#define IDLE_CYCLES       4
+#define BUSY_CYCLES       5
+#define RD_PIPE_OCCUPANCY 6
+#define NUM_PERF_CNTRS    7
+
+
+// Counters of a simulated 100 MHz SdramCntl running a steady mix of reads and writes.
+class SimSdramPerf : public SimHostIoToRam
+{
+public:
+    SimSdramPerf( uint8_t id )
+        : SimHostIoToRam( id, 3, 32 ), cleared( Clock::now() )
+    {
+    }
+
+protected:
+    virtual uint32_t MemRead( uint32_t addr )
+    {
+        double cycles = std::chrono::duration<double>( Clock::now() - cleared ).count() * 100e6;
+        double busy   = cycles * 0.6;
+        switch ( addr )
+        {
+        case ROW_HITS:          return (uint32_t)(uint64_t)( busy * 0.25 );
+        case ROW_MISSES:        return (uint32_t)(uint64_t)( busy * 0.03 );
+        case BANK_CONFLICTS:    return (uint32_t)(uint64_t)( busy * 0.01 );
+        case RFSH_STALLS:       return (uint32_t)(uint64_t)( busy * 0.005 );
+        case IDLE_CYCLES:       return (uint32_t)(uint64_t)( cycles - busy );
+        case BUSY_CYCLES:       return (uint32_t)(uint64_t)busy;
+        case RD_PIPE_OCCUPANCY: return (uint32_t)(uint64_t)( busy * 0.8 );
+        default:                return 0;
+        }
+    }
+
+    virtual void MemWrite( uint32_t, uint32_t )
+    {
+        cleared = Clock::now();
+    }
+
+private:
+    Clock::time_point cleared;
+};
+
+
+static int monitor( XulaJtag &jtag, uint8_t id, double interval, int count, bool clear )
+{
+    HostIoJtag host_io( jtag );
+    HostIoRam  perf( host_io, id );
+    if ( !perf.GetSize() || perf.DataWidth() != 32 )
+    {
+        fprintf( stderr, "No HostIoToSdramPerf module with ID %u.\n", id );
+        return 1;
+    }
+
+    if ( clear )
+        perf.Write( 0, std::vector<uint32_t>( 1, 0 ) );     // Any write clears the counters.
+
+    // Reading from address 0 snapshots all the counters so they're consistent with each other.
+    std::vector<uint32_t> prev      = perf.Read( 0, NUM_PERF_CNTRS );
+    Clock::time_point     prev_time = Clock::now();
+
+    printf( "%12s %12s %12s %7s %8s %7s %7s %8s\n",
+            "hits/s", "misses/s", "conflicts/s", "hit %", "stall %", "idle %", "busy %", "rd pipe" );
+    for ( int n = 0; count == 0 || n < count; n++ )
+    {
+        std::this_thread::sleep_for( std::chrono::duration<double>( interval ) );
+        std::vector<uint32_t> cur      = perf.Read( 0, NUM_PERF_CNTRS );
+        Clock::time_point     cur_time = Clock::now();
+        double                secs     = std::chrono::duration<double>( cur_time - prev_time ).count();
+
+        // Unsigned differences are correct across a single wrap of a counter.
+        double delta[NUM_PERF_CNTRS];
+        for ( int i = 0; i < NUM_PERF_CNTRS; i++ )
+            delta[i] = (double)(uint32_t)( cur[i] - prev[i] );
+        double cycles   = delta[IDLE_CYCLES] + delta[BUSY_CYCLES];
+        double accesses = delta[ROW_HITS] + delta[ROW_MISSES];
+
+        printf( "%12.0f %12.0f %12.0f %7.1f %8.2f %7.1f %7.1f %8.3f\n",
+                delta[ROW_HITS] / secs,
+                delta[ROW_MISSES] / secs,
+                delta[BANK_CONFLICTS] / secs,
+                accesses ? 100.0 * delta[ROW_HITS] / accesses : 0.0,
+                cycles ? 100.0 * delta[RFSH_STALLS] / cycles : 0.0,
+                cycles ? 100.0 * delta[IDLE_CYCLES] / cycles : 0.0,
+                cycles ? 100.0 * delta[BUSY_CYCLES] / cycles : 0.0,
+                cycles ? delta[RD_PIPE_OCCUPANCY] / cycles : 0.0 );     // Average # of reads in flight.
+        fflush( stdout );
+
+        prev      = cur;
+        prev_time = cur_time;
+    }
+    return 0;
+}
+
+
+int main( int argc, char **argv )
+{
+    bool   sim      = false;
+    int    id       = 254;
+    double interval = 1.0;
+    int    count    = 0;
+    bool   clear    = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( !strcmp( argv[i], "--sim" ) )
+            sim = true;
+        else if ( !strcmp( argv[i], "--id" ) && i + 1 < argc )
+            id = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "--interval" ) && i + 1 < argc )
+            interval = atof( argv[++i] );
+        else if ( !strcmp( argv[i], "--count" ) && i + 1 < argc )
+            count = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "--clear" ) )
+            clear = true;
+        else
+        {
+            fprintf( stderr, "Usage: %s [--sim] [--id N] [--interval SECS] [--count N] [--clear]\n", argv[0] );
+            return 2;
+        }
+    }
+    if ( interval <= 0.0 )
+    {
+        fprintf( stderr, "The interval must be positive.\n" );
+        return 2;
+    }
+
+    if ( sim )
+    {
+        SimSdramPerf perf( (uint8_t)id );
+        SimFpga      fpga( XC3S200A_IDCODE );
+        fpga.AddHostIo( &perf );
+        SimXula      board( fpga );
+        SimTransport transport( board );
+        XulaJtag     jtag( transport );
+        return monitor( jtag, (uint8_t)id, interval, count, clear );
+    }
+
+#ifndef XULA_BENCH_NO_LIBUSB
+    LibusbTransport transport;
+    if ( !transport.IsOpen() )
+    {
+        fprintf( stderr, "No XuLA found.\n" );
+        return 1;
+    }
+    XulaJtag jtag( transport );
+    return monitor( jtag, (uint8_t)id, interval, count, clear );
+#else
+    fprintf( stderr, "Built without libusb, so only --sim is available.\n" );
+    return 1;
+#endif
+}
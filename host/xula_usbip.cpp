@@ -0,0 +1,50 @@
+//*********************************************************************
+// Copyright (C) 2013 Dave Vanden Bout / XESS Corp. / www.xess.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+//
+//====================================================================
+//
+// Module Description:
+//  Serves a virtual XuLA-200 over USB/IP. The simulated FPGA has a
+//  HostIoToRam module (ID 255, 24-bit address, 16-bit data) on USER1
+//  that looks like the SDRAM in the XuLA SDRAM test designs.
+//
+//      xula_usbip [port]
+//      sudo modprobe vhci-hcd
+//      sudo usbip attach -r localhost -b 1-1
+//
+//********************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include "SimFpga.h"
+#include "UsbipServer.h"
+
+using namespace xula;
+
+int main( int argc, char **argv )
+{
+    uint16_t port = argc > 1 ? (uint16_t)atoi( argv[1] ) : USBIP_PORT;
+
+    SimHostIoToRam sdram( 255, 24, 16 );
+    SimFpga        fpga( XC3S200A_IDCODE );
+    fpga.AddHostIo( &sdram );
+    SimXula        board( fpga );
+    UsbipServer    server( board, port );
+
+    printf( "Serving a virtual XuLA on port %u (bus ID 1-1).\n", port );
+    return server.Run() ? 0 : 1;
+}